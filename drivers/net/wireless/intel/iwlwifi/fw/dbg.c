@@ -2810,31 +2810,73 @@ static void iwl_fw_error_dump_data_free(struct iwl_fwrt_dump_data *dump_data)
 	dump_data->fw_pkt = NULL;
 }
 
+/*
+ * The collected ini dump is handed to devcoredump as the list of dump
+ * TLVs and read from there, rather than copied into one big scatterlist
+ * up front. This avoids holding the dump in memory twice and copying
+ * it all before the dump worker can let recovery continue.
+ */
+static ssize_t iwl_fw_error_ini_dump_read(char *buffer, loff_t offset,
+					  size_t count, void *data,
+					  size_t datalen)
+{
+	struct iwl_fw_ini_dump_entry *entry;
+	struct list_head *list = data;
+	loff_t entry_offs = 0;
+	size_t copied = 0;
+
+	list_for_each_entry(entry, list, list) {
+		size_t len;
+
+		if (copied == count)
+			break;
+
+		if (offset >= entry_offs + entry->size) {
+			entry_offs += entry->size;
+			continue;
+		}
+
+		len = min_t(size_t, count - copied,
+			    entry_offs + entry->size - offset);
+		memcpy(buffer + copied, entry->data + (offset - entry_offs),
+		       len);
+		copied += len;
+		offset += len;
+		entry_offs += entry->size;
+	}
+
+	return copied;
+}
+
+static void iwl_fw_error_ini_dump_free(void *data)
+{
+	struct list_head *list = data;
+
+	iwl_dump_ini_list_free(list);
+	kfree(list);
+}
+
 static void iwl_fw_error_ini_dump(struct iwl_fw_runtime *fwrt,
 				  struct iwl_fwrt_dump_data *dump_data)
 {
-	LIST_HEAD(dump_list);
-	struct scatterlist *sg_dump_data;
-	u32 file_len = iwl_dump_ini_file_gen(fwrt, dump_data, &dump_list);
+	struct list_head *dump_list;
+	u32 file_len;
 
-	if (!file_len)
+	dump_list = kmalloc(sizeof(*dump_list), GFP_KERNEL);
+	if (!dump_list)
 		return;
+	INIT_LIST_HEAD(dump_list);
 
-	sg_dump_data = alloc_sgtable(file_len);
-	if (sg_dump_data) {
-		struct iwl_fw_ini_dump_entry *entry;
-		int sg_entries = sg_nents(sg_dump_data);
-		u32 offs = 0;
-
-		list_for_each_entry(entry, &dump_list, list) {
-			sg_pcopy_from_buffer(sg_dump_data, sg_entries,
-					     entry->data, entry->size, offs);
-			offs += entry->size;
-		}
-		dev_coredumpsg(fwrt->trans->dev, sg_dump_data, file_len,
-			       GFP_KERNEL);
+	file_len = iwl_dump_ini_file_gen(fwrt, dump_data, dump_list);
+	if (!file_len) {
+		kfree(dump_list);
+		return;
 	}
-	iwl_dump_ini_list_free(&dump_list);
+
+	/* devcoredump owns the list now, even if it fails */
+	dev_coredumpm(fwrt->trans->dev, THIS_MODULE, dump_list, file_len,
+		      GFP_KERNEL, iwl_fw_error_ini_dump_read,
+		      iwl_fw_error_ini_dump_free);
 }
 
 const struct iwl_fw_dump_desc iwl_dump_desc_assert = {
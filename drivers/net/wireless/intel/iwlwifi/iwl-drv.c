@@ -14,12 +14,14 @@
 #include "iwl-csr.h"
 #include "iwl-debug.h"
 #include "iwl-trans.h"
+#include "iwl-io.h"
 #include "iwl-op-mode.h"
 #include "iwl-agn-hw.h"
 #include "fw/img.h"
 #include "iwl-dbg-tlv.h"
 #include "iwl-config.h"
 #include "iwl-modparams.h"
+#include "iwl-nvm-parse.h"
 #include "fw/api/alive.h"
 #include "fw/api/mac.h"
 #ifdef CPTCFG_IWLWIFI_SUPPORT_DEBUG_OVERRIDES
@@ -51,7 +53,9 @@ static struct dentry *iwl_dbgfs_root;
  * @trans: transport layer
  * @dev: for debug prints only
  * @fw_index: firmware revision to try loading
+ * @fw_index_cached: @fw_index was taken from the firmware cache
  * @firmware_name: composite filename of ucode file to load
+ * @fw_cache: firmware cache entry owning the section data in @fw, if any
  * @request_firmware_complete: the firmware has been obtained from user space
  * @dbgfs_drv: debugfs root directory entry
  * @dbgfs_trans: debugfs transport directory entry
@@ -72,7 +76,9 @@ struct iwl_drv {
 #endif
 
 	int fw_index;                   /* firmware we're trying to load */
+	bool fw_index_cached;
 	char firmware_name[64];         /* name of firmware file to load */
+	struct iwl_fw_cache_entry *fw_cache;
 
 	struct completion request_firmware_complete;
 
@@ -310,6 +316,120 @@ struct fw_sec {
 	u32 offset;			/* offset of writing in the device */
 };
 
+/*
+ * Firmware cache, shared by all devices.
+ *
+ * Finding the firmware file walks down from the maximum API version, and
+ * each miss is another round trip to user space. The version that was
+ * found is remembered per file name prefix, so that further devices of
+ * the same type start with it.
+ *
+ * The section data copied out of the file is never written to, so while
+ * it's in use, devices that load the same file share it instead of each
+ * copying it again.
+ */
+
+/**
+ * struct iwl_fw_cache_entry - firmware cache entry
+ * @list: entry in &iwl_fw_cache
+ * @name_pre: firmware file name prefix this entry is for
+ * @index: API version of the file last found for @name_pre
+ * @users: devices using the section data in @img
+ * @firmware_name: file the section data in @img was copied from
+ * @file_size: size of that file
+ * @fw_version: firmware version string of that file
+ * @img: the shared section data, only valid while there are @users
+ */
+struct iwl_fw_cache_entry {
+	struct list_head list;
+	char name_pre[FW_NAME_PRE_BUFSIZE];
+	int index;
+
+	unsigned int users;
+	char firmware_name[64];
+	size_t file_size;
+	char fw_version[sizeof_field(struct iwl_fw, fw_version)];
+	struct fw_img img[IWL_UCODE_TYPE_MAX];
+};
+
+/* Protects the firmware cache, nests inside iwlwifi_opmode_table_mtx */
+static DEFINE_MUTEX(iwl_fw_cache_mtx);
+static LIST_HEAD(iwl_fw_cache);
+
+static struct iwl_fw_cache_entry *iwl_fw_cache_find(const char *name_pre)
+{
+	struct iwl_fw_cache_entry *entry;
+
+	lockdep_assert_held(&iwl_fw_cache_mtx);
+
+	list_for_each_entry(entry, &iwl_fw_cache, list)
+		if (!strcmp(entry->name_pre, name_pre))
+			return entry;
+
+	return NULL;
+}
+
+static int iwl_fw_cache_index(struct iwl_drv *drv, const char *name_pre)
+{
+	const struct iwl_cfg *cfg = drv->trans->cfg;
+	struct iwl_fw_cache_entry *entry;
+	int index = cfg->ucode_api_max;
+
+	mutex_lock(&iwl_fw_cache_mtx);
+	entry = iwl_fw_cache_find(name_pre);
+	if (entry && entry->index >= cfg->ucode_api_min &&
+	    entry->index < cfg->ucode_api_max) {
+		index = entry->index;
+		drv->fw_index_cached = true;
+	}
+	mutex_unlock(&iwl_fw_cache_mtx);
+
+	return index;
+}
+
+static void iwl_fw_cache_free_img(struct iwl_fw_cache_entry *entry)
+{
+	int i, j;
+
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		struct fw_img *img = &entry->img[i];
+
+		for (j = 0; img->sec && j < img->num_sec; j++)
+			vfree(img->sec[j].data);
+		kfree(img->sec);
+		img->sec = NULL;
+		img->num_sec = 0;
+	}
+}
+
+static void iwl_fw_cache_put(struct iwl_drv *drv)
+{
+	struct iwl_fw_cache_entry *entry = drv->fw_cache;
+
+	if (!entry)
+		return;
+
+	mutex_lock(&iwl_fw_cache_mtx);
+	if (!--entry->users)
+		iwl_fw_cache_free_img(entry);
+	mutex_unlock(&iwl_fw_cache_mtx);
+
+	drv->fw_cache = NULL;
+}
+
+static void iwl_fw_cache_free(void)
+{
+	struct iwl_fw_cache_entry *entry, *tmp;
+
+	mutex_lock(&iwl_fw_cache_mtx);
+	list_for_each_entry_safe(entry, tmp, &iwl_fw_cache, list) {
+		WARN_ON(entry->users);
+		list_del(&entry->list);
+		kfree(entry);
+	}
+	mutex_unlock(&iwl_fw_cache_mtx);
+}
+
 static void iwl_free_fw_desc(struct iwl_drv *drv, struct fw_desc *desc)
 {
 	vfree(desc->data);
@@ -341,8 +461,13 @@ static void iwl_dealloc_ucode(struct iwl_drv *drv)
 	kfree(drv->trans->dbg.pc_data);
 	drv->trans->dbg.pc_data = NULL;
 
-	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++)
-		iwl_free_fw_img(drv, drv->fw.img + i);
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		if (drv->fw_cache)
+			kfree(drv->fw.img[i].sec);
+		else
+			iwl_free_fw_img(drv, drv->fw.img + i);
+	}
+	iwl_fw_cache_put(drv);
 
 	/* clear the data for the aborted load case */
 	memset(&drv->fw, 0, sizeof(drv->fw));
@@ -458,10 +583,15 @@ static int iwl_request_firmware(struct iwl_drv *drv, bool first)
 
 	fw_name_pre = iwl_drv_get_fwname_pre(drv->trans, _fw_name_pre);
 
-	if (first)
+	if (first) {
+		drv->fw_index = iwl_fw_cache_index(drv, fw_name_pre);
+	} else if (drv->fw_index_cached) {
+		/* the file we found before is gone, look for all of them */
+		drv->fw_index_cached = false;
 		drv->fw_index = cfg->ucode_api_max;
-	else
+	} else {
 		drv->fw_index--;
+	}
 
 #ifdef CPTCFG_IWLWIFI_DISALLOW_OLDER_FW
 	/* The dbg-cfg check here works because the first time we get
@@ -1650,6 +1780,128 @@ static int iwl_alloc_ucode(struct iwl_drv *drv,
 	return 0;
 }
 
+static bool iwl_fw_cache_match(struct iwl_fw_cache_entry *entry,
+			       struct iwl_drv *drv,
+			       struct iwl_firmware_pieces *pieces,
+			       size_t file_size)
+{
+	int i, j;
+
+	if (!entry->users || entry->file_size != file_size ||
+	    strcmp(entry->firmware_name, drv->firmware_name) ||
+	    strcmp(entry->fw_version, drv->fw.fw_version))
+		return false;
+
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		const struct fw_img *img = &entry->img[i];
+
+		if (img->num_sec != pieces->img[i].sec_counter)
+			return false;
+
+		for (j = 0; j < img->num_sec; j++) {
+			struct fw_sec *sec = get_sec(pieces, i, j);
+
+			if (img->sec[j].len != sec->size ||
+			    img->sec[j].offset != sec->offset)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Allocate the ucode sections, or share them with another device that
+ * loaded the same file, and remember the file's API version either way.
+ */
+static int iwl_alloc_ucode_cached(struct iwl_drv *drv,
+				  struct iwl_firmware_pieces *pieces,
+				  size_t file_size)
+{
+	char _fw_name_pre[FW_NAME_PRE_BUFSIZE];
+	struct iwl_fw_cache_entry *entry;
+	const char *fw_name_pre;
+	int i, err = 0;
+
+	fw_name_pre = iwl_drv_get_fwname_pre(drv->trans, _fw_name_pre);
+
+	mutex_lock(&iwl_fw_cache_mtx);
+
+	entry = iwl_fw_cache_find(fw_name_pre);
+	if (!entry) {
+		entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+		if (entry) {
+			strscpy(entry->name_pre, fw_name_pre,
+				sizeof(entry->name_pre));
+			list_add_tail(&entry->list, &iwl_fw_cache);
+		}
+	}
+	if (entry)
+		entry->index = drv->fw_index;
+
+	if (entry && iwl_fw_cache_match(entry, drv, pieces, file_size)) {
+		IWL_DEBUG_FW_INFO(drv, "sharing firmware sections of '%s'\n",
+				  drv->firmware_name);
+
+		entry->users++;
+		drv->fw_cache = entry;
+
+		for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+			struct fw_img *img = &drv->fw.img[i];
+
+			img->num_sec = entry->img[i].num_sec;
+			img->sec = kmemdup(entry->img[i].sec,
+					   img->num_sec * sizeof(*img->sec),
+					   GFP_KERNEL);
+			if (img->num_sec && !img->sec) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+		goto out;
+	}
+
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		err = iwl_alloc_ucode(drv, pieces, i);
+		if (err)
+			goto out;
+	}
+
+	/* nobody is using the cached sections, hand ours over */
+	if (!entry || entry->users)
+		goto out;
+
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		struct fw_img *img = &entry->img[i];
+
+		img->num_sec = drv->fw.img[i].num_sec;
+		img->sec = kmemdup(drv->fw.img[i].sec,
+				   img->num_sec * sizeof(*img->sec),
+				   GFP_KERNEL);
+		if (img->num_sec && !img->sec) {
+			/* the section data is still ours, just don't cache */
+			for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+				kfree(entry->img[i].sec);
+				entry->img[i].sec = NULL;
+				entry->img[i].num_sec = 0;
+			}
+			goto out;
+		}
+	}
+
+	strscpy(entry->firmware_name, drv->firmware_name,
+		sizeof(entry->firmware_name));
+	strscpy(entry->fw_version, drv->fw.fw_version,
+		sizeof(entry->fw_version));
+	entry->file_size = file_size;
+	entry->users = 1;
+	drv->fw_cache = entry;
+
+out:
+	mutex_unlock(&iwl_fw_cache_mtx);
+	return err;
+}
+
 static int validate_sec_sizes(struct iwl_drv *drv,
 			      struct iwl_firmware_pieces *pieces,
 			      const struct iwl_cfg *cfg)
@@ -1859,9 +2111,8 @@ static void iwl_req_fw_callback(const struct firmware *ucode_raw, void *context)
 	 * 1) unmodified from disk
 	 * 2) backup cache for save/restore during power-downs
 	 */
-	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++)
-		if (iwl_alloc_ucode(drv, pieces, i))
-			goto out_free_fw;
+	if (iwl_alloc_ucode_cached(drv, pieces, ucode_raw->size))
+		goto out_free_fw;
 
 	if (pieces->dbg_dest_tlv_init) {
 		size_t dbg_dest_size = sizeof(*drv->fw.dbg.dest_tlv) +
@@ -2088,6 +2339,69 @@ static void iwl_req_fw_callback(const struct firmware *ucode_raw, void *context)
 	}
 }
 
+#if IS_ENABLED(CPTCFG_IWLWIFI_KUNIT_TESTS)
+/*
+ * Parse a TLV firmware file and allocate its sections the same way
+ * iwl_req_fw_callback() does, but without the firmware cache and
+ * without starting an op_mode. Release with iwl_drv_test_free_fw().
+ */
+struct iwl_fw *iwl_drv_test_parse_fw(struct iwl_trans *trans,
+				     const struct firmware *ucode_raw)
+{
+	struct iwl_firmware_pieces *pieces;
+	bool usniffer_images = false;
+	struct iwl_drv *drv;
+	int err, i;
+
+	drv = kzalloc(sizeof(*drv), GFP_KERNEL);
+	if (!drv)
+		return ERR_PTR(-ENOMEM);
+
+	pieces = kzalloc(sizeof(*pieces), GFP_KERNEL);
+	if (!pieces) {
+		kfree(drv);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	drv->trans = trans;
+	drv->dev = trans->dev;
+	drv->fw.ucode_capa.n_scan_channels = IWL_DEFAULT_SCAN_CHANNELS;
+	drv->fw.ucode_capa.num_stations = IWL_MVM_STATION_COUNT_MAX;
+	drv->fw.ucode_capa.num_beacons = 1;
+
+	err = iwl_parse_tlv_firmware(drv, ucode_raw, pieces,
+				     &drv->fw.ucode_capa, &usniffer_images);
+
+	for (i = 0; !err && i < IWL_UCODE_TYPE_MAX; i++) {
+		if (pieces->img[i].sec_counter)
+			err = iwl_alloc_ucode(drv, pieces, i);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(pieces->img); i++)
+		kfree(pieces->img[i].sec);
+	kfree(pieces->dbg_mem_tlv);
+	kfree(pieces);
+
+	if (err) {
+		iwl_dealloc_ucode(drv);
+		kfree(drv);
+		return ERR_PTR(err);
+	}
+
+	return &drv->fw;
+}
+EXPORT_SYMBOL_IF_IWLWIFI_KUNIT(iwl_drv_test_parse_fw);
+
+void iwl_drv_test_free_fw(struct iwl_fw *fw)
+{
+	struct iwl_drv *drv = container_of(fw, struct iwl_drv, fw);
+
+	iwl_dealloc_ucode(drv);
+	kfree(drv);
+}
+EXPORT_SYMBOL_IF_IWLWIFI_KUNIT(iwl_drv_test_free_fw);
+#endif
+
 struct iwl_drv *iwl_drv_start(struct iwl_trans *trans)
 {
 	struct iwl_drv *drv;
@@ -2218,6 +2532,9 @@ struct iwl_mod_params iwlwifi_mod_params = {
 	.power_level = IWL_POWER_INDEX_1,
 	.uapsd_disable = IWL_DISABLE_UAPSD_BSS | IWL_DISABLE_UAPSD_P2P_CLIENT,
 	.enable_ini = ENABLE_INI,
+#ifdef CPTCFG_IWLWIFI_SIMULATION
+	.sim_devices = 1,
+#endif
 	/* the rest are 0 by default */
 };
 IWL_EXPORT_SYMBOL(iwlwifi_mod_params);
@@ -2293,14 +2610,21 @@ static int __init iwl_drv_init(void)
 #ifdef CPTCFG_IWLWIFI_DEBUGFS
 	/* Create the root of iwlwifi debugfs subsystem. */
 	iwl_dbgfs_root = debugfs_create_dir(DRV_NAME, NULL);
+	iwl_poll_stats_dbgfs_register(iwl_dbgfs_root);
 #endif
 
 	err = iwl_pci_register_driver();
 	if (err)
 		goto cleanup_debugfs;
 
+	err = iwl_sim_register_driver();
+	if (err)
+		goto cleanup_pci;
+
 	return 0;
 
+cleanup_pci:
+	iwl_pci_unregister_driver();
 cleanup_debugfs:
 #if IS_ENABLED(CPTCFG_IWLXVT)
 	kobject_put(iwl_kobj);
@@ -2318,7 +2642,10 @@ module_init(iwl_drv_init);
 
 static void __exit iwl_drv_exit(void)
 {
+	iwl_sim_unregister_driver();
 	iwl_pci_unregister_driver();
+	iwl_fw_cache_free();
+	iwl_nvm_sbands_tmpl_free();
 
 #ifdef CPTCFG_IWLWIFI_DEBUGFS
 	debugfs_remove_recursive(iwl_dbgfs_root);
@@ -2346,6 +2673,11 @@ module_param_named(xvt_default_mode, iwlwifi_mod_params.xvt_default_mode,
 MODULE_PARM_DESC(xvt_default_mode, "xVT is the default operation mode (default: false)");
 #endif
 
+#ifdef CPTCFG_IWLWIFI_SIMULATION
+module_param_named(sim_devices, iwlwifi_mod_params.sim_devices, int, 0444);
+MODULE_PARM_DESC(sim_devices, "number of simulated devices to create (default: 1)");
+#endif
+
 module_param_named(swcrypto, iwlwifi_mod_params.swcrypto, int, 0444);
 MODULE_PARM_DESC(swcrypto, "using crypto in software (default 0 [hardware])");
 module_param_named(11n_disable, iwlwifi_mod_params.disable_11n, uint, 0444);
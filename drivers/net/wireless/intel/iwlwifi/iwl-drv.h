@@ -117,4 +117,12 @@ int iwl_drv_switch_op_mode(struct iwl_drv *drv, const char *new_op_name);
 struct iwl_trans;
 const char *iwl_drv_get_fwname_pre(struct iwl_trans *trans, char *buf);
 
+#if IS_ENABLED(CPTCFG_IWLWIFI_KUNIT_TESTS)
+struct iwl_fw;
+struct firmware;
+struct iwl_fw *iwl_drv_test_parse_fw(struct iwl_trans *trans,
+				     const struct firmware *ucode_raw);
+void iwl_drv_test_free_fw(struct iwl_fw *fw);
+#endif
+
 #endif /* __iwl_drv_h__ */
@@ -6,6 +6,10 @@
 #include <linux/delay.h>
 #include <linux/device.h>
 #include <linux/export.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include "iwl-drv.h"
 #include "iwl-io.h"
@@ -46,22 +50,127 @@ u32 iwl_read32(struct iwl_trans *trans, u32 ofs)
 IWL_EXPORT_SYMBOL(iwl_read32);
 
 #define IWL_POLL_INTERVAL 10	/* microseconds */
+/* sleeping polls spin this long before backing off */
+#define IWL_POLL_SPIN_US 50
+#define IWL_POLL_SLEEP_MAX_US 1000U
 
-int iwl_poll_bit(struct iwl_trans *trans, u32 addr,
-		 u32 bits, u32 mask, int timeout)
+#ifdef CPTCFG_IWLWIFI_DEBUGFS
+static LIST_HEAD(iwl_poll_sites);
+static DEFINE_SPINLOCK(iwl_poll_sites_lock);
+
+static void iwl_poll_account(struct iwl_poll_site *site, unsigned int iters,
+			     u64 us, bool timed_out)
+{
+	unsigned long flags;
+
+	/* sites of other modules would dangle once those are unloaded */
+	if (THIS_MODULE && !within_module((unsigned long)site, THIS_MODULE))
+		return;
+
+	spin_lock_irqsave(&iwl_poll_sites_lock, flags);
+	if (!site->registered) {
+		list_add_tail(&site->list, &iwl_poll_sites);
+		site->registered = true;
+	}
+	site->calls++;
+	site->timeouts += timed_out;
+	site->iters += iters;
+	site->total_us += us;
+	site->max_us = max_t(u64, site->max_us, min_t(u64, us, U32_MAX));
+	site->hist[min_t(int, fls64(us), IWL_POLL_HIST_BUCKETS - 1)]++;
+	spin_unlock_irqrestore(&iwl_poll_sites_lock, flags);
+}
+
+static int iwl_poll_stats_show(struct seq_file *m, void *data)
+{
+	struct iwl_poll_site *site;
+	int i;
+
+	seq_puts(m, "# site calls timeouts iters total_us max_us\n");
+	seq_puts(m, "# histogram: polls taking 0, <2, <4, ... usec\n");
+
+	spin_lock_irq(&iwl_poll_sites_lock);
+	list_for_each_entry(site, &iwl_poll_sites, list) {
+		seq_printf(m, "%s:%d%s %u %u %llu %llu %u\n",
+			   site->func, site->line,
+			   site->may_sleep ? " (sleep)" : "",
+			   site->calls, site->timeouts, site->iters,
+			   site->total_us, site->max_us);
+		seq_puts(m, "\t");
+		for (i = 0; i < IWL_POLL_HIST_BUCKETS; i++)
+			seq_printf(m, " %u", site->hist[i]);
+		seq_puts(m, "\n");
+	}
+	spin_unlock_irq(&iwl_poll_sites_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(iwl_poll_stats);
+
+void iwl_poll_stats_dbgfs_register(struct dentry *dir)
+{
+	debugfs_create_file("poll_stats", 0400, dir, NULL,
+			    &iwl_poll_stats_fops);
+}
+#else
+static inline void iwl_poll_account(struct iwl_poll_site *site,
+				    unsigned int iters, u64 us, bool timed_out)
+{
+}
+#endif
+
+static int iwl_poll(struct iwl_trans *trans,
+		    u32 (*read)(struct iwl_trans *trans, u32 addr),
+		    u32 addr, u32 bits, u32 mask, int timeout,
+		    struct iwl_poll_site *site)
 {
+	unsigned int sleep_us = IWL_POLL_INTERVAL;
+	unsigned int iters = 0;
+	ktime_t start;
 	int t = 0;
+	int ret;
+
+	if (site->may_sleep)
+		might_sleep();
+
+	start = ktime_get();
 
 	do {
-		if ((iwl_read32(trans, addr) & mask) == (bits & mask))
-			return t;
-		udelay(IWL_POLL_INTERVAL);
-		t += IWL_POLL_INTERVAL;
+		iters++;
+		if ((read(trans, addr) & mask) == (bits & mask)) {
+			ret = t;
+			goto out;
+		}
+
+		if (!site->may_sleep || t < IWL_POLL_SPIN_US) {
+			udelay(IWL_POLL_INTERVAL);
+			t += IWL_POLL_INTERVAL;
+			continue;
+		}
+
+		/*
+		 * Back off exponentially, but not past the timeout so we
+		 * don't overshoot it by more than the usleep_range() slack.
+		 */
+		sleep_us = min3(sleep_us * 2, IWL_POLL_SLEEP_MAX_US,
+				(unsigned int)(timeout - t));
+		usleep_range(sleep_us, sleep_us * 2);
+		t = ktime_us_delta(ktime_get(), start);
 	} while (t < timeout);
 
-	return -ETIMEDOUT;
+	ret = -ETIMEDOUT;
+out:
+	iwl_poll_account(site, iters, ktime_us_delta(ktime_get(), start),
+			 ret < 0);
+	return ret;
+}
+
+int __iwl_poll_bit(struct iwl_trans *trans, u32 addr, u32 bits, u32 mask,
+		   int timeout, struct iwl_poll_site *site)
+{
+	return iwl_poll(trans, iwl_read32, addr, bits, mask, timeout, site);
 }
-IWL_EXPORT_SYMBOL(iwl_poll_bit);
+IWL_EXPORT_SYMBOL(__iwl_poll_bit);
 
 u32 iwl_read_direct32(struct iwl_trans *trans, u32 reg)
 {
@@ -95,21 +204,13 @@ void iwl_write_direct64(struct iwl_trans *trans, u64 reg, u64 value)
 }
 IWL_EXPORT_SYMBOL(iwl_write_direct64);
 
-int iwl_poll_direct_bit(struct iwl_trans *trans, u32 addr, u32 mask,
-			int timeout)
+int __iwl_poll_direct_bit(struct iwl_trans *trans, u32 addr, u32 mask,
+			  int timeout, struct iwl_poll_site *site)
 {
-	int t = 0;
-
-	do {
-		if ((iwl_read_direct32(trans, addr) & mask) == mask)
-			return t;
-		udelay(IWL_POLL_INTERVAL);
-		t += IWL_POLL_INTERVAL;
-	} while (t < timeout);
-
-	return -ETIMEDOUT;
+	return iwl_poll(trans, iwl_read_direct32, addr, mask, mask, timeout,
+			site);
 }
-IWL_EXPORT_SYMBOL(iwl_poll_direct_bit);
+IWL_EXPORT_SYMBOL(__iwl_poll_direct_bit);
 
 u32 iwl_read_prph_no_grab(struct iwl_trans *trans, u32 ofs)
 {
@@ -159,19 +260,10 @@ void iwl_write_prph_delay(struct iwl_trans *trans, u32 ofs, u32 val, u32 delay_m
 }
 IWL_EXPORT_SYMBOL(iwl_write_prph_delay);
 
-int iwl_poll_prph_bit(struct iwl_trans *trans, u32 addr,
-		      u32 bits, u32 mask, int timeout)
+int __iwl_poll_prph_bit(struct iwl_trans *trans, u32 addr, u32 bits, u32 mask,
+			int timeout, struct iwl_poll_site *site)
 {
-	int t = 0;
-
-	do {
-		if ((iwl_read_prph(trans, addr) & mask) == (bits & mask))
-			return t;
-		udelay(IWL_POLL_INTERVAL);
-		t += IWL_POLL_INTERVAL;
-	} while (t < timeout);
-
-	return -ETIMEDOUT;
+	return iwl_poll(trans, iwl_read_prph, addr, bits, mask, timeout, site);
 }
 
 void iwl_set_bits_prph(struct iwl_trans *trans, u32 ofs, u32 mask)
@@ -23,10 +23,74 @@ static inline void iwl_clear_bit(struct iwl_trans *trans, u32 reg, u32 mask)
 	iwl_trans_set_bits_mask(trans, reg, mask, 0);
 }
 
-int iwl_poll_bit(struct iwl_trans *trans, u32 addr,
-		 u32 bits, u32 mask, int timeout);
-int iwl_poll_direct_bit(struct iwl_trans *trans, u32 addr, u32 mask,
-			int timeout);
+#define IWL_POLL_HIST_BUCKETS	16
+
+/**
+ * struct iwl_poll_site - statistics for one register polling call site
+ * @func: function the poll is in
+ * @line: source line of the poll
+ * @may_sleep: the site is known to run in process context and may back
+ *	off with usleep_range() after the initial spin
+ * @registered: the site is on the global list shown in debugfs
+ * @list: entry in the global list
+ * @calls: number of polls done
+ * @timeouts: number of polls that timed out
+ * @iters: total number of register reads
+ * @total_us: total time spent polling
+ * @max_us: longest single poll
+ * @hist: polls by duration, bucket n counts polls of [2^(n-1), 2^n) usec
+ *
+ * One instance is created statically for every caller of the polling
+ * macros below, so it must only be used from code built into this module.
+ */
+struct iwl_poll_site {
+	const char *func;
+	int line;
+	bool may_sleep;
+	bool registered;
+	struct list_head list;
+	u32 calls;
+	u32 timeouts;
+	u64 iters;
+	u64 total_us;
+	u32 max_us;
+	u32 hist[IWL_POLL_HIST_BUCKETS];
+};
+
+#define IWL_POLL_SITE(_may_sleep) ({					\
+	static struct iwl_poll_site __iwl_poll_site = {			\
+		.func = __func__,					\
+		.line = __LINE__,					\
+		.may_sleep = _may_sleep,				\
+	};								\
+	&__iwl_poll_site;						\
+})
+
+int __iwl_poll_bit(struct iwl_trans *trans, u32 addr, u32 bits, u32 mask,
+		   int timeout, struct iwl_poll_site *site);
+int __iwl_poll_direct_bit(struct iwl_trans *trans, u32 addr, u32 mask,
+			  int timeout, struct iwl_poll_site *site);
+int __iwl_poll_prph_bit(struct iwl_trans *trans, u32 addr, u32 bits, u32 mask,
+			int timeout, struct iwl_poll_site *site);
+
+/*
+ * The plain variants only busy-wait and are safe in atomic context. The
+ * _sleep variants spin for a short while and then back off with
+ * usleep_range(), use them where the caller is allowed to sleep.
+ * All return the time spent polling in usec, or -ETIMEDOUT.
+ */
+#define iwl_poll_bit(trans, addr, bits, mask, timeout)			\
+	__iwl_poll_bit(trans, addr, bits, mask, timeout,		\
+		       IWL_POLL_SITE(false))
+#define iwl_poll_bit_sleep(trans, addr, bits, mask, timeout)		\
+	__iwl_poll_bit(trans, addr, bits, mask, timeout,		\
+		       IWL_POLL_SITE(true))
+#define iwl_poll_direct_bit(trans, addr, mask, timeout)			\
+	__iwl_poll_direct_bit(trans, addr, mask, timeout,		\
+			      IWL_POLL_SITE(false))
+#define iwl_poll_direct_bit_sleep(trans, addr, mask, timeout)		\
+	__iwl_poll_direct_bit(trans, addr, mask, timeout,		\
+			      IWL_POLL_SITE(true))
 
 u32 iwl_read_direct32(struct iwl_trans *trans, u32 reg);
 void iwl_write_direct32(struct iwl_trans *trans, u32 reg, u32 value);
@@ -44,8 +108,12 @@ static inline void iwl_write_prph(struct iwl_trans *trans, u32 ofs, u32 val)
 	iwl_write_prph_delay(trans, ofs, val, 0);
 }
 
-int iwl_poll_prph_bit(struct iwl_trans *trans, u32 addr,
-		      u32 bits, u32 mask, int timeout);
+#define iwl_poll_prph_bit(trans, addr, bits, mask, timeout)		\
+	__iwl_poll_prph_bit(trans, addr, bits, mask, timeout,		\
+			    IWL_POLL_SITE(false))
+#define iwl_poll_prph_bit_sleep(trans, addr, bits, mask, timeout)	\
+	__iwl_poll_prph_bit(trans, addr, bits, mask, timeout,		\
+			    IWL_POLL_SITE(true))
 void iwl_set_bits_prph(struct iwl_trans *trans, u32 ofs, u32 mask);
 void iwl_set_bits_mask_prph(struct iwl_trans *trans, u32 ofs,
 			    u32 bits, u32 mask);
@@ -54,6 +122,12 @@ void iwl_force_nmi(struct iwl_trans *trans);
 
 int iwl_finish_nic_init(struct iwl_trans *trans);
 
+#ifdef CPTCFG_IWLWIFI_DEBUGFS
+void iwl_poll_stats_dbgfs_register(struct dentry *dir);
+#else
+static inline void iwl_poll_stats_dbgfs_register(struct dentry *dir) {}
+#endif
+
 /* Error handling */
 int iwl_dump_fh(struct iwl_trans *trans, char **buf);
 
@@ -91,12 +165,14 @@ static inline void iwl_write_umac_prph(struct iwl_trans *trans, u32 ofs,
 	iwl_write_prph(trans,  ofs + trans->trans_cfg->umac_prph_offset, val);
 }
 
-static inline int iwl_poll_umac_prph_bit(struct iwl_trans *trans, u32 addr,
-					 u32 bits, u32 mask, int timeout)
-{
-	return iwl_poll_prph_bit(trans, addr +
-				 trans->trans_cfg->umac_prph_offset,
-				 bits, mask, timeout);
-}
+/* macros rather than inlines so the statistics go to the real caller */
+#define iwl_poll_umac_prph_bit(trans, addr, bits, mask, timeout)	\
+	iwl_poll_prph_bit(trans,					\
+			  (addr) + (trans)->trans_cfg->umac_prph_offset,\
+			  bits, mask, timeout)
+#define iwl_poll_umac_prph_bit_sleep(trans, addr, bits, mask, timeout)	\
+	iwl_poll_prph_bit_sleep(trans,					\
+				(addr) + (trans)->trans_cfg->umac_prph_offset,\
+				bits, mask, timeout)
 
 #endif
@@ -65,6 +65,7 @@ enum iwl_uapsd_disable {
  * @remove_when_gone: remove an inaccessible device from the PCIe bus.
  * @enable_ini: enable new FW debug infratructure (INI TLVs)
  * @disable_11be: disable EHT capabilities, default = false.
+ * @sim_devices: number of simulated devices to create, default = 1
  */
 struct iwl_mod_params {
 	int swcrypto;
@@ -92,7 +93,9 @@ struct iwl_mod_params {
 	bool remove_when_gone;
 	u32 enable_ini;
 	bool disable_11be;
-
+#ifdef CPTCFG_IWLWIFI_SIMULATION
+	int sim_devices;
+#endif
 };
 
 static inline bool iwl_enable_rx_ampdu(void)
@@ -6,6 +6,7 @@
  */
 #include <linux/types.h>
 #include <linux/slab.h>
+#include <linux/mutex.h>
 #include <linux/export.h>
 #include <linux/etherdevice.h>
 #include <linux/pci.h>
@@ -1397,7 +1398,7 @@ void iwl_reinit_cab(struct iwl_trans *trans, struct iwl_nvm_data *data,
 }
 IWL_EXPORT_SYMBOL(iwl_reinit_cab);
 
-static void iwl_init_sbands(struct iwl_trans *trans,
+static int iwl_build_sbands(struct iwl_trans *trans,
 			    struct iwl_nvm_data *data,
 			    const void *nvm_ch_flags, u8 tx_chains,
 			    u8 rx_chains, u32 sbands_flags, bool v4,
@@ -1457,6 +1458,222 @@ static void iwl_init_sbands(struct iwl_trans *trans,
 	if (n_channels != n_used)
 		IWL_ERR_DEV(dev, "NVM: used only %d of %d channels\n",
 			    n_used, n_channels);
+
+	return n_channels;
+}
+
+/*
+ * Band templates: devices with the same configuration, SKU and channel
+ * profile end up with identical channel lists and HT/VHT/HE/EHT
+ * capabilities, so build those only once and copy them for the other
+ * devices. Each device still gets its own copy since cfg80211 and the
+ * regulatory code modify the channels (and the driver the capabilities)
+ * of a wiphy. Templates are kept until the module is unloaded.
+ */
+struct iwl_nvm_sbands_key {
+	const struct iwl_cfg *cfg;
+	const struct iwl_cfg_trans_params *trans_cfg;
+	u32 hw_rev, hw_rf_id;
+	u8 pcie_link_speed;
+	u8 no_160:1, step_urm:1, reduced_cap_sku:1, v4:1;
+	u8 tx_chains, rx_chains;
+	u32 sbands_flags;
+	bool sku_cap_band_24ghz_enable;
+	bool sku_cap_band_52ghz_enable;
+	bool sku_cap_11n_enable;
+	bool sku_cap_11ac_enable;
+	bool sku_cap_11ax_enable;
+	bool sku_cap_11be_enable;
+	bool sku_cap_mimo_disabled;
+	unsigned long fw_api[BITS_TO_LONGS(NUM_IWL_UCODE_TLV_API)];
+	unsigned long fw_capa[BITS_TO_LONGS(NUM_IWL_UCODE_TLV_CAPA)];
+};
+
+struct iwl_nvm_sbands_tmpl {
+	struct list_head list;
+	struct iwl_nvm_sbands_key key;
+	size_t nvm_ch_len;
+	const void *nvm_ch_flags;
+	int n_channels;
+	struct iwl_nvm_data *data;
+};
+
+static LIST_HEAD(iwl_nvm_sbands_tmpls);
+static DEFINE_MUTEX(iwl_nvm_sbands_mtx);
+
+static void iwl_nvm_sbands_key(struct iwl_nvm_sbands_key *key,
+			       struct iwl_trans *trans,
+			       const struct iwl_nvm_data *data,
+			       u8 tx_chains, u8 rx_chains, u32 sbands_flags,
+			       bool v4, const struct iwl_fw *fw)
+{
+	/* compared with memcmp(), so clear the padding too */
+	memset(key, 0, sizeof(*key));
+
+	key->cfg = trans->cfg;
+	key->trans_cfg = trans->trans_cfg;
+	key->hw_rev = trans->hw_rev;
+	key->hw_rf_id = trans->hw_rf_id;
+	key->pcie_link_speed = trans->pcie_link_speed;
+	key->no_160 = trans->no_160;
+	key->step_urm = trans->step_urm;
+	key->reduced_cap_sku = trans->reduced_cap_sku;
+	key->v4 = v4;
+	key->tx_chains = tx_chains;
+	key->rx_chains = rx_chains;
+	key->sbands_flags = sbands_flags;
+	key->sku_cap_band_24ghz_enable = data->sku_cap_band_24ghz_enable;
+	key->sku_cap_band_52ghz_enable = data->sku_cap_band_52ghz_enable;
+	key->sku_cap_11n_enable = data->sku_cap_11n_enable;
+	key->sku_cap_11ac_enable = data->sku_cap_11ac_enable;
+	key->sku_cap_11ax_enable = data->sku_cap_11ax_enable;
+	key->sku_cap_11be_enable = data->sku_cap_11be_enable;
+	key->sku_cap_mimo_disabled = data->sku_cap_mimo_disabled;
+	memcpy(key->fw_api, fw->ucode_capa._api, sizeof(key->fw_api));
+	memcpy(key->fw_capa, fw->ucode_capa._capa, sizeof(key->fw_capa));
+}
+
+static size_t iwl_nvm_ch_flags_len(const struct iwl_cfg *cfg, bool v4)
+{
+	size_t num_of_ch;
+
+	if (cfg->uhb_supported)
+		num_of_ch = IWL_NVM_NUM_CHANNELS_UHB;
+	else if (cfg->nvm_type == IWL_NVM_EXT)
+		num_of_ch = IWL_NVM_NUM_CHANNELS_EXT;
+	else
+		num_of_ch = IWL_NVM_NUM_CHANNELS;
+
+	return num_of_ch * (v4 ? sizeof(__le32) : sizeof(__le16));
+}
+
+/* copy the bands and fix up the pointers into the channel/iftype arrays */
+static void iwl_nvm_sbands_copy(struct iwl_nvm_data *dst,
+				const struct iwl_nvm_data *src, int n_channels)
+{
+	int band;
+
+	memcpy(dst->channels, src->channels,
+	       n_channels * sizeof(*dst->channels));
+	memcpy(dst->bands, src->bands, sizeof(dst->bands));
+	memcpy(&dst->iftd, &src->iftd, sizeof(dst->iftd));
+	dst->vht160_supported = src->vht160_supported;
+
+	for (band = 0; band < NUM_NL80211_BANDS; band++) {
+		struct ieee80211_supported_band *sband = &dst->bands[band];
+		const void *iftd = (const void __force *)sband->iftype_data;
+
+		if (sband->channels)
+			sband->channels = dst->channels +
+					  (sband->channels - src->channels);
+		if (iftd)
+			_ieee80211_set_sband_iftype_data(sband,
+							 (void *)&dst->iftd +
+							 (iftd - (void *)&src->iftd),
+							 sband->n_iftype_data);
+	}
+}
+
+static struct iwl_nvm_sbands_tmpl *
+iwl_nvm_sbands_tmpl_find(const struct iwl_nvm_sbands_key *key,
+			 const void *nvm_ch_flags, size_t nvm_ch_len)
+{
+	struct iwl_nvm_sbands_tmpl *tmpl;
+
+	lockdep_assert_held(&iwl_nvm_sbands_mtx);
+
+	list_for_each_entry(tmpl, &iwl_nvm_sbands_tmpls, list) {
+		if (!memcmp(&tmpl->key, key, sizeof(*key)) &&
+		    tmpl->nvm_ch_len == nvm_ch_len &&
+		    !memcmp(tmpl->nvm_ch_flags, nvm_ch_flags, nvm_ch_len))
+			return tmpl;
+	}
+
+	return NULL;
+}
+
+static void iwl_nvm_sbands_tmpl_add(const struct iwl_nvm_sbands_key *key,
+				    const void *nvm_ch_flags,
+				    size_t nvm_ch_len,
+				    const struct iwl_nvm_data *data,
+				    int n_channels)
+{
+	struct iwl_nvm_sbands_tmpl *tmpl;
+
+	lockdep_assert_held(&iwl_nvm_sbands_mtx);
+
+	tmpl = kzalloc(sizeof(*tmpl), GFP_KERNEL);
+	if (!tmpl)
+		return;
+
+	tmpl->nvm_ch_flags = kmemdup(nvm_ch_flags, nvm_ch_len, GFP_KERNEL);
+	tmpl->data = kzalloc(struct_size(tmpl->data, channels, n_channels),
+			     GFP_KERNEL);
+	if (!tmpl->nvm_ch_flags || !tmpl->data) {
+		kfree(tmpl->nvm_ch_flags);
+		kfree(tmpl->data);
+		kfree(tmpl);
+		return;
+	}
+
+	tmpl->key = *key;
+	tmpl->nvm_ch_len = nvm_ch_len;
+	tmpl->n_channels = n_channels;
+	iwl_nvm_sbands_copy(tmpl->data, data, n_channels);
+
+	list_add_tail(&tmpl->list, &iwl_nvm_sbands_tmpls);
+}
+
+void iwl_nvm_sbands_tmpl_free(void)
+{
+	struct iwl_nvm_sbands_tmpl *tmpl, *tmp;
+
+	mutex_lock(&iwl_nvm_sbands_mtx);
+	list_for_each_entry_safe(tmpl, tmp, &iwl_nvm_sbands_tmpls, list) {
+		list_del(&tmpl->list);
+		kfree(tmpl->nvm_ch_flags);
+		kfree(tmpl->data);
+		kfree(tmpl);
+	}
+	mutex_unlock(&iwl_nvm_sbands_mtx);
+}
+
+static void iwl_init_sbands(struct iwl_trans *trans,
+			    struct iwl_nvm_data *data,
+			    const void *nvm_ch_flags, u8 tx_chains,
+			    u8 rx_chains, u32 sbands_flags, bool v4,
+			    const struct iwl_fw *fw)
+{
+	size_t nvm_ch_len = iwl_nvm_ch_flags_len(trans->cfg, v4);
+	struct iwl_nvm_sbands_tmpl *tmpl;
+	struct iwl_nvm_sbands_key key;
+	int n_channels;
+
+#ifdef CPTCFG_IWLWIFI_SUPPORT_DEBUG_OVERRIDES
+	/* the debug configuration can change the capabilities per device */
+	if (trans->dbg_cfg.loaded) {
+		iwl_build_sbands(trans, data, nvm_ch_flags, tx_chains,
+				 rx_chains, sbands_flags, v4, fw);
+		return;
+	}
+#endif
+
+	iwl_nvm_sbands_key(&key, trans, data, tx_chains, rx_chains,
+			   sbands_flags, v4, fw);
+
+	mutex_lock(&iwl_nvm_sbands_mtx);
+	tmpl = iwl_nvm_sbands_tmpl_find(&key, nvm_ch_flags, nvm_ch_len);
+	if (tmpl) {
+		IWL_DEBUG_EEPROM(trans->dev, "NVM: using band template\n");
+		iwl_nvm_sbands_copy(data, tmpl->data, tmpl->n_channels);
+	} else {
+		n_channels = iwl_build_sbands(trans, data, nvm_ch_flags,
+					      tx_chains, rx_chains,
+					      sbands_flags, v4, fw);
+		iwl_nvm_sbands_tmpl_add(&key, nvm_ch_flags, nvm_ch_len,
+					data, n_channels);
+	}
+	mutex_unlock(&iwl_nvm_sbands_mtx);
 }
 
 static int iwl_get_sku(const struct iwl_cfg *cfg, const __le16 *nvm_sw,
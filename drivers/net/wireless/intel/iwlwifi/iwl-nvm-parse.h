@@ -37,6 +37,13 @@ iwl_parse_nvm_data(struct iwl_trans *trans, const struct iwl_cfg *cfg,
 		   const __le16 *mac_override, const __le16 *phy_sku,
 		   u8 tx_chains, u8 rx_chains);
 
+/*
+ * iwl_nvm_sbands_tmpl_free - free the band templates shared by devices
+ *
+ * Must only be called when no device can parse its NVM any longer.
+ */
+void iwl_nvm_sbands_tmpl_free(void);
+
 /**
  * iwl_parse_mcc_info - parse MCC (mobile country code) info coming from FW
  *
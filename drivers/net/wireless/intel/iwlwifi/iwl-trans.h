@@ -9,6 +9,7 @@
 
 #include <linux/ieee80211.h>
 #include <linux/mm.h> /* for page_address */
+#include <linux/skbuff.h>
 #include <linux/lockdep.h>
 #include <linux/kernel.h>
 
@@ -247,6 +248,8 @@ struct iwl_rx_cmd_buffer {
 	struct page *_page;
 	int _offset;
 	bool _page_stolen;
+	bool _page_pool;
+	bool _page_recycle;
 	u32 _rx_page_order;
 	unsigned int truesize;
 };
@@ -268,6 +271,22 @@ static inline struct page *rxb_steal_page(struct iwl_rx_cmd_buffer *r)
 	return r->_page;
 }
 
+/*
+ * Steal the page to attach it as a fragment to @skb. If the transport
+ * allocated it from a page pool the SKB is marked for recycling, so the
+ * page goes back to the pool when the SKB is freed.
+ */
+static inline struct page *rxb_steal_page_skb(struct iwl_rx_cmd_buffer *r,
+					      struct sk_buff *skb)
+{
+	if (r->_page_pool) {
+		skb_mark_for_recycle(skb);
+		r->_page_recycle = true;
+	}
+
+	return rxb_steal_page(r);
+}
+
 static inline void iwl_free_rxb(struct iwl_rx_cmd_buffer *r)
 {
 	__free_pages(r->_page, r->_rx_page_order);
@@ -452,6 +471,7 @@ struct iwl_trans_dump_data {
 };
 
 struct iwl_trans;
+struct page_pool_stats;
 
 struct iwl_trans_txq_scd_cfg {
 	u8 fifo;
@@ -575,6 +595,8 @@ struct iwl_pnvm_image {
  * @load_reduce_power: copy reduce power table to the corresponding DRAM memory
  * @set_reduce_power: set reduce power table addresses in the sratch buffer
  * @interrupts: disable/enable interrupts to transport
+ * @get_page_pool_stats: optional, accumulate the statistics of the page
+ *	pools backing the RX buffers into the given struct
  */
 struct iwl_trans_ops {
 
@@ -664,7 +686,8 @@ struct iwl_trans_ops {
 	int (*imr_dma_data)(struct iwl_trans *trans,
 			    u32 dst_addr, u64 src_addr,
 			    u32 byte_cnt);
-
+	void (*get_page_pool_stats)(struct iwl_trans *trans,
+				    struct page_pool_stats *stats);
 };
 
 /**
@@ -1381,6 +1404,14 @@ iwl_trans_get_rxq_dma_data(struct iwl_trans *trans, int queue,
 	return trans->ops->rxq_dma_data(trans, queue, data);
 }
 
+static inline void
+iwl_trans_get_page_pool_stats(struct iwl_trans *trans,
+			      struct page_pool_stats *stats)
+{
+	if (trans->ops->get_page_pool_stats)
+		trans->ops->get_page_pool_stats(trans, stats);
+}
+
 static inline void
 iwl_trans_txq_free(struct iwl_trans *trans, int queue)
 {
@@ -1704,4 +1735,19 @@ static inline void iwl_trans_pcie_remove(struct iwl_trans *trans, bool rescan)
 }
 #endif /* CONFIG_PCI */
 
+/* Simulation */
+#ifdef CPTCFG_IWLWIFI_SIMULATION
+int __must_check iwl_sim_register_driver(void);
+void iwl_sim_unregister_driver(void);
+#else
+static inline int __must_check iwl_sim_register_driver(void)
+{
+	return 0;
+}
+
+static inline void iwl_sim_unregister_driver(void)
+{
+}
+#endif /* CPTCFG_IWLWIFI_SIMULATION */
+
 #endif /* __iwl_trans_h__ */
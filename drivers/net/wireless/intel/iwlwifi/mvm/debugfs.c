@@ -1556,6 +1556,84 @@ static ssize_t iwl_dbgfs_drv_rx_stats_read(struct file *file,
 					  &mvm->drv_rx_stats);
 }
 
+static ssize_t iwl_dbgfs_reorder_stats_read(struct file *file,
+					    char __user *user_buf,
+					    size_t count, loff_t *ppos)
+{
+	struct iwl_mvm *mvm = file->private_data;
+	char *buff, *pos, *endpos;
+	size_t bufsz = 200 * mvm->trans->num_rx_queues + 1;
+	ssize_t ret;
+	int i;
+
+	buff = kmalloc(bufsz, GFP_KERNEL);
+	if (!buff)
+		return -ENOMEM;
+
+	pos = buff;
+	endpos = pos + bufsz;
+
+	for (i = 0; i < mvm->trans->num_rx_queues; i++) {
+		struct iwl_mvm_reorder_stats *stats = &mvm->reorder_stats[i];
+		u64 releases = READ_ONCE(stats->frame_release);
+
+		pos += scnprintf(pos, endpos - pos,
+				 "queue %d: releases %llu frames %llu avg_ns %llu max_ns %llu\n",
+				 i, releases,
+				 READ_ONCE(stats->frame_release_frames),
+				 releases ?
+				 div64_u64(READ_ONCE(stats->frame_release_ns),
+					   releases) : 0,
+				 READ_ONCE(stats->frame_release_max_ns));
+	}
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buff, pos - buff);
+	kfree(buff);
+
+	return ret;
+}
+
+static ssize_t iwl_dbgfs_cmd_latency_read(struct file *file,
+					  char __user *user_buf,
+					  size_t count, loff_t *ppos)
+{
+	struct iwl_mvm *mvm = file->private_data;
+	char *buff, *pos, *endpos;
+	size_t bufsz = 80 * IWL_MVM_CMD_LAT_LOG_SIZE + 1;
+	unsigned int idx;
+	ssize_t ret;
+	int i;
+
+	buff = kmalloc(bufsz, GFP_KERNEL);
+	if (!buff)
+		return -ENOMEM;
+
+	pos = buff;
+	endpos = pos + bufsz;
+
+	/* oldest first */
+	mutex_lock(&mvm->mutex);
+	idx = mvm->cmd_lat_idx;
+	for (i = 0; i < IWL_MVM_CMD_LAT_LOG_SIZE; i++) {
+		struct iwl_mvm_cmd_lat *lat = &mvm->cmd_lat[idx];
+
+		idx = (idx + 1) % IWL_MVM_CMD_LAT_LOG_SIZE;
+		if (!lat->id)
+			continue;
+
+		pos += scnprintf(pos, endpos - pos, "%s (0x%04x): %u us%s\n",
+				 iwl_get_cmd_string(mvm->trans, lat->id),
+				 lat->id, lat->latency_us,
+				 lat->batched ? " (batch)" : "");
+	}
+	mutex_unlock(&mvm->mutex);
+
+	ret = simple_read_from_buffer(user_buf, count, ppos, buff, pos - buff);
+	kfree(buff);
+
+	return ret;
+}
+
 static ssize_t iwl_dbgfs_fw_restart_write(struct iwl_mvm *mvm, char *buf,
 					  size_t count, loff_t *ppos)
 {
@@ -2661,6 +2739,8 @@ MVM_DEBUGFS_READ_FILE_OPS(bt_cmd);
 MVM_DEBUGFS_READ_WRITE_FILE_OPS(disable_power_off, 64);
 MVM_DEBUGFS_READ_FILE_OPS(fw_rx_stats);
 MVM_DEBUGFS_READ_FILE_OPS(drv_rx_stats);
+MVM_DEBUGFS_READ_FILE_OPS(reorder_stats);
+MVM_DEBUGFS_READ_FILE_OPS(cmd_latency);
 MVM_DEBUGFS_READ_FILE_OPS(fw_system_stats);
 MVM_DEBUGFS_READ_FILE_OPS(fw_ver);
 MVM_DEBUGFS_READ_FILE_OPS(phy_integration_ver);
@@ -2896,6 +2976,8 @@ void iwl_mvm_dbgfs_register(struct iwl_mvm *mvm)
 	MVM_DEBUGFS_ADD_FILE(fw_ver, mvm->debugfs_dir, 0400);
 	MVM_DEBUGFS_ADD_FILE(fw_rx_stats, mvm->debugfs_dir, 0400);
 	MVM_DEBUGFS_ADD_FILE(drv_rx_stats, mvm->debugfs_dir, 0400);
+	MVM_DEBUGFS_ADD_FILE(reorder_stats, mvm->debugfs_dir, 0400);
+	MVM_DEBUGFS_ADD_FILE(cmd_latency, mvm->debugfs_dir, 0400);
 	MVM_DEBUGFS_ADD_FILE(fw_system_stats, mvm->debugfs_dir, 0400);
 	MVM_DEBUGFS_ADD_FILE(fw_restart, mvm->debugfs_dir, 0200);
 	MVM_DEBUGFS_ADD_FILE(fw_nmi, mvm->debugfs_dir, 0200);
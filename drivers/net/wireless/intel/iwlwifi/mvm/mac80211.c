@@ -15,6 +15,7 @@
 #include <net/mac80211.h>
 #include <net/ieee80211_radiotap.h>
 #include <net/tcp.h>
+#include <net/page_pool/helpers.h>
 
 #include "iwl-drv.h"
 #include "iwl-op-mode.h"
@@ -6529,6 +6530,37 @@ int iwl_mvm_set_hw_timestamp(struct ieee80211_hw *hw,
 	return ret;
 }
 
+int iwl_mvm_mac_get_et_sset_count(struct ieee80211_hw *hw,
+				  struct ieee80211_vif *vif, int sset)
+{
+	if (sset != ETH_SS_STATS)
+		return 0;
+
+	return page_pool_ethtool_stats_get_count();
+}
+
+void iwl_mvm_mac_get_et_strings(struct ieee80211_hw *hw,
+				struct ieee80211_vif *vif, u32 sset, u8 *data)
+{
+	if (sset != ETH_SS_STATS)
+		return;
+
+	page_pool_ethtool_stats_get_strings(data);
+}
+
+void iwl_mvm_mac_get_et_stats(struct ieee80211_hw *hw,
+			      struct ieee80211_vif *vif,
+			      struct ethtool_stats *stats, u64 *data)
+{
+#ifdef CPTCFG_PAGE_POOL_STATS
+	struct iwl_mvm *mvm = IWL_MAC80211_GET_MVM(hw);
+	struct page_pool_stats pp_stats = {};
+
+	iwl_trans_get_page_pool_stats(mvm->trans, &pp_stats);
+	page_pool_ethtool_stats_get(data, &pp_stats);
+#endif
+}
+
 const struct ieee80211_ops iwl_mvm_hw_ops = {
 	.tx = iwl_mvm_mac_tx,
 	.wake_tx_queue = iwl_mvm_mac_wake_tx_queue,
@@ -6626,4 +6658,8 @@ const struct ieee80211_ops iwl_mvm_hw_ops = {
 	.link_sta_add_debugfs = iwl_mvm_link_sta_add_debugfs,
 #endif
 	.set_hw_timestamp = iwl_mvm_set_hw_timestamp,
+
+	.get_et_sset_count = iwl_mvm_mac_get_et_sset_count,
+	.get_et_strings = iwl_mvm_mac_get_et_strings,
+	.get_et_stats = iwl_mvm_mac_get_et_stats,
 };
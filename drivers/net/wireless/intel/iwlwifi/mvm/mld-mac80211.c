@@ -1480,6 +1480,10 @@ const struct ieee80211_ops iwl_mvm_mld_hw_ops = {
 #endif
 	.set_hw_timestamp = iwl_mvm_set_hw_timestamp,
 
+	.get_et_sset_count = iwl_mvm_mac_get_et_sset_count,
+	.get_et_strings = iwl_mvm_mac_get_et_strings,
+	.get_et_stats = iwl_mvm_mac_get_et_stats,
+
 	.change_vif_links = iwl_mvm_mld_change_vif_links,
 	.change_sta_links = iwl_mvm_mld_change_sta_links,
 	.can_activate_links = iwl_mvm_mld_can_activate_links,
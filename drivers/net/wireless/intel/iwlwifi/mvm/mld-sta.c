@@ -946,39 +946,43 @@ static int iwl_mvm_mld_update_sta_queues(struct iwl_mvm *mvm,
 					 u32 new_sta_mask)
 {
 	struct iwl_mvm_sta *mvm_sta = iwl_mvm_sta_from_mac80211(sta);
-	struct iwl_scd_queue_cfg_cmd cmd = {
-		.operation = cpu_to_le32(IWL_SCD_QUEUE_MODIFY),
-		.u.modify.old_sta_mask = cpu_to_le32(old_sta_mask),
-		.u.modify.new_sta_mask = cpu_to_le32(new_sta_mask),
-	};
-	struct iwl_host_cmd hcmd = {
-		.id = WIDE_ID(DATA_PATH_GROUP, SCD_QUEUE_CONFIG_CMD),
-		.len[0] = sizeof(cmd),
-		.data[0] = &cmd
-	};
+	struct iwl_scd_queue_cfg_cmd cmds[IWL_MAX_TID_COUNT + 1];
+	struct iwl_host_cmd hcmds[IWL_MAX_TID_COUNT + 1];
+	int n_cmds = 0;
 	int tid;
-	int ret;
 
 	lockdep_assert_held(&mvm->mutex);
 
+	BUILD_BUG_ON(ARRAY_SIZE(hcmds) > IWL_MVM_CMD_BATCH_MAX);
+
+	/* the queues are independent, so update them all in one go */
 	for (tid = 0; tid <= IWL_MAX_TID_COUNT; tid++) {
 		struct iwl_mvm_tid_data *tid_data = &mvm_sta->tid_data[tid];
+		struct iwl_scd_queue_cfg_cmd *cmd = &cmds[n_cmds];
 		int txq_id = tid_data->txq_id;
 
 		if (txq_id == IWL_MVM_INVALID_QUEUE)
 			continue;
 
+		*cmd = (struct iwl_scd_queue_cfg_cmd) {
+			.operation = cpu_to_le32(IWL_SCD_QUEUE_MODIFY),
+			.u.modify.old_sta_mask = cpu_to_le32(old_sta_mask),
+			.u.modify.new_sta_mask = cpu_to_le32(new_sta_mask),
+		};
+
 		if (tid == IWL_MAX_TID_COUNT)
-			cmd.u.modify.tid = cpu_to_le32(IWL_MGMT_TID);
+			cmd->u.modify.tid = cpu_to_le32(IWL_MGMT_TID);
 		else
-			cmd.u.modify.tid = cpu_to_le32(tid);
+			cmd->u.modify.tid = cpu_to_le32(tid);
 
-		ret = iwl_mvm_send_cmd(mvm, &hcmd);
-		if (ret)
-			return ret;
+		hcmds[n_cmds++] = (struct iwl_host_cmd) {
+			.id = WIDE_ID(DATA_PATH_GROUP, SCD_QUEUE_CONFIG_CMD),
+			.len[0] = sizeof(*cmd),
+			.data[0] = cmd,
+		};
 	}
 
-	return 0;
+	return iwl_mvm_send_cmd_batch(mvm, hcmds, n_cmds, NULL);
 }
 
 static int iwl_mvm_mld_update_sta_baids(struct iwl_mvm *mvm,
@@ -589,6 +589,20 @@ struct iwl_mvm_frame_stats {
 	int last_frame_idx;
 };
 
+#define IWL_MVM_CMD_LAT_LOG_SIZE	64
+
+/**
+ * struct iwl_mvm_cmd_lat - host command latency log entry
+ * @id: command ID
+ * @latency_us: time from sending the command to its response
+ * @batched: sent as part of iwl_mvm_send_cmd_batch()
+ */
+struct iwl_mvm_cmd_lat {
+	u32 id;
+	u32 latency_us;
+	bool batched;
+};
+
 #define IWL_MVM_DEBUG_SET_TEMPERATURE_DISABLE 0xff
 #define IWL_MVM_DEBUG_SET_TEMPERATURE_MIN -100
 #define IWL_MVM_DEBUG_SET_TEMPERATURE_MAX 200
@@ -669,23 +683,30 @@ struct iwl_mvm_tdls_peer_counter {
  * @head_sn: reorder window head sn
  * @num_stored: number of mpdus stored in the buffer
  * @buf_size: the reorder buffer size as set by the last addba request
+ * @index_mask: entries are indexed by sn & index_mask, there are
+ *	roundup_pow_of_two(buf_size) of them so consecutive SNs always map
+ *	to consecutive entries, even when the SN wraps
  * @queue: queue of this reorder buffer
  * @last_amsdu: track last ASMDU SN for duplication detection
  * @last_sub_index: track ASMDU sub frame index for duplication detection
  * @valid: reordering is valid for this queue
  * @lock: protect reorder buffer internal state
  * @mvm: mvm pointer, needed for frame timer context
+ * @stored: entries (indexed by sn & index_mask) that hold frames, so that
+ *	releasing doesn't have to look at every slot up to the NSSN
  */
 struct iwl_mvm_reorder_buffer {
 	u16 head_sn;
 	u16 num_stored;
 	u16 buf_size;
+	u16 index_mask;
 	int queue;
 	u16 last_amsdu;
 	u8 last_sub_index;
 	bool valid;
 	spinlock_t lock;
 	struct iwl_mvm *mvm;
+	DECLARE_BITMAP(stored, IEEE80211_MAX_AMPDU_BUF_EHT);
 } ____cacheline_aligned_in_smp;
 
 /**
@@ -701,6 +722,22 @@ __aligned(roundup_pow_of_two(sizeof(struct sk_buff_head)))
 #endif
 ;
 
+/**
+ * struct iwl_mvm_reorder_stats - frame release statistics, per RX queue
+ * @frame_release: frame release notifications (and BARs) handled
+ * @frame_release_frames: frames released to mac80211 by them
+ * @frame_release_ns: total time spent handling them
+ * @frame_release_max_ns: longest time spent handling a single one
+ *
+ * Only updated from the RX queue's own NAPI context, so no locking.
+ */
+struct iwl_mvm_reorder_stats {
+	u64 frame_release;
+	u64 frame_release_frames;
+	u64 frame_release_ns;
+	u64 frame_release_max_ns;
+} ____cacheline_aligned_in_smp;
+
 /**
  * struct iwl_mvm_baid_data - BA session data
  * @sta_mask: current station mask for the BAID
@@ -996,6 +1033,10 @@ struct iwl_mvm {
 	struct iwl_mvm_frame_stats drv_rx_stats;
 	spinlock_t drv_stats_lock;
 	u16 dbgfs_rx_phyinfo;
+
+	/* protected by the mutex */
+	struct iwl_mvm_cmd_lat cmd_lat[IWL_MVM_CMD_LAT_LOG_SIZE];
+	unsigned int cmd_lat_idx;
 #endif
 	struct iwl_mvm_phy_ctxt phy_ctxts[NUM_PHY_CTX];
 
@@ -1208,6 +1249,7 @@ struct iwl_mvm {
 
 	struct ieee80211_vif *nan_vif;
 	struct iwl_mvm_baid_data __rcu *baid_map[IWL_MAX_BAID];
+	struct iwl_mvm_reorder_stats reorder_stats[IWL_MAX_RX_HW_QUEUES];
 
 	/*
 	 * Drop beacons from other APs in AP mode when there are no connected
@@ -1695,6 +1737,10 @@ int __must_check iwl_mvm_send_cmd_status(struct iwl_mvm *mvm,
 int __must_check iwl_mvm_send_cmd_pdu_status(struct iwl_mvm *mvm, u32 id,
 					     u16 len, const void *data,
 					     u32 *status);
+#define IWL_MVM_CMD_BATCH_MAX	16
+int __must_check iwl_mvm_send_cmd_batch(struct iwl_mvm *mvm,
+					struct iwl_host_cmd *cmds,
+					int n_cmds, u32 *status);
 int iwl_mvm_tx_skb_sta(struct iwl_mvm *mvm, struct sk_buff *skb,
 		       struct ieee80211_sta *sta);
 int iwl_mvm_tx_skb_non_sta(struct iwl_mvm *mvm, struct sk_buff *skb);
@@ -1837,6 +1883,19 @@ void iwl_mvm_rx_bar_frame_release(struct iwl_mvm *mvm, struct napi_struct *napi,
 				  struct iwl_rx_cmd_buffer *rxb, int queue);
 void iwl_mvm_rx_queue_notif(struct iwl_mvm *mvm, struct napi_struct *napi,
 			    struct iwl_rx_cmd_buffer *rxb, int queue);
+#if IS_ENABLED(CPTCFG_IWLWIFI_KUNIT_TESTS)
+void iwl_mvm_reorder_buf_init(struct iwl_mvm_reorder_buffer *buffer,
+			      struct iwl_mvm_reorder_buf_entry *entries,
+			      u16 ssn, u16 buf_size);
+bool iwl_mvm_reorder_buf_add(struct iwl_mvm_reorder_buffer *buffer,
+			     struct iwl_mvm_reorder_buf_entry *entries,
+			     struct sk_buff *skb,
+			     const struct iwl_rx_mpdu_desc *desc,
+			     struct sk_buff_head *release);
+void iwl_mvm_reorder_buf_release(struct iwl_mvm_reorder_buffer *buffer,
+				 struct iwl_mvm_reorder_buf_entry *entries,
+				 u16 nssn, struct sk_buff_head *release);
+#endif
 void iwl_mvm_rx_tx_cmd(struct iwl_mvm *mvm, struct iwl_rx_cmd_buffer *rxb);
 void iwl_mvm_mfu_assert_dump_notif(struct iwl_mvm *mvm,
 				   struct iwl_rx_cmd_buffer *rxb);
@@ -2808,6 +2867,13 @@ int iwl_mvm_set_tx_power(struct iwl_mvm *mvm, struct ieee80211_vif *vif,
 int iwl_mvm_set_hw_timestamp(struct ieee80211_hw *hw,
 			     struct ieee80211_vif *vif,
 			     struct cfg80211_set_hw_timestamp *hwts);
+int iwl_mvm_mac_get_et_sset_count(struct ieee80211_hw *hw,
+				  struct ieee80211_vif *vif, int sset);
+void iwl_mvm_mac_get_et_strings(struct ieee80211_hw *hw,
+				struct ieee80211_vif *vif, u32 sset, u8 *data);
+void iwl_mvm_mac_get_et_stats(struct ieee80211_hw *hw,
+			      struct ieee80211_vif *vif,
+			      struct ethtool_stats *stats, u64 *data);
 int iwl_mvm_update_mu_groups(struct iwl_mvm *mvm, struct ieee80211_vif *vif);
 void iwl_mvm_set_twt_testmode(struct iwl_mvm *mvm);
 bool iwl_mvm_eval_dsm_rfi(struct iwl_mvm *mvm);
@@ -86,7 +86,7 @@ static void iwl_mvm_pass_packet_to_mac80211(struct iwl_mvm *mvm,
 		int offset = (u8 *)hdr + hdrlen -
 			     (u8 *)rxb_addr(rxb) + rxb_offset(rxb);
 
-		skb_add_rx_frag(skb, 0, rxb_steal_page(rxb), offset,
+		skb_add_rx_frag(skb, 0, rxb_steal_page_skb(rxb, skb), offset,
 				fraglen, rxb->truesize);
 	}
 
@@ -182,7 +182,7 @@ static int iwl_mvm_create_skb(struct iwl_mvm *mvm, struct sk_buff *skb,
 		int offset = (u8 *)hdr + headlen + pad_len -
 			     (u8 *)rxb_addr(rxb) + rxb_offset(rxb);
 
-		skb_add_rx_frag(skb, 0, rxb_steal_page(rxb), offset,
+		skb_add_rx_frag(skb, 0, rxb_steal_page_skb(rxb, skb), offset,
 				fraglen, rxb->truesize);
 	}
 
@@ -557,40 +557,94 @@ static bool iwl_mvm_is_dup(struct ieee80211_sta *sta, int queue,
 	return false;
 }
 
-static void iwl_mvm_release_frames(struct iwl_mvm *mvm,
-				   struct ieee80211_sta *sta,
-				   struct napi_struct *napi,
-				   struct iwl_mvm_baid_data *baid_data,
-				   struct iwl_mvm_reorder_buffer *reorder_buf,
-				   u16 nssn)
+static void iwl_mvm_reorder_buf_pop(struct iwl_mvm_reorder_buffer *buffer,
+				    struct iwl_mvm_reorder_buf_entry *entries,
+				    unsigned int start, unsigned int end,
+				    struct sk_buff_head *release)
 {
-	struct iwl_mvm_reorder_buf_entry *entries =
-		&baid_data->entries[reorder_buf->queue *
-				    baid_data->entries_per_queue];
-	u16 ssn = reorder_buf->head_sn;
+	unsigned int index = start;
 
-	lockdep_assert_held(&reorder_buf->lock);
+	/*
+	 * Only look at the entries that hold frames. The others are valid
+	 * as well, since nssn indicates those frames were received (or
+	 * given up on), and there's nothing to do for them.
+	 */
+	for_each_set_bit_from(index, buffer->stored, end) {
+		struct sk_buff_head *frames = &entries[index].frames;
+
+		/* will have more than one frame for A-MSDU */
+		buffer->num_stored -= skb_queue_len(frames);
+		skb_queue_splice_tail_init(frames, release);
+		__clear_bit(index, buffer->stored);
+	}
+}
+
+/*
+ * Move all frames before @nssn from the reorder buffer to @release, in
+ * order, and advance the head of the reorder window to @nssn.
+ */
+VISIBLE_IF_IWLWIFI_KUNIT
+void iwl_mvm_reorder_buf_release(struct iwl_mvm_reorder_buffer *buffer,
+				 struct iwl_mvm_reorder_buf_entry *entries,
+				 u16 nssn, struct sk_buff_head *release)
+{
+	unsigned int size = buffer->index_mask + 1;
+	unsigned int start, end;
+
+	lockdep_assert_held(&buffer->lock);
+
+	if (buffer->num_stored && ieee80211_sn_less(buffer->head_sn, nssn)) {
+		/* never walk more than the whole window, whatever the nssn */
+		start = buffer->head_sn & buffer->index_mask;
+		end = start + min_t(u16, buffer->buf_size,
+				    ieee80211_sn_sub(nssn, buffer->head_sn));
 
-	while (ieee80211_sn_less(ssn, nssn)) {
-		int index = ssn % reorder_buf->buf_size;
-		struct sk_buff_head *skb_list = &entries[index].frames;
-		struct sk_buff *skb;
+		/* the window may wrap around the end of the entries */
+		iwl_mvm_reorder_buf_pop(buffer, entries, start,
+					min_t(unsigned int, end, size), release);
+		if (end > size)
+			iwl_mvm_reorder_buf_pop(buffer, entries, 0, end - size,
+						release);
+	}
+
+	buffer->head_sn = nssn;
+}
+EXPORT_SYMBOL_IF_IWLWIFI_KUNIT(iwl_mvm_reorder_buf_release);
 
-		ssn = ieee80211_sn_inc(ssn);
+/* returns the number of frames that were passed to mac80211 */
+static unsigned int iwl_mvm_release_frames(struct iwl_mvm *mvm,
+					   struct ieee80211_sta *sta,
+					   struct napi_struct *napi, int queue,
+					   struct sk_buff_head *release)
+{
+	struct sk_buff *skbs[16];
+	unsigned int n_skbs = 0, n_released = 0;
+	struct sk_buff *skb;
+
+	while ((skb = __skb_dequeue(release))) {
+		if (unlikely(iwl_mvm_check_pn(mvm, skb, queue, sta))) {
+			kfree_skb(skb);
+			continue;
+		}
 
 		/*
-		 * Empty the list. Will have more than one frame for A-MSDU.
-		 * Empty list is valid as well since nssn indicates frames were
-		 * received.
+		 * All frames are for the same station and TID, so
+		 * hand them to mac80211 in batches.
+		 * FIXME: link station
 		 */
-		while ((skb = __skb_dequeue(skb_list))) {
-			iwl_mvm_pass_packet_to_mac80211(mvm, napi, skb,
-							reorder_buf->queue,
-							sta, NULL /* FIXME */);
-			reorder_buf->num_stored--;
+		skbs[n_skbs++] = skb;
+		n_released++;
+		if (n_skbs == ARRAY_SIZE(skbs)) {
+			ieee80211_rx_napi_batch(mvm->hw, sta, skbs,
+						n_skbs, napi);
+			n_skbs = 0;
 		}
 	}
-	reorder_buf->head_sn = nssn;
+
+	if (n_skbs)
+		ieee80211_rx_napi_batch(mvm->hw, sta, skbs, n_skbs, napi);
+
+	return n_released;
 }
 
 static void iwl_mvm_del_ba(struct iwl_mvm *mvm, int queue,
@@ -599,6 +653,8 @@ static void iwl_mvm_del_ba(struct iwl_mvm *mvm, int queue,
 	struct iwl_mvm_baid_data *ba_data;
 	struct ieee80211_sta *sta;
 	struct iwl_mvm_reorder_buffer *reorder_buf;
+	struct iwl_mvm_reorder_buf_entry *entries;
+	struct sk_buff_head release;
 	u8 baid = data->baid;
 	u32 sta_id;
 
@@ -618,12 +674,16 @@ static void iwl_mvm_del_ba(struct iwl_mvm *mvm, int queue,
 		goto out;
 
 	reorder_buf = &ba_data->reorder_buf[queue];
+	entries = &ba_data->entries[queue * ba_data->entries_per_queue];
+	__skb_queue_head_init(&release);
 
 	/* release all frames that are in the reorder buffer to the stack */
 	spin_lock_bh(&reorder_buf->lock);
-	iwl_mvm_release_frames(mvm, sta, NULL, ba_data, reorder_buf,
-			       ieee80211_sn_add(reorder_buf->head_sn,
-						reorder_buf->buf_size));
+	iwl_mvm_reorder_buf_release(reorder_buf, entries,
+				    ieee80211_sn_add(reorder_buf->head_sn,
+						     reorder_buf->buf_size),
+				    &release);
+	iwl_mvm_release_frames(mvm, sta, NULL, queue, &release);
 	spin_unlock_bh(&reorder_buf->lock);
 
 out:
@@ -634,10 +694,16 @@ static void iwl_mvm_release_frames_from_notif(struct iwl_mvm *mvm,
 					      struct napi_struct *napi,
 					      u8 baid, u16 nssn, int queue)
 {
+	struct iwl_mvm_reorder_stats *stats = &mvm->reorder_stats[queue];
 	struct ieee80211_sta *sta;
 	struct iwl_mvm_reorder_buffer *reorder_buf;
 	struct iwl_mvm_baid_data *ba_data;
+	struct iwl_mvm_reorder_buf_entry *entries;
+	struct sk_buff_head release;
+	u64 start = ktime_get_ns();
+	unsigned int released;
 	u32 sta_id;
+	u64 delta;
 
 	IWL_DEBUG_HT(mvm, "Frame release notification for BAID %u, NSSN %d\n",
 		     baid, nssn);
@@ -661,12 +727,21 @@ static void iwl_mvm_release_frames_from_notif(struct iwl_mvm *mvm,
 		goto out;
 
 	reorder_buf = &ba_data->reorder_buf[queue];
+	entries = &ba_data->entries[queue * ba_data->entries_per_queue];
+	__skb_queue_head_init(&release);
 
 	spin_lock_bh(&reorder_buf->lock);
-	iwl_mvm_release_frames(mvm, sta, napi, ba_data,
-			       reorder_buf, nssn);
+	iwl_mvm_reorder_buf_release(reorder_buf, entries, nssn, &release);
+	released = iwl_mvm_release_frames(mvm, sta, napi, queue, &release);
 	spin_unlock_bh(&reorder_buf->lock);
 
+	delta = ktime_get_ns() - start;
+	stats->frame_release++;
+	stats->frame_release_frames += released;
+	stats->frame_release_ns += delta;
+	if (delta > stats->frame_release_max_ns)
+		stats->frame_release_max_ns = delta;
+
 out:
 	rcu_read_unlock();
 }
@@ -720,95 +795,34 @@ void iwl_mvm_rx_queue_notif(struct iwl_mvm *mvm, struct napi_struct *napi,
 
 /*
  * Returns true if the MPDU was buffered\dropped, false if it should be passed
- * to upper layer.
+ * to upper layer. Frames that can be released to the upper layer (possibly
+ * including this MPDU) are moved to @release.
  */
-static bool iwl_mvm_reorder(struct iwl_mvm *mvm,
-			    struct napi_struct *napi,
-			    int queue,
-			    struct ieee80211_sta *sta,
-			    struct sk_buff *skb,
-			    struct iwl_rx_mpdu_desc *desc)
+VISIBLE_IF_IWLWIFI_KUNIT
+bool iwl_mvm_reorder_buf_add(struct iwl_mvm_reorder_buffer *buffer,
+			     struct iwl_mvm_reorder_buf_entry *entries,
+			     struct sk_buff *skb,
+			     const struct iwl_rx_mpdu_desc *desc,
+			     struct sk_buff_head *release)
 {
-	struct ieee80211_hdr *hdr = (void *)skb_mac_header(skb);
-	struct iwl_mvm_baid_data *baid_data;
-	struct iwl_mvm_reorder_buffer *buffer;
 	u32 reorder = le32_to_cpu(desc->reorder_data);
 	bool amsdu = desc->mac_flags2 & IWL_RX_MPDU_MFLG2_AMSDU;
 	bool last_subframe =
 		desc->amsdu_info & IWL_RX_MPDU_AMSDU_LAST_SUBFRAME;
-	u8 tid = ieee80211_get_tid(hdr);
 	u8 sub_frame_idx = desc->amsdu_info &
 			   IWL_RX_MPDU_AMSDU_SUBFRAME_IDX_MASK;
-	struct iwl_mvm_reorder_buf_entry *entries;
-	u32 sta_mask;
 	int index;
 	u16 nssn, sn;
-	u8 baid;
-
-	baid = (reorder & IWL_RX_MPDU_REORDER_BAID_MASK) >>
-		IWL_RX_MPDU_REORDER_BAID_SHIFT;
-
-	if (mvm->trans->trans_cfg->device_family == IWL_DEVICE_FAMILY_9000)
-		return false;
 
-	/*
-	 * This also covers the case of receiving a Block Ack Request
-	 * outside a BA session; we'll pass it to mac80211 and that
-	 * then sends a delBA action frame.
-	 * This also covers pure monitor mode, in which case we won't
-	 * have any BA sessions.
-	 */
-	if (baid == IWL_RX_REORDER_DATA_INVALID_BAID)
-		return false;
-
-	/* no sta yet */
-	if (WARN_ONCE(IS_ERR_OR_NULL(sta),
-		      "Got valid BAID without a valid station assigned\n"))
-		return false;
-
-	/* not a data packet or a bar */
-	if (!ieee80211_is_back_req(hdr->frame_control) &&
-	    (!ieee80211_is_data_qos(hdr->frame_control) ||
-	     is_multicast_ether_addr(hdr->addr1)))
-		return false;
-
-	if (unlikely(!ieee80211_is_data_present(hdr->frame_control)))
-		return false;
-
-	baid_data = rcu_dereference(mvm->baid_map[baid]);
-	if (!baid_data) {
-		IWL_DEBUG_RX(mvm,
-			     "Got valid BAID but no baid allocated, bypass the re-ordering buffer. Baid %d reorder 0x%x\n",
-			      baid, reorder);
-		return false;
-	}
-
-	rcu_read_lock();
-	sta_mask = iwl_mvm_sta_fw_id_mask(mvm, sta, -1);
-	rcu_read_unlock();
-
-	if (IWL_FW_CHECK(mvm,
-			 tid != baid_data->tid ||
-			 !(sta_mask & baid_data->sta_mask),
-			 "baid 0x%x is mapped to sta_mask:0x%x tid:%d, but was received for sta_mask:0x%x tid:%d\n",
-			 baid, baid_data->sta_mask, baid_data->tid,
-			 sta_mask, tid))
-		return false;
+	lockdep_assert_held(&buffer->lock);
 
 	nssn = reorder & IWL_RX_MPDU_REORDER_NSSN_MASK;
 	sn = (reorder & IWL_RX_MPDU_REORDER_SN_MASK) >>
 		IWL_RX_MPDU_REORDER_SN_SHIFT;
 
-	buffer = &baid_data->reorder_buf[queue];
-	entries = &baid_data->entries[queue * baid_data->entries_per_queue];
-
-	spin_lock_bh(&buffer->lock);
-
 	if (!buffer->valid) {
-		if (reorder & IWL_RX_MPDU_REORDER_BA_OLD_SN) {
-			spin_unlock_bh(&buffer->lock);
+		if (reorder & IWL_RX_MPDU_REORDER_BA_OLD_SN)
 			return false;
-		}
 		buffer->valid = true;
 	}
 
@@ -825,7 +839,6 @@ static bool iwl_mvm_reorder(struct iwl_mvm *mvm,
 		if (!amsdu || last_subframe)
 			buffer->head_sn = nssn;
 		/* No need to update AMSDU last SN - we are moving the head */
-		spin_unlock_bh(&buffer->lock);
 		return false;
 	}
 
@@ -842,13 +855,13 @@ static bool iwl_mvm_reorder(struct iwl_mvm *mvm,
 			buffer->head_sn = ieee80211_sn_inc(buffer->head_sn);
 
 		/* No need to update AMSDU last SN - we are moving the head */
-		spin_unlock_bh(&buffer->lock);
 		return false;
 	}
 
 	/* put in reorder buffer */
-	index = sn % buffer->buf_size;
+	index = sn & buffer->index_mask;
 	__skb_queue_tail(&entries[index].frames, skb);
+	__set_bit(index, buffer->stored);
 	buffer->num_stored++;
 
 	if (amsdu) {
@@ -868,17 +881,99 @@ static bool iwl_mvm_reorder(struct iwl_mvm *mvm,
 	 * release notification with up to date NSSN.
 	 */
 	if (!amsdu || last_subframe)
-		iwl_mvm_release_frames(mvm, sta, napi, baid_data,
-				       buffer, nssn);
+		iwl_mvm_reorder_buf_release(buffer, entries, nssn, release);
 
-	spin_unlock_bh(&buffer->lock);
 	return true;
 
 drop:
 	kfree_skb(skb);
-	spin_unlock_bh(&buffer->lock);
 	return true;
 }
+EXPORT_SYMBOL_IF_IWLWIFI_KUNIT(iwl_mvm_reorder_buf_add);
+
+/*
+ * Returns true if the MPDU was buffered\dropped, false if it should be passed
+ * to upper layer.
+ */
+static bool iwl_mvm_reorder(struct iwl_mvm *mvm,
+			    struct napi_struct *napi,
+			    int queue,
+			    struct ieee80211_sta *sta,
+			    struct sk_buff *skb,
+			    struct iwl_rx_mpdu_desc *desc)
+{
+	struct ieee80211_hdr *hdr = (void *)skb_mac_header(skb);
+	struct iwl_mvm_baid_data *baid_data;
+	struct iwl_mvm_reorder_buffer *buffer;
+	u32 reorder = le32_to_cpu(desc->reorder_data);
+	u8 tid = ieee80211_get_tid(hdr);
+	struct iwl_mvm_reorder_buf_entry *entries;
+	struct sk_buff_head release;
+	u32 sta_mask;
+	bool ret;
+	u8 baid;
+
+	baid = (reorder & IWL_RX_MPDU_REORDER_BAID_MASK) >>
+		IWL_RX_MPDU_REORDER_BAID_SHIFT;
+
+	if (mvm->trans->trans_cfg->device_family == IWL_DEVICE_FAMILY_9000)
+		return false;
+
+	/*
+	 * This also covers the case of receiving a Block Ack Request
+	 * outside a BA session; we'll pass it to mac80211 and that
+	 * then sends a delBA action frame.
+	 * This also covers pure monitor mode, in which case we won't
+	 * have any BA sessions.
+	 */
+	if (baid == IWL_RX_REORDER_DATA_INVALID_BAID)
+		return false;
+
+	/* no sta yet */
+	if (WARN_ONCE(IS_ERR_OR_NULL(sta),
+		      "Got valid BAID without a valid station assigned\n"))
+		return false;
+
+	/* not a data packet or a bar */
+	if (!ieee80211_is_back_req(hdr->frame_control) &&
+	    (!ieee80211_is_data_qos(hdr->frame_control) ||
+	     is_multicast_ether_addr(hdr->addr1)))
+		return false;
+
+	if (unlikely(!ieee80211_is_data_present(hdr->frame_control)))
+		return false;
+
+	baid_data = rcu_dereference(mvm->baid_map[baid]);
+	if (!baid_data) {
+		IWL_DEBUG_RX(mvm,
+			     "Got valid BAID but no baid allocated, bypass the re-ordering buffer. Baid %d reorder 0x%x\n",
+			      baid, reorder);
+		return false;
+	}
+
+	rcu_read_lock();
+	sta_mask = iwl_mvm_sta_fw_id_mask(mvm, sta, -1);
+	rcu_read_unlock();
+
+	if (IWL_FW_CHECK(mvm,
+			 tid != baid_data->tid ||
+			 !(sta_mask & baid_data->sta_mask),
+			 "baid 0x%x is mapped to sta_mask:0x%x tid:%d, but was received for sta_mask:0x%x tid:%d\n",
+			 baid, baid_data->sta_mask, baid_data->tid,
+			 sta_mask, tid))
+		return false;
+
+	buffer = &baid_data->reorder_buf[queue];
+	entries = &baid_data->entries[queue * baid_data->entries_per_queue];
+	__skb_queue_head_init(&release);
+
+	spin_lock_bh(&buffer->lock);
+	ret = iwl_mvm_reorder_buf_add(buffer, entries, skb, desc, &release);
+	iwl_mvm_release_frames(mvm, sta, napi, queue, &release);
+	spin_unlock_bh(&buffer->lock);
+
+	return ret;
+}
 
 static void iwl_mvm_agg_rx_received(struct iwl_mvm *mvm,
 				    u32 reorder_data, u8 baid)
@@ -2715,13 +2715,33 @@ static void iwl_mvm_free_reorder(struct iwl_mvm *mvm,
 		 */
 		WARN_ON(1);
 
-		for (j = 0; j < reorder_buf->buf_size; j++)
+		for (j = 0; j <= reorder_buf->index_mask; j++)
 			__skb_queue_purge(&entries[j].frames);
+		bitmap_zero(reorder_buf->stored, reorder_buf->index_mask + 1);
 
 		spin_unlock_bh(&reorder_buf->lock);
 	}
 }
 
+VISIBLE_IF_IWLWIFI_KUNIT
+void iwl_mvm_reorder_buf_init(struct iwl_mvm_reorder_buffer *buffer,
+			      struct iwl_mvm_reorder_buf_entry *entries,
+			      u16 ssn, u16 buf_size)
+{
+	int i;
+
+	buffer->num_stored = 0;
+	buffer->head_sn = ssn;
+	buffer->buf_size = buf_size;
+	buffer->index_mask = roundup_pow_of_two(buf_size) - 1;
+	spin_lock_init(&buffer->lock);
+	buffer->valid = false;
+	bitmap_zero(buffer->stored, buffer->index_mask + 1);
+	for (i = 0; i <= buffer->index_mask; i++)
+		__skb_queue_head_init(&entries[i].frames);
+}
+EXPORT_SYMBOL_IF_IWLWIFI_KUNIT(iwl_mvm_reorder_buf_init);
+
 static void iwl_mvm_init_reorder_buffer(struct iwl_mvm *mvm,
 					struct iwl_mvm_baid_data *data,
 					u16 ssn, u16 buf_size)
@@ -2733,17 +2753,10 @@ static void iwl_mvm_init_reorder_buffer(struct iwl_mvm *mvm,
 			&data->reorder_buf[i];
 		struct iwl_mvm_reorder_buf_entry *entries =
 			&data->entries[i * data->entries_per_queue];
-		int j;
 
-		reorder_buf->num_stored = 0;
-		reorder_buf->head_sn = ssn;
-		reorder_buf->buf_size = buf_size;
-		spin_lock_init(&reorder_buf->lock);
+		iwl_mvm_reorder_buf_init(reorder_buf, entries, ssn, buf_size);
 		reorder_buf->mvm = mvm;
 		reorder_buf->queue = i;
-		reorder_buf->valid = false;
-		for (j = 0; j < reorder_buf->buf_size; j++)
-			__skb_queue_head_init(&entries[j].frames);
 	}
 }
 
@@ -2875,7 +2888,17 @@ int iwl_mvm_sta_rx_agg(struct iwl_mvm *mvm, struct ieee80211_sta *sta,
 	}
 
 	if (iwl_mvm_has_new_rx_api(mvm) && start) {
-		u32 reorder_buf_size = buf_size * sizeof(baid_data->entries[0]);
+		u32 reorder_buf_size;
+
+		/* the occupancy bitmap has room for this many entries */
+		if (WARN_ON(!buf_size ||
+			    roundup_pow_of_two(buf_size) >
+			    IEEE80211_MAX_AMPDU_BUF_EHT))
+			return -EINVAL;
+
+		/* entries are indexed by sn & index_mask */
+		reorder_buf_size = roundup_pow_of_two(buf_size) *
+				   sizeof(baid_data->entries[0]);
 
 		/* sparse doesn't like the __align() so don't check */
 #ifndef __CHECKER__
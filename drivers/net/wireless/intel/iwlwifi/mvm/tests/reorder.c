@@ -0,0 +1,351 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/*
+ * KUnit tests for the RX reorder buffer
+ */
+#include <kunit/test.h>
+#include "../mvm.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+struct reorder_test_buf {
+	struct iwl_mvm_reorder_buffer buffer;
+	struct iwl_mvm_reorder_buf_entry entries[IEEE80211_MAX_AMPDU_BUF_EHT];
+};
+
+#define REORDER_TEST_SN(skb)	(*(u16 *)(skb)->cb)
+
+enum reorder_test_op {
+	REORDER_TEST_END,
+	REORDER_TEST_RX,
+	REORDER_TEST_RELEASE,
+};
+
+struct reorder_test_step {
+	enum reorder_test_op op;
+	u16 sn, nssn;
+	u32 flags;
+	bool amsdu;
+	u8 amsdu_info;
+	bool buffered;
+	u8 n_released;
+	u16 released[4];
+};
+
+static const struct reorder_test_case {
+	const char *desc;
+	u16 ssn, buf_size;
+	struct reorder_test_step steps[5];
+	u16 head_sn, num_stored;
+} reorder_steps_cases[] = {
+	{
+		.desc = "in order",
+		.ssn = 100,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 100, .nssn = 101,
+			  .n_released = 1, .released = { 100 } },
+			{ .op = REORDER_TEST_RX, .sn = 101, .nssn = 102,
+			  .n_released = 1, .released = { 101 } },
+			{ .op = REORDER_TEST_RX, .sn = 102, .nssn = 103,
+			  .n_released = 1, .released = { 102 } },
+		},
+		.head_sn = 103,
+	},
+	{
+		.desc = "hole",
+		.ssn = 0,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 1, .nssn = 0,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 2, .nssn = 0,
+			  .buffered = true },
+			/* filling the hole releases everything in order */
+			{ .op = REORDER_TEST_RX, .sn = 0, .nssn = 3,
+			  .buffered = true,
+			  .n_released = 3, .released = { 0, 1, 2 } },
+		},
+		.head_sn = 3,
+	},
+	{
+		.desc = "A-MSDU",
+		.ssn = 0,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 2, .nssn = 0,
+			  .buffered = true },
+			/* NSSN can't be trusted before the last subframe */
+			{ .op = REORDER_TEST_RX, .sn = 0, .nssn = 3,
+			  .amsdu = true, .amsdu_info = 0, .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 0, .nssn = 3,
+			  .amsdu = true, .amsdu_info = 1, .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 0, .nssn = 1,
+			  .amsdu = true,
+			  .amsdu_info = 2 | IWL_RX_MPDU_AMSDU_LAST_SUBFRAME,
+			  .buffered = true,
+			  .n_released = 3, .released = { 0, 0, 0 } },
+			{ .op = REORDER_TEST_RELEASE, .nssn = 3,
+			  .n_released = 1, .released = { 2 } },
+		},
+		.head_sn = 3,
+	},
+	{
+		.desc = "old SN before the first frame",
+		.ssn = 10,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 5, .nssn = 10,
+			  .flags = IWL_RX_MPDU_REORDER_BA_OLD_SN,
+			  .n_released = 1, .released = { 5 } },
+		},
+		.head_sn = 10,
+	},
+	{
+		.desc = "old SN",
+		.ssn = 10,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 12, .nssn = 10,
+			  .buffered = true },
+			/* dropped */
+			{ .op = REORDER_TEST_RX, .sn = 5, .nssn = 10,
+			  .flags = IWL_RX_MPDU_REORDER_BA_OLD_SN,
+			  .buffered = true },
+		},
+		.head_sn = 10,
+		.num_stored = 1,
+	},
+	{
+		.desc = "SN at the head after the reorder timer",
+		.ssn = 5,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 5, .nssn = 3,
+			  .n_released = 1, .released = { 5 } },
+		},
+		.head_sn = 6,
+	},
+	{
+		.desc = "NSSN beyond the window",
+		.ssn = 0,
+		.buf_size = 64,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 63, .nssn = 0,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 1, .nssn = 0,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RELEASE, .nssn = 1000,
+			  .n_released = 2, .released = { 1, 63 } },
+		},
+		.head_sn = 1000,
+	},
+	{
+		.desc = "SN wrap with buf_size 100",
+		.ssn = 4090,
+		.buf_size = 100,
+		.steps = {
+			{ .op = REORDER_TEST_RX, .sn = 4095, .nssn = 4090,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 2, .nssn = 4090,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RX, .sn = 4091, .nssn = 4090,
+			  .buffered = true },
+			{ .op = REORDER_TEST_RELEASE, .nssn = 3,
+			  .n_released = 3, .released = { 4091, 4095, 2 } },
+		},
+		.head_sn = 3,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(reorder_steps, reorder_steps_cases, desc);
+
+/*
+ * Run a synthetic MPDU or frame release through the reorder buffer.
+ * Frames that aren't buffered go to @release right after those released
+ * for them, which is the order the driver passes them to mac80211 in.
+ */
+static bool reorder_test_step(struct kunit *test, struct reorder_test_buf *buf,
+			      const struct reorder_test_step *step,
+			      struct sk_buff_head *release)
+{
+	struct iwl_rx_mpdu_desc desc = {
+		.reorder_data =
+			cpu_to_le32(step->flags | step->nssn |
+				    step->sn << IWL_RX_MPDU_REORDER_SN_SHIFT),
+		.mac_flags2 = step->amsdu ? IWL_RX_MPDU_MFLG2_AMSDU : 0,
+		.amsdu_info = step->amsdu_info,
+	};
+	struct sk_buff *skb;
+	bool buffered;
+
+	if (step->op == REORDER_TEST_RELEASE) {
+		spin_lock_bh(&buf->buffer.lock);
+		iwl_mvm_reorder_buf_release(&buf->buffer, buf->entries,
+					    step->nssn, release);
+		spin_unlock_bh(&buf->buffer.lock);
+		return false;
+	}
+
+	skb = alloc_skb(0, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+	REORDER_TEST_SN(skb) = step->sn;
+
+	spin_lock_bh(&buf->buffer.lock);
+	buffered = iwl_mvm_reorder_buf_add(&buf->buffer, buf->entries, skb,
+					   &desc, release);
+	spin_unlock_bh(&buf->buffer.lock);
+
+	if (!buffered)
+		__skb_queue_tail(release, skb);
+
+	return buffered;
+}
+
+static void reorder_test_expect(struct kunit *test,
+				struct sk_buff_head *release,
+				const u16 *sns, unsigned int n_sns)
+{
+	struct sk_buff *skb;
+	unsigned int i = 0;
+
+	KUNIT_EXPECT_EQ(test, skb_queue_len(release), n_sns);
+
+	while ((skb = __skb_dequeue(release))) {
+		if (i < n_sns)
+			KUNIT_EXPECT_EQ_MSG(test, REORDER_TEST_SN(skb), sns[i],
+					    "frame %u", i);
+		i++;
+		kfree_skb(skb);
+	}
+}
+
+/* like iwl_mvm_del_ba(), release whatever is left in the buffer */
+static void reorder_test_flush(struct reorder_test_buf *buf)
+{
+	struct iwl_mvm_reorder_buffer *buffer = &buf->buffer;
+	struct sk_buff_head release;
+
+	__skb_queue_head_init(&release);
+	spin_lock_bh(&buffer->lock);
+	iwl_mvm_reorder_buf_release(buffer, buf->entries,
+				    ieee80211_sn_add(buffer->head_sn,
+						     buffer->buf_size),
+				    &release);
+	spin_unlock_bh(&buffer->lock);
+	__skb_queue_purge(&release);
+}
+
+static void reorder_steps(struct kunit *test)
+{
+	const struct reorder_test_case *params = test->param_value;
+	const struct reorder_test_step *step;
+	struct reorder_test_buf *buf;
+	struct sk_buff_head release;
+
+	buf = kunit_kzalloc(test, sizeof(*buf), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	iwl_mvm_reorder_buf_init(&buf->buffer, buf->entries, params->ssn,
+				 params->buf_size);
+	__skb_queue_head_init(&release);
+
+	for (step = params->steps;
+	     step < params->steps + ARRAY_SIZE(params->steps) &&
+	     step->op != REORDER_TEST_END;
+	     step++) {
+		bool buffered = reorder_test_step(test, buf, step, &release);
+
+		KUNIT_EXPECT_EQ(test, buffered, step->buffered);
+		reorder_test_expect(test, &release, step->released,
+				    step->n_released);
+	}
+
+	KUNIT_EXPECT_EQ(test, buf->buffer.head_sn, params->head_sn);
+	KUNIT_EXPECT_EQ(test, buf->buffer.num_stored, params->num_stored);
+	KUNIT_EXPECT_EQ(test,
+			!bitmap_empty(buf->buffer.stored,
+				      IEEE80211_MAX_AMPDU_BUF_EHT),
+			!!params->num_stored);
+
+	reorder_test_flush(buf);
+}
+
+static const struct reorder_wrap_case {
+	const char *desc;
+	u16 buf_size;
+} reorder_wrap_cases[] = {
+	{ .desc = "buf_size 64", .buf_size = 64, },
+	{ .desc = "buf_size 100", .buf_size = 100, },
+	{ .desc = "buf_size 256", .buf_size = 256, },
+	{ .desc = "buf_size 1000", .buf_size = 1000, },
+	{ .desc = "buf_size 1024", .buf_size = 1024, },
+};
+
+KUNIT_ARRAY_PARAM_DESC(reorder_wrap, reorder_wrap_cases, desc);
+
+static void reorder_wrap(struct kunit *test)
+{
+	const struct reorder_wrap_case *params = test->param_value;
+	u16 buf_size = params->buf_size;
+	/* start close to the end of the SN space, so both wrap */
+	u16 head = IEEE80211_SN_MODULO - buf_size / 2 - 1;
+	u16 nssn = ieee80211_sn_add(head, buf_size + buf_size / 2);
+	struct reorder_test_step step = {};
+	unsigned int i, n = 0, first;
+	struct reorder_test_buf *buf;
+	struct sk_buff_head release;
+	u16 *sns;
+
+	buf = kunit_kzalloc(test, sizeof(*buf), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	iwl_mvm_reorder_buf_init(&buf->buffer, buf->entries, head, buf_size);
+
+	sns = kunit_kcalloc(test, buf_size, sizeof(*sns), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sns);
+	__skb_queue_head_init(&release);
+
+	/* store every third frame of the window, backwards */
+	step.op = REORDER_TEST_RX;
+	step.nssn = head;
+	for (i = buf_size - 1; i > 0; i--) {
+		if (i % 3)
+			continue;
+		step.sn = ieee80211_sn_add(head, i);
+		KUNIT_EXPECT_TRUE(test,
+				  reorder_test_step(test, buf, &step,
+						    &release));
+	}
+	for (i = 3; i < buf_size; i += 3)
+		sns[n++] = ieee80211_sn_add(head, i);
+	KUNIT_EXPECT_EQ(test, buf->buffer.num_stored, n);
+	KUNIT_EXPECT_EQ(test, skb_queue_len(&release), 0);
+
+	/* release the first half of the window */
+	step.op = REORDER_TEST_RELEASE;
+	step.nssn = ieee80211_sn_add(head, buf_size / 2);
+	reorder_test_step(test, buf, &step, &release);
+	first = (buf_size / 2 - 1) / 3;
+	reorder_test_expect(test, &release, sns, first);
+
+	/* and the rest, with an NSSN beyond the end of the window */
+	step.nssn = nssn;
+	reorder_test_step(test, buf, &step, &release);
+	reorder_test_expect(test, &release, sns + first, n - first);
+
+	KUNIT_EXPECT_EQ(test, buf->buffer.num_stored, 0);
+	KUNIT_EXPECT_TRUE(test, bitmap_empty(buf->buffer.stored,
+					     IEEE80211_MAX_AMPDU_BUF_EHT));
+	KUNIT_EXPECT_EQ(test, buf->buffer.head_sn, nssn);
+}
+
+static struct kunit_case reorder_test_cases[] = {
+	KUNIT_CASE_PARAM(reorder_steps, reorder_steps_gen_params),
+	KUNIT_CASE_PARAM(reorder_wrap, reorder_wrap_gen_params),
+	{}
+};
+
+static struct kunit_suite iwlmvm_reorder = {
+	.name = "iwlmvm-reorder",
+	.test_cases = reorder_test_cases,
+};
+
+kunit_test_suite(iwlmvm_reorder);
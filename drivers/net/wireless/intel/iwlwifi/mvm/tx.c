@@ -2041,6 +2041,7 @@ static void iwl_mvm_tx_reclaim(struct iwl_mvm *mvm, int sta_id, int tid,
 {
 	struct sk_buff_head reclaimed_skbs;
 	struct iwl_mvm_tid_data *tid_data = NULL;
+	struct ieee80211_tx_info *rs_info = NULL;
 	struct ieee80211_sta *sta;
 	struct iwl_mvm_sta *mvmsta = NULL;
 	struct sk_buff *skb;
@@ -2144,6 +2145,7 @@ static void iwl_mvm_tx_reclaim(struct iwl_mvm *mvm, int sta_id, int tid,
 			memcpy(&info->status, &tx_info->status,
 			       sizeof(tx_info->status));
 			iwl_mvm_hwrate_to_tx_status(mvm->fw, rate, info);
+			rs_info = info;
 		}
 	}
 
@@ -2173,6 +2175,18 @@ static void iwl_mvm_tx_reclaim(struct iwl_mvm *mvm, int sta_id, int tid,
 	}
 
 out:
+	/* report the whole BA at once, the status is shared by all frames */
+	if (!IS_ERR(sta) && !skb_queue_empty(&reclaimed_skbs)) {
+		struct ieee80211_tx_status status = {
+			.sta = sta,
+			.info = rs_info ?:
+				IEEE80211_SKB_CB(skb_peek(&reclaimed_skbs)),
+		};
+
+		ieee80211_tx_status_batch(mvm->hw, &status, tid, 0,
+					  &reclaimed_skbs);
+	}
+
 	rcu_read_unlock();
 
 	while (!skb_queue_empty(&reclaimed_skbs)) {
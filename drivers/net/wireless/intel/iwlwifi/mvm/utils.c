@@ -14,6 +14,46 @@
 #include "fw/api/rs.h"
 #include "fw/img.h"
 
+#ifdef CPTCFG_IWLWIFI_DEBUGFS
+static void iwl_mvm_cmd_lat_record(struct iwl_mvm *mvm, u32 id, ktime_t start,
+				   ktime_t end, bool batched)
+{
+	struct iwl_mvm_cmd_lat *lat = &mvm->cmd_lat[mvm->cmd_lat_idx];
+
+	lockdep_assert_held(&mvm->mutex);
+
+	lat->id = id;
+	lat->latency_us = min_t(s64, ktime_us_delta(end, start), U32_MAX);
+	lat->batched = batched;
+	mvm->cmd_lat_idx = (mvm->cmd_lat_idx + 1) % ARRAY_SIZE(mvm->cmd_lat);
+}
+
+static int iwl_mvm_trans_send_cmd(struct iwl_mvm *mvm,
+				  struct iwl_host_cmd *cmd)
+{
+	ktime_t start = ktime_get();
+	u32 id = cmd->id;
+	int ret;
+
+	ret = iwl_trans_send_cmd(mvm->trans, cmd);
+	if (!ret && !(cmd->flags & CMD_ASYNC))
+		iwl_mvm_cmd_lat_record(mvm, id, start, ktime_get(), false);
+
+	return ret;
+}
+#else
+static void iwl_mvm_cmd_lat_record(struct iwl_mvm *mvm, u32 id, ktime_t start,
+				   ktime_t end, bool batched)
+{
+}
+
+static int iwl_mvm_trans_send_cmd(struct iwl_mvm *mvm,
+				  struct iwl_host_cmd *cmd)
+{
+	return iwl_trans_send_cmd(mvm->trans, cmd);
+}
+#endif
+
 /*
  * Will return 0 even if the cmd failed when RFKILL is asserted unless
  * CMD_WANT_SKB is set in cmd->flags.
@@ -35,7 +75,7 @@ int iwl_mvm_send_cmd(struct iwl_mvm *mvm, struct iwl_host_cmd *cmd)
 	if (!(cmd->flags & CMD_ASYNC))
 		lockdep_assert_held(&mvm->mutex);
 
-	ret = iwl_trans_send_cmd(mvm->trans, cmd);
+	ret = iwl_mvm_trans_send_cmd(mvm, cmd);
 
 	/*
 	 * If the caller wants the SKB, then don't hide any problems, the
@@ -94,7 +134,7 @@ int iwl_mvm_send_cmd_status(struct iwl_mvm *mvm, struct iwl_host_cmd *cmd,
 
 	cmd->flags |= CMD_WANT_SKB;
 
-	ret = iwl_trans_send_cmd(mvm->trans, cmd);
+	ret = iwl_mvm_trans_send_cmd(mvm, cmd);
 	if (ret == -ERFKILL) {
 		/*
 		 * The command failed because of RFKILL, don't update
@@ -135,6 +175,166 @@ int iwl_mvm_send_cmd_pdu_status(struct iwl_mvm *mvm, u32 id, u16 len,
 	return iwl_mvm_send_cmd_status(mvm, &cmd, status);
 }
 
+#define IWL_MVM_CMD_BATCH_TIMEOUT	(2 * HZ * CPTCFG_IWL_TIMEOUT_FACTOR)
+
+struct iwl_mvm_cmd_batch {
+	struct iwl_mvm *mvm;
+	u32 *status;
+	int n_cmds;
+	int n_done;
+	struct {
+		u16 id;
+		bool done;
+		ktime_t sent, completed;
+	} cmds[IWL_MVM_CMD_BATCH_MAX];
+};
+
+static bool iwl_mvm_cmd_batch_id_match(u16 id, u16 rx_id)
+{
+	/* same as the notification wait, legacy IDs may come back as DEF_ID */
+	return id == rx_id || (!iwl_cmd_groupid(id) && DEF_ID(id) == rx_id);
+}
+
+static bool iwl_mvm_cmd_batch_resp(struct iwl_notif_wait_data *notif_wait,
+				   struct iwl_rx_packet *pkt, void *data)
+{
+	struct iwl_mvm_cmd_batch *batch = data;
+	u16 sequence = le16_to_cpu(pkt->hdr.sequence);
+	u16 rx_id = WIDE_ID(pkt->hdr.group_id, pkt->hdr.cmd);
+	int i;
+
+	/* only responses to our commands, not notifications with the same ID */
+	if (pkt->hdr.sequence & SEQ_RX_FRAME ||
+	    SEQ_TO_QUEUE(sequence) != batch->mvm->trans->txqs.cmd.q_id)
+		return false;
+
+	/*
+	 * The command queue is processed in order, so the response is for
+	 * the oldest command with this ID that is still outstanding.
+	 */
+	for (i = 0; i < batch->n_cmds; i++) {
+		struct iwl_cmd_response *resp = (void *)pkt->data;
+
+		if (batch->cmds[i].done ||
+		    !iwl_mvm_cmd_batch_id_match(batch->cmds[i].id, rx_id))
+			continue;
+
+		batch->cmds[i].done = true;
+		batch->cmds[i].completed = ktime_get();
+		batch->n_done++;
+
+		if (batch->status &&
+		    !WARN_ON_ONCE(iwl_rx_packet_payload_len(pkt) !=
+				  sizeof(*resp)))
+			batch->status[i] = le32_to_cpu(resp->status);
+		break;
+	}
+
+	return batch->n_done == batch->n_cmds;
+}
+
+/**
+ * iwl_mvm_send_cmd_batch - send independent commands and wait for all
+ * @mvm: the mvm
+ * @cmds: the commands, they're sent in order
+ * @n_cmds: number of commands, at most %IWL_MVM_CMD_BATCH_MAX
+ * @status: if not %NULL, the status from each command's response is
+ *	written here, the caller sets the success values like for
+ *	iwl_mvm_send_cmd_status()
+ *
+ * All commands are queued to the firmware back to back and we wait once
+ * for all the responses, instead of doing a round trip per command. Don't
+ * use it when a command depends on the outcome of an earlier one. At most
+ * %MAX_NOTIF_CMDS different command IDs can be used in one batch.
+ *
+ * Like iwl_mvm_send_cmd() this returns 0 when RFKILL is asserted.
+ */
+int iwl_mvm_send_cmd_batch(struct iwl_mvm *mvm, struct iwl_host_cmd *cmds,
+			   int n_cmds, u32 *status)
+{
+	struct iwl_notification_wait wait;
+	struct iwl_mvm_cmd_batch batch = {
+		.mvm = mvm,
+		.status = status,
+		.n_cmds = n_cmds,
+	};
+	u16 ids[MAX_NOTIF_CMDS];
+	int n_ids = 0;
+	int i, j, ret;
+
+	lockdep_assert_held(&mvm->mutex);
+
+#if defined(CPTCFG_IWLWIFI_DEBUGFS) && defined(CONFIG_PM_SLEEP)
+	if (WARN_ON(mvm->d3_test_active))
+		return -EIO;
+#endif
+
+	if (WARN_ON(n_cmds > IWL_MVM_CMD_BATCH_MAX))
+		return -EINVAL;
+
+	if (!n_cmds)
+		return 0;
+
+	for (i = 0; i < n_cmds; i++) {
+		if (WARN_ONCE(cmds[i].flags & (CMD_ASYNC | CMD_WANT_SKB),
+			      "cmd flags %x", cmds[i].flags))
+			return -EINVAL;
+
+		batch.cmds[i].id = cmds[i].id;
+
+		for (j = 0; j < n_ids; j++)
+			if (ids[j] == cmds[i].id)
+				break;
+		if (j < n_ids)
+			continue;
+		if (WARN_ON(n_ids == ARRAY_SIZE(ids)))
+			return -EINVAL;
+		ids[n_ids++] = cmds[i].id;
+	}
+
+	iwl_init_notification_wait(&mvm->notif_wait, &wait, ids, n_ids,
+				   iwl_mvm_cmd_batch_resp, &batch);
+
+	for (i = 0; i < n_cmds; i++) {
+		batch.cmds[i].sent = ktime_get();
+		cmds[i].flags |= CMD_ASYNC;
+		ret = iwl_trans_send_cmd(mvm->trans, &cmds[i]);
+		cmds[i].flags &= ~CMD_ASYNC;
+		if (ret) {
+			iwl_remove_notification(&mvm->notif_wait, &wait);
+			if (ret == -ERFKILL || ret == -EHOSTDOWN)
+				return 0;
+			IWL_ERR(mvm, "Failed to send batched command %s: %d\n",
+				iwl_get_cmd_string(mvm->trans, cmds[i].id),
+				ret);
+			return ret;
+		}
+	}
+
+	ret = iwl_wait_notification(&mvm->notif_wait, &wait,
+				    IWL_MVM_CMD_BATCH_TIMEOUT);
+	if (ret) {
+		/* the wait is aborted when RFKILL is asserted */
+		if (ret == -EIO && iwl_mvm_is_radio_killed(mvm))
+			return 0;
+
+		IWL_ERR(mvm, "Batch of %d commands failed (%d done): %d\n",
+			n_cmds, batch.n_done, ret);
+
+		/* like a timed out sync command, get the firmware restarted */
+		if (ret == -ETIMEDOUT)
+			iwl_trans_sync_nmi(mvm->trans);
+		return ret;
+	}
+
+	for (i = 0; i < n_cmds; i++)
+		iwl_mvm_cmd_lat_record(mvm, batch.cmds[i].id,
+				       batch.cmds[i].sent,
+				       batch.cmds[i].completed, true);
+
+	return 0;
+}
+
 int iwl_mvm_legacy_hw_idx_to_mac80211_idx(u32 rate_n_flags,
 					  enum nl80211_band band)
 {
@@ -48,10 +48,12 @@ struct iwl_host_cmd;
  * @vid: index of this rxb in the global table
  * @offset: indicates which offset of the page (in bytes)
  *	this buffer uses (if multiple RBs fit into one page)
+ * @page_pool: the page pool the page was allocated from, if any
  */
 struct iwl_rx_mem_buffer {
 	dma_addr_t page_dma;
 	struct page *page;
+	struct page_pool *page_pool;
 	struct list_head list;
 	u32 offset;
 	u16 vid;
@@ -140,6 +142,9 @@ struct iwl_rx_completion_desc_bz {
  *	the fragmented flag, so the next one is still another fragment
  * @napi: NAPI struct for this queue
  * @queue_size: size of this queue
+ * @page_pool: page pool this queue refills its RBDs from, in its own NAPI
+ *	context, with the RB allocator only as a fallback; only used when
+ *	each RB takes a page of its own
  *
  * NOTE:  rx_free and rx_used are used as a FIFO for iwl_rx_mem_buffers
  */
@@ -162,6 +167,7 @@ struct iwl_rxq {
 	dma_addr_t rb_stts_dma;
 	spinlock_t lock;
 	struct napi_struct napi;
+	struct page_pool *page_pool;
 	struct iwl_rx_mem_buffer *queue[RX_QUEUE_SIZE];
 };
 
@@ -170,7 +176,8 @@ struct iwl_rxq {
  * @req_pending: number of requests the allcator had not processed yet
  * @req_ready: number of requests honored and ready for claiming
  * @rbd_allocated: RBDs with pages allocated and ready to be handled to
- *	the queue. This is a list of &struct iwl_rx_mem_buffer
+ *	the queue. This is a list of &struct iwl_rx_mem_buffer. With page
+ *	pools, this also holds RBDs a queue had no room for
  * @rbd_empty: RBDs with no page attached for allocator use. This is a list
  *	of &struct iwl_rx_mem_buffer
  * @lock: protects the rbd_allocated and rbd_empty lists
@@ -312,6 +319,8 @@ enum iwl_pcie_imr_status {
  * @hw_base: pci hardware address support
  * @ucode_write_complete: indicates that the ucode has been copied.
  * @ucode_write_waitq: wait queue for uCode load
+ * @fw_load_bufs: DMA buffers for loading the firmware sections, only
+ *	allocated while the firmware is being loaded
  * @cmd_queue - command queue number
  * @rx_buf_size: Rx buffer size
  * @scd_set_active: should the transport configure the SCD for HCMD queue
@@ -416,6 +425,7 @@ struct iwl_trans_pcie {
 	bool ucode_write_complete;
 	bool sx_complete;
 	wait_queue_head_t ucode_write_waitq;
+	struct iwl_dram_data fw_load_bufs[2];
 	wait_queue_head_t sx_waitq;
 
 	u8 n_no_reclaim_cmds;
@@ -524,6 +534,10 @@ void iwl_pcie_rx_init_rxb_lists(struct iwl_rxq *rxq);
 void iwl_pcie_rx_napi_sync(struct iwl_trans *trans);
 void iwl_pcie_rxq_alloc_rbs(struct iwl_trans *trans, gfp_t priority,
 			    struct iwl_rxq *rxq);
+#ifdef CPTCFG_PAGE_POOL_STATS
+void iwl_pcie_rx_page_pool_stats(struct iwl_trans *trans,
+				 struct page_pool_stats *stats);
+#endif
 
 /*****************************************************
 * ICT - interrupt handling
@@ -7,6 +7,7 @@
 #include <linux/sched.h>
 #include <linux/wait.h>
 #include <linux/gfp.h>
+#include <net/page_pool/helpers.h>
 
 #include "iwl-prph.h"
 #include "iwl-io.h"
@@ -107,6 +108,13 @@
  * Page Stolen:
  * rxq.queue -> rxq.rx_used -> allocator.rbd_empty ->
  * allocator.rbd_allocated -> rxq.rx_free -> rxq.queue
+ * Page Stolen, with a page pool (the queue refills from it in NAPI):
+ * rxq.queue -> rxq.rx_used -> rxq.rx_free -> rxq.queue
+ * Page Stolen, with the page pool out of pages:
+ * rxq.queue -> rxq.rx_used -> allocator.rbd_empty ->
+ * allocator.rbd_allocated -> rxq.rx_free -> rxq.queue
+ * With a page pool, RBDs a full queue has no room for:
+ * rxq.rx_free -> allocator.rbd_allocated -> (other) rxq.rx_free
  * Page not Stolen:
  * rxq.queue -> rxq.rx_free -> rxq.queue
  * ...
@@ -146,17 +154,19 @@ int iwl_pcie_rx_stop(struct iwl_trans *trans)
 	if (trans->trans_cfg->device_family >= IWL_DEVICE_FAMILY_AX210) {
 		/* TODO: remove this once fw does it */
 		iwl_write_umac_prph(trans, RFH_RXF_DMA_CFG_GEN3, 0);
-		return iwl_poll_umac_prph_bit(trans, RFH_GEN_STATUS_GEN3,
-					      RXF_DMA_IDLE, RXF_DMA_IDLE, 1000);
+		return iwl_poll_umac_prph_bit_sleep(trans, RFH_GEN_STATUS_GEN3,
+						    RXF_DMA_IDLE, RXF_DMA_IDLE,
+						    1000);
 	} else if (trans->trans_cfg->mq_rx_supported) {
 		iwl_write_prph(trans, RFH_RXF_DMA_CFG, 0);
-		return iwl_poll_prph_bit(trans, RFH_GEN_STATUS,
-					   RXF_DMA_IDLE, RXF_DMA_IDLE, 1000);
+		return iwl_poll_prph_bit_sleep(trans, RFH_GEN_STATUS,
+					       RXF_DMA_IDLE, RXF_DMA_IDLE, 1000);
 	} else {
 		iwl_write_direct32(trans, FH_MEM_RCSR_CHNL0_CONFIG_REG, 0);
-		return iwl_poll_direct_bit(trans, FH_MEM_RSSR_RX_STATUS_REG,
-					   FH_RSSR_CHNL0_RX_STATUS_CHNL_IDLE,
-					   1000);
+		return iwl_poll_direct_bit_sleep(trans,
+						 FH_MEM_RSSR_RX_STATUS_REG,
+						 FH_RSSR_CHNL0_RX_STATUS_CHNL_IDLE,
+						 1000);
 	}
 }
 
@@ -259,7 +269,7 @@ static void iwl_pcie_rxmq_restock(struct iwl_trans *trans,
 		return;
 
 	spin_lock_bh(&rxq->lock);
-	while (rxq->free_count) {
+	while ((iwl_rxq_space(rxq) > 0) && (rxq->free_count)) {
 		/* Get next free Rx buffer, remove from free list */
 		rxb = list_first_entry(&rxq->rx_free, struct iwl_rx_mem_buffer,
 				       list);
@@ -354,11 +364,29 @@ void iwl_pcie_rxq_restock(struct iwl_trans *trans, struct iwl_rxq *rxq)
 		iwl_pcie_rxsq_restock(trans, rxq);
 }
 
+/*
+ * iwl_pcie_rxq_restock_all - restock all RX queues
+ *
+ * Only the default queue has RBDs of its own at init, unless the queues
+ * refill from page pools, then each queue got a share of them.
+ */
+static void iwl_pcie_rxq_restock_all(struct iwl_trans *trans)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	int i;
+
+	for (i = 0; i < trans->num_rx_queues; i++)
+		iwl_pcie_rxq_restock(trans, &trans_pcie->rxq[i]);
+}
+
 /*
  * iwl_pcie_rx_alloc_page - allocates and returns a page.
  *
+ * If @pool is given the page is taken from it, already DMA mapped, and is
+ * never shared between RBs.
  */
 static struct page *iwl_pcie_rx_alloc_page(struct iwl_trans *trans,
+					   struct page_pool *pool,
 					   u32 *offset, gfp_t priority)
 {
 	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
@@ -388,7 +416,10 @@ static struct page *iwl_pcie_rx_alloc_page(struct iwl_trans *trans,
 	}
 
 	/* Alloc a new receive buffer */
-	page = alloc_pages(gfp_mask, trans_pcie->rx_page_order);
+	if (pool)
+		page = page_pool_alloc_pages(pool, priority);
+	else
+		page = alloc_pages(gfp_mask, trans_pcie->rx_page_order);
 	if (!page) {
 		if (net_ratelimit())
 			IWL_DEBUG_INFO(trans, "alloc_pages failed, order: %d\n",
@@ -403,7 +434,7 @@ static struct page *iwl_pcie_rx_alloc_page(struct iwl_trans *trans,
 		return NULL;
 	}
 
-	if (2 * rbsize <= allocsize) {
+	if (!pool && 2 * rbsize <= allocsize) {
 		spin_lock_bh(&trans_pcie->alloc_page_lock);
 		if (!trans_pcie->alloc_page) {
 			get_page(page);
@@ -417,6 +448,50 @@ static struct page *iwl_pcie_rx_alloc_page(struct iwl_trans *trans,
 	return page;
 }
 
+static void iwl_pcie_rx_free_page(struct iwl_trans *trans,
+				  struct page_pool *pool, struct page *page)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+	if (pool)
+		page_pool_put_full_page(pool, page, false);
+	else
+		__free_pages(page, trans_pcie->rx_page_order);
+}
+
+/*
+ * iwl_pcie_rx_map_page - attach a newly allocated page to an RBD
+ *
+ * Pages from a page pool were mapped by the pool already, others are
+ * mapped here.
+ */
+static int iwl_pcie_rx_map_page(struct iwl_trans *trans,
+				struct iwl_rx_mem_buffer *rxb,
+				struct page_pool *pool, struct page *page)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+
+	rxb->page = page;
+	rxb->page_pool = pool;
+
+	if (pool) {
+		rxb->page_dma = page_pool_get_dma_addr(page);
+		return 0;
+	}
+
+	/* Get physical address of the RB */
+	rxb->page_dma = dma_map_page(trans->dev, page, rxb->offset,
+				     trans_pcie->rx_buf_bytes,
+				     DMA_FROM_DEVICE);
+	if (dma_mapping_error(trans->dev, rxb->page_dma)) {
+		rxb->page = NULL;
+		__free_pages(page, trans_pcie->rx_page_order);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
 /*
  * iwl_pcie_rxq_alloc_rbs - allocate a page for each used RBD
  *
@@ -429,7 +504,6 @@ static struct page *iwl_pcie_rx_alloc_page(struct iwl_trans *trans,
 void iwl_pcie_rxq_alloc_rbs(struct iwl_trans *trans, gfp_t priority,
 			    struct iwl_rxq *rxq)
 {
-	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
 	struct iwl_rx_mem_buffer *rxb;
 	struct page *page;
 
@@ -443,7 +517,12 @@ void iwl_pcie_rxq_alloc_rbs(struct iwl_trans *trans, gfp_t priority,
 		}
 		spin_unlock_bh(&rxq->lock);
 
-		page = iwl_pcie_rx_alloc_page(trans, &offset, priority);
+		/*
+		 * If the page pool is out of pages the RBDs simply stay on
+		 * the used list, see iwl_pcie_rxq_pool_refill().
+		 */
+		page = iwl_pcie_rx_alloc_page(trans, rxq->page_pool, &offset,
+					      priority);
 		if (!page)
 			return;
 
@@ -451,7 +530,7 @@ void iwl_pcie_rxq_alloc_rbs(struct iwl_trans *trans, gfp_t priority,
 
 		if (list_empty(&rxq->rx_used)) {
 			spin_unlock_bh(&rxq->lock);
-			__free_pages(page, trans_pcie->rx_page_order);
+			iwl_pcie_rx_free_page(trans, rxq->page_pool, page);
 			return;
 		}
 		rxb = list_first_entry(&rxq->rx_used, struct iwl_rx_mem_buffer,
@@ -460,19 +539,11 @@ void iwl_pcie_rxq_alloc_rbs(struct iwl_trans *trans, gfp_t priority,
 		spin_unlock_bh(&rxq->lock);
 
 		BUG_ON(rxb->page);
-		rxb->page = page;
 		rxb->offset = offset;
-		/* Get physical address of the RB */
-		rxb->page_dma =
-			dma_map_page(trans->dev, page, rxb->offset,
-				     trans_pcie->rx_buf_bytes,
-				     DMA_FROM_DEVICE);
-		if (dma_mapping_error(trans->dev, rxb->page_dma)) {
-			rxb->page = NULL;
+		if (iwl_pcie_rx_map_page(trans, rxb, rxq->page_pool, page)) {
 			spin_lock_bh(&rxq->lock);
 			list_add(&rxb->list, &rxq->rx_used);
 			spin_unlock_bh(&rxq->lock);
-			__free_pages(page, trans_pcie->rx_page_order);
 			return;
 		}
 
@@ -494,13 +565,16 @@ void iwl_pcie_free_rbs_pool(struct iwl_trans *trans)
 		return;
 
 	for (i = 0; i < RX_POOL_SIZE(trans_pcie->num_rx_bufs); i++) {
-		if (!trans_pcie->rx_pool[i].page)
+		struct iwl_rx_mem_buffer *rxb = &trans_pcie->rx_pool[i];
+
+		if (!rxb->page)
 			continue;
-		dma_unmap_page(trans->dev, trans_pcie->rx_pool[i].page_dma,
-			       trans_pcie->rx_buf_bytes, DMA_FROM_DEVICE);
-		__free_pages(trans_pcie->rx_pool[i].page,
-			     trans_pcie->rx_page_order);
-		trans_pcie->rx_pool[i].page = NULL;
+		if (!rxb->page_pool)
+			dma_unmap_page(trans->dev, rxb->page_dma,
+				       trans_pcie->rx_buf_bytes,
+				       DMA_FROM_DEVICE);
+		iwl_pcie_rx_free_page(trans, rxb->page_pool, rxb->page);
+		rxb->page = NULL;
 	}
 }
 
@@ -550,22 +624,13 @@ static void iwl_pcie_rx_allocator(struct iwl_trans *trans)
 			BUG_ON(rxb->page);
 
 			/* Alloc a new receive buffer */
-			page = iwl_pcie_rx_alloc_page(trans, &rxb->offset,
+			page = iwl_pcie_rx_alloc_page(trans, NULL, &rxb->offset,
 						      gfp_mask);
 			if (!page)
 				continue;
-			rxb->page = page;
-
-			/* Get physical address of the RB */
-			rxb->page_dma = dma_map_page(trans->dev, page,
-						     rxb->offset,
-						     trans_pcie->rx_buf_bytes,
-						     DMA_FROM_DEVICE);
-			if (dma_mapping_error(trans->dev, rxb->page_dma)) {
-				rxb->page = NULL;
-				__free_pages(page, trans_pcie->rx_page_order);
+
+			if (iwl_pcie_rx_map_page(trans, rxb, NULL, page))
 				continue;
-			}
 
 			/* move the allocated entry to the out list */
 			list_move(&rxb->list, &local_allocated);
@@ -645,6 +710,104 @@ static void iwl_pcie_rx_allocator_get(struct iwl_trans *trans,
 	rxq->free_count += RX_CLAIM_REQ_ALLOC;
 }
 
+/*
+ * iwl_pcie_rx_pool_allocator - Allocator for queues with page pools
+ *
+ * Queues with page pools normally refill themselves, they only hand RBDs
+ * to the allocator when their pool ran dry, or when they have more RBDs
+ * than room in their ring. Allocates pages for the former from the page
+ * allocator, since the page pools may only be used from their NAPI, and
+ * hands all of them to the queues with the most room first, so RBDs also
+ * flow back to queues that ran out of them.
+ * Called as a scheduled work item.
+ */
+static void iwl_pcie_rx_pool_allocator(struct iwl_trans *trans)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	struct iwl_rb_allocator *rba = &trans_pcie->rba;
+	struct iwl_rx_mem_buffer *rxb, *tmp;
+	LIST_HEAD(local_allocated);
+	LIST_HEAD(local_empty);
+	bool retry;
+
+	spin_lock_bh(&rba->lock);
+	list_splice_init(&rba->rbd_empty, &local_empty);
+	spin_unlock_bh(&rba->lock);
+
+	list_for_each_entry_safe(rxb, tmp, &local_empty, list) {
+		struct page *page;
+
+		BUG_ON(rxb->page);
+
+		page = iwl_pcie_rx_alloc_page(trans, NULL, &rxb->offset,
+					      GFP_KERNEL | __GFP_NOWARN);
+		if (!page)
+			break;
+
+		if (iwl_pcie_rx_map_page(trans, rxb, NULL, page))
+			break;
+
+		list_move_tail(&rxb->list, &local_allocated);
+	}
+
+	spin_lock_bh(&rba->lock);
+	list_splice_tail(&local_empty, &rba->rbd_empty);
+	list_splice_tail(&local_allocated, &rba->rbd_allocated);
+	spin_unlock_bh(&rba->lock);
+
+	while (1) {
+		struct iwl_rxq *rxq = NULL;
+		int i, room = 0;
+
+		for (i = 0; i < trans->num_rx_queues; i++) {
+			struct iwl_rxq *q = &trans_pcie->rxq[i];
+			int n;
+
+			spin_lock_bh(&q->lock);
+			n = iwl_rxq_space(q) - q->free_count;
+			spin_unlock_bh(&q->lock);
+
+			if (n > room) {
+				room = n;
+				rxq = q;
+			}
+		}
+
+		if (!rxq)
+			break;
+
+		spin_lock_bh(&rxq->lock);
+		spin_lock(&rba->lock);
+		for (i = 0; i < min(room, RX_CLAIM_REQ_ALLOC); i++) {
+			if (list_empty(&rba->rbd_allocated))
+				break;
+
+			rxb = list_first_entry(&rba->rbd_allocated,
+					       struct iwl_rx_mem_buffer, list);
+			list_move_tail(&rxb->list, &rxq->rx_free);
+			rxq->free_count++;
+		}
+		spin_unlock(&rba->lock);
+		spin_unlock_bh(&rxq->lock);
+
+		if (!i)
+			break;
+
+		iwl_pcie_rxq_restock(trans, rxq);
+	}
+
+	/*
+	 * A queue that ran out of RBDs gets no more interrupts to refill
+	 * itself, so don't give up on the pages it's missing.
+	 */
+	spin_lock_bh(&rba->lock);
+	retry = !list_empty(&rba->rbd_empty);
+	spin_unlock_bh(&rba->lock);
+
+	if (retry)
+		queue_work(rba->alloc_wq, &rba->rx_alloc);
+}
+
 void iwl_pcie_rx_allocator_work(struct work_struct *data)
 {
 	struct iwl_rb_allocator *rba_p =
@@ -652,7 +815,10 @@ void iwl_pcie_rx_allocator_work(struct work_struct *data)
 	struct iwl_trans_pcie *trans_pcie =
 		container_of(rba_p, struct iwl_trans_pcie, rba);
 
-	iwl_pcie_rx_allocator(trans_pcie->trans);
+	if (trans_pcie->rxq[0].page_pool)
+		iwl_pcie_rx_pool_allocator(trans_pcie->trans);
+	else
+		iwl_pcie_rx_allocator(trans_pcie->trans);
 }
 
 static int iwl_pcie_free_bd_size(struct iwl_trans *trans)
@@ -1075,6 +1241,91 @@ void iwl_pcie_rx_napi_sync(struct iwl_trans *trans)
 	}
 }
 
+static void iwl_pcie_rx_destroy_page_pools(struct iwl_trans *trans)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	int i;
+
+	for (i = 0; i < trans->num_rx_queues; i++) {
+		struct iwl_rxq *rxq = &trans_pcie->rxq[i];
+
+		page_pool_destroy(rxq->page_pool);
+		rxq->page_pool = NULL;
+	}
+}
+
+static struct page_pool *iwl_pcie_rx_create_page_pool(struct iwl_trans *trans,
+						      unsigned int size)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	struct page_pool_params pp_params = {
+		.order = trans_pcie->rx_page_order,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = size,
+		.nid = NUMA_NO_NODE,
+		.dev = trans->dev,
+		.dma_dir = DMA_FROM_DEVICE,
+		.max_len = trans_pcie->rx_buf_bytes,
+	};
+
+	return page_pool_create(&pp_params);
+}
+
+/*
+ * Each queue refills its used RBDs from its own page pool in its NAPI
+ * context. The RB allocator only steps in when a pool runs dry, and to move
+ * RBDs from queues that have more than they can post to the others.
+ * Pages are recycled back to whichever pool they came from, even if the
+ * RBD moved to another queue in the meantime.
+ * When multiple RBs fit into one page the pages are split by the driver,
+ * so those keep using the page allocator and the RB allocator.
+ */
+static int iwl_pcie_rx_create_page_pools(struct iwl_trans *trans)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	unsigned int rbsize = iwl_trans_get_rb_size(trans_pcie->rx_buf_size);
+	unsigned int allocsize = PAGE_SIZE << trans_pcie->rx_page_order;
+	struct page_pool *pool;
+	int i;
+
+	if (2 * rbsize <= allocsize)
+		return 0;
+
+	for (i = 0; i < trans->num_rx_queues; i++) {
+		struct iwl_rxq *rxq = &trans_pcie->rxq[i];
+
+		pool = iwl_pcie_rx_create_page_pool(trans, rxq->queue_size);
+		if (IS_ERR(pool))
+			goto err;
+		rxq->page_pool = pool;
+	}
+
+	return 0;
+
+err:
+	iwl_pcie_rx_destroy_page_pools(trans);
+	return PTR_ERR(pool);
+}
+
+#ifdef CPTCFG_PAGE_POOL_STATS
+void iwl_pcie_rx_page_pool_stats(struct iwl_trans *trans,
+				 struct page_pool_stats *stats)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	int i;
+
+	if (!trans_pcie->rxq)
+		return;
+
+	for (i = 0; i < trans->num_rx_queues; i++) {
+		struct iwl_rxq *rxq = &trans_pcie->rxq[i];
+
+		if (rxq->page_pool)
+			page_pool_get_stats(rxq->page_pool, stats);
+	}
+}
+#endif
+
 static int _iwl_pcie_rx_init(struct iwl_trans *trans)
 {
 	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
@@ -1101,6 +1352,12 @@ static int _iwl_pcie_rx_init(struct iwl_trans *trans)
 	/* free all first - we overwrite everything here */
 	iwl_pcie_free_rbs_pool(trans);
 
+	/* the RB size may have changed, so recreate the page pools too */
+	iwl_pcie_rx_destroy_page_pools(trans);
+	err = iwl_pcie_rx_create_page_pools(trans);
+	if (err)
+		return err;
+
 	for (i = 0; i < RX_QUEUE_SIZE; i++)
 		def_rxq->queue[i] = NULL;
 
@@ -1136,7 +1393,10 @@ static int _iwl_pcie_rx_init(struct iwl_trans *trans)
 		}
 	}
 
-	/* move the pool to the default queue and allocator ownerships */
+	/*
+	 * move the pool to the default queue and allocator ownerships, or
+	 * split it over all queues if they refill from their page pools
+	 */
 	queue_size = trans->trans_cfg->mq_rx_supported ?
 			trans_pcie->num_rx_bufs - 1 : RX_QUEUE_SIZE;
 	allocator_pool_size = trans->num_rx_queues *
@@ -1145,8 +1405,11 @@ static int _iwl_pcie_rx_init(struct iwl_trans *trans)
 
 	for (i = 0; i < num_alloc; i++) {
 		struct iwl_rx_mem_buffer *rxb = &trans_pcie->rx_pool[i];
+		int q = i % trans->num_rx_queues;
 
-		if (i < allocator_pool_size)
+		if (def_rxq->page_pool)
+			list_add(&rxb->list, &trans_pcie->rxq[q].rx_used);
+		else if (i < allocator_pool_size)
 			list_add(&rxb->list, &rba->rbd_empty);
 		else
 			list_add(&rxb->list, &def_rxq->rx_used);
@@ -1155,7 +1418,8 @@ static int _iwl_pcie_rx_init(struct iwl_trans *trans)
 		rxb->invalid = true;
 	}
 
-	iwl_pcie_rxq_alloc_rbs(trans, GFP_KERNEL, def_rxq);
+	for (i = 0; i < trans->num_rx_queues; i++)
+		iwl_pcie_rxq_alloc_rbs(trans, GFP_KERNEL, &trans_pcie->rxq[i]);
 
 	return 0;
 }
@@ -1173,7 +1437,7 @@ int iwl_pcie_rx_init(struct iwl_trans *trans)
 	else
 		iwl_pcie_rx_hw_init(trans, trans_pcie->rxq);
 
-	iwl_pcie_rxq_restock(trans, trans_pcie->rxq);
+	iwl_pcie_rxq_restock_all(trans);
 
 	spin_lock_bh(&trans_pcie->rxq->lock);
 	iwl_pcie_rxq_inc_wr_ptr(trans, trans_pcie->rxq);
@@ -1233,6 +1497,7 @@ void iwl_pcie_rx_free(struct iwl_trans *trans)
 			netif_napi_del(&rxq->napi);
 		}
 	}
+	iwl_pcie_rx_destroy_page_pools(trans);
 	kfree(trans_pcie->rx_pool);
 	kfree(trans_pcie->global_table);
 	kfree(trans_pcie->rxq);
@@ -1266,7 +1531,8 @@ static void iwl_pcie_rx_reuse_rbd(struct iwl_trans *trans,
 	 * before claiming or posting a request*/
 	list_add_tail(&rxb->list, &rxq->rx_used);
 
-	if (unlikely(emergency))
+	/* the queue allocates pages for these itself */
+	if (unlikely(emergency) || rxq->page_pool)
 		return;
 
 	/* Count the allocator owned RBDs */
@@ -1287,6 +1553,44 @@ static void iwl_pcie_rx_reuse_rbd(struct iwl_trans *trans,
 	}
 }
 
+/*
+ * iwl_pcie_rxq_pool_refill - Refill a queue from its page pool and restock
+ *
+ * Used RBDs the page pool has no pages for, and RBDs the queue has no room
+ * for in its ring, are handed to the allocator. The allocator is also woken
+ * up if the queue has room for RBDs another queue handed over.
+ */
+static void iwl_pcie_rxq_pool_refill(struct iwl_trans *trans,
+				     struct iwl_rxq *rxq)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	struct iwl_rb_allocator *rba = &trans_pcie->rba;
+	bool surplus, kick;
+
+	iwl_pcie_rxq_alloc_rbs(trans, GFP_ATOMIC, rxq);
+	iwl_pcie_rxq_restock(trans, rxq);
+
+	spin_lock_bh(&rxq->lock);
+	surplus = !iwl_rxq_space(rxq) && rxq->free_count >= RX_CLAIM_REQ_ALLOC;
+	if (!list_empty(&rxq->rx_used) || surplus) {
+		spin_lock(&rba->lock);
+		list_splice_tail_init(&rxq->rx_used, &rba->rbd_empty);
+		if (surplus) {
+			list_splice_tail_init(&rxq->rx_free,
+					      &rba->rbd_allocated);
+			rxq->free_count = 0;
+		}
+		spin_unlock(&rba->lock);
+		kick = true;
+	} else {
+		kick = iwl_rxq_space(rxq) && !list_empty(&rba->rbd_allocated);
+	}
+	spin_unlock_bh(&rxq->lock);
+
+	if (kick)
+		queue_work(rba->alloc_wq, &rba->rx_alloc);
+}
+
 static void iwl_pcie_rx_handle_rb(struct iwl_trans *trans,
 				  struct iwl_rxq *rxq,
 				  struct iwl_rx_mem_buffer *rxb,
@@ -1295,14 +1599,19 @@ static void iwl_pcie_rx_handle_rb(struct iwl_trans *trans,
 {
 	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
 	struct iwl_txq *txq = trans->txqs.txq[trans->txqs.cmd.q_id];
-	bool page_stolen = false;
+	bool page_stolen = false, page_detach = false;
 	int max_len = trans_pcie->rx_buf_bytes;
 	u32 offset = 0;
 
 	if (WARN_ON(!rxb))
 		return;
 
-	dma_unmap_page(trans->dev, rxb->page_dma, max_len, DMA_FROM_DEVICE);
+	if (rxb->page_pool)
+		dma_sync_single_for_cpu(trans->dev, rxb->page_dma, max_len,
+					DMA_FROM_DEVICE);
+	else
+		dma_unmap_page(trans->dev, rxb->page_dma, max_len,
+			       DMA_FROM_DEVICE);
 
 	while (offset + sizeof(u32) + sizeof(struct iwl_cmd_header) < max_len) {
 		struct iwl_rx_packet *pkt;
@@ -1313,6 +1622,7 @@ static void iwl_pcie_rx_handle_rb(struct iwl_trans *trans,
 			._rx_page_order = trans_pcie->rx_page_order,
 			._page = rxb->page,
 			._page_stolen = false,
+			._page_pool = !!rxb->page_pool,
 			.truesize = max_len,
 		};
 
@@ -1401,20 +1711,36 @@ static void iwl_pcie_rx_handle_rb(struct iwl_trans *trans,
 		}
 
 		page_stolen |= rxcb._page_stolen;
+		page_detach |= rxcb._page_stolen && !rxcb._page_recycle;
 		if (trans->trans_cfg->device_family >= IWL_DEVICE_FAMILY_AX210)
 			break;
 	}
 
 	/* page was stolen from us -- free our reference */
 	if (page_stolen) {
-		__free_pages(rxb->page, trans_pcie->rx_page_order);
+		/*
+		 * If only SKBs marked for recycling hold the page they'll
+		 * return it to the pool, so just drop our reference. Otherwise
+		 * let the pool release the page, so whoever else holds it can
+		 * free it with the page allocator.
+		 */
+		if (rxb->page_pool && page_detach)
+			page_pool_put_full_page(rxb->page_pool, rxb->page,
+						false);
+		else
+			__free_pages(rxb->page, trans_pcie->rx_page_order);
 		rxb->page = NULL;
 	}
 
 	/* Reuse the page if possible. For notification packets and
 	 * SKBs that fail to Rx correctly, add them back into the
 	 * rx_free list for reuse later. */
-	if (rxb->page != NULL) {
+	if (rxb->page && rxb->page_pool) {
+		dma_sync_single_for_device(trans->dev, rxb->page_dma, max_len,
+					   DMA_FROM_DEVICE);
+		list_add_tail(&rxb->list, &rxq->rx_free);
+		rxq->free_count++;
+	} else if (rxb->page != NULL) {
 		rxb->page_dma =
 			dma_map_page(trans->dev, rxb->page, rxb->offset,
 				     trans_pcie->rx_buf_bytes,
@@ -1563,6 +1889,21 @@ restart:
 
 		i = (i + 1) & (rxq->queue_size - 1);
 
+		/*
+		 * With a page pool, refill from it every RX_CLAIM_REQ_ALLOC
+		 * buffers instead of waiting for the allocator.
+		 */
+		if (rxq->page_pool) {
+			if (++count < RX_CLAIM_REQ_ALLOC)
+				continue;
+
+			count = 0;
+			rxq->read = i;
+			spin_unlock(&rxq->lock);
+			iwl_pcie_rxq_pool_refill(trans, rxq);
+			goto restart;
+		}
+
 		/*
 		 * If we have RX_CLAIM_REQ_ALLOC released rx buffers -
 		 * try to claim the pre-allocated buffers from the allocator.
@@ -1611,7 +1952,13 @@ out:
 	 * by the queue.
 	 * by allocating them here, they are now in the queue free list, and
 	 * will be restocked by the next call of iwl_pcie_rxq_restock.
+	 * Queues with a page pool always allocate for their used RBDs here.
 	 */
+	if (rxq->page_pool) {
+		iwl_pcie_rxq_pool_refill(trans, rxq);
+		return handled;
+	}
+
 	if (unlikely(emergency && count))
 		iwl_pcie_rxq_alloc_rbs(trans, GFP_ATOMIC, rxq);
 
@@ -1933,7 +2280,7 @@ irqreturn_t iwl_pcie_irq_handler(int irq, void *dev_id)
 			 * We can restock, since firmware configured
 			 * the RFH
 			 */
-			iwl_pcie_rxmq_restock(trans, trans_pcie->rxq);
+			iwl_pcie_rxq_restock_all(trans);
 		}
 
 		handled |= CSR_INT_BIT_ALIVE;
@@ -2330,7 +2677,7 @@ irqreturn_t iwl_pcie_irq_msix_handler(int irq, void *dev_id)
 		isr_stats->alive++;
 		if (trans->trans_cfg->gen2) {
 			/* We can restock, since firmware configured the RFH */
-			iwl_pcie_rxmq_restock(trans, trans_pcie->rxq);
+			iwl_pcie_rxq_restock_all(trans);
 		}
 	}
 
@@ -478,18 +478,18 @@ void iwl_pcie_apm_stop_master(struct iwl_trans *trans)
 		iwl_set_bit(trans, CSR_GP_CNTRL,
 			    CSR_GP_CNTRL_REG_FLAG_BUS_MASTER_DISABLE_REQ);
 
-		ret = iwl_poll_bit(trans, CSR_GP_CNTRL,
-				   CSR_GP_CNTRL_REG_FLAG_BUS_MASTER_DISABLE_STATUS,
-				   CSR_GP_CNTRL_REG_FLAG_BUS_MASTER_DISABLE_STATUS,
-				   100);
+		ret = iwl_poll_bit_sleep(trans, CSR_GP_CNTRL,
+					 CSR_GP_CNTRL_REG_FLAG_BUS_MASTER_DISABLE_STATUS,
+					 CSR_GP_CNTRL_REG_FLAG_BUS_MASTER_DISABLE_STATUS,
+					 100);
 		usleep_range(10000 * CPTCFG_IWL_DELAY_FACTOR,
 			     20000 * CPTCFG_IWL_DELAY_FACTOR);
 	} else {
 		iwl_set_bit(trans, CSR_RESET, CSR_RESET_REG_FLAG_STOP_MASTER);
 
-		ret = iwl_poll_bit(trans, CSR_RESET,
-				   CSR_RESET_REG_FLAG_MASTER_DISABLED,
-				   CSR_RESET_REG_FLAG_MASTER_DISABLED, 100);
+		ret = iwl_poll_bit_sleep(trans, CSR_RESET,
+					 CSR_RESET_REG_FLAG_MASTER_DISABLED,
+					 CSR_RESET_REG_FLAG_MASTER_DISABLED, 100);
 	}
 
 	if (ret < 0)
@@ -591,10 +591,10 @@ static int iwl_pcie_set_hw_ready(struct iwl_trans *trans)
 		    CSR_HW_IF_CONFIG_REG_BIT_NIC_READY);
 
 	/* See if we got it */
-	ret = iwl_poll_bit(trans, CSR_HW_IF_CONFIG_REG,
-			   CSR_HW_IF_CONFIG_REG_BIT_NIC_READY,
-			   CSR_HW_IF_CONFIG_REG_BIT_NIC_READY,
-			   HW_READY_TIMEOUT);
+	ret = iwl_poll_bit_sleep(trans, CSR_HW_IF_CONFIG_REG,
+				 CSR_HW_IF_CONFIG_REG_BIT_NIC_READY,
+				 CSR_HW_IF_CONFIG_REG_BIT_NIC_READY,
+				 HW_READY_TIMEOUT);
 
 	if (ret >= 0)
 		iwl_set_bit(trans, CSR_MBOX_SET_REG, CSR_MBOX_SET_REG_OS_ALIVE);
@@ -691,12 +691,11 @@ static void iwl_pcie_load_firmware_chunk_fh(struct iwl_trans *trans,
 		    FH_TCSR_TX_CONFIG_REG_VAL_CIRQ_HOST_ENDTFD);
 }
 
-static int iwl_pcie_load_firmware_chunk(struct iwl_trans *trans,
-					u32 dst_addr, dma_addr_t phy_addr,
-					u32 byte_cnt)
+static int iwl_pcie_start_firmware_chunk(struct iwl_trans *trans,
+					 u32 dst_addr, dma_addr_t phy_addr,
+					 u32 byte_cnt)
 {
 	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
-	int ret;
 
 	trans_pcie->ucode_write_complete = false;
 
@@ -707,6 +706,14 @@ static int iwl_pcie_load_firmware_chunk(struct iwl_trans *trans,
 					byte_cnt);
 	iwl_trans_release_nic_access(trans);
 
+	return 0;
+}
+
+static int iwl_pcie_wait_firmware_chunk(struct iwl_trans *trans)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	int ret;
+
 	ret = wait_event_timeout(trans_pcie->ucode_write_waitq,
 				 trans_pcie->ucode_write_complete, 5 * HZ);
 	if (!ret) {
@@ -718,30 +725,87 @@ static int iwl_pcie_load_firmware_chunk(struct iwl_trans *trans,
 	return 0;
 }
 
-static int iwl_pcie_load_section(struct iwl_trans *trans, u8 section_num,
-			    const struct fw_desc *section)
+static void iwl_pcie_free_fw_load_bufs(struct iwl_trans *trans)
 {
-	u8 *v_addr;
-	dma_addr_t p_addr;
-	u32 offset, chunk_sz = min_t(u32, FH_MEM_TB_MAX_LENGTH, section->len);
-	int ret = 0;
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	int i;
 
-	IWL_DEBUG_FW(trans, "[%d] uCode section being loaded...\n",
-		     section_num);
+	for (i = 0; i < ARRAY_SIZE(trans_pcie->fw_load_bufs); i++) {
+		struct iwl_dram_data *buf = &trans_pcie->fw_load_bufs[i];
+
+		if (!buf->block)
+			continue;
+
+		dma_free_coherent(trans->dev, buf->size, buf->block,
+				  buf->physical);
+		buf->block = NULL;
+		buf->size = 0;
+	}
+}
+
+/*
+ * Allocate the buffers the firmware sections are copied to for DMA once
+ * for the whole image, rather than per section. With two of them, the
+ * next chunk is copied while the previous one is being transferred.
+ */
+static int iwl_pcie_alloc_fw_load_bufs(struct iwl_trans *trans,
+				       const struct fw_img *image)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	struct iwl_dram_data *bufs = trans_pcie->fw_load_bufs;
+	u32 chunk_sz = 0;
+	int i;
+
+	for (i = 0; i < image->num_sec; i++)
+		chunk_sz = max(chunk_sz, image->sec[i].len);
+	chunk_sz = min_t(u32, FH_MEM_TB_MAX_LENGTH, chunk_sz);
+	if (!chunk_sz)
+		return 0;
 
-	v_addr = dma_alloc_coherent(trans->dev, chunk_sz, &p_addr,
-				    GFP_KERNEL | __GFP_NOWARN);
-	if (!v_addr) {
+	bufs[0].block = dma_alloc_coherent(trans->dev, chunk_sz,
+					   &bufs[0].physical,
+					   GFP_KERNEL | __GFP_NOWARN);
+	if (!bufs[0].block) {
 		IWL_DEBUG_INFO(trans, "Falling back to small chunks of DMA\n");
 		chunk_sz = PAGE_SIZE;
-		v_addr = dma_alloc_coherent(trans->dev, chunk_sz,
-					    &p_addr, GFP_KERNEL);
-		if (!v_addr)
+		bufs[0].block = dma_alloc_coherent(trans->dev, chunk_sz,
+						   &bufs[0].physical,
+						   GFP_KERNEL);
+		if (!bufs[0].block)
 			return -ENOMEM;
 	}
+	bufs[0].size = chunk_sz;
+
+	/* without a second buffer, just don't overlap copy and transfer */
+	bufs[1].block = dma_alloc_coherent(trans->dev, chunk_sz,
+					   &bufs[1].physical,
+					   GFP_KERNEL | __GFP_NOWARN);
+	if (bufs[1].block)
+		bufs[1].size = chunk_sz;
+
+	return 0;
+}
+
+static int iwl_pcie_load_section(struct iwl_trans *trans, u8 section_num,
+			    const struct fw_desc *section)
+{
+	struct iwl_trans_pcie *trans_pcie = IWL_TRANS_GET_PCIE_TRANS(trans);
+	struct iwl_dram_data *bufs = trans_pcie->fw_load_bufs;
+	int n_bufs = bufs[1].block ? 2 : 1;
+	u32 offset, chunk_sz = bufs[0].size;
+	int ret = 0, idx = 0;
+
+	IWL_DEBUG_FW(trans, "[%d] uCode section being loaded...\n",
+		     section_num);
+
+	if (WARN_ON(!bufs[0].block))
+		return -EINVAL;
+
+	memcpy(bufs[0].block, section->data,
+	       min_t(u32, chunk_sz, section->len));
 
 	for (offset = 0; offset < section->len; offset += chunk_sz) {
-		u32 copy_size, dst_addr;
+		u32 copy_size, dst_addr, next = offset + chunk_sz;
 		bool extended_addr = false;
 
 		copy_size = min_t(u32, chunk_sz, section->len - offset);
@@ -755,9 +819,21 @@ static int iwl_pcie_load_section(struct iwl_trans *trans, u8 section_num,
 			iwl_set_bits_prph(trans, LMPM_CHICK,
 					  LMPM_CHICK_EXTENDED_ADDR_SPACE);
 
-		memcpy(v_addr, (const u8 *)section->data + offset, copy_size);
-		ret = iwl_pcie_load_firmware_chunk(trans, dst_addr, p_addr,
-						   copy_size);
+		ret = iwl_pcie_start_firmware_chunk(trans, dst_addr,
+						    bufs[idx].physical,
+						    copy_size);
+		if (!ret) {
+			idx = (idx + 1) % n_bufs;
+
+			/* prepare the next chunk while this one is in flight */
+			if (n_bufs > 1 && next < section->len)
+				memcpy(bufs[idx].block,
+				       (const u8 *)section->data + next,
+				       min_t(u32, chunk_sz,
+					     section->len - next));
+
+			ret = iwl_pcie_wait_firmware_chunk(trans);
+		}
 
 		if (extended_addr)
 			iwl_clear_bits_prph(trans, LMPM_CHICK,
@@ -769,9 +845,13 @@ static int iwl_pcie_load_section(struct iwl_trans *trans, u8 section_num,
 				section_num);
 			break;
 		}
+
+		if (n_bufs == 1 && next < section->len)
+			memcpy(bufs[0].block,
+			       (const u8 *)section->data + next,
+			       min_t(u32, chunk_sz, section->len - next));
 	}
 
-	dma_free_coherent(trans->dev, chunk_sz, v_addr, p_addr);
 	return ret;
 }
 
@@ -1458,12 +1538,18 @@ static int iwl_trans_pcie_start_fw(struct iwl_trans *trans,
 	iwl_write32(trans, CSR_UCODE_DRV_GP1_CLR, CSR_UCODE_SW_BIT_RFKILL);
 	iwl_write32(trans, CSR_UCODE_DRV_GP1_CLR, CSR_UCODE_SW_BIT_RFKILL);
 
+	ret = iwl_pcie_alloc_fw_load_bufs(trans, fw);
+	if (ret)
+		goto out;
+
 	/* Load the given image to the HW */
 	if (trans->trans_cfg->device_family >= IWL_DEVICE_FAMILY_8000)
 		ret = iwl_pcie_load_given_ucode_8000(trans, fw);
 	else
 		ret = iwl_pcie_load_given_ucode(trans, fw);
 
+	iwl_pcie_free_fw_load_bufs(trans);
+
 	/* re-check RF-Kill state since we may have missed the interrupt */
 	hw_rfkill = iwl_pcie_check_hw_rf_kill(trans);
 	if (hw_rfkill && !run_in_rfkill)
@@ -3618,6 +3704,9 @@ static const struct iwl_trans_ops trans_ops_pcie = {
 #ifdef CPTCFG_IWLWIFI_DEBUGFS
 	.debugfs_cleanup = iwl_trans_pcie_debugfs_cleanup,
 #endif
+#ifdef CPTCFG_PAGE_POOL_STATS
+	.get_page_pool_stats = iwl_pcie_rx_page_pool_stats,
+#endif
 };
 
 static const struct iwl_trans_ops trans_ops_pcie_gen2 = {
@@ -3645,6 +3734,9 @@ static const struct iwl_trans_ops trans_ops_pcie_gen2 = {
 #ifdef CPTCFG_IWLWIFI_DEBUGFS
 	.debugfs_cleanup = iwl_trans_pcie_debugfs_cleanup,
 #endif
+#ifdef CPTCFG_PAGE_POOL_STATS
+	.get_page_pool_stats = iwl_pcie_rx_page_pool_stats,
+#endif
 };
 
 struct iwl_trans *iwl_trans_pcie_alloc(struct pci_dev *pdev,
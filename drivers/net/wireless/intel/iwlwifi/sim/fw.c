@@ -0,0 +1,883 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+#include <linux/etherdevice.h>
+#include <linux/ieee80211.h>
+#include <net/mac80211.h>
+
+#include "iwl-trans.h"
+#include "iwl-config.h"
+#include "fw/api/debug.h"
+#include "mvm/fw-api.h"
+#include "sim/internal.h"
+
+/*
+ * The firmware model plays a single open 2.4 GHz AP on channel 6: it
+ * shows up in every scan, accepts open authentication and association
+ * from anyone, opens an RX BA session for every TID the station sends
+ * QoS data on, and reflects every data frame it receives back to the
+ * sender.  Everything the op_mode sends that the model doesn't know is
+ * simply acknowledged with a zero status.
+ */
+
+#define IWL_SIM_CHANNEL		6
+#define IWL_SIM_BEACON_INT	100
+#define IWL_SIM_BA_BUF_SIZE	64
+#define IWL_SIM_MGMT_LEN	256
+#define IWL_SIM_AID		1
+
+#define IWL_SIM_NO_BAID		(IWL_RX_REORDER_DATA_INVALID_BAID << \
+				 IWL_RX_MPDU_REORDER_BAID_SHIFT)
+
+/* private to iwl-nvm-parse.c, see enum iwl_nvm_channel_flags there */
+#define IWL_SIM_NVM_CHANNEL_FLAGS	(BIT(0) | /* VALID */		\
+					 BIT(1) | /* IBSS */		\
+					 BIT(3) | /* ACTIVE */		\
+					 BIT(8) | /* 20MHZ */		\
+					 BIT(9))  /* 40MHZ */
+#define IWL_SIM_NVM_CHANNELS		14
+
+static const u8 iwl_sim_bssid[ETH_ALEN] = {
+	0x02, 0x00, 0x00, 0x00, 0x0a, 0x01,
+};
+static const char iwl_sim_ssid[] = "iwl-sim";
+
+static const u8 iwl_sim_supp_rates[] = {
+	WLAN_EID_SUPP_RATES, 8, 0x82, 0x84, 0x8b, 0x96, 0x0c, 0x12, 0x18, 0x24,
+};
+
+static const u8 iwl_sim_ext_supp_rates[] = {
+	WLAN_EID_EXT_SUPP_RATES, 4, 0x30, 0x48, 0x60, 0x6c,
+};
+
+static const u8 iwl_sim_wmm_param[] = {
+	WLAN_EID_VENDOR_SPECIFIC, 24,
+	0x00, 0x50, 0xf2, 0x02, 0x01, 0x01, 0x00, 0x00,
+	0x03, 0xa4, 0x00, 0x00,	/* BE */
+	0x27, 0xa4, 0x00, 0x00,	/* BK */
+	0x42, 0x43, 0x5e, 0x00,	/* VI */
+	0x62, 0x32, 0x2f, 0x00,	/* VO */
+};
+
+/* RX path */
+
+static void *iwl_sim_fw_mpdu_alloc(struct iwl_trans_sim *trans_sim,
+				   struct iwl_rx_packet **pkt, size_t len,
+				   u32 reorder_data)
+{
+	struct iwl_rx_mpdu_desc *desc;
+	size_t size = sizeof(*desc) + len;
+
+	/* frames that don't fit an RB are silently lost, like on the air */
+	if (sizeof(**pkt) + size > PAGE_SIZE << trans_sim->rx_page_order)
+		return NULL;
+
+	*pkt = iwl_sim_rx_alloc(trans_sim, REPLY_RX_MPDU_CMD, SEQ_RX_FRAME,
+				size);
+	if (!*pkt)
+		return NULL;
+
+	desc = (void *)(*pkt)->data;
+	desc->mac_phy_idx = PHY_BAND_24 << RX_MPDU_BAND_POS;
+	desc->status = cpu_to_le32(IWL_RX_MPDU_STATUS_CRC_OK |
+				   IWL_RX_MPDU_STATUS_OVERRUN_OK);
+	desc->reorder_data = cpu_to_le32(reorder_data);
+	desc->v3.rate_n_flags = cpu_to_le32(RATE_MCS_LEGACY_OFDM_MSK | 7);
+	desc->v3.channel = IWL_SIM_CHANNEL;
+	desc->v3.energy_a = 40;
+	desc->v3.energy_b = 40;
+
+	return desc + 1;
+}
+
+static void iwl_sim_fw_mpdu_commit(struct iwl_trans_sim *trans_sim,
+				   struct iwl_rx_packet *pkt, size_t len)
+{
+	struct iwl_rx_mpdu_desc *desc = (void *)pkt->data;
+
+	desc->mpdu_len = cpu_to_le16(len);
+	pkt->len_n_flags = cpu_to_le32(sizeof(pkt->hdr) + sizeof(*desc) + len);
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+static __le16 iwl_sim_fw_next_seq(struct iwl_sim_fw *fw, u8 tid)
+{
+	u16 sn = fw->seq[tid];
+
+	fw->seq[tid] = (sn + 1) & IEEE80211_SN_MASK;
+
+	return cpu_to_le16(IEEE80211_SN_TO_SEQ(sn));
+}
+
+static struct ieee80211_mgmt *
+iwl_sim_fw_mgmt_alloc(struct iwl_trans_sim *trans_sim,
+		      struct iwl_rx_packet **pkt, const u8 *da, u16 stype)
+{
+	struct ieee80211_mgmt *mgmt;
+
+	mgmt = iwl_sim_fw_mpdu_alloc(trans_sim, pkt, IWL_SIM_MGMT_LEN,
+				     IWL_SIM_NO_BAID);
+	if (!mgmt)
+		return NULL;
+
+	mgmt->frame_control = cpu_to_le16(IEEE80211_FTYPE_MGMT | stype);
+	memcpy(mgmt->da, da, ETH_ALEN);
+	memcpy(mgmt->sa, iwl_sim_bssid, ETH_ALEN);
+	memcpy(mgmt->bssid, iwl_sim_bssid, ETH_ALEN);
+	mgmt->seq_ctrl = iwl_sim_fw_next_seq(&trans_sim->fw,
+					     IWL_MAX_TID_COUNT);
+
+	return mgmt;
+}
+
+static u8 *iwl_sim_fw_put_ies(u8 *pos, bool beacon)
+{
+	struct ieee80211_ht_operation *ht_oper;
+	struct ieee80211_ht_cap *ht_cap;
+
+	if (beacon) {
+		*pos++ = WLAN_EID_SSID;
+		*pos++ = sizeof(iwl_sim_ssid) - 1;
+		memcpy(pos, iwl_sim_ssid, sizeof(iwl_sim_ssid) - 1);
+		pos += sizeof(iwl_sim_ssid) - 1;
+	}
+
+	memcpy(pos, iwl_sim_supp_rates, sizeof(iwl_sim_supp_rates));
+	pos += sizeof(iwl_sim_supp_rates);
+
+	if (beacon) {
+		*pos++ = WLAN_EID_DS_PARAMS;
+		*pos++ = 1;
+		*pos++ = IWL_SIM_CHANNEL;
+
+		/* DTIM count 0, period 1, empty bitmap */
+		*pos++ = WLAN_EID_TIM;
+		*pos++ = 4;
+		*pos++ = 0;
+		*pos++ = 1;
+		*pos++ = 0;
+		*pos++ = 0;
+	}
+
+	memcpy(pos, iwl_sim_ext_supp_rates, sizeof(iwl_sim_ext_supp_rates));
+	pos += sizeof(iwl_sim_ext_supp_rates);
+
+	*pos++ = WLAN_EID_HT_CAPABILITY;
+	*pos++ = sizeof(*ht_cap);
+	ht_cap = (void *)pos;
+	ht_cap->cap_info = cpu_to_le16(IEEE80211_HT_CAP_SGI_20 |
+				       WLAN_HT_CAP_SM_PS_DISABLED <<
+				       IEEE80211_HT_CAP_SM_PS_SHIFT);
+	ht_cap->ampdu_params_info = IEEE80211_HT_MAX_AMPDU_64K;
+	ht_cap->mcs.rx_mask[0] = 0xff;
+	ht_cap->mcs.rx_mask[1] = 0xff;
+	ht_cap->mcs.tx_params = IEEE80211_HT_MCS_TX_DEFINED;
+	pos += sizeof(*ht_cap);
+
+	*pos++ = WLAN_EID_HT_OPERATION;
+	*pos++ = sizeof(*ht_oper);
+	ht_oper = (void *)pos;
+	ht_oper->primary_chan = IWL_SIM_CHANNEL;
+	pos += sizeof(*ht_oper);
+
+	memcpy(pos, iwl_sim_wmm_param, sizeof(iwl_sim_wmm_param));
+	pos += sizeof(iwl_sim_wmm_param);
+
+	return pos;
+}
+
+static void iwl_sim_fw_rx_beacon(struct iwl_trans_sim *trans_sim)
+{
+	static const u8 bcast[ETH_ALEN] = {
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	};
+	struct ieee80211_mgmt *mgmt;
+	struct iwl_rx_packet *pkt;
+	u8 *pos;
+
+	mgmt = iwl_sim_fw_mgmt_alloc(trans_sim, &pkt, bcast,
+				     IEEE80211_STYPE_BEACON);
+	if (!mgmt)
+		return;
+
+	mgmt->u.beacon.beacon_int = cpu_to_le16(IWL_SIM_BEACON_INT);
+	mgmt->u.beacon.capab_info = cpu_to_le16(WLAN_CAPABILITY_ESS |
+						WLAN_CAPABILITY_SHORT_SLOT_TIME);
+	pos = iwl_sim_fw_put_ies(mgmt->u.beacon.variable, true);
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt, pos - (u8 *)mgmt);
+}
+
+/* simulated AP */
+
+static void iwl_sim_fw_ap_auth(struct iwl_trans_sim *trans_sim,
+			       const struct ieee80211_mgmt *req, size_t len)
+{
+	struct ieee80211_mgmt *mgmt;
+	struct iwl_rx_packet *pkt;
+
+	if (len < offsetof(struct ieee80211_mgmt, u.auth.variable) ||
+	    req->u.auth.auth_alg != cpu_to_le16(WLAN_AUTH_OPEN) ||
+	    req->u.auth.auth_transaction != cpu_to_le16(1))
+		return;
+
+	/* a new connection, forget about the previous one */
+	trans_sim->fw.addba_sent = 0;
+
+	mgmt = iwl_sim_fw_mgmt_alloc(trans_sim, &pkt, req->sa,
+				     IEEE80211_STYPE_AUTH);
+	if (!mgmt)
+		return;
+
+	mgmt->u.auth.auth_alg = cpu_to_le16(WLAN_AUTH_OPEN);
+	mgmt->u.auth.auth_transaction = cpu_to_le16(2);
+	mgmt->u.auth.status_code = cpu_to_le16(WLAN_STATUS_SUCCESS);
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt,
+			       offsetof(struct ieee80211_mgmt,
+					u.auth.variable));
+}
+
+static void iwl_sim_fw_ap_assoc(struct iwl_trans_sim *trans_sim,
+				const struct ieee80211_mgmt *req)
+{
+	bool reassoc = ieee80211_is_reassoc_req(req->frame_control);
+	struct ieee80211_mgmt *mgmt;
+	struct iwl_rx_packet *pkt;
+	u8 *pos;
+
+	mgmt = iwl_sim_fw_mgmt_alloc(trans_sim, &pkt, req->sa,
+				     reassoc ? IEEE80211_STYPE_REASSOC_RESP :
+					       IEEE80211_STYPE_ASSOC_RESP);
+	if (!mgmt)
+		return;
+
+	mgmt->u.assoc_resp.capab_info =
+		cpu_to_le16(WLAN_CAPABILITY_ESS |
+			    WLAN_CAPABILITY_SHORT_SLOT_TIME);
+	mgmt->u.assoc_resp.status_code = cpu_to_le16(WLAN_STATUS_SUCCESS);
+	mgmt->u.assoc_resp.aid = cpu_to_le16(IWL_SIM_AID | BIT(14) | BIT(15));
+	pos = iwl_sim_fw_put_ies(mgmt->u.assoc_resp.variable, false);
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt, pos - (u8 *)mgmt);
+}
+
+static void iwl_sim_fw_ap_addba_req(struct iwl_trans_sim *trans_sim,
+				    const u8 *da, u8 tid)
+{
+	struct ieee80211_mgmt *mgmt;
+	struct iwl_rx_packet *pkt;
+	u16 capab;
+
+	mgmt = iwl_sim_fw_mgmt_alloc(trans_sim, &pkt, da,
+				     IEEE80211_STYPE_ACTION);
+	if (!mgmt)
+		return;
+
+	capab = IEEE80211_ADDBA_PARAM_POLICY_MASK |
+		u16_encode_bits(tid, IEEE80211_ADDBA_PARAM_TID_MASK) |
+		u16_encode_bits(IWL_SIM_BA_BUF_SIZE,
+				IEEE80211_ADDBA_PARAM_BUF_SIZE_MASK);
+
+	mgmt->u.action.category = WLAN_CATEGORY_BACK;
+	mgmt->u.action.u.addba_req.action_code = WLAN_ACTION_ADDBA_REQ;
+	mgmt->u.action.u.addba_req.dialog_token = tid + 1;
+	mgmt->u.action.u.addba_req.capab = cpu_to_le16(capab);
+	mgmt->u.action.u.addba_req.start_seq_num =
+		cpu_to_le16(IEEE80211_SN_TO_SEQ(trans_sim->fw.seq[tid]));
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt,
+			       IEEE80211_MIN_ACTION_SIZE +
+			       sizeof(mgmt->u.action.u.addba_req));
+}
+
+static void iwl_sim_fw_ap_action(struct iwl_trans_sim *trans_sim,
+				 const struct ieee80211_mgmt *req, size_t len)
+{
+	const size_t addba_len = IEEE80211_MIN_ACTION_SIZE +
+				 sizeof(req->u.action.u.addba_req);
+	struct ieee80211_mgmt *mgmt;
+	struct iwl_rx_packet *pkt;
+	u16 capab;
+
+	if (len < addba_len ||
+	    req->u.action.category != WLAN_CATEGORY_BACK ||
+	    req->u.action.u.addba_req.action_code != WLAN_ACTION_ADDBA_REQ)
+		return;
+
+	mgmt = iwl_sim_fw_mgmt_alloc(trans_sim, &pkt, req->sa,
+				     IEEE80211_STYPE_ACTION);
+	if (!mgmt)
+		return;
+
+	/* accept whatever was asked for, with our buffer size */
+	capab = le16_to_cpu(req->u.action.u.addba_req.capab);
+	capab &= ~IEEE80211_ADDBA_PARAM_BUF_SIZE_MASK;
+	capab |= u16_encode_bits(IWL_SIM_BA_BUF_SIZE,
+				 IEEE80211_ADDBA_PARAM_BUF_SIZE_MASK);
+
+	mgmt->u.action.category = WLAN_CATEGORY_BACK;
+	mgmt->u.action.u.addba_resp.action_code = WLAN_ACTION_ADDBA_RESP;
+	mgmt->u.action.u.addba_resp.dialog_token =
+		req->u.action.u.addba_req.dialog_token;
+	mgmt->u.action.u.addba_resp.status = cpu_to_le16(WLAN_STATUS_SUCCESS);
+	mgmt->u.action.u.addba_resp.capab = cpu_to_le16(capab);
+	mgmt->u.action.u.addba_resp.timeout =
+		req->u.action.u.addba_req.timeout;
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt,
+			       IEEE80211_MIN_ACTION_SIZE +
+			       sizeof(mgmt->u.action.u.addba_resp));
+}
+
+static u32 iwl_sim_fw_reorder_data(struct iwl_sim_fw *fw, u8 sta_id, u8 tid,
+				   u16 sn)
+{
+	int baid;
+
+	for (baid = 0; baid < ARRAY_SIZE(fw->baid); baid++) {
+		if (!fw->baid[baid].valid || fw->baid[baid].sta_id != sta_id ||
+		    fw->baid[baid].tid != tid)
+			continue;
+
+		/* every frame is in order, so it's released right away */
+		return baid << IWL_RX_MPDU_REORDER_BAID_SHIFT |
+		       sn << IWL_RX_MPDU_REORDER_SN_SHIFT |
+		       ((sn + 1) & IEEE80211_SN_MASK);
+	}
+
+	return IWL_SIM_NO_BAID;
+}
+
+static void iwl_sim_fw_ap_data(struct iwl_trans_sim *trans_sim,
+			       struct iwl_sim_txq *sim_txq,
+			       struct sk_buff *skb)
+{
+	struct ieee80211_hdr *hdr = (void *)skb->data;
+	struct iwl_sim_fw *fw = &trans_sim->fw;
+	u8 tid = IWL_MAX_TID_COUNT;
+	struct ieee80211_hdr *rx;
+	struct iwl_rx_packet *pkt;
+	u32 reorder_data;
+	__le16 seq;
+
+	if (skb->len <= ieee80211_hdrlen(hdr->frame_control) ||
+	    !ieee80211_has_tods(hdr->frame_control) ||
+	    ieee80211_has_fromds(hdr->frame_control) ||
+	    ieee80211_has_protected(hdr->frame_control))
+		return;
+
+	if (ieee80211_is_data_qos(hdr->frame_control)) {
+		tid = ieee80211_get_tid(hdr);
+		if (tid >= IWL_MAX_TID_COUNT)
+			return;
+
+		if (!test_and_set_bit(tid, &fw->addba_sent))
+			iwl_sim_fw_ap_addba_req(trans_sim, hdr->addr2, tid);
+	}
+
+	seq = iwl_sim_fw_next_seq(fw, tid);
+	if (tid < IWL_MAX_TID_COUNT)
+		reorder_data =
+			iwl_sim_fw_reorder_data(fw, sim_txq->sta_id, tid,
+						IEEE80211_SEQ_TO_SN(le16_to_cpu(seq)));
+	else
+		reorder_data = IWL_SIM_NO_BAID;
+
+	rx = iwl_sim_fw_mpdu_alloc(trans_sim, &pkt, skb->len, reorder_data);
+	if (!rx)
+		return;
+
+	/* the same frame, as if the AP forwarded it back to the sender */
+	memcpy(rx, skb->data, skb->len);
+	rx->frame_control &= ~cpu_to_le16(IEEE80211_FCTL_TODS |
+					  IEEE80211_FCTL_PM |
+					  IEEE80211_FCTL_RETRY);
+	rx->frame_control |= cpu_to_le16(IEEE80211_FCTL_FROMDS);
+	rx->duration_id = 0;
+	memcpy(rx->addr1, hdr->addr2, ETH_ALEN);
+	memcpy(rx->addr2, iwl_sim_bssid, ETH_ALEN);
+	rx->seq_ctrl = seq;
+
+	iwl_sim_fw_mpdu_commit(trans_sim, pkt, skb->len);
+}
+
+static void iwl_sim_fw_ap_rx(struct iwl_trans_sim *trans_sim,
+			     struct iwl_sim_txq *sim_txq, struct sk_buff *skb)
+{
+	const struct ieee80211_mgmt *mgmt = (void *)skb->data;
+	__le16 fc = mgmt->frame_control;
+
+	if (ieee80211_is_auth(fc))
+		iwl_sim_fw_ap_auth(trans_sim, mgmt, skb->len);
+	else if (ieee80211_is_assoc_req(fc) || ieee80211_is_reassoc_req(fc))
+		iwl_sim_fw_ap_assoc(trans_sim, mgmt);
+	else if (ieee80211_is_deauth(fc) || ieee80211_is_disassoc(fc))
+		trans_sim->fw.addba_sent = 0;
+	else if (ieee80211_is_action(fc))
+		iwl_sim_fw_ap_action(trans_sim, mgmt, skb->len);
+	else if (ieee80211_is_data_present(fc))
+		iwl_sim_fw_ap_data(trans_sim, sim_txq, skb);
+}
+
+/* TX status */
+
+static void iwl_sim_fw_tx_resp(struct iwl_trans_sim *trans_sim,
+			       struct iwl_txq *txq, int idx,
+			       const struct ieee80211_hdr *hdr)
+{
+	struct iwl_sim_txq *sim_txq = iwl_sim_txq(txq);
+	struct iwl_mvm_tx_resp *tx_resp;
+	struct iwl_rx_packet *pkt;
+	__le32 *scd_ssn;
+
+	/* no SEQ_RX_FRAME, but TX_CMD is never reclaimed */
+	pkt = iwl_sim_rx_alloc(trans_sim, TX_CMD,
+			       cpu_to_le16(QUEUE_TO_SEQ(txq->id) |
+					   INDEX_TO_SEQ(idx)),
+			       sizeof(*tx_resp) + sizeof(*scd_ssn));
+	if (!pkt)
+		return;
+
+	tx_resp = (void *)pkt->data;
+	tx_resp->frame_count = 1;
+	tx_resp->initial_rate = cpu_to_le32(RATE_MCS_LEGACY_OFDM_MSK | 7);
+	tx_resp->seq_ctl = hdr->seq_ctrl;
+	tx_resp->ra_tid = sim_txq->sta_id << 4 | (sim_txq->tid & 0x0f);
+	tx_resp->frame_ctrl = hdr->frame_control;
+	tx_resp->tx_queue = cpu_to_le16(txq->id);
+	tx_resp->status.status = cpu_to_le16(TX_STATUS_SUCCESS);
+
+	/* the SSN follows the frame status array */
+	scd_ssn = (void *)(tx_resp + 1);
+	*scd_ssn = cpu_to_le32((idx + 1) & (txq->n_window - 1));
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+static void iwl_sim_fw_ba_notif(struct iwl_trans_sim *trans_sim,
+				struct iwl_txq *txq, int idx)
+{
+	struct iwl_sim_txq *sim_txq = iwl_sim_txq(txq);
+	struct iwl_mvm_compressed_ba_notif *ba;
+	struct iwl_rx_packet *pkt;
+
+	pkt = iwl_sim_rx_alloc(trans_sim, BA_NOTIF, SEQ_RX_FRAME,
+			       struct_size(ba, tfd, 1));
+	if (!pkt)
+		return;
+
+	ba = (void *)pkt->data;
+	ba->sta_id = sim_txq->sta_id;
+	ba->txed = cpu_to_le16(1);
+	ba->done = cpu_to_le16(1);
+	ba->tx_rate = cpu_to_le32(RATE_MCS_LEGACY_OFDM_MSK | 7);
+	ba->tfd_cnt = cpu_to_le16(1);
+	ba->tfd[0].q_num = cpu_to_le16(txq->id);
+	ba->tfd[0].tfd_index =
+		cpu_to_le16((idx + 1) & (txq->n_window - 1));
+	ba->tfd[0].scd_queue = txq->id;
+	ba->tfd[0].tid = sim_txq->tid;
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+void iwl_sim_fw_tx(struct iwl_trans_sim *trans_sim, struct iwl_txq *txq,
+		   int idx, struct sk_buff *skb)
+{
+	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+	struct ieee80211_hdr *hdr = (void *)skb->data;
+
+	lockdep_assert_held(&txq->lock);
+
+	spin_lock_bh(&trans_sim->fw_lock);
+
+	/* the status is reported before the peer gets to answer */
+	if (info->flags & IEEE80211_TX_CTL_AMPDU)
+		iwl_sim_fw_ba_notif(trans_sim, txq, idx);
+	else
+		iwl_sim_fw_tx_resp(trans_sim, txq, idx, hdr);
+
+	if (skb->len >= sizeof(struct ieee80211_hdr_3addr) &&
+	    ether_addr_equal(hdr->addr1, iwl_sim_bssid))
+		iwl_sim_fw_ap_rx(trans_sim, iwl_sim_txq(txq), skb);
+
+	spin_unlock_bh(&trans_sim->fw_lock);
+}
+
+/* host commands */
+
+static int iwl_sim_fw_baid_alloc(struct iwl_sim_fw *fw, u8 sta_id, u8 tid)
+{
+	int baid;
+
+	for (baid = 0; baid < ARRAY_SIZE(fw->baid); baid++) {
+		if (fw->baid[baid].valid)
+			continue;
+
+		fw->baid[baid].valid = true;
+		fw->baid[baid].sta_id = sta_id;
+		fw->baid[baid].tid = tid;
+		return baid;
+	}
+
+	return -ENOSPC;
+}
+
+static bool iwl_sim_fw_baid_free(struct iwl_sim_fw *fw, u8 sta_id, u8 tid)
+{
+	int baid;
+
+	for (baid = 0; baid < ARRAY_SIZE(fw->baid); baid++) {
+		if (!fw->baid[baid].valid || fw->baid[baid].sta_id != sta_id ||
+		    fw->baid[baid].tid != tid)
+			continue;
+
+		fw->baid[baid].valid = false;
+		return true;
+	}
+
+	return false;
+}
+
+static void iwl_sim_fw_nvm_get_info(struct iwl_trans_sim *trans_sim,
+				    const void *data, u16 len, void *resp)
+{
+	struct iwl_nvm_get_info_rsp *rsp = resp;
+	int i;
+
+	rsp->general.n_hw_addrs = 1;
+	rsp->mac_sku.mac_sku_flags =
+		cpu_to_le32(NVM_MAC_SKU_FLAGS_BAND_2_4_ENABLED |
+			    NVM_MAC_SKU_FLAGS_802_11N_ENABLED);
+	rsp->phy_sku.tx_chains = cpu_to_le32(ANT_AB);
+	rsp->phy_sku.rx_chains = cpu_to_le32(ANT_AB);
+	rsp->regulatory.n_channels = cpu_to_le32(IWL_NUM_CHANNELS);
+
+	/* the 2.4 GHz channels always come first */
+	for (i = 0; i < IWL_SIM_NVM_CHANNELS; i++)
+		rsp->regulatory.channel_profile[i] =
+			cpu_to_le32(IWL_SIM_NVM_CHANNEL_FLAGS);
+}
+
+static void iwl_sim_fw_add_sta(struct iwl_trans_sim *trans_sim,
+			       const void *data, u16 len, void *resp)
+{
+	const struct iwl_mvm_add_sta_cmd *cmd = data;
+	struct iwl_cmd_response *rsp = resp;
+	u32 status = ADD_STA_SUCCESS;
+	int baid;
+
+	if (len < offsetofend(struct iwl_mvm_add_sta_cmd,
+			      add_immediate_ba_ssn))
+		goto out;
+
+	if (cmd->modify_mask & STA_MODIFY_REMOVE_BA_TID)
+		iwl_sim_fw_baid_free(&trans_sim->fw, cmd->sta_id,
+				     cmd->remove_immediate_ba_tid);
+
+	if (cmd->modify_mask & STA_MODIFY_ADD_BA_TID) {
+		baid = iwl_sim_fw_baid_alloc(&trans_sim->fw, cmd->sta_id,
+					     cmd->add_immediate_ba_tid);
+		if (baid < 0)
+			status = ADD_STA_IMMEDIATE_BA_FAILURE;
+		else
+			status |= IWL_ADD_STA_BAID_VALID_MASK |
+				  baid << IWL_ADD_STA_BAID_SHIFT;
+	}
+
+out:
+	rsp->status = cpu_to_le32(status);
+}
+
+static void iwl_sim_fw_add_sta_key(struct iwl_trans_sim *trans_sim,
+				   const void *data, u16 len, void *resp)
+{
+	struct iwl_cmd_response *rsp = resp;
+
+	rsp->status = cpu_to_le32(ADD_STA_SUCCESS);
+}
+
+static void iwl_sim_fw_baid_cfg(struct iwl_trans_sim *trans_sim,
+				const void *data, u16 len, void *resp)
+{
+	const struct iwl_rx_baid_cfg_cmd *cmd = data;
+	struct iwl_rx_baid_cfg_resp *rsp = resp;
+	struct iwl_sim_fw *fw = &trans_sim->fw;
+	u32 sta_mask, baid = IWL_MAX_BAID;
+	int ret;
+
+	if (len < sizeof(*cmd))
+		goto out;
+
+	switch (le32_to_cpu(cmd->action)) {
+	case IWL_RX_BAID_ACTION_ADD:
+		sta_mask = le32_to_cpu(cmd->alloc.sta_id_mask);
+		if (!sta_mask)
+			break;
+
+		ret = iwl_sim_fw_baid_alloc(fw, __ffs(sta_mask),
+					    cmd->alloc.tid);
+		if (ret >= 0)
+			baid = ret;
+		break;
+	case IWL_RX_BAID_ACTION_MODIFY:
+		baid = 0;
+		break;
+	case IWL_RX_BAID_ACTION_REMOVE:
+		/* version 2 identifies the session, version 1 the BAID */
+		sta_mask = le32_to_cpu(cmd->remove.sta_id_mask);
+		if (sta_mask &&
+		    iwl_sim_fw_baid_free(fw, __ffs(sta_mask),
+					 le32_to_cpu(cmd->remove.tid))) {
+			baid = 0;
+			break;
+		}
+
+		baid = le32_to_cpu(cmd->remove_v1.baid);
+		if (baid < ARRAY_SIZE(fw->baid))
+			fw->baid[baid].valid = false;
+		baid = 0;
+		break;
+	}
+
+out:
+	rsp->baid = cpu_to_le32(baid);
+}
+
+static void iwl_sim_fw_tx_path_flush(struct iwl_trans_sim *trans_sim,
+				     const void *data, u16 len, void *resp)
+{
+	const struct iwl_tx_path_flush_cmd *cmd = data;
+	struct iwl_tx_path_flush_cmd_rsp *rsp = resp;
+
+	/* every frame was already answered, nothing is ever flushed */
+	if (len >= sizeof(*cmd))
+		rsp->sta_id = cpu_to_le16(le32_to_cpu(cmd->sta_id));
+}
+
+static void iwl_sim_fw_phy_cfg(struct iwl_trans_sim *trans_sim,
+			       const void *data, u16 len)
+{
+	struct iwl_rx_packet *pkt;
+
+	/* the last step of the unified init flow */
+	pkt = iwl_sim_rx_alloc(trans_sim, INIT_COMPLETE_NOTIF, SEQ_RX_FRAME, 0);
+	if (pkt)
+		iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+static void iwl_sim_fw_rxq_sync(struct iwl_trans_sim *trans_sim,
+				const void *data, u16 len)
+{
+	const struct iwl_rxq_sync_cmd *cmd = data;
+	struct iwl_rxq_sync_notification *notif;
+	struct iwl_rx_packet *pkt;
+	u32 count;
+
+	if (len < sizeof(*cmd) ||
+	    !(cmd->rxq_mask & cpu_to_le32(BIT(0))))
+		return;
+
+	count = le32_to_cpu(cmd->count);
+	if (count > len - sizeof(*cmd))
+		return;
+
+	pkt = iwl_sim_rx_alloc(trans_sim,
+			       WIDE_ID(DATA_PATH_GROUP, RX_QUEUES_NOTIFICATION),
+			       SEQ_RX_FRAME, sizeof(*notif) + count);
+	if (!pkt)
+		return;
+
+	notif = (void *)pkt->data;
+	notif->count = cmd->count;
+	memcpy(notif->payload, cmd->payload, count);
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+static void iwl_sim_fw_session_prot(struct iwl_trans_sim *trans_sim,
+				    const void *data, u16 len)
+{
+	const struct iwl_mvm_session_prot_cmd *cmd = data;
+	struct iwl_mvm_session_prot_notif *notif;
+	struct iwl_rx_packet *pkt;
+
+	if (len < sizeof(*cmd) ||
+	    cmd->action != cpu_to_le32(FW_CTXT_ACTION_ADD))
+		return;
+
+	pkt = iwl_sim_rx_alloc(trans_sim,
+			       WIDE_ID(MAC_CONF_GROUP,
+				       SESSION_PROTECTION_NOTIF),
+			       SEQ_RX_FRAME, sizeof(*notif));
+	if (!pkt)
+		return;
+
+	/* the session starts right away and never ends on its own */
+	notif = (void *)pkt->data;
+	notif->mac_link_id = cpu_to_le32(le32_to_cpu(cmd->id_and_color) &
+					 FW_CTXT_ID_MSK);
+	notif->status = cpu_to_le32(1);
+	notif->start = cpu_to_le32(1);
+	notif->conf_id = cmd->conf_id;
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+static void iwl_sim_fw_scan(struct iwl_trans_sim *trans_sim,
+			    const void *data, u16 len)
+{
+	struct iwl_umac_scan_complete *notif;
+	struct iwl_rx_packet *pkt;
+
+	if (len < sizeof(__le32))
+		return;
+
+	/* whatever was asked for, the AP is always found */
+	iwl_sim_fw_rx_beacon(trans_sim);
+
+	pkt = iwl_sim_rx_alloc(trans_sim, SCAN_COMPLETE_UMAC, SEQ_RX_FRAME,
+			       sizeof(*notif));
+	if (!pkt)
+		return;
+
+	/* the UID is the first field in all versions of the request */
+	notif = (void *)pkt->data;
+	notif->uid = *(const __le32 *)data;
+	notif->last_schedule = 1;
+	notif->last_iter = 1;
+	notif->status = IWL_SCAN_OFFLOAD_COMPLETED;
+
+	iwl_sim_rx_commit(trans_sim, pkt);
+}
+
+/**
+ * struct iwl_sim_fw_cmd - host command known to the firmware model
+ * @id: command ID, legacy commands are in the long group
+ * @resp_len: length of the response, defaults to
+ *	&struct iwl_cmd_response
+ * @resp: fills in the (zeroed) response, if needed
+ * @notif: sends the notifications triggered by the command, after the
+ *	response
+ */
+struct iwl_sim_fw_cmd {
+	u32 id;
+	u16 resp_len;
+	void (*resp)(struct iwl_trans_sim *trans_sim, const void *data,
+		     u16 len, void *resp);
+	void (*notif)(struct iwl_trans_sim *trans_sim, const void *data,
+		      u16 len);
+};
+
+static const struct iwl_sim_fw_cmd iwl_sim_fw_cmds[] = {
+	{
+		.id = WIDE_ID(REGULATORY_AND_NVM_GROUP, NVM_GET_INFO),
+		.resp_len = sizeof(struct iwl_nvm_get_info_rsp),
+		.resp = iwl_sim_fw_nvm_get_info,
+	},
+	{
+		.id = WIDE_ID(SYSTEM_GROUP, SHARED_MEM_CFG_CMD),
+		.resp_len = sizeof(struct iwl_shared_mem_cfg),
+	},
+	{
+		.id = DEF_ID(SHARED_MEM_CFG),
+		.resp_len = sizeof(struct iwl_shared_mem_cfg),
+	},
+	{
+		.id = DEF_ID(ADD_STA),
+		.resp = iwl_sim_fw_add_sta,
+	},
+	{
+		.id = DEF_ID(ADD_STA_KEY),
+		.resp = iwl_sim_fw_add_sta_key,
+	},
+	{
+		.id = WIDE_ID(DATA_PATH_GROUP, RX_BAID_ALLOCATION_CONFIG_CMD),
+		.resp_len = sizeof(struct iwl_rx_baid_cfg_resp),
+		.resp = iwl_sim_fw_baid_cfg,
+	},
+	{
+		.id = DEF_ID(TXPATH_FLUSH),
+		.resp_len = sizeof(struct iwl_tx_path_flush_cmd_rsp),
+		.resp = iwl_sim_fw_tx_path_flush,
+	},
+	{
+		.id = DEF_ID(PHY_CONFIGURATION_CMD),
+		.notif = iwl_sim_fw_phy_cfg,
+	},
+	{
+		.id = WIDE_ID(DATA_PATH_GROUP, TRIGGER_RX_QUEUES_NOTIF_CMD),
+		.notif = iwl_sim_fw_rxq_sync,
+	},
+	{
+		.id = WIDE_ID(MAC_CONF_GROUP, SESSION_PROTECTION_CMD),
+		.notif = iwl_sim_fw_session_prot,
+	},
+	{
+		.id = DEF_ID(SCAN_REQ_UMAC),
+		.notif = iwl_sim_fw_scan,
+	},
+};
+
+void iwl_sim_fw_hcmd(struct iwl_trans_sim *trans_sim, u32 id, u16 sequence,
+		     const void *data, u16 len)
+{
+	const struct iwl_sim_fw_cmd *cmd = NULL;
+	u16 resp_len = sizeof(struct iwl_cmd_response);
+	u32 wide_id = WIDE_ID(iwl_cmd_groupid(id), iwl_cmd_opcode(id));
+	struct iwl_rx_packet *pkt;
+	int i;
+
+	if (!iwl_cmd_groupid(id))
+		wide_id = DEF_ID(iwl_cmd_opcode(id));
+
+	for (i = 0; i < ARRAY_SIZE(iwl_sim_fw_cmds); i++) {
+		if (iwl_sim_fw_cmds[i].id == wide_id) {
+			cmd = &iwl_sim_fw_cmds[i];
+			break;
+		}
+	}
+
+	if (cmd && cmd->resp_len)
+		resp_len = cmd->resp_len;
+
+	spin_lock_bh(&trans_sim->fw_lock);
+
+	/* without a response the command will time out, as on a real NIC */
+	pkt = iwl_sim_rx_alloc(trans_sim, id, cpu_to_le16(sequence), resp_len);
+	if (pkt) {
+		if (cmd && cmd->resp)
+			cmd->resp(trans_sim, data, len, pkt->data);
+		iwl_sim_rx_commit(trans_sim, pkt);
+	}
+
+	if (cmd && cmd->notif)
+		cmd->notif(trans_sim, data, len);
+
+	spin_unlock_bh(&trans_sim->fw_lock);
+}
+
+void iwl_sim_fw_start(struct iwl_trans_sim *trans_sim)
+{
+	struct iwl_alive_ntf_v6 *alive;
+	struct iwl_rx_packet *pkt;
+
+	spin_lock_bh(&trans_sim->fw_lock);
+
+	memset(&trans_sim->fw, 0, sizeof(trans_sim->fw));
+
+	/*
+	 * The largest version is good for all of them, the op_mode only
+	 * checks the length is sufficient. All the pointers are left zero
+	 * so that nothing is ever read from the (nonexistent) SRAM.
+	 */
+	pkt = iwl_sim_rx_alloc(trans_sim, UCODE_ALIVE_NTFY, SEQ_RX_FRAME,
+			       sizeof(*alive));
+	if (pkt) {
+		alive = (void *)pkt->data;
+		alive->status = cpu_to_le16(IWL_ALIVE_STATUS_OK);
+		iwl_sim_rx_commit(trans_sim, pkt);
+	}
+
+	spin_unlock_bh(&trans_sim->fw_lock);
+}
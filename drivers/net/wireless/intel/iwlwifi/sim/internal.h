@@ -0,0 +1,140 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause */
+#ifndef __iwl_trans_int_sim_h__
+#define __iwl_trans_int_sim_h__
+
+#include <linux/spinlock.h>
+#include <linux/platform_device.h>
+#include <linux/netdevice.h>
+#include <linux/skbuff.h>
+#include <linux/wait.h>
+
+#include "iwl-trans.h"
+#include "iwl-op-mode.h"
+#include "fw/api/txq.h"
+#include "fw/api/datapath.h"
+
+/*
+ * The simulated transport has no device behind it: host commands and
+ * TX frames are handed to a small firmware model (sim/fw.c) that builds
+ * the responses, notifications and RX frames the real firmware would
+ * send, and queues them on a single RX queue that is drained by NAPI
+ * just like the PCIe RX path.
+ */
+
+#define IWL_SIM_CSR_SIZE	0x400
+#define IWL_SIM_TXQ_SIZE	IWL_DEFAULT_QUEUE_SIZE
+
+/**
+ * struct iwl_sim_txq - simulated TX queue
+ * @txq: the generic queue, only the pointers, marks, lock and entries
+ *	are used; nothing is ever mapped for DMA
+ * @sta_id: station the queue was allocated for
+ * @tid: firmware TID the queue was allocated for
+ */
+struct iwl_sim_txq {
+	struct iwl_txq txq;
+	u8 sta_id;
+	u8 tid;
+};
+
+/**
+ * struct iwl_sim_baid - RX BA session known to the firmware model
+ * @valid: the BAID is allocated
+ * @sta_id: station of the session
+ * @tid: TID of the session
+ */
+struct iwl_sim_baid {
+	bool valid;
+	u8 sta_id;
+	u8 tid;
+};
+
+/**
+ * struct iwl_sim_fw - state of the firmware model
+ * @seq: next sequence number used by the simulated AP, per TID plus one
+ *	for management and non-QoS frames
+ * @addba_sent: TIDs the simulated AP already asked for an RX BA session
+ * @baid: RX BA sessions, indexed by BAID
+ */
+struct iwl_sim_fw {
+	u16 seq[IWL_MAX_TID_COUNT + 1];
+	unsigned long addba_sent;
+	struct iwl_sim_baid baid[IWL_MAX_BAID];
+};
+
+/**
+ * struct iwl_trans_sim - simulated transport
+ * @trans: pointer to the generic transport area
+ * @pdev: platform device backing the transport
+ * @list: entry in the list of simulated devices
+ * @csr: CSR register file, only used to hold the MAC address and
+ *	whatever the op_mode writes there
+ * @napi_dev: (fake) netdev for NAPI registration
+ * @napi: NAPI context draining @rx_list
+ * @rx_lock: protects @rx_list
+ * @rx_list: pages waiting to be handed to the op_mode, linked through
+ *	&struct page.lru
+ * @rx_page_order: page order of RX buffers, from the op_mode config
+ * @no_reclaim_cmds: legacy command IDs that never complete a host command
+ * @n_no_reclaim_cmds: number of entries in @no_reclaim_cmds
+ * @cmd_txq: the host command queue
+ * @cmd_entries: entries of @cmd_txq
+ * @txq_wait: woken up whenever a data queue drains
+ * @fw_lock: serializes the firmware model, nests inside the TX queue
+ *	locks and must be held (with BH disabled) to commit RX packets
+ * @fw: firmware model state
+ */
+struct iwl_trans_sim {
+	struct iwl_trans *trans;
+	struct platform_device *pdev;
+	struct list_head list;
+
+	u32 csr[IWL_SIM_CSR_SIZE / sizeof(u32)];
+
+	struct net_device napi_dev;
+	struct napi_struct napi;
+
+	spinlock_t rx_lock;
+	struct list_head rx_list;
+	u8 rx_page_order;
+
+	u8 no_reclaim_cmds[MAX_NO_RECLAIM_CMDS];
+	unsigned int n_no_reclaim_cmds;
+
+	struct iwl_txq cmd_txq;
+	struct iwl_pcie_txq_entry cmd_entries[IWL_CMD_QUEUE_SIZE];
+	wait_queue_head_t txq_wait;
+
+	spinlock_t fw_lock;
+	struct iwl_sim_fw fw;
+};
+
+#define IWL_TRANS_GET_SIM_TRANS(_iwl_trans)			\
+	((struct iwl_trans_sim *)((_iwl_trans)->trans_specific))
+
+static inline struct iwl_trans *
+iwl_trans_sim_get_trans(struct iwl_trans_sim *trans_sim)
+{
+	return container_of((void *)trans_sim, struct iwl_trans,
+			    trans_specific);
+}
+
+static inline struct iwl_sim_txq *iwl_sim_txq(struct iwl_txq *txq)
+{
+	return container_of(txq, struct iwl_sim_txq, txq);
+}
+
+/* RX queue, implemented in trans.c */
+struct iwl_rx_packet *iwl_sim_rx_alloc(struct iwl_trans_sim *trans_sim,
+				       u32 id, __le16 sequence, size_t len);
+void iwl_sim_rx_commit(struct iwl_trans_sim *trans_sim,
+		       struct iwl_rx_packet *pkt);
+
+/* firmware model, implemented in fw.c */
+void iwl_sim_fw_start(struct iwl_trans_sim *trans_sim);
+void iwl_sim_fw_hcmd(struct iwl_trans_sim *trans_sim, u32 id, u16 sequence,
+		     const void *data, u16 len);
+void iwl_sim_fw_tx(struct iwl_trans_sim *trans_sim, struct iwl_txq *txq,
+		   int idx, struct sk_buff *skb);
+
+#endif /* __iwl_trans_int_sim_h__ */
@@ -0,0 +1,881 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+#include <linux/etherdevice.h>
+#include <linux/gfp.h>
+#include <linux/list.h>
+#include <linux/log2.h>
+
+#include "iwl-drv.h"
+#include "iwl-trans.h"
+#include "iwl-csr.h"
+#include "iwl-config.h"
+#include "iwl-modparams.h"
+#include "queue/tx.h"
+#include "sim/internal.h"
+
+#define IWL_SIM_DRV_NAME	"iwlwifi-sim"
+#define IWL_SIM_FLUSH_WAIT_MS	2000
+
+static LIST_HEAD(iwl_sim_devices);
+
+/* RX queue */
+
+struct iwl_rx_packet *iwl_sim_rx_alloc(struct iwl_trans_sim *trans_sim,
+				       u32 id, __le16 sequence, size_t len)
+{
+	unsigned int order = trans_sim->rx_page_order;
+	gfp_t gfp = GFP_ATOMIC | __GFP_NOWARN | __GFP_ZERO;
+	struct iwl_rx_packet *pkt;
+	struct page *page;
+
+	if (WARN_ON_ONCE(sizeof(*pkt) + len > PAGE_SIZE << order))
+		return NULL;
+
+	if (order)
+		gfp |= __GFP_COMP;
+
+	page = alloc_pages(gfp, order);
+	if (!page)
+		return NULL;
+
+	pkt = page_address(page);
+	pkt->len_n_flags = cpu_to_le32(sizeof(pkt->hdr) + len);
+	pkt->hdr.cmd = iwl_cmd_opcode(id);
+	pkt->hdr.group_id = iwl_cmd_groupid(id);
+	pkt->hdr.sequence = sequence;
+
+	return pkt;
+}
+
+void iwl_sim_rx_commit(struct iwl_trans_sim *trans_sim,
+		       struct iwl_rx_packet *pkt)
+{
+	struct page *page = virt_to_page(pkt);
+
+	lockdep_assert_held(&trans_sim->fw_lock);
+
+	spin_lock(&trans_sim->rx_lock);
+	list_add_tail(&page->lru, &trans_sim->rx_list);
+	spin_unlock(&trans_sim->rx_lock);
+
+	/* runs once the caller re-enables BHs and dropped its locks */
+	napi_schedule(&trans_sim->napi);
+}
+
+static void iwl_trans_sim_rx_purge(struct iwl_trans_sim *trans_sim)
+{
+	struct page *page, *tmp;
+	LIST_HEAD(pages);
+
+	spin_lock_bh(&trans_sim->rx_lock);
+	list_splice_init(&trans_sim->rx_list, &pages);
+	spin_unlock_bh(&trans_sim->rx_lock);
+
+	list_for_each_entry_safe(page, tmp, &pages, lru) {
+		list_del(&page->lru);
+		__free_pages(page, trans_sim->rx_page_order);
+	}
+}
+
+static void iwl_trans_sim_hcmd_complete(struct iwl_trans *trans,
+					struct iwl_rx_cmd_buffer *rxb)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_rx_packet *pkt = rxb_addr(rxb);
+	u16 sequence = le16_to_cpu(pkt->hdr.sequence);
+	struct iwl_txq *txq = &trans_sim->cmd_txq;
+	struct iwl_cmd_meta *meta;
+	int cmd_index;
+
+	if (WARN(SEQ_TO_QUEUE(sequence) != trans->txqs.cmd.q_id,
+		 "wrong command queue %d (should be %d), sequence 0x%X\n",
+		 SEQ_TO_QUEUE(sequence), trans->txqs.cmd.q_id, sequence))
+		return;
+
+	spin_lock_bh(&txq->lock);
+
+	cmd_index = iwl_txq_get_cmd_index(txq, SEQ_TO_INDEX(sequence));
+	meta = &txq->entries[cmd_index].meta;
+
+	if (meta->flags & CMD_WANT_SKB) {
+		struct page *p = rxb_steal_page(rxb);
+
+		meta->source->resp_pkt = pkt;
+		meta->source->_rx_page_addr = (unsigned long)page_address(p);
+		meta->source->_rx_page_order = trans_sim->rx_page_order;
+	}
+
+	/* the firmware model answers in order */
+	txq->read_ptr = iwl_txq_get_cmd_index(txq, cmd_index + 1);
+
+	if (!(meta->flags & CMD_ASYNC)) {
+		clear_bit(STATUS_SYNC_HCMD_ACTIVE, &trans->status);
+		wake_up(&trans->wait_command_queue);
+	}
+
+	meta->flags = 0;
+
+	spin_unlock_bh(&txq->lock);
+}
+
+static void iwl_trans_sim_rx_handle(struct iwl_trans *trans,
+				    struct page *page)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_rx_cmd_buffer rxcb = {
+		._page = page,
+		._rx_page_order = trans_sim->rx_page_order,
+		.truesize = PAGE_SIZE << trans_sim->rx_page_order,
+	};
+	struct iwl_rx_packet *pkt = rxb_addr(&rxcb);
+	bool reclaim;
+	int i;
+
+	IWL_DEBUG_RX(trans, "cmd: %s (%.2x.%.2x, seq 0x%x)\n",
+		     iwl_get_cmd_string(trans,
+					WIDE_ID(pkt->hdr.group_id, pkt->hdr.cmd)),
+		     pkt->hdr.group_id, pkt->hdr.cmd,
+		     le16_to_cpu(pkt->hdr.sequence));
+
+	reclaim = !(pkt->hdr.sequence & SEQ_RX_FRAME);
+	if (reclaim && !pkt->hdr.group_id) {
+		for (i = 0; i < trans_sim->n_no_reclaim_cmds; i++) {
+			if (trans_sim->no_reclaim_cmds[i] == pkt->hdr.cmd) {
+				reclaim = false;
+				break;
+			}
+		}
+	}
+
+	iwl_op_mode_rx(trans->op_mode, &trans_sim->napi, &rxcb);
+
+	if (reclaim) {
+		if (!rxcb._page_stolen)
+			iwl_trans_sim_hcmd_complete(trans, &rxcb);
+		else
+			IWL_WARN(trans, "Claim null rxb?\n");
+	}
+
+	/* if the page was stolen, this only drops our reference */
+	__free_pages(page, trans_sim->rx_page_order);
+}
+
+static int iwl_trans_sim_napi_poll(struct napi_struct *napi, int budget)
+{
+	struct iwl_trans_sim *trans_sim =
+		container_of(napi->dev, struct iwl_trans_sim, napi_dev);
+	int done = 0;
+
+	while (done < budget) {
+		struct page *page;
+
+		spin_lock(&trans_sim->rx_lock);
+		page = list_first_entry_or_null(&trans_sim->rx_list,
+						struct page, lru);
+		if (page)
+			list_del(&page->lru);
+		spin_unlock(&trans_sim->rx_lock);
+
+		if (!page)
+			break;
+
+		iwl_trans_sim_rx_handle(trans_sim->trans, page);
+		done++;
+	}
+
+	if (done < budget)
+		napi_complete_done(napi, done);
+
+	return done;
+}
+
+/* TX queues */
+
+static int iwl_trans_sim_txq_space(const struct iwl_txq *txq)
+{
+	return txq->n_window - 1 -
+	       iwl_txq_get_cmd_index(txq, txq->write_ptr - txq->read_ptr);
+}
+
+static bool iwl_trans_sim_txq_empty(struct iwl_txq *txq)
+{
+	bool empty;
+
+	spin_lock_bh(&txq->lock);
+	empty = txq->read_ptr == txq->write_ptr && !txq->overflow_tx &&
+		skb_queue_empty(&txq->overflow_q);
+	spin_unlock_bh(&txq->lock);
+
+	return empty;
+}
+
+static void iwl_trans_sim_txq_init(struct iwl_txq *txq, int size, u32 id)
+{
+	spin_lock_init(&txq->lock);
+	__skb_queue_head_init(&txq->overflow_q);
+
+	/* same marks as the PCIe queues */
+	txq->n_window = size;
+	txq->low_mark = max(size / 4, 4);
+	txq->high_mark = max(size / 8, 2);
+	txq->id = id;
+	txq->read_ptr = 0;
+	txq->write_ptr = 0;
+}
+
+static void iwl_trans_sim_txq_unmap(struct iwl_trans *trans,
+				    struct iwl_txq *txq)
+{
+	struct sk_buff *skb;
+
+	spin_lock_bh(&txq->lock);
+	while (txq->read_ptr != txq->write_ptr) {
+		skb = txq->entries[txq->read_ptr].skb;
+		txq->entries[txq->read_ptr].skb = NULL;
+		txq->entries[txq->read_ptr].cmd = NULL;
+		if (!WARN_ON_ONCE(!skb))
+			iwl_op_mode_free_skb(trans->op_mode, skb);
+		txq->read_ptr = iwl_txq_get_cmd_index(txq, txq->read_ptr + 1);
+	}
+
+	while ((skb = __skb_dequeue(&txq->overflow_q)))
+		iwl_op_mode_free_skb(trans->op_mode, skb);
+	spin_unlock_bh(&txq->lock);
+
+	/* just in case - this queue may have been stopped */
+	iwl_wake_queue(trans, txq);
+}
+
+static int iwl_trans_sim_txq_alloc(struct iwl_trans *trans, u32 flags,
+				   u32 sta_mask, u8 tid, int size,
+				   unsigned int timeout)
+{
+	struct iwl_sim_txq *sim_txq;
+	struct iwl_txq *txq;
+	int qid;
+
+	size = min(size, IWL_SIM_TXQ_SIZE);
+	if (WARN_ON(!is_power_of_2(size) || !sta_mask))
+		return -EINVAL;
+
+	sim_txq = kzalloc(sizeof(*sim_txq), GFP_KERNEL);
+	if (!sim_txq)
+		return -ENOMEM;
+
+	txq = &sim_txq->txq;
+	txq->entries = kcalloc(size, sizeof(*txq->entries), GFP_KERNEL);
+	if (!txq->entries) {
+		kfree(sim_txq);
+		return -ENOMEM;
+	}
+
+	do {
+		qid = find_first_zero_bit(trans->txqs.queue_used,
+					  IWL_MAX_TVQM_QUEUES);
+		if (qid >= IWL_MAX_TVQM_QUEUES) {
+			kfree(txq->entries);
+			kfree(sim_txq);
+			return -ENOSPC;
+		}
+	} while (test_and_set_bit(qid, trans->txqs.queue_used));
+
+	iwl_trans_sim_txq_init(txq, size, qid);
+	txq->trans = trans;
+	txq->wd_timeout = msecs_to_jiffies(timeout);
+	sim_txq->sta_id = __ffs(sta_mask);
+	sim_txq->tid = tid;
+
+	trans->txqs.txq[qid] = txq;
+
+	IWL_DEBUG_TX_QUEUES(trans, "Activate queue %d (sta mask 0x%x, tid %d)\n",
+			    qid, sta_mask, tid);
+
+	return qid;
+}
+
+static void iwl_trans_sim_txq_free(struct iwl_trans *trans, int queue)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq = trans->txqs.txq[queue];
+
+	if (WARN(!test_bit(queue, trans->txqs.queue_used) || !txq,
+		 "queue %d not used", queue))
+		return;
+
+	iwl_trans_sim_txq_unmap(trans, txq);
+
+	trans->txqs.txq[queue] = NULL;
+	clear_bit(queue, trans->txqs.queue_stopped);
+	clear_bit(queue, trans->txqs.queue_used);
+
+	kfree(txq->entries);
+	kfree(iwl_sim_txq(txq));
+
+	wake_up(&trans_sim->txq_wait);
+
+	IWL_DEBUG_TX_QUEUES(trans, "Deactivate queue %d\n", queue);
+}
+
+static int iwl_trans_sim_tx(struct iwl_trans *trans, struct sk_buff *skb,
+			    struct iwl_device_tx_cmd *dev_cmd, int txq_id)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq;
+	int idx;
+
+	if (WARN_ONCE(txq_id >= IWL_MAX_TVQM_QUEUES ||
+		      !test_bit(txq_id, trans->txqs.queue_used),
+		      "TX on unused queue %d\n", txq_id))
+		return -EINVAL;
+
+	/* the firmware model parses the frame in place */
+	if (skb_is_nonlinear(skb) && __skb_linearize(skb))
+		return -ENOMEM;
+
+	txq = trans->txqs.txq[txq_id];
+
+	spin_lock_bh(&txq->lock);
+
+	if (iwl_trans_sim_txq_space(txq) < txq->high_mark) {
+		iwl_txq_stop(trans, txq);
+
+		/* don't put the packet on the ring, if there is no room */
+		if (unlikely(iwl_trans_sim_txq_space(txq) < 3)) {
+			struct iwl_device_tx_cmd **dev_cmd_ptr;
+
+			dev_cmd_ptr = (void *)((u8 *)skb->cb +
+					       trans->txqs.dev_cmd_offs);
+
+			*dev_cmd_ptr = dev_cmd;
+			__skb_queue_tail(&txq->overflow_q, skb);
+			spin_unlock_bh(&txq->lock);
+			return 0;
+		}
+	}
+
+	idx = txq->write_ptr;
+	txq->entries[idx].skb = skb;
+	txq->entries[idx].cmd = dev_cmd;
+	txq->write_ptr = iwl_txq_get_cmd_index(txq, idx + 1);
+
+	iwl_sim_fw_tx(trans_sim, txq, idx, skb);
+
+	spin_unlock_bh(&txq->lock);
+
+	return 0;
+}
+
+static void iwl_trans_sim_reclaim(struct iwl_trans *trans, int txq_id,
+				  int ssn, struct sk_buff_head *skbs,
+				  bool is_flush)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq = trans->txqs.txq[txq_id];
+	int tfd_num;
+	bool empty;
+
+	/* This function is not meant to release cmd queue*/
+	if (WARN_ON(txq_id == trans->txqs.cmd.q_id))
+		return;
+
+	if (WARN_ON(!txq))
+		return;
+
+	spin_lock_bh(&txq->lock);
+
+	if (!test_bit(txq_id, trans->txqs.queue_used)) {
+		IWL_DEBUG_TX_QUEUES(trans, "Q %d inactive - ignoring idx %d\n",
+				    txq_id, ssn);
+		goto out;
+	}
+
+	tfd_num = iwl_txq_get_cmd_index(txq, ssn);
+	if (iwl_txq_get_cmd_index(txq, tfd_num - txq->read_ptr) >
+	    iwl_txq_get_cmd_index(txq, txq->write_ptr - txq->read_ptr)) {
+		IWL_ERR(trans,
+			"%s: Read index for txq id (%d), %d is out of range [%d-%d]\n",
+			__func__, txq_id, tfd_num, txq->read_ptr,
+			txq->write_ptr);
+		goto out;
+	}
+
+	if (WARN_ON(!skb_queue_empty(skbs)))
+		goto out;
+
+	while (txq->read_ptr != tfd_num) {
+		struct sk_buff *skb = txq->entries[txq->read_ptr].skb;
+
+		txq->entries[txq->read_ptr].skb = NULL;
+		txq->entries[txq->read_ptr].cmd = NULL;
+		txq->read_ptr = iwl_txq_get_cmd_index(txq, txq->read_ptr + 1);
+
+		if (WARN_ON_ONCE(!skb))
+			continue;
+
+		__skb_queue_tail(skbs, skb);
+	}
+
+	if (iwl_trans_sim_txq_space(txq) > txq->low_mark &&
+	    test_bit(txq_id, trans->txqs.queue_stopped)) {
+		struct sk_buff_head overflow_skbs;
+		struct sk_buff *skb;
+
+		__skb_queue_head_init(&overflow_skbs);
+		skb_queue_splice_init(&txq->overflow_q,
+				      is_flush ? skbs : &overflow_skbs);
+
+		/* as in iwl_txq_reclaim(), keep wait_txq_empty() waiting */
+		txq->overflow_tx = true;
+		spin_unlock_bh(&txq->lock);
+
+		while ((skb = __skb_dequeue(&overflow_skbs))) {
+			struct iwl_device_tx_cmd *dev_cmd_ptr;
+
+			dev_cmd_ptr = *(void **)((u8 *)skb->cb +
+						 trans->txqs.dev_cmd_offs);
+
+			iwl_trans_tx(trans, skb, dev_cmd_ptr, txq_id);
+		}
+
+		if (iwl_trans_sim_txq_space(txq) > txq->low_mark)
+			iwl_wake_queue(trans, txq);
+
+		spin_lock_bh(&txq->lock);
+		txq->overflow_tx = false;
+	}
+
+out:
+	empty = txq->read_ptr == txq->write_ptr;
+	spin_unlock_bh(&txq->lock);
+
+	if (empty)
+		wake_up(&trans_sim->txq_wait);
+}
+
+static int iwl_trans_sim_wait_txq_empty(struct iwl_trans *trans, int txq_id)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq;
+
+	if (!test_bit(txq_id, trans->txqs.queue_used))
+		return -EINVAL;
+
+	txq = trans->txqs.txq[txq_id];
+
+	if (!wait_event_timeout(trans_sim->txq_wait,
+				iwl_trans_sim_txq_empty(txq),
+				msecs_to_jiffies(IWL_SIM_FLUSH_WAIT_MS))) {
+		IWL_ERR(trans,
+			"fail to flush all tx fifo queues Q %d\n", txq_id);
+		return -ETIMEDOUT;
+	}
+
+	IWL_DEBUG_TX_QUEUES(trans, "Queue %d is now empty.\n", txq_id);
+
+	return 0;
+}
+
+/* host commands */
+
+static void iwl_trans_sim_cmdq_reset(struct iwl_trans *trans)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq = &trans_sim->cmd_txq;
+
+	spin_lock_bh(&txq->lock);
+	memset(trans_sim->cmd_entries, 0, sizeof(trans_sim->cmd_entries));
+	txq->read_ptr = 0;
+	txq->write_ptr = 0;
+	spin_unlock_bh(&txq->lock);
+}
+
+static int iwl_trans_sim_send_cmd(struct iwl_trans *trans,
+				  struct iwl_host_cmd *cmd)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	struct iwl_txq *txq = &trans_sim->cmd_txq;
+	const void *data = cmd->data[0];
+	u16 len = 0, copied = 0;
+	u8 *buf = NULL;
+	u16 sequence;
+	int i, idx;
+
+	for (i = 0; i < IWL_MAX_CMD_TBS_PER_TFD; i++)
+		len += cmd->len[i];
+
+	/* the firmware model wants the command in one piece */
+	if (len != cmd->len[0]) {
+		buf = kmalloc(len, GFP_ATOMIC);
+		if (!buf)
+			return -ENOMEM;
+
+		for (i = 0; i < IWL_MAX_CMD_TBS_PER_TFD; i++) {
+			memcpy(buf + copied, cmd->data[i], cmd->len[i]);
+			copied += cmd->len[i];
+		}
+		data = buf;
+	}
+
+	spin_lock_bh(&txq->lock);
+
+	if (iwl_trans_sim_txq_space(txq) < ((cmd->flags & CMD_ASYNC) ? 2 : 1)) {
+		spin_unlock_bh(&txq->lock);
+
+		IWL_ERR(trans, "No space in command queue\n");
+		iwl_op_mode_cmd_queue_full(trans->op_mode);
+		idx = -ENOSPC;
+		goto free_buf;
+	}
+
+	idx = txq->write_ptr;
+	txq->entries[idx].meta.source = cmd;
+	txq->entries[idx].meta.flags = cmd->flags;
+
+	sequence = QUEUE_TO_SEQ(trans->txqs.cmd.q_id) | INDEX_TO_SEQ(idx);
+	txq->write_ptr = iwl_txq_get_cmd_index(txq, idx + 1);
+
+	IWL_DEBUG_HC(trans, "Sending command %s (%.2x.%.2x), seq: 0x%04X, %d bytes\n",
+		     iwl_get_cmd_string(trans, cmd->id),
+		     iwl_cmd_groupid(cmd->id), iwl_cmd_opcode(cmd->id),
+		     sequence, len);
+
+	iwl_sim_fw_hcmd(trans_sim, cmd->id, sequence, data, len);
+
+	spin_unlock_bh(&txq->lock);
+
+free_buf:
+	kfree(buf);
+	return idx;
+}
+
+/* device */
+
+static int iwl_trans_sim_start_hw(struct iwl_trans *trans)
+{
+	set_bit(STATUS_DEVICE_ENABLED, &trans->status);
+
+	return 0;
+}
+
+static int iwl_trans_sim_start_fw(struct iwl_trans *trans,
+				  const struct fw_img *fw, bool run_in_rfkill)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	int q_id = trans->txqs.cmd.q_id;
+
+	if (WARN_ON(test_and_set_bit(q_id, trans->txqs.queue_used)))
+		return -EBUSY;
+
+	iwl_trans_sim_txq_init(&trans_sim->cmd_txq, IWL_CMD_QUEUE_SIZE, q_id);
+	trans->txqs.txq[q_id] = &trans_sim->cmd_txq;
+
+	iwl_sim_fw_start(trans_sim);
+
+	return 0;
+}
+
+static void iwl_trans_sim_fw_alive(struct iwl_trans *trans, u32 scd_addr)
+{
+}
+
+static void iwl_trans_sim_stop_device(struct iwl_trans *trans)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	int i;
+
+	/* nothing the firmware still had to say matters anymore */
+	napi_disable(&trans_sim->napi);
+	iwl_trans_sim_rx_purge(trans_sim);
+
+	for (i = 0; i < ARRAY_SIZE(trans->txqs.txq); i++) {
+		if (i == trans->txqs.cmd.q_id || !trans->txqs.txq[i])
+			continue;
+
+		iwl_trans_sim_txq_free(trans, i);
+	}
+
+	iwl_trans_sim_cmdq_reset(trans);
+	trans->txqs.txq[trans->txqs.cmd.q_id] = NULL;
+	clear_bit(trans->txqs.cmd.q_id, trans->txqs.queue_used);
+
+	napi_enable(&trans_sim->napi);
+
+	clear_bit(STATUS_DEVICE_ENABLED, &trans->status);
+	clear_bit(STATUS_SYNC_HCMD_ACTIVE, &trans->status);
+	clear_bit(STATUS_INT_ENABLED, &trans->status);
+	clear_bit(STATUS_TPOWER_PMI, &trans->status);
+}
+
+static void iwl_trans_sim_configure(struct iwl_trans *trans,
+				    const struct iwl_trans_config *trans_cfg)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+
+	trans->txqs.cmd.q_id = trans_cfg->cmd_queue;
+	trans->txqs.cmd.fifo = trans_cfg->cmd_fifo;
+	trans->txqs.cmd.wdg_timeout = trans_cfg->cmd_q_wdg_timeout;
+	trans->txqs.page_offs = trans_cfg->cb_data_offs;
+	trans->txqs.dev_cmd_offs = trans_cfg->cb_data_offs + sizeof(void *);
+	trans->txqs.queue_alloc_cmd_ver = trans_cfg->queue_alloc_cmd_ver;
+
+	if (WARN_ON(trans_cfg->n_no_reclaim_cmds > MAX_NO_RECLAIM_CMDS))
+		trans_sim->n_no_reclaim_cmds = 0;
+	else
+		trans_sim->n_no_reclaim_cmds = trans_cfg->n_no_reclaim_cmds;
+	if (trans_sim->n_no_reclaim_cmds)
+		memcpy(trans_sim->no_reclaim_cmds, trans_cfg->no_reclaim_cmds,
+		       trans_sim->n_no_reclaim_cmds * sizeof(u8));
+
+	/* only pages that were already queued use the old order */
+	iwl_trans_sim_rx_purge(trans_sim);
+	trans_sim->rx_page_order =
+		iwl_trans_get_rb_size_order(trans_cfg->rx_buf_size);
+
+	trans->txqs.bc_table_dword = trans_cfg->bc_table_dword;
+
+	trans->command_groups = trans_cfg->command_groups;
+	trans->command_groups_size = trans_cfg->command_groups_size;
+}
+
+static void iwl_trans_sim_write8(struct iwl_trans *trans, u32 ofs, u8 val)
+{
+}
+
+static void iwl_trans_sim_write32(struct iwl_trans *trans, u32 ofs, u32 val)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+
+	if (ofs < IWL_SIM_CSR_SIZE)
+		WRITE_ONCE(trans_sim->csr[ofs / sizeof(u32)], val);
+}
+
+static u32 iwl_trans_sim_read32(struct iwl_trans *trans, u32 ofs)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+
+	if (ofs < IWL_SIM_CSR_SIZE)
+		return READ_ONCE(trans_sim->csr[ofs / sizeof(u32)]);
+
+	return 0;
+}
+
+static u32 iwl_trans_sim_read_prph(struct iwl_trans *trans, u32 reg)
+{
+	return 0;
+}
+
+static void iwl_trans_sim_write_prph(struct iwl_trans *trans, u32 addr,
+				     u32 val)
+{
+}
+
+static int iwl_trans_sim_read_mem(struct iwl_trans *trans, u32 addr,
+				  void *buf, int dwords)
+{
+	memset(buf, 0, dwords * sizeof(u32));
+
+	return 0;
+}
+
+static int iwl_trans_sim_write_mem(struct iwl_trans *trans, u32 addr,
+				   const void *buf, int dwords)
+{
+	return 0;
+}
+
+static bool iwl_trans_sim_grab_nic_access(struct iwl_trans *trans)
+{
+	return true;
+}
+
+static void iwl_trans_sim_release_nic_access(struct iwl_trans *trans)
+{
+}
+
+static void iwl_trans_sim_set_bits_mask(struct iwl_trans *trans, u32 reg,
+					u32 mask, u32 value)
+{
+	struct iwl_trans_sim *trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+
+	if (reg < IWL_SIM_CSR_SIZE)
+		trans_sim->csr[reg / sizeof(u32)] =
+			(trans_sim->csr[reg / sizeof(u32)] & ~mask) |
+			(value & mask);
+}
+
+static int iwl_trans_sim_load_pnvm(struct iwl_trans *trans,
+				   const struct iwl_pnvm_image *pnvm_payloads,
+				   const struct iwl_ucode_capabilities *capa)
+{
+	return 0;
+}
+
+static int
+iwl_trans_sim_load_reduce_power(struct iwl_trans *trans,
+				const struct iwl_pnvm_image *payloads,
+				const struct iwl_ucode_capabilities *capa)
+{
+	return 0;
+}
+
+static const struct iwl_trans_ops trans_ops_sim = {
+	.start_hw = iwl_trans_sim_start_hw,
+	.start_fw = iwl_trans_sim_start_fw,
+	.fw_alive = iwl_trans_sim_fw_alive,
+	.stop_device = iwl_trans_sim_stop_device,
+
+	.send_cmd = iwl_trans_sim_send_cmd,
+
+	.tx = iwl_trans_sim_tx,
+	.reclaim = iwl_trans_sim_reclaim,
+
+	.txq_alloc = iwl_trans_sim_txq_alloc,
+	.txq_free = iwl_trans_sim_txq_free,
+	.wait_txq_empty = iwl_trans_sim_wait_txq_empty,
+
+	.write8 = iwl_trans_sim_write8,
+	.write32 = iwl_trans_sim_write32,
+	.read32 = iwl_trans_sim_read32,
+	.read_prph = iwl_trans_sim_read_prph,
+	.write_prph = iwl_trans_sim_write_prph,
+	.read_mem = iwl_trans_sim_read_mem,
+	.write_mem = iwl_trans_sim_write_mem,
+	.configure = iwl_trans_sim_configure,
+	.grab_nic_access = iwl_trans_sim_grab_nic_access,
+	.release_nic_access = iwl_trans_sim_release_nic_access,
+	.set_bits_mask = iwl_trans_sim_set_bits_mask,
+
+	.load_pnvm = iwl_trans_sim_load_pnvm,
+	.load_reduce_power = iwl_trans_sim_load_reduce_power,
+};
+
+static void iwl_trans_sim_set_hw_address(struct iwl_trans *trans)
+{
+	u8 addr[ETH_ALEN];
+
+	eth_random_addr(addr);
+
+	/* in the layout iwl_set_hw_address_from_csr() expects */
+	iwl_trans_sim_write32(trans, CSR_MAC_ADDR0_STRAP(trans),
+			      addr[0] << 24 | addr[1] << 16 |
+			      addr[2] << 8 | addr[3]);
+	iwl_trans_sim_write32(trans, CSR_MAC_ADDR1_STRAP(trans),
+			      addr[4] << 8 | addr[5]);
+}
+
+static int iwl_trans_sim_add_device(int idx)
+{
+	struct iwl_trans_sim *trans_sim;
+	struct platform_device *pdev;
+	struct iwl_trans *trans;
+	int ret;
+
+	pdev = platform_device_register_simple(IWL_SIM_DRV_NAME, idx, NULL, 0);
+	if (IS_ERR(pdev))
+		return PTR_ERR(pdev);
+
+	trans = iwl_trans_alloc(sizeof(*trans_sim), &pdev->dev,
+				&trans_ops_sim, &iwl_so_trans_cfg);
+	if (!trans) {
+		ret = -ENOMEM;
+		goto out_unregister;
+	}
+
+	trans_sim = IWL_TRANS_GET_SIM_TRANS(trans);
+	trans_sim->trans = trans;
+	trans_sim->pdev = pdev;
+	spin_lock_init(&trans_sim->rx_lock);
+	INIT_LIST_HEAD(&trans_sim->rx_list);
+	spin_lock_init(&trans_sim->fw_lock);
+	init_waitqueue_head(&trans_sim->txq_wait);
+	trans_sim->cmd_txq.entries = trans_sim->cmd_entries;
+	trans_sim->cmd_txq.trans = trans;
+
+	trans->cfg = &iwlax211_2ax_cfg_so_gf_a0;
+	trans->name = iwl_ax211_name;
+	trans->hw_rev = CSR_HW_REV_TYPE_SO;
+	trans->hw_rf_id = IWL_CFG_RF_TYPE_GF << 12;
+	trans->hw_id = idx;
+	snprintf(trans->hw_id_str, sizeof(trans->hw_id_str),
+		 "SIM ID: 0x%04x", idx);
+
+	/* keep frames linear, so the firmware model can parse them */
+	trans->max_skb_frags = 0;
+
+	iwl_trans_sim_set_hw_address(trans);
+
+	init_dummy_netdev(&trans_sim->napi_dev);
+	netif_napi_add(&trans_sim->napi_dev, &trans_sim->napi,
+		       iwl_trans_sim_napi_poll);
+	napi_enable(&trans_sim->napi);
+
+	ret = iwl_trans_init(trans);
+	if (ret)
+		goto out_napi;
+
+	platform_set_drvdata(pdev, trans);
+
+	trans->drv = iwl_drv_start(trans);
+	if (IS_ERR(trans->drv)) {
+		ret = PTR_ERR(trans->drv);
+		goto out_free_trans;
+	}
+
+	list_add_tail(&trans_sim->list, &iwl_sim_devices);
+
+	IWL_INFO(trans, "Simulated device %d, rev=0x%x, rfid=0x%x\n",
+		 idx, trans->hw_rev, trans->hw_rf_id);
+
+	return 0;
+
+out_free_trans:
+	iwl_trans_free(trans);
+out_napi:
+	napi_disable(&trans_sim->napi);
+	netif_napi_del(&trans_sim->napi);
+out_unregister:
+	platform_device_unregister(pdev);
+	return ret;
+}
+
+static void iwl_trans_sim_remove_device(struct iwl_trans_sim *trans_sim)
+{
+	struct iwl_trans *trans = trans_sim->trans;
+	struct platform_device *pdev = trans_sim->pdev;
+
+	list_del(&trans_sim->list);
+
+	iwl_drv_stop(trans->drv);
+
+	napi_disable(&trans_sim->napi);
+	netif_napi_del(&trans_sim->napi);
+	iwl_trans_sim_rx_purge(trans_sim);
+
+	iwl_trans_free(trans);
+
+	/* the transport itself is device managed memory */
+	platform_device_unregister(pdev);
+}
+
+int __must_check iwl_sim_register_driver(void)
+{
+	int i, ret;
+
+	for (i = 0; i < iwlwifi_mod_params.sim_devices; i++) {
+		ret = iwl_trans_sim_add_device(i);
+		if (ret) {
+			pr_err("Unable to create simulated device %d\n", i);
+			iwl_sim_unregister_driver();
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+void iwl_sim_unregister_driver(void)
+{
+	struct iwl_trans_sim *trans_sim, *tmp;
+
+	list_for_each_entry_safe(trans_sim, tmp, &iwl_sim_devices, list)
+		iwl_trans_sim_remove_device(trans_sim);
+}
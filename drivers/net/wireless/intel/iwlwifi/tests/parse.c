@@ -0,0 +1,605 @@
+// SPDX-License-Identifier: GPL-2.0 OR BSD-3-Clause
+/*
+ * KUnit tests and timing for the firmware file and NVM parsers
+ */
+#include <kunit/test.h>
+#include <linux/firmware.h>
+#include <linux/ktime.h>
+#include <asm/unaligned.h>
+#include "iwl-drv.h"
+#include "iwl-csr.h"
+#include "iwl-trans.h"
+#include "iwl-nvm-parse.h"
+#include "fw/file.h"
+#include "fw/img.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+MODULE_IMPORT_NS(IWLWIFI);
+
+/* how often the timing cases run each parser */
+#define PARSE_TEST_ITERATIONS	100
+
+#define PARSE_TEST_FW_SIZE	SZ_64K
+#define PARSE_TEST_SEC_SIZE	SZ_4K
+#define PARSE_TEST_RT_SECS	3
+#define PARSE_TEST_INIT_SECS	2
+#define PARSE_TEST_IML_SIZE	SZ_1K
+#define PARSE_TEST_CSR_BASE	0x380
+
+static const u8 parse_test_hw_addr[ETH_ALEN] = {
+	0x02, 0x12, 0x34, 0x56, 0x78, 0x9a
+};
+
+static const struct iwl_ht_params parse_test_ht_params = {
+	.stbc = true,
+	.ldpc = true,
+	.ht40_bands = BIT(NL80211_BAND_2GHZ) | BIT(NL80211_BAND_5GHZ),
+};
+
+/* 9000-like device with the 7000-family NVM layout */
+static const struct iwl_cfg parse_test_cfg = {
+	.name = "iwlwifi parser test",
+	.trans.device_family = IWL_DEVICE_FAMILY_9000,
+	.trans.mq_rx_supported = true,
+	.ht_params = &parse_test_ht_params,
+	.nvm_type = IWL_NVM,
+};
+
+/* AX210-like device, MAC address from CSR and the UHB channel list */
+static const struct iwl_cfg parse_test_cfg_uhb = {
+	.name = "iwlwifi parser test (UHB)",
+	.trans.device_family = IWL_DEVICE_FAMILY_AX210,
+	.trans.mq_rx_supported = true,
+	.trans.integrated = true,
+	.ht_params = &parse_test_ht_params,
+	.nvm_type = IWL_NVM_EXT,
+	.mac_addr_from_csr = PARSE_TEST_CSR_BASE,
+	.uhb_supported = true,
+};
+
+static u32 parse_test_read32(struct iwl_trans *trans, u32 ofs)
+{
+	/* the strap registers hold the address in the flipped order */
+	if (ofs == CSR_MAC_ADDR0_STRAP(trans))
+		return get_unaligned_be32(parse_test_hw_addr);
+	if (ofs == CSR_MAC_ADDR1_STRAP(trans))
+		return get_unaligned_be16(parse_test_hw_addr + 4);
+	return 0;
+}
+
+static const struct iwl_trans_ops parse_test_trans_ops = {
+	.read32 = parse_test_read32,
+};
+
+static struct iwl_trans *parse_test_trans(struct kunit *test,
+					  const struct iwl_cfg *cfg)
+{
+	struct iwl_trans *trans;
+
+	trans = kunit_kzalloc(test, sizeof(*trans), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, trans);
+
+	trans->ops = &parse_test_trans_ops;
+	trans->cfg = cfg;
+	trans->trans_cfg = &cfg->trans;
+	/* keeps the NVM parser from reading the OTP version over PRPH */
+	trans->csme_own = true;
+
+	return trans;
+}
+
+/*
+ * Synthetic firmware file
+ */
+struct parse_test_fw {
+	struct firmware fw;
+	u8 *data;
+	size_t len;
+};
+
+static void parse_test_fw_tlv(struct kunit *test, struct parse_test_fw *file,
+			      u32 type, const void *data, u32 len)
+{
+	struct iwl_ucode_tlv *tlv = (void *)(file->data + file->len);
+
+	KUNIT_ASSERT_LE(test, file->len + sizeof(*tlv) + ALIGN(len, 4),
+			PARSE_TEST_FW_SIZE);
+
+	tlv->type = cpu_to_le32(type);
+	tlv->length = cpu_to_le32(len);
+	if (data)
+		memcpy(tlv->data, data, len);
+	file->len += sizeof(*tlv) + ALIGN(len, 4);
+	file->fw.size = file->len;
+}
+
+static void parse_test_fw_u32(struct kunit *test, struct parse_test_fw *file,
+			      u32 type, u32 val)
+{
+	__le32 data = cpu_to_le32(val);
+
+	parse_test_fw_tlv(test, file, type, &data, sizeof(data));
+}
+
+static void parse_test_fw_sec(struct kunit *test, struct parse_test_fw *file,
+			      u32 type, u32 offset, u8 fill)
+{
+	struct {
+		__le32 offset;
+		u8 data[PARSE_TEST_SEC_SIZE];
+	} *sec;
+
+	sec = kunit_kmalloc(test, sizeof(*sec), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sec);
+
+	sec->offset = cpu_to_le32(offset);
+	memset(sec->data, fill, sizeof(sec->data));
+	parse_test_fw_tlv(test, file, type, sec, sizeof(*sec));
+}
+
+static struct parse_test_fw *parse_test_fw_alloc(struct kunit *test)
+{
+	struct iwl_tlv_ucode_header *hdr;
+	struct parse_test_fw *file;
+
+	file = kunit_kzalloc(test, sizeof(*file), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, file);
+	file->data = kunit_kzalloc(test, PARSE_TEST_FW_SIZE, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, file->data);
+
+	hdr = (void *)file->data;
+	hdr->magic = cpu_to_le32(IWL_TLV_UCODE_MAGIC);
+	strscpy(hdr->human_readable, "kunit", sizeof(hdr->human_readable));
+	hdr->ver = cpu_to_le32(77);
+
+	file->len = sizeof(*hdr);
+	file->fw.data = file->data;
+	file->fw.size = file->len;
+
+	return file;
+}
+
+/* roughly what an MVM firmware file carries, with small sections */
+static struct parse_test_fw *parse_test_fw_mvm(struct kunit *test)
+{
+	static const struct iwl_fw_cmd_version cmd_versions[] = {
+		{ .cmd = 0x08, .group = 0x00, .cmd_ver = 5, .notif_ver = 2 },
+		{ .cmd = 0x1c, .group = 0x01, .cmd_ver = 3, .notif_ver = 0 },
+	};
+	static const struct iwl_ucode_api api = {
+		.api_index = cpu_to_le32(0),
+		.api_flags = cpu_to_le32(BIT((__force u32)
+					     IWL_UCODE_TLV_API_FRAGMENTED_SCAN)),
+	};
+	static const struct iwl_ucode_capa capa = {
+		.api_index = cpu_to_le32(0),
+		.api_capa = cpu_to_le32(BIT((__force u32)
+					    IWL_UCODE_TLV_CAPA_LAR_SUPPORT)),
+	};
+	static const __le32 version[] = {
+		cpu_to_le32(77), cpu_to_le32(0x0badcafe), cpu_to_le32(2),
+	};
+	struct parse_test_fw *file = parse_test_fw_alloc(test);
+	u8 *iml;
+	int i;
+
+	parse_test_fw_tlv(test, file, IWL_UCODE_TLV_API_CHANGES_SET,
+			  &api, sizeof(api));
+	parse_test_fw_tlv(test, file, IWL_UCODE_TLV_ENABLED_CAPABILITIES,
+			  &capa, sizeof(capa));
+	parse_test_fw_tlv(test, file, IWL_UCODE_TLV_FW_VERSION,
+			  version, sizeof(version));
+	parse_test_fw_u32(test, file, IWL_UCODE_TLV_NUM_OF_CPU, 2);
+	parse_test_fw_u32(test, file, IWL_UCODE_TLV_PHY_SKU,
+			  ANT_AB << FW_PHY_CFG_TX_CHAIN_POS |
+			  ANT_AB << FW_PHY_CFG_RX_CHAIN_POS);
+	parse_test_fw_tlv(test, file, IWL_UCODE_TLV_CMD_VERSIONS,
+			  cmd_versions, sizeof(cmd_versions));
+
+	iml = kunit_kmalloc(test, PARSE_TEST_IML_SIZE, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, iml);
+	memset(iml, 0x1a, PARSE_TEST_IML_SIZE);
+	parse_test_fw_tlv(test, file, IWL_UCODE_TLV_IML,
+			  iml, PARSE_TEST_IML_SIZE);
+
+	for (i = 0; i < PARSE_TEST_INIT_SECS; i++)
+		parse_test_fw_sec(test, file, IWL_UCODE_TLV_SEC_INIT,
+				  0x400000 + i * PARSE_TEST_SEC_SIZE, 0x10 + i);
+	for (i = 0; i < PARSE_TEST_RT_SECS; i++)
+		parse_test_fw_sec(test, file, IWL_UCODE_TLV_SEC_RT,
+				  0x800000 + i * PARSE_TEST_SEC_SIZE, 0x20 + i);
+
+	return file;
+}
+
+static void parse_test_expect_img(struct kunit *test, const struct fw_img *img,
+				  int num_sec, u32 base, u8 fill)
+{
+	int i;
+
+	KUNIT_ASSERT_EQ(test, img->num_sec, num_sec);
+
+	for (i = 0; i < num_sec; i++) {
+		const u8 *data = img->sec[i].data;
+
+		KUNIT_EXPECT_EQ(test, img->sec[i].len, PARSE_TEST_SEC_SIZE);
+		KUNIT_EXPECT_EQ(test, img->sec[i].offset,
+				base + i * PARSE_TEST_SEC_SIZE);
+		KUNIT_EXPECT_EQ(test, data[0], fill + i);
+		KUNIT_EXPECT_EQ(test, data[PARSE_TEST_SEC_SIZE - 1], fill + i);
+	}
+}
+
+static void parse_test_fw_tlv_mvm(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg);
+	struct parse_test_fw *file = parse_test_fw_mvm(test);
+	struct iwl_fw *fw;
+
+	fw = iwl_drv_test_parse_fw(trans, &file->fw);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, fw);
+
+	KUNIT_EXPECT_EQ(test, fw->type, IWL_FW_MVM);
+	KUNIT_EXPECT_EQ(test, fw->ucode_ver, 77);
+	KUNIT_EXPECT_STREQ(test, fw->fw_version, "77.0badcafe.2 ");
+	KUNIT_EXPECT_TRUE(test, fw_has_api(&fw->ucode_capa,
+					   IWL_UCODE_TLV_API_FRAGMENTED_SCAN));
+	KUNIT_EXPECT_TRUE(test, fw_has_capa(&fw->ucode_capa,
+					    IWL_UCODE_TLV_CAPA_LAR_SUPPORT));
+	KUNIT_EXPECT_EQ(test, fw->valid_tx_ant, ANT_AB);
+	KUNIT_EXPECT_EQ(test, fw->valid_rx_ant, ANT_AB);
+	KUNIT_EXPECT_EQ(test, fw->ucode_capa.n_cmd_versions, 2);
+	KUNIT_EXPECT_EQ(test, fw->iml_len, PARSE_TEST_IML_SIZE);
+
+	KUNIT_EXPECT_TRUE(test, fw->img[IWL_UCODE_REGULAR].is_dual_cpus);
+	parse_test_expect_img(test, &fw->img[IWL_UCODE_INIT],
+			      PARSE_TEST_INIT_SECS, 0x400000, 0x10);
+	parse_test_expect_img(test, &fw->img[IWL_UCODE_REGULAR],
+			      PARSE_TEST_RT_SECS, 0x800000, 0x20);
+	KUNIT_EXPECT_EQ(test, fw->img[IWL_UCODE_WOWLAN].num_sec, 0);
+
+	iwl_drv_test_free_fw(fw);
+}
+
+static void parse_test_fw_tlv_invalid(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg);
+	struct parse_test_fw *file = parse_test_fw_mvm(test);
+	struct iwl_ucode_tlv *tlv;
+	struct iwl_fw *fw;
+
+	/* a TLV that claims to extend beyond the end of the file */
+	tlv = (void *)(file->data + file->len);
+	parse_test_fw_u32(test, file, IWL_UCODE_TLV_NUM_OF_CPU, 1);
+	tlv->length = cpu_to_le32(sizeof(u32) + 4);
+
+	fw = iwl_drv_test_parse_fw(trans, &file->fw);
+	KUNIT_EXPECT_EQ(test, PTR_ERR_OR_ZERO(fw), -EINVAL);
+	if (!IS_ERR(fw))
+		iwl_drv_test_free_fw(fw);
+
+	/* and a file without the TLV magic */
+	file = parse_test_fw_alloc(test);
+	((struct iwl_tlv_ucode_header *)file->data)->magic = 0;
+
+	fw = iwl_drv_test_parse_fw(trans, &file->fw);
+	KUNIT_EXPECT_EQ(test, PTR_ERR_OR_ZERO(fw), -EINVAL);
+	if (!IS_ERR(fw))
+		iwl_drv_test_free_fw(fw);
+}
+
+/*
+ * Synthetic NVM sections, in the 7000-family layout (word offsets)
+ */
+#define PARSE_TEST_NVM_HW_ADDR		0x15
+#define PARSE_TEST_NVM_SW_SKU		2
+#define PARSE_TEST_NVM_SW_N_HW_ADDRS	3
+#define PARSE_TEST_NVM_SW_CHANNELS	0x20
+#define PARSE_TEST_NVM_SIZE		0x80
+
+#define PARSE_TEST_NVM_SKU		(BIT(0) | BIT(1) | BIT(2) | BIT(3))
+#define PARSE_TEST_CH_VALID		BIT(0)
+#define PARSE_TEST_CH_ACTIVE		BIT(3)
+#define PARSE_TEST_CH_WIDE		(BIT(8) | BIT(9) | BIT(10) | BIT(11))
+#define PARSE_TEST_NVM_2GHZ		14
+#define PARSE_TEST_NVM_5GHZ		25
+
+struct parse_test_nvm {
+	__be16 hw[PARSE_TEST_NVM_SIZE];
+	__le16 sw[PARSE_TEST_NVM_SIZE];
+	__le16 calib[PARSE_TEST_NVM_SIZE];
+};
+
+static struct parse_test_nvm *parse_test_nvm(struct kunit *test)
+{
+	struct parse_test_nvm *nvm;
+	u8 *hw_addr;
+	int i;
+
+	nvm = kunit_kzalloc(test, sizeof(*nvm), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, nvm);
+
+	/* the MAC address is stored as little endian 16-bit words */
+	hw_addr = (u8 *)&nvm->hw[PARSE_TEST_NVM_HW_ADDR];
+	for (i = 0; i < ETH_ALEN; i++)
+		hw_addr[i ^ 1] = parse_test_hw_addr[i];
+
+	nvm->sw[PARSE_TEST_NVM_SW_SKU] = cpu_to_le16(PARSE_TEST_NVM_SKU);
+	nvm->sw[PARSE_TEST_NVM_SW_N_HW_ADDRS] = cpu_to_le16(2);
+
+	/* all channels but the last one (165) are usable */
+	for (i = 0; i < PARSE_TEST_NVM_2GHZ + PARSE_TEST_NVM_5GHZ - 1; i++)
+		nvm->sw[PARSE_TEST_NVM_SW_CHANNELS + i] =
+			cpu_to_le16(PARSE_TEST_CH_VALID |
+				    PARSE_TEST_CH_ACTIVE |
+				    PARSE_TEST_CH_WIDE);
+
+	return nvm;
+}
+
+static struct iwl_nvm_data *parse_test_parse_nvm(struct iwl_trans *trans,
+						 const struct iwl_fw *fw,
+						 struct parse_test_nvm *nvm)
+{
+	return iwl_parse_nvm_data(trans, trans->cfg, fw, nvm->hw, nvm->sw,
+				  nvm->calib, NULL, NULL, NULL,
+				  ANT_AB, ANT_AB);
+}
+
+static void parse_test_nvm_legacy(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg);
+	struct parse_test_nvm *nvm = parse_test_nvm(test);
+	struct ieee80211_supported_band *sband;
+	static const struct iwl_fw fw = {};
+	struct iwl_nvm_data *data;
+
+	data = parse_test_parse_nvm(trans, &fw, nvm);
+	KUNIT_ASSERT_NOT_NULL(test, data);
+
+	KUNIT_EXPECT_MEMEQ(test, data->hw_addr, parse_test_hw_addr, ETH_ALEN);
+	KUNIT_EXPECT_EQ(test, data->n_hw_addrs, 2);
+	KUNIT_EXPECT_TRUE(test, data->sku_cap_11ac_enable);
+	KUNIT_EXPECT_FALSE(test, data->sku_cap_11ax_enable);
+	KUNIT_EXPECT_TRUE(test, data->vht160_supported);
+
+	sband = &data->bands[NL80211_BAND_2GHZ];
+	KUNIT_EXPECT_EQ(test, sband->n_channels, PARSE_TEST_NVM_2GHZ);
+	KUNIT_EXPECT_TRUE(test, sband->ht_cap.ht_supported);
+	KUNIT_EXPECT_EQ(test, sband->n_iftype_data, 0);
+
+	/* without LAR, channels that aren't valid are left out */
+	sband = &data->bands[NL80211_BAND_5GHZ];
+	KUNIT_EXPECT_EQ(test, sband->n_channels, PARSE_TEST_NVM_5GHZ - 1);
+	KUNIT_EXPECT_TRUE(test, sband->vht_cap.vht_supported);
+	KUNIT_EXPECT_TRUE(test, sband->vht_cap.cap &
+				IEEE80211_VHT_CAP_SUPP_CHAN_WIDTH_160MHZ);
+	KUNIT_EXPECT_EQ(test, sband->channels[0].hw_value, 36);
+	KUNIT_EXPECT_EQ(test, sband->channels[0].center_freq, 5180);
+
+	KUNIT_EXPECT_EQ(test, data->bands[NL80211_BAND_6GHZ].n_channels, 0);
+
+	kfree(data);
+}
+
+static struct iwl_mei_nvm *parse_test_mei_nvm(struct kunit *test)
+{
+	struct iwl_mei_nvm *mei_nvm;
+	int i;
+
+	mei_nvm = kunit_kzalloc(test, sizeof(*mei_nvm), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mei_nvm);
+
+	mei_nvm->n_hw_addrs = 1;
+	mei_nvm->caps = MEI_NVM_CAPS_LARI_SUPPORT | MEI_NVM_CAPS_11AX_SUPPORT;
+	for (i = 0; i < ARRAY_SIZE(mei_nvm->channels); i++)
+		mei_nvm->channels[i] = PARSE_TEST_CH_VALID |
+				       PARSE_TEST_CH_ACTIVE |
+				       PARSE_TEST_CH_WIDE;
+
+	return mei_nvm;
+}
+
+static void parse_test_nvm_mei_he(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg_uhb);
+	struct iwl_mei_nvm *mei_nvm = parse_test_mei_nvm(test);
+	static const struct iwl_fw fw = {
+		.valid_tx_ant = ANT_AB,
+		.valid_rx_ant = ANT_AB,
+	};
+	static const unsigned int n_channels[] = {
+		[NL80211_BAND_2GHZ] = 14,
+		[NL80211_BAND_5GHZ] = 37,
+		[NL80211_BAND_6GHZ] = 59,
+	};
+	struct iwl_nvm_data *data;
+	int band;
+
+	data = iwl_parse_mei_nvm_data(trans, trans->cfg, mei_nvm, &fw, 0, 0);
+	KUNIT_ASSERT_NOT_NULL(test, data);
+
+	KUNIT_EXPECT_MEMEQ(test, data->hw_addr, parse_test_hw_addr, ETH_ALEN);
+	KUNIT_EXPECT_TRUE(test, data->lar_enabled);
+
+	for (band = 0; band < ARRAY_SIZE(n_channels); band++) {
+		struct ieee80211_supported_band *sband = &data->bands[band];
+		const struct ieee80211_sband_iftype_data *iftd;
+
+		KUNIT_EXPECT_EQ_MSG(test, sband->n_channels, n_channels[band],
+				    "band %d", band);
+		KUNIT_ASSERT_GT_MSG(test, sband->n_iftype_data, 0,
+				    "band %d", band);
+
+		iftd = ieee80211_get_sband_iftype_data(sband,
+						       NL80211_IFTYPE_STATION);
+		KUNIT_ASSERT_NOT_NULL(test, iftd);
+		KUNIT_EXPECT_TRUE_MSG(test, iftd->he_cap.has_he,
+				      "band %d", band);
+	}
+
+	KUNIT_EXPECT_NE(test,
+			le16_to_cpu(data->iftd.uhb[0].he_6ghz_capa.capa), 0);
+
+	kfree(data);
+}
+
+static void parse_test_nvm_template(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg_uhb);
+	struct iwl_mei_nvm *mei_nvm = parse_test_mei_nvm(test);
+	static const struct iwl_fw fw = {
+		.valid_tx_ant = ANT_AB,
+		.valid_rx_ant = ANT_AB,
+	};
+	struct iwl_nvm_data *data[2];
+	int i, band;
+
+	/* the second device gets the bands copied from the template */
+	for (i = 0; i < ARRAY_SIZE(data); i++) {
+		data[i] = iwl_parse_mei_nvm_data(trans, trans->cfg, mei_nvm,
+						 &fw, 0, 0);
+		KUNIT_ASSERT_NOT_NULL(test, data[i]);
+	}
+
+	for (band = 0; band < NUM_NL80211_BANDS; band++) {
+		struct ieee80211_supported_band *a = &data[0]->bands[band];
+		struct ieee80211_supported_band *b = &data[1]->bands[band];
+		const void *iftd = (const void __force *)b->iftype_data;
+
+		KUNIT_EXPECT_EQ(test, a->n_channels, b->n_channels);
+		KUNIT_EXPECT_EQ(test, a->n_iftype_data, b->n_iftype_data);
+		if (!b->n_channels)
+			continue;
+
+		/* nothing may point into the template or the other device */
+		KUNIT_EXPECT_EQ(test, b->channels - data[1]->channels,
+				a->channels - data[0]->channels);
+		KUNIT_EXPECT_MEMEQ(test, b->channels, a->channels,
+				   b->n_channels * sizeof(*b->channels));
+		KUNIT_EXPECT_TRUE(test,
+				  iftd >= (void *)&data[1]->iftd &&
+				  iftd < (void *)(&data[1]->iftd + 1));
+	}
+
+	KUNIT_EXPECT_MEMEQ(test, &data[1]->iftd, &data[0]->iftd,
+			   sizeof(data[0]->iftd));
+
+	/* the copies are private to each device */
+	data[1]->bands[NL80211_BAND_2GHZ].channels[0].flags |=
+		IEEE80211_CHAN_DISABLED;
+	KUNIT_EXPECT_FALSE(test,
+			   data[0]->bands[NL80211_BAND_2GHZ].channels[0].flags &
+			   IEEE80211_CHAN_DISABLED);
+
+	kfree(data[0]);
+	kfree(data[1]);
+}
+
+/*
+ * Timing: these don't fail on their own, but report how long a parse
+ * takes and how many buffers its result holds, so that startup cost
+ * regressions show up in the KUnit logs.
+ */
+static void parse_test_bench_fw(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg);
+	struct parse_test_fw *file = parse_test_fw_mvm(test);
+	unsigned int allocs = 1, i;
+	size_t bytes = 0;
+	struct iwl_fw *fw;
+	u64 start, ns;
+
+	start = ktime_get_ns();
+	for (i = 0; i < PARSE_TEST_ITERATIONS; i++) {
+		fw = iwl_drv_test_parse_fw(trans, &file->fw);
+		KUNIT_ASSERT_NOT_ERR_OR_NULL(test, fw);
+		iwl_drv_test_free_fw(fw);
+	}
+	ns = ktime_get_ns() - start;
+
+	fw = iwl_drv_test_parse_fw(trans, &file->fw);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, fw);
+
+	for (i = 0; i < IWL_UCODE_TYPE_MAX; i++) {
+		const struct fw_img *img = &fw->img[i];
+		int j;
+
+		if (!img->num_sec)
+			continue;
+
+		allocs += 1 + img->num_sec;
+		for (j = 0; j < img->num_sec; j++)
+			bytes += img->sec[j].len;
+	}
+	allocs += !!fw->iml + !!fw->ucode_capa.cmd_versions;
+	bytes += fw->iml_len;
+
+	kunit_info(test,
+		   "TLV firmware: %llu ns per parse, %u allocations, %zu bytes of sections/IML (file %zu bytes)\n",
+		   div_u64(ns, PARSE_TEST_ITERATIONS), allocs, bytes,
+		   file->fw.size);
+
+	iwl_drv_test_free_fw(fw);
+}
+
+static void parse_test_bench_nvm(struct kunit *test)
+{
+	struct iwl_trans *trans = parse_test_trans(test, &parse_test_cfg);
+	struct iwl_trans *trans_uhb = parse_test_trans(test,
+						       &parse_test_cfg_uhb);
+	struct iwl_mei_nvm *mei_nvm = parse_test_mei_nvm(test);
+	struct parse_test_nvm *nvm = parse_test_nvm(test);
+	static const struct iwl_fw fw = {
+		.valid_tx_ant = ANT_AB,
+		.valid_rx_ant = ANT_AB,
+	};
+	struct iwl_nvm_data *data;
+	u64 start, ns, ns_he;
+	unsigned int i;
+
+	start = ktime_get_ns();
+	for (i = 0; i < PARSE_TEST_ITERATIONS; i++) {
+		data = parse_test_parse_nvm(trans, &fw, nvm);
+		KUNIT_ASSERT_NOT_NULL(test, data);
+		kfree(data);
+	}
+	ns = ktime_get_ns() - start;
+
+	start = ktime_get_ns();
+	for (i = 0; i < PARSE_TEST_ITERATIONS; i++) {
+		data = iwl_parse_mei_nvm_data(trans_uhb, trans_uhb->cfg,
+					      mei_nvm, &fw, 0, 0);
+		KUNIT_ASSERT_NOT_NULL(test, data);
+		kfree(data);
+	}
+	ns_he = ktime_get_ns() - start;
+
+	/* each parse is a single allocation, sized for the channel list */
+	kunit_info(test,
+		   "NVM: %llu ns per parse (%zu bytes), with HE/UHB %llu ns per parse (%zu bytes)\n",
+		   div_u64(ns, PARSE_TEST_ITERATIONS),
+		   struct_size(data, channels, PARSE_TEST_NVM_2GHZ +
+					       PARSE_TEST_NVM_5GHZ),
+		   div_u64(ns_he, PARSE_TEST_ITERATIONS),
+		   struct_size(data, channels,
+			       ARRAY_SIZE(mei_nvm->channels)));
+}
+
+static struct kunit_case parse_test_cases[] = {
+	KUNIT_CASE(parse_test_fw_tlv_mvm),
+	KUNIT_CASE(parse_test_fw_tlv_invalid),
+	KUNIT_CASE(parse_test_nvm_legacy),
+	KUNIT_CASE(parse_test_nvm_mei_he),
+	KUNIT_CASE(parse_test_nvm_template),
+	KUNIT_CASE(parse_test_bench_fw),
+	KUNIT_CASE(parse_test_bench_nvm),
+	{}
+};
+
+static struct kunit_suite iwlwifi_parse = {
+	.name = "iwlwifi-parse",
+	.test_cases = parse_test_cases,
+};
+
+kunit_test_suite(iwlwifi_parse);
@@ -12,6 +12,38 @@ static unsigned long mt76_aggr_tid_to_timeo(u8 tidno)
 	return HZ / (tidno >= 4 ? 25 : 10);
 }
 
+static ktime_t mt76_aggr_tid_to_ktime(u8 tidno)
+{
+	return ms_to_ktime(jiffies_to_msecs(mt76_aggr_tid_to_timeo(tidno)));
+}
+
+/*
+ * The ring has a power of two number of slots, so the slot index stays
+ * continuous across the SN wrap and slot distance equals SN distance.
+ */
+static int
+mt76_rx_aggr_idx(struct mt76_rx_tid *tid, u16 seqno)
+{
+	return seqno & (tid->ring_size - 1);
+}
+
+/* first occupied slot at or after @start, wrapping around the ring */
+static int
+mt76_rx_aggr_next_frame(struct mt76_rx_tid *tid, int start)
+{
+	int idx;
+
+	idx = find_next_bit(tid->reorder_map, tid->ring_size, start);
+	if (idx < tid->ring_size)
+		return idx;
+
+	idx = find_first_bit(tid->reorder_map, start);
+	if (idx < start)
+		return idx;
+
+	return -1;
+}
+
 static void
 mt76_aggr_release(struct mt76_rx_tid *tid, struct sk_buff_head *frames, int idx)
 {
@@ -24,6 +56,7 @@ mt76_aggr_release(struct mt76_rx_tid *tid, struct sk_buff_head *frames, int idx)
 		return;
 
 	tid->reorder_buf[idx] = NULL;
+	__clear_bit(idx, tid->reorder_map);
 	tid->nframes--;
 	__skb_queue_tail(frames, skb);
 }
@@ -33,22 +66,36 @@ mt76_rx_aggr_release_frames(struct mt76_rx_tid *tid,
 			    struct sk_buff_head *frames,
 			    u16 head)
 {
-	int idx;
+	int idx, next, skip;
 
 	while (ieee80211_sn_less(tid->head, head)) {
-		idx = tid->head % tid->size;
-		mt76_aggr_release(tid, frames, idx);
+		idx = mt76_rx_aggr_idx(tid, tid->head);
+		if (tid->reorder_buf[idx]) {
+			mt76_aggr_release(tid, frames, idx);
+			continue;
+		}
+
+		/* skip the whole hole up to the next stored frame at once */
+		next = mt76_rx_aggr_next_frame(tid, idx);
+		if (next < 0)
+			skip = tid->ring_size;
+		else
+			skip = mt76_rx_aggr_idx(tid, next - idx);
+		skip = min_t(int, skip, ieee80211_sn_sub(head, tid->head));
+
+		tid->head = (tid->head + skip) & IEEE80211_SN_MASK;
+		tid->stats.holes += skip;
 	}
 }
 
 static void
 mt76_rx_aggr_release_head(struct mt76_rx_tid *tid, struct sk_buff_head *frames)
 {
-	int idx = tid->head % tid->size;
+	int idx = mt76_rx_aggr_idx(tid, tid->head);
 
 	while (tid->reorder_buf[idx]) {
 		mt76_aggr_release(tid, frames, idx);
-		idx = tid->head % tid->size;
+		idx = mt76_rx_aggr_idx(tid, tid->head);
 	}
 }
 
@@ -57,62 +104,67 @@ mt76_rx_aggr_check_release(struct mt76_rx_tid *tid, struct sk_buff_head *frames)
 {
 	struct mt76_rx_status *status;
 	struct sk_buff *skb;
-	int start, idx, nframes;
+	int start, idx, offs, next;
 
 	if (!tid->nframes)
 		return;
 
 	mt76_rx_aggr_release_head(tid, frames);
 
-	start = tid->head % tid->size;
-	nframes = tid->nframes;
+	/* only visit occupied slots, offsets are relative to the head */
+	start = mt76_rx_aggr_idx(tid, tid->head);
+	for (offs = 0; tid->nframes && offs < tid->ring_size; offs = next + 1) {
+		idx = mt76_rx_aggr_idx(tid, start + offs);
+		idx = mt76_rx_aggr_next_frame(tid, idx);
+		if (idx < 0)
+			break;
 
-	for (idx = (tid->head + 1) % tid->size;
-	     idx != start && nframes;
-	     idx = (idx + 1) % tid->size) {
-		skb = tid->reorder_buf[idx];
-		if (!skb)
-			continue;
+		next = mt76_rx_aggr_idx(tid, idx - start);
+		if (next < offs)
+			break;
 
-		nframes--;
+		skb = tid->reorder_buf[idx];
 		status = (struct mt76_rx_status *)skb->cb;
 		if (!time_after32(jiffies,
 				  status->reorder_time +
 				  mt76_aggr_tid_to_timeo(tid->num)))
 			continue;
 
+		tid->stats.timeouts++;
 		mt76_rx_aggr_release_frames(tid, frames, status->seqno);
 	}
 
 	mt76_rx_aggr_release_head(tid, frames);
 }
 
-static void
-mt76_rx_aggr_reorder_work(struct work_struct *work)
+static enum hrtimer_restart
+mt76_rx_aggr_reorder_timer(struct hrtimer *timer)
 {
-	struct mt76_rx_tid *tid = container_of(work, struct mt76_rx_tid,
-					       reorder_work.work);
+	struct mt76_rx_tid *tid = container_of(timer, struct mt76_rx_tid,
+					       reorder_timer);
 	struct mt76_dev *dev = tid->dev;
 	struct sk_buff_head frames;
-	int nframes;
 
 	__skb_queue_head_init(&frames);
 
-	local_bh_disable();
 	rcu_read_lock();
 
+	/*
+	 * Re-arm under the lock, so mt76_rx_aggr_reorder() can't start the
+	 * timer concurrently once it sees it isn't queued.
+	 */
 	spin_lock(&tid->lock);
 	mt76_rx_aggr_check_release(tid, &frames);
-	nframes = tid->nframes;
+	if (tid->nframes)
+		hrtimer_start(timer, mt76_aggr_tid_to_ktime(tid->num),
+			      HRTIMER_MODE_REL_SOFT);
 	spin_unlock(&tid->lock);
 
-	if (nframes)
-		ieee80211_queue_delayed_work(tid->dev->hw, &tid->reorder_work,
-					     mt76_aggr_tid_to_timeo(tid->num));
 	mt76_rx_complete(dev, &frames, NULL);
 
 	rcu_read_unlock();
-	local_bh_enable();
+
+	return HRTIMER_NORESTART;
 }
 
 static void
@@ -198,6 +250,7 @@ void mt76_rx_aggr_reorder(struct sk_buff *skb, struct sk_buff_head *frames)
 	if (sn_less) {
 		__skb_unlink(skb, frames);
 		dev_kfree_skb(skb);
+		tid->stats.dups++;
 		goto out;
 	}
 
@@ -219,21 +272,25 @@ void mt76_rx_aggr_reorder(struct sk_buff *skb, struct sk_buff_head *frames)
 		mt76_rx_aggr_release_frames(tid, frames, head);
 	}
 
-	idx = seqno % size;
+	idx = mt76_rx_aggr_idx(tid, seqno);
 
 	/* Discard if the current slot is already in use */
 	if (tid->reorder_buf[idx]) {
 		dev_kfree_skb(skb);
+		tid->stats.dups++;
 		goto out;
 	}
 
 	status->reorder_time = jiffies;
 	tid->reorder_buf[idx] = skb;
+	__set_bit(idx, tid->reorder_map);
 	tid->nframes++;
 	mt76_rx_aggr_release_head(tid, frames);
 
-	ieee80211_queue_delayed_work(tid->dev->hw, &tid->reorder_work,
-				     mt76_aggr_tid_to_timeo(tid->num));
+	if (tid->nframes && !hrtimer_is_queued(&tid->reorder_timer))
+		hrtimer_start(&tid->reorder_timer,
+			      mt76_aggr_tid_to_ktime(tid->num),
+			      HRTIMER_MODE_REL_SOFT);
 
 out:
 	spin_unlock_bh(&tid->lock);
@@ -242,19 +299,27 @@ out:
 int mt76_rx_aggr_start(struct mt76_dev *dev, struct mt76_wcid *wcid, u8 tidno,
 		       u16 ssn, u16 size)
 {
+	u16 ring_size = roundup_pow_of_two(size);
 	struct mt76_rx_tid *tid;
 
 	mt76_rx_aggr_stop(dev, wcid, tidno);
 
-	tid = kzalloc(struct_size(tid, reorder_buf, size), GFP_KERNEL);
+	/* the occupancy bitmap is placed right after the frame ring */
+	tid = kzalloc(struct_size(tid, reorder_buf, ring_size) +
+		      BITS_TO_LONGS(ring_size) * sizeof(unsigned long),
+		      GFP_KERNEL);
 	if (!tid)
 		return -ENOMEM;
 
 	tid->dev = dev;
 	tid->head = ssn;
 	tid->size = size;
+	tid->ring_size = ring_size;
 	tid->num = tidno;
-	INIT_DELAYED_WORK(&tid->reorder_work, mt76_rx_aggr_reorder_work);
+	tid->reorder_map = (unsigned long *)&tid->reorder_buf[ring_size];
+	hrtimer_init(&tid->reorder_timer, CLOCK_MONOTONIC,
+		     HRTIMER_MODE_REL_SOFT);
+	tid->reorder_timer.function = mt76_rx_aggr_reorder_timer;
 	spin_lock_init(&tid->lock);
 
 	rcu_assign_pointer(wcid->aggr[tidno], tid);
@@ -265,26 +330,22 @@ EXPORT_SYMBOL_GPL(mt76_rx_aggr_start);
 
 static void mt76_rx_aggr_shutdown(struct mt76_dev *dev, struct mt76_rx_tid *tid)
 {
-	u16 size = tid->size;
+	u16 size = tid->ring_size;
 	int i;
 
 	spin_lock_bh(&tid->lock);
 
 	tid->stopped = true;
-	for (i = 0; tid->nframes && i < size; i++) {
-		struct sk_buff *skb = tid->reorder_buf[i];
-
-		if (!skb)
-			continue;
-
+	for_each_set_bit(i, tid->reorder_map, size) {
+		dev_kfree_skb(tid->reorder_buf[i]);
 		tid->reorder_buf[i] = NULL;
-		tid->nframes--;
-		dev_kfree_skb(skb);
 	}
+	bitmap_zero(tid->reorder_map, size);
+	tid->nframes = 0;
 
 	spin_unlock_bh(&tid->lock);
 
-	cancel_delayed_work_sync(&tid->reorder_work);
+	hrtimer_cancel(&tid->reorder_timer);
 }
 
 void mt76_rx_aggr_stop(struct mt76_dev *dev, struct mt76_wcid *wcid, u8 tidno)
@@ -88,6 +88,38 @@ static int mt76_rx_queues_read(struct seq_file *s, void *data)
 	return 0;
 }
 
+static int mt76_rx_reorder_read(struct seq_file *s, void *data)
+{
+	struct mt76_dev *dev = dev_get_drvdata(s->private);
+	int i, tidno;
+
+	seq_puts(s, "      wcid |  tid | size |  queued |    holes | timeouts |     dups |\n");
+
+	rcu_read_lock();
+	for (i = 0; i < ARRAY_SIZE(dev->wcid); i++) {
+		struct mt76_wcid *wcid = rcu_dereference(dev->wcid[i]);
+
+		if (!wcid)
+			continue;
+
+		for (tidno = 0; tidno < IEEE80211_NUM_TIDS; tidno++) {
+			struct mt76_rx_tid *tid;
+
+			tid = rcu_dereference(wcid->aggr[tidno]);
+			if (!tid)
+				continue;
+
+			seq_printf(s, " %9d | %4d | %4d | %7d | %8u | %8u | %8u |\n",
+				   i, tidno, tid->size, tid->nframes,
+				   tid->stats.holes, tid->stats.timeouts,
+				   tid->stats.dups);
+		}
+	}
+	rcu_read_unlock();
+
+	return 0;
+}
+
 void mt76_seq_puts_array(struct seq_file *file, const char *str,
 			 s8 *val, int len)
 {
@@ -120,6 +152,8 @@ mt76_register_debugfs_fops(struct mt76_phy *phy,
 		debugfs_create_blob("otp", 0400, dir, &dev->otp);
 	debugfs_create_devm_seqfile(dev->dev, "rx-queues", dir,
 				    mt76_rx_queues_read);
+	debugfs_create_devm_seqfile(dev->dev, "rx-reorder", dir,
+				    mt76_rx_reorder_read);
 
 	return dir;
 }
@@ -1304,10 +1304,11 @@ mt76_check_sta(struct mt76_dev *dev, struct sk_buff *skb)
 void mt76_rx_complete(struct mt76_dev *dev, struct sk_buff_head *frames,
 		      struct napi_struct *napi)
 {
-	struct ieee80211_sta *sta;
-	struct ieee80211_hw *hw;
-	struct sk_buff *skb, *tmp;
+	struct ieee80211_sta *sta, *batch_sta = NULL;
+	struct ieee80211_hw *hw, *batch_hw = NULL;
+	struct sk_buff *skb, *tmp, *batch[16];
 	LIST_HEAD(list);
+	int n = 0;
 
 	spin_lock(&dev->rx_lock);
 	while ((skb = __skb_dequeue(frames)) != NULL) {
@@ -1315,19 +1316,33 @@ void mt76_rx_complete(struct mt76_dev *dev, struct sk_buff_head *frames,
 
 		mt76_check_ccmp_pn(skb);
 		skb_shinfo(skb)->frag_list = NULL;
-		mt76_rx_convert(dev, skb, &hw, &sta);
-		ieee80211_rx_list(hw, sta, skb, &list);
-
-		/* subsequent amsdu frames */
-		while (nskb) {
-			skb = nskb;
-			nskb = nskb->next;
-			skb->next = NULL;
 
+		while (skb) {
 			mt76_rx_convert(dev, skb, &hw, &sta);
-			ieee80211_rx_list(hw, sta, skb, &list);
+
+			/* hand over consecutive frames of a station at once */
+			if (n == ARRAY_SIZE(batch) ||
+			    (n && (hw != batch_hw || sta != batch_sta))) {
+				ieee80211_rx_list_batch(batch_hw, batch_sta,
+							batch, n, &list);
+				n = 0;
+			}
+
+			batch_hw = hw;
+			batch_sta = sta;
+			batch[n++] = skb;
+
+			/* subsequent amsdu frames */
+			skb = nskb;
+			if (nskb) {
+				nskb = nskb->next;
+				skb->next = NULL;
+			}
 		}
 	}
+
+	if (n)
+		ieee80211_rx_list_batch(batch_hw, batch_sta, batch, n, &list);
 	spin_unlock(&dev->rx_lock);
 
 	if (!napi) {
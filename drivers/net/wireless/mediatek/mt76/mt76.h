@@ -362,23 +362,33 @@ struct mt76_txwi_cache {
 	};
 };
 
+struct mt76_rx_tid_stats {
+	u32 holes;
+	u32 timeouts;
+	u32 dups;
+};
+
 struct mt76_rx_tid {
 	struct rcu_head rcu_head;
 
 	struct mt76_dev *dev;
 
 	spinlock_t lock;
-	struct delayed_work reorder_work;
+	struct hrtimer reorder_timer;
 
 	u16 head;
 	u16 size;
+	u16 ring_size;
 	u16 nframes;
 
 	u8 num;
 
 	u8 started:1, stopped:1, timer_pending:1;
 
-	struct sk_buff *reorder_buf[] __counted_by(size);
+	struct mt76_rx_tid_stats stats;
+
+	unsigned long *reorder_map;
+	struct sk_buff *reorder_buf[] __counted_by(ring_size);
 };
 
 #define MT_TX_CB_DMA_DONE		BIT(0)
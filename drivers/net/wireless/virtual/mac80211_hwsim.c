@@ -59,7 +59,7 @@ MODULE_PARM_DESC(paged_rx, "Use paged SKBs for RX instead of linear ones");
 
 static bool rctbl = false;
 module_param(rctbl, bool, 0444);
-MODULE_PARM_DESC(rctbl, "Handle rate control table");
+MODULE_PARM_DESC(rctbl, "Handle rate control table, including HE/EHT rates");
 
 static bool support_p2p_device = true;
 module_param(support_p2p_device, bool, 0444);
@@ -1241,13 +1241,17 @@ static void mac80211_hwsim_monitor_rx(struct ieee80211_hw *hw,
 	struct mac80211_hwsim_data *data = hw->priv;
 	struct sk_buff *skb;
 	struct hwsim_radiotap_hdr *hdr;
-	u16 flags, bitrate;
+	u16 flags, bitrate = 0;
 	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(tx_skb);
-	struct ieee80211_rate *txrate = ieee80211_get_tx_rate(hw, info);
+	struct ieee80211_rate *txrate = NULL;
 
-	if (!txrate)
-		bitrate = 0;
-	else
+	/*
+	 * HE/EHT rates from the rate table leave no legacy rate in the tx
+	 * info, radiotap can't carry those in the rate field, so omit it.
+	 */
+	if (info->control.rates[0].idx >= 0)
+		txrate = ieee80211_get_tx_rate(hw, info);
+	if (txrate)
 		bitrate = txrate->bitrate;
 
 	if (!netif_running(hwsim_mon))
@@ -1270,7 +1274,7 @@ static void mac80211_hwsim_monitor_rx(struct ieee80211_hw *hw,
 	hdr->rt_rate = bitrate / 5;
 	hdr->rt_channel = cpu_to_le16(chan->center_freq);
 	flags = IEEE80211_CHAN_2GHZ;
-	if (txrate && txrate->flags & IEEE80211_RATE_ERP_G)
+	if (!txrate || txrate->flags & IEEE80211_RATE_ERP_G)
 		flags |= IEEE80211_CHAN_OFDM;
 	else
 		flags |= IEEE80211_CHAN_CCK;
@@ -1737,9 +1741,71 @@ static void mac80211_hwsim_rx(struct mac80211_hwsim_data *data,
 	ieee80211_rx_irqsafe(data->hw, skb);
 }
 
+/*
+ * With SUPPORTS_HE_RC_TABLE the first entry of the station rate table may be
+ * an HE/EHT rate, which ieee80211_get_tx_rates() can't put into the tx info.
+ * Translate it so the frame can be simulated and reported at that rate.
+ */
+static bool hwsim_get_table_rate(struct ieee80211_sta *sta,
+				 struct rate_info *rate)
+{
+	struct ieee80211_sta_rates *ratetbl;
+	u16 flags;
+	s8 idx;
+
+	if (!sta)
+		return false;
+
+	ratetbl = rcu_dereference(sta->rates);
+	if (!ratetbl)
+		return false;
+
+	idx = ratetbl->rate[0].idx;
+	flags = ratetbl->rate[0].flags;
+	if (idx < 0 ||
+	    !(flags & (IEEE80211_TX_RC_HE_MCS | IEEE80211_TX_RC_EHT_MCS)))
+		return false;
+
+	memset(rate, 0, sizeof(*rate));
+	rate->mcs = idx & 0xf;
+	rate->nss = (idx >> 4) + 1;
+
+	if (flags & IEEE80211_TX_RC_320_MHZ_WIDTH)
+		rate->bw = RATE_INFO_BW_320;
+	else if (flags & IEEE80211_TX_RC_160_MHZ_WIDTH)
+		rate->bw = RATE_INFO_BW_160;
+	else if (flags & IEEE80211_TX_RC_80_MHZ_WIDTH)
+		rate->bw = RATE_INFO_BW_80;
+	else if (flags & IEEE80211_TX_RC_40_MHZ_WIDTH)
+		rate->bw = RATE_INFO_BW_40;
+	else
+		rate->bw = RATE_INFO_BW_20;
+
+	if (flags & IEEE80211_TX_RC_EHT_MCS) {
+		rate->flags = RATE_INFO_FLAGS_EHT_MCS;
+		if (flags & IEEE80211_TX_RC_GI_3_2)
+			rate->eht_gi = NL80211_RATE_INFO_EHT_GI_3_2;
+		else if (flags & IEEE80211_TX_RC_GI_1_6)
+			rate->eht_gi = NL80211_RATE_INFO_EHT_GI_1_6;
+		else
+			rate->eht_gi = NL80211_RATE_INFO_EHT_GI_0_8;
+	} else {
+		rate->flags = RATE_INFO_FLAGS_HE_MCS;
+		if (flags & IEEE80211_TX_RC_GI_3_2)
+			rate->he_gi = NL80211_RATE_INFO_HE_GI_3_2;
+		else if (flags & IEEE80211_TX_RC_GI_1_6)
+			rate->he_gi = NL80211_RATE_INFO_HE_GI_1_6;
+		else
+			rate->he_gi = NL80211_RATE_INFO_HE_GI_0_8;
+	}
+
+	return true;
+}
+
 static bool mac80211_hwsim_tx_frame_no_nl(struct ieee80211_hw *hw,
 					  struct sk_buff *skb,
-					  struct ieee80211_channel *chan)
+					  struct ieee80211_channel *chan,
+					  const struct rate_info *txrate)
 {
 	struct mac80211_hwsim_data *data = hw->priv, *data2;
 	bool ack = false;
@@ -1774,6 +1840,18 @@ static bool mac80211_hwsim_tx_frame_no_nl(struct ieee80211_hw *hw,
 		rx_status.bw = RATE_INFO_BW_20;
 	if (info->control.rates[0].flags & IEEE80211_TX_RC_SHORT_GI)
 		rx_status.enc_flags |= RX_ENC_FLAG_SHORT_GI;
+	if (txrate) {
+		rx_status.encoding = txrate->flags & RATE_INFO_FLAGS_EHT_MCS ?
+				     RX_ENC_EHT : RX_ENC_HE;
+		rx_status.enc_flags = 0;
+		rx_status.rate_idx = txrate->mcs;
+		rx_status.nss = txrate->nss;
+		rx_status.bw = txrate->bw;
+		if (rx_status.encoding == RX_ENC_EHT)
+			rx_status.eht.gi = txrate->eht_gi;
+		else
+			rx_status.he_gi = txrate->he_gi;
+	}
 	/* TODO: simulate optional packet loss */
 	rx_status.signal = data->rx_rssi;
 	if (info->control.vif)
@@ -1930,7 +2008,8 @@ static void mac80211_hwsim_tx(struct ieee80211_hw *hw,
 	struct ieee80211_hdr *hdr = (void *)skb->data;
 	struct ieee80211_chanctx_conf *chanctx_conf;
 	struct ieee80211_channel *channel;
-	bool ack;
+	struct rate_info txrate;
+	bool ack, table_rate = false;
 	enum nl80211_chan_width confbw = NL80211_CHAN_WIDTH_20_NOHT;
 	u32 _portid, i;
 
@@ -2023,6 +2102,10 @@ static void mac80211_hwsim_tx(struct ieee80211_hw *hw,
 				       txi->control.rates,
 				       ARRAY_SIZE(txi->control.rates));
 
+	if (ieee80211_hw_check(hw, SUPPORTS_HE_RC_TABLE) &&
+	    txi->control.rates[0].idx < 0)
+		table_rate = hwsim_get_table_rate(control->sta, &txrate);
+
 	for (i = 0; i < ARRAY_SIZE(txi->control.rates); i++) {
 		u16 rflags = txi->control.rates[i].flags;
 		/* initialize to data->bw for 5/10 MHz handling */
@@ -2046,15 +2129,19 @@ static void mac80211_hwsim_tx(struct ieee80211_hw *hw,
 	    ieee80211_is_probe_resp(hdr->frame_control)) {
 		/* fake header transmission time */
 		struct ieee80211_mgmt *mgmt;
-		struct ieee80211_rate *txrate;
+		struct ieee80211_rate *legacy;
 		/* TODO: get MCS */
 		int bitrate = 100;
 		u64 ts;
 
 		mgmt = (struct ieee80211_mgmt *)skb->data;
-		txrate = ieee80211_get_tx_rate(hw, txi);
-		if (txrate)
-			bitrate = txrate->bitrate;
+		if (table_rate) {
+			bitrate = cfg80211_calculate_bitrate(&txrate) ?: bitrate;
+		} else if (txi->control.rates[0].idx >= 0) {
+			legacy = ieee80211_get_tx_rate(hw, txi);
+			if (legacy)
+				bitrate = legacy->bitrate;
+		}
 		ts = mac80211_hwsim_get_tsf_raw();
 		mgmt->u.probe_resp.timestamp =
 			cpu_to_le64(ts + data->tsf_offset +
@@ -2066,13 +2153,22 @@ static void mac80211_hwsim_tx(struct ieee80211_hw *hw,
 	/* wmediumd mode check */
 	_portid = READ_ONCE(data->wmediumd);
 
-	if (_portid || hwsim_virtio_enabled)
+	if (_portid || hwsim_virtio_enabled) {
+		/* wmediumd can't simulate HE/EHT rates, use the lowest rate */
+		if (table_rate) {
+			txi->control.rates[0].idx = 0;
+			txi->control.rates[0].flags = 0;
+			txi->control.rates[0].count = 1;
+			txi->control.rates[1].idx = -1;
+		}
 		return mac80211_hwsim_tx_frame_nl(hw, skb, _portid, channel);
+	}
 
 	/* NO wmediumd detected, perfect medium simulation */
 	data->tx_pkts++;
 	data->tx_bytes += skb->len;
-	ack = mac80211_hwsim_tx_frame_no_nl(hw, skb, channel);
+	ack = mac80211_hwsim_tx_frame_no_nl(hw, skb, channel,
+					    table_rate ? &txrate : NULL);
 
 	if (ack && skb->len >= 16)
 		mac80211_hwsim_monitor_ack(channel, hdr->addr2);
@@ -2085,6 +2181,33 @@ static void mac80211_hwsim_tx(struct ieee80211_hw *hw,
 
 	if (!(txi->flags & IEEE80211_TX_CTL_NO_ACK) && ack)
 		txi->flags |= IEEE80211_TX_STAT_ACK;
+
+	/*
+	 * HE/EHT rates can only be reported with rate_info, and the status
+	 * APIs may not be mixed, so use the extended one for all frames.
+	 */
+	if (ieee80211_hw_check(hw, SUPPORTS_HE_RC_TABLE)) {
+		struct ieee80211_rate_status rs = {
+			.try_count = 1,
+		};
+		struct ieee80211_tx_status status = {
+			.sta = control->sta,
+			.info = txi,
+			.skb = skb,
+		};
+
+		if (table_rate) {
+			rs.rate_idx = txrate;
+			status.rates = &rs;
+			status.n_rates = 1;
+		}
+
+		local_bh_disable();
+		ieee80211_tx_status_ext(hw, &status);
+		local_bh_enable();
+		return;
+	}
+
 	ieee80211_tx_status_irqsafe(hw, skb);
 }
 
@@ -2190,7 +2313,7 @@ static void mac80211_hwsim_tx_frame(struct ieee80211_hw *hw,
 
 	data->tx_pkts++;
 	data->tx_bytes += skb->len;
-	mac80211_hwsim_tx_frame_no_nl(hw, skb, chan);
+	mac80211_hwsim_tx_frame_no_nl(hw, skb, chan, NULL);
 	dev_kfree_skb(skb);
 }
 
@@ -5231,8 +5354,10 @@ static int mac80211_hwsim_new_radio(struct genl_info *info,
 	} else {
 		ieee80211_hw_set(hw, HOST_BROADCAST_PS_BUFFERING);
 		ieee80211_hw_set(hw, PS_NULLFUNC_STACK);
-		if (rctbl)
+		if (rctbl) {
 			ieee80211_hw_set(hw, SUPPORTS_RC_TABLE);
+			ieee80211_hw_set(hw, SUPPORTS_HE_RC_TABLE);
+		}
 	}
 
 	hw->wiphy->flags &= ~WIPHY_FLAG_PS_ON_BY_DEFAULT;
@@ -1029,6 +1029,19 @@ enum mac80211_tx_status_flags {
  *	adjacent 20 MHz channels, if the current channel type is
  *	NL80211_CHAN_HT40MINUS or NL80211_CHAN_HT40PLUS.
  * @IEEE80211_TX_RC_SHORT_GI: Short Guard interval should be used for this rate.
+ * @IEEE80211_TX_RC_HE_MCS: HE MCS rate, the idx field is split like for
+ *	%IEEE80211_TX_RC_VHT_MCS. Only valid in &struct ieee80211_sta_rates.
+ * @IEEE80211_TX_RC_EHT_MCS: EHT MCS rate, the idx field is split like for
+ *	%IEEE80211_TX_RC_VHT_MCS. Only valid in &struct ieee80211_sta_rates.
+ * @IEEE80211_TX_RC_320_MHZ_WIDTH: Indicates 320 MHz transmission (EHT only)
+ * @IEEE80211_TX_RC_GI_1_6: Use a 1.6 usec guard interval with 2x LTF for
+ *	this HE/EHT rate instead of the default 0.8 usec with 2x LTF.
+ * @IEEE80211_TX_RC_GI_3_2: Use a 3.2 usec guard interval with 4x LTF for
+ *	this HE/EHT rate.
+ *
+ * The HE/EHT flags (from %IEEE80211_TX_RC_HE_MCS on) don't fit into the
+ * @flags member of struct ieee80211_tx_rate, they can only be used in the
+ * station rate table by drivers setting %IEEE80211_HW_SUPPORTS_HE_RC_TABLE.
  */
 enum mac80211_rate_control_flags {
 	IEEE80211_TX_RC_USE_RTS_CTS		= BIT(0),
@@ -1044,6 +1057,13 @@ enum mac80211_rate_control_flags {
 	IEEE80211_TX_RC_VHT_MCS			= BIT(8),
 	IEEE80211_TX_RC_80_MHZ_WIDTH		= BIT(9),
 	IEEE80211_TX_RC_160_MHZ_WIDTH		= BIT(10),
+
+	/* rate table only, see &struct ieee80211_sta_rates */
+	IEEE80211_TX_RC_HE_MCS			= BIT(11),
+	IEEE80211_TX_RC_EHT_MCS			= BIT(12),
+	IEEE80211_TX_RC_320_MHZ_WIDTH		= BIT(13),
+	IEEE80211_TX_RC_GI_1_6			= BIT(14),
+	IEEE80211_TX_RC_GI_3_2			= BIT(15),
 };
 
 
@@ -2277,6 +2297,10 @@ enum ieee80211_sta_rx_bandwidth {
  * @rcu_head: RCU head used for freeing the table on update
  * @rate: transmit rates/flags to be used by default.
  *	Overriding entries per-packet is possible by using cb tx control.
+ *	If the driver sets %IEEE80211_HW_SUPPORTS_HE_RC_TABLE, entries may
+ *	also use the HE/EHT flags from &enum mac80211_rate_control_flags;
+ *	ieee80211_get_tx_rates() stops at the first such entry since it can't
+ *	be expressed in &struct ieee80211_tx_rate.
  */
 struct ieee80211_sta_rates {
 	struct rcu_head rcu_head;
@@ -2776,6 +2800,12 @@ struct ieee80211_txq {
  * @IEEE80211_HW_DISALLOW_PUNCTURING: HW requires disabling puncturing in EHT
  *	and connecting with a lower bandwidth instead
  *
+ * @IEEE80211_HW_SUPPORTS_HE_RC_TABLE: The driver reads HE/EHT rates
+ *	(%IEEE80211_TX_RC_HE_MCS, %IEEE80211_TX_RC_EHT_MCS) directly from the
+ *	station rate table, and reports their tx status using &struct rate_info
+ *	in ieee80211_tx_status_ext(). Lets software rate control use HE and
+ *	EHT rates. Requires %IEEE80211_HW_SUPPORTS_RC_TABLE.
+ *
  * @NUM_IEEE80211_HW_FLAGS: number of hardware flags, used for sizing arrays
  */
 enum ieee80211_hw_flags {
@@ -2834,6 +2864,7 @@ enum ieee80211_hw_flags {
 	IEEE80211_HW_DETECTS_COLOR_COLLISION,
 	IEEE80211_HW_MLO_MCAST_MULTI_LINK_TX,
 	IEEE80211_HW_DISALLOW_PUNCTURING,
+	IEEE80211_HW_SUPPORTS_HE_RC_TABLE,
 
 	/* keep last, obviously */
 	NUM_IEEE80211_HW_FLAGS
@@ -5030,6 +5061,36 @@ void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *sta,
 		       struct sk_buff *skb, struct sk_buff_head *list);
 #endif
 
+/**
+ * ieee80211_rx_list_batch - receive a batch of frames into a list
+ *
+ * Like ieee80211_rx_list(), but for several frames at once, typically
+ * all frames for one station and TID that the driver collected within
+ * one NAPI poll. Checks that only depend on the device state are done
+ * once for the whole batch, and the header of the next frame is
+ * prefetched while the current one is processed. For MLO stations,
+ * drivers that know the link should set the link_valid and link_id
+ * fields of each frame's &struct ieee80211_rx_status, so the link
+ * station isn't looked up by the transmitter address.
+ *
+ * The same context and locking requirements as for ieee80211_rx_list()
+ * apply.
+ *
+ * @hw: the hardware the frames came in on
+ * @sta: the station the frames were received from, or %NULL
+ * @skbs: the buffers to receive, owned by mac80211 after this call
+ * @n_skbs: number of entries in @skbs
+ * @list: the destination list
+ */
+void ieee80211_rx_list_batch(struct ieee80211_hw *hw,
+			     struct ieee80211_sta *sta,
+			     struct sk_buff **skbs, unsigned int n_skbs,
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+			     struct list_head *list);
+#else
+			     struct sk_buff_head *list);
+#endif
+
 /**
  * ieee80211_rx_napi - receive frame from NAPI context
  *
@@ -5055,6 +5116,25 @@ void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *sta,
 void ieee80211_rx_napi(struct ieee80211_hw *hw, struct ieee80211_sta *sta,
 		       struct sk_buff *skb, struct napi_struct *napi);
 
+/**
+ * ieee80211_rx_napi_batch - receive a batch of frames from NAPI context
+ *
+ * Like ieee80211_rx_napi(), but for several frames at once, see
+ * ieee80211_rx_list_batch().
+ *
+ * This function must be called with BHs disabled.
+ *
+ * @hw: the hardware the frames came in on
+ * @sta: the station the frames were received from, or %NULL
+ * @skbs: the buffers to receive, owned by mac80211 after this call
+ * @n_skbs: number of entries in @skbs
+ * @napi: the NAPI context
+ */
+void ieee80211_rx_napi_batch(struct ieee80211_hw *hw,
+			     struct ieee80211_sta *sta,
+			     struct sk_buff **skbs, unsigned int n_skbs,
+			     struct napi_struct *napi);
+
 /**
  * ieee80211_rx - receive frame
  *
@@ -5314,6 +5394,36 @@ void ieee80211_tx_status_skb(struct ieee80211_hw *hw,
 void ieee80211_tx_status_ext(struct ieee80211_hw *hw,
 			     struct ieee80211_tx_status *status);
 
+/**
+ * ieee80211_tx_status_batch - transmit status callback for a batch of frames
+ *
+ * This function can be used instead of calling ieee80211_tx_status_ext()
+ * for every frame when a single status (e.g. a BlockAck) covers several
+ * frames sent to the same station on the same TID. Rate control and
+ * airtime accounting are updated once for the batch, the station
+ * statistics and the per-frame handling (ack skbs, monitor interfaces,
+ * filtered frames) still use the &struct ieee80211_tx_info of each frame.
+ *
+ * @status->info carries the rates and ack state shared by the batch,
+ * usually it's the tx info of the frame the status was reported for.
+ * Rate control algorithms that don't implement the extended status
+ * callback only look at the skb, they get the frame in @skbs whose tx
+ * info is @status->info, or the first frame if there is none.
+ *
+ * The same restrictions as for ieee80211_tx_status_ext() apply.
+ *
+ * @hw: the hardware the frames were transmitted by
+ * @status: tx status shared by all frames, must have a station and tx info
+ *	but no skb set. The free_list, if any, is used for all frames.
+ * @tid: the TID the frames were transmitted on
+ * @tx_airtime: airtime used by the batch (in usec) to register for the
+ *	station, or 0 if the driver reports it separately
+ * @skbs: the frames that were transmitted, owned by mac80211 after this call
+ */
+void ieee80211_tx_status_batch(struct ieee80211_hw *hw,
+			       struct ieee80211_tx_status *status, u8 tid,
+			       u32 tx_airtime, struct sk_buff_head *skbs);
+
 /**
  * ieee80211_tx_status_noskb - transmit status callback without skb
  *
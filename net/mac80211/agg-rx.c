@@ -48,10 +48,11 @@ static void ieee80211_free_tid_rx(struct rcu_head *h)
 		container_of(h, struct tid_ampdu_rx, rcu_head);
 	int i;
 
-	for (i = 0; i < tid_rx->buf_size; i++)
+	for (i = 0; i <= tid_rx->reorder_buf_mask; i++)
 		__skb_queue_purge(&tid_rx->reorder_buf[i]);
 	kfree(tid_rx->reorder_buf);
 	kfree(tid_rx->reorder_time);
+	bitmap_free(tid_rx->reorder_buf_used);
 	kfree(tid_rx);
 }
 
@@ -268,7 +269,7 @@ static void ___ieee80211_start_rx_ba_session(struct sta_info *sta,
 	};
 	int i, ret = -EOPNOTSUPP;
 	u16 status = WLAN_STATUS_REQUEST_DECLINED;
-	u16 max_buf_size;
+	u16 max_buf_size, ring_size;
 
 	lockdep_assert_wiphy(sta->local->hw.wiphy);
 
@@ -384,19 +385,27 @@ static void ___ieee80211_start_rx_ba_session(struct sta_info *sta,
 	timer_setup(&tid_agg_rx->reorder_timer,
 		    sta_rx_agg_reorder_timer_expired, 0);
 
-	/* prepare reordering buffer */
+	/*
+	 * prepare reordering buffer, with a power of two number of slots
+	 * so that the slot index stays continuous when the SN wraps
+	 */
+	ring_size = roundup_pow_of_two(buf_size);
+	tid_agg_rx->reorder_buf_mask = ring_size - 1;
 	tid_agg_rx->reorder_buf =
-		kcalloc(buf_size, sizeof(struct sk_buff_head), GFP_KERNEL);
+		kcalloc(ring_size, sizeof(struct sk_buff_head), GFP_KERNEL);
 	tid_agg_rx->reorder_time =
-		kcalloc(buf_size, sizeof(unsigned long), GFP_KERNEL);
-	if (!tid_agg_rx->reorder_buf || !tid_agg_rx->reorder_time) {
+		kcalloc(ring_size, sizeof(unsigned long), GFP_KERNEL);
+	tid_agg_rx->reorder_buf_used = bitmap_zalloc(ring_size, GFP_KERNEL);
+	if (!tid_agg_rx->reorder_buf || !tid_agg_rx->reorder_time ||
+	    !tid_agg_rx->reorder_buf_used) {
 		kfree(tid_agg_rx->reorder_buf);
 		kfree(tid_agg_rx->reorder_time);
+		bitmap_free(tid_agg_rx->reorder_buf_used);
 		kfree(tid_agg_rx);
 		goto end;
 	}
 
-	for (i = 0; i < buf_size; i++)
+	for (i = 0; i < ring_size; i++)
 		__skb_queue_head_init(&tid_agg_rx->reorder_buf[i]);
 
 	ret = drv_ampdu_action(local, sta->sdata, &params);
@@ -405,6 +414,7 @@ static void ___ieee80211_start_rx_ba_session(struct sta_info *sta,
 	if (ret) {
 		kfree(tid_agg_rx->reorder_buf);
 		kfree(tid_agg_rx->reorder_time);
+		bitmap_free(tid_agg_rx->reorder_buf_used);
 		kfree(tid_agg_rx);
 		goto end;
 	}
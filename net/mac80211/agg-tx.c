@@ -253,11 +253,11 @@ ieee80211_agg_splice_packets(struct ieee80211_sub_if_data *sdata,
 		return;
 
 	if (!skb_queue_empty(&tid_tx->pending)) {
-		spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
+		spin_lock_irqsave(&local->pending[queue].lock, flags);
 		/* copy over remaining packets */
 		skb_queue_splice_tail_init(&tid_tx->pending,
 					   &local->pending[queue]);
-		spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
+		spin_unlock_irqrestore(&local->pending[queue].lock, flags);
 	}
 }
 
@@ -59,6 +59,7 @@
 #define BW_40			1
 #define BW_80			2
 #define BW_160			3
+#define BW_320			4
 
 /*
  * Define group sort order: HT40 -> SGI -> #streams
@@ -68,6 +69,9 @@
 #define IEEE80211_VHT_STREAM_GROUPS	8 /* BW(=4) * SGI(=2) */
 
 #define IEEE80211_HE_MAX_STREAMS	8
+#define IEEE80211_EHT_MAX_STREAMS	8
+
+#define IEEE80211_HE_GROUPS_NB	(IEEE80211_HE_MAX_STREAMS * 3 * 4)
 
 #define IEEE80211_HT_GROUPS_NB	(IEEE80211_MAX_STREAMS *	\
 				 IEEE80211_HT_STREAM_GROUPS)
@@ -77,8 +81,9 @@
 #define IEEE80211_HT_GROUP_0	0
 #define IEEE80211_VHT_GROUP_0	(IEEE80211_HT_GROUP_0 + IEEE80211_HT_GROUPS_NB)
 #define IEEE80211_HE_GROUP_0	(IEEE80211_VHT_GROUP_0 + IEEE80211_VHT_GROUPS_NB)
+#define IEEE80211_EHT_GROUP_0	(IEEE80211_HE_GROUP_0 + IEEE80211_HE_GROUPS_NB)
 
-#define MCS_GROUP_RATES		12
+#define MCS_GROUP_RATES		14
 
 #define HT_GROUP_IDX(_streams, _sgi, _ht40)	\
 	IEEE80211_HT_GROUP_0 +			\
@@ -165,44 +170,62 @@
 	 IEEE80211_HE_MAX_STREAMS * (_gi) +				\
 	 (_streams) - 1)
 
-#define __HE_GROUP(_streams, _gi, _bw, _s)				\
-	[HE_GROUP_IDX(_streams, _gi, _bw)] = {			\
+#define __HE_GROUP(_idx, _streams, _gi, _bw, _s)			\
+	[_idx] = {							\
 	.shift = _s,							\
 	.duration = {							\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,   979,  489,  230,  115)),	\
+			      IEEE80211_HE_DBPS(_bw, 0)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  1958,  979,  475,  230)),	\
+			      IEEE80211_HE_DBPS(_bw, 1)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  2937, 1468,  705,  345)),	\
+			      IEEE80211_HE_DBPS(_bw, 2)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  3916, 1958,  936,  475)),	\
+			      IEEE80211_HE_DBPS(_bw, 3)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  5875, 2937, 1411,  705)),	\
+			      IEEE80211_HE_DBPS(_bw, 4)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  7833, 3916, 1872,  936)),	\
+			      IEEE80211_HE_DBPS(_bw, 5)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  8827, 4406, 2102, 1051)),	\
+			      IEEE80211_HE_DBPS(_bw, 6)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw,  9806, 4896, 2347, 1166)),	\
+			      IEEE80211_HE_DBPS(_bw, 7)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw, 11764, 5875, 2808, 1411)),	\
+			      IEEE80211_HE_DBPS(_bw, 8)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw, 13060, 6523, 3124, 1555)),	\
+			      IEEE80211_HE_DBPS(_bw, 9)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw, 14702, 7344, 3513, 1756)),	\
+			      IEEE80211_HE_DBPS(_bw, 10)),		\
 		HE_DURATION_S(_s, _streams, _gi,			\
-			      BW2VBPS(_bw, 16329, 8164, 3902, 1944))	\
-        }								\
+			      IEEE80211_HE_DBPS(_bw, 11)),		\
+		HE_DURATION_S(_s, _streams, _gi,			\
+			      IEEE80211_HE_DBPS(_bw, 12)),		\
+		HE_DURATION_S(_s, _streams, _gi,			\
+			      IEEE80211_HE_DBPS(_bw, 13))		\
+	}								\
 }
 
 #define HE_GROUP_SHIFT(_streams, _gi, _bw)				\
 	GROUP_SHIFT(HE_DURATION(_streams, _gi,			\
-				BW2VBPS(_bw,   979,  489,  230,  115)))
+				IEEE80211_HE_DBPS(_bw, 0)))
 
 #define HE_GROUP(_streams, _gi, _bw)					\
-	__HE_GROUP(_streams, _gi, _bw,				\
+	__HE_GROUP(HE_GROUP_IDX(_streams, _gi, _bw),			\
+		   _streams, _gi, _bw,					\
+		   HE_GROUP_SHIFT(_streams, _gi, _bw))
+
+/* EHT uses the HE symbol timing, with 320 MHz on top */
+#define EHT_GROUP_IDX(_streams, _gi, _bw)				\
+	(IEEE80211_EHT_GROUP_0 +					\
+	 IEEE80211_EHT_MAX_STREAMS * 3 * (_bw) +			\
+	 IEEE80211_EHT_MAX_STREAMS * (_gi) +				\
+	 (_streams) - 1)
+
+#define EHT_GROUP(_streams, _gi, _bw)					\
+	__HE_GROUP(EHT_GROUP_IDX(_streams, _gi, _bw),			\
+		   _streams, _gi, _bw,					\
 		   HE_GROUP_SHIFT(_streams, _gi, _bw))
+
 struct mcs_group {
 	u8 shift;
 	u16 duration[MCS_GROUP_RATES];
@@ -376,6 +399,141 @@ static const struct mcs_group airtime_mcs_groups[] = {
 	HE_GROUP(6, HE_GI_32, BW_160),
 	HE_GROUP(7, HE_GI_32, BW_160),
 	HE_GROUP(8, HE_GI_32, BW_160),
+
+	EHT_GROUP(1, HE_GI_08, BW_20),
+	EHT_GROUP(2, HE_GI_08, BW_20),
+	EHT_GROUP(3, HE_GI_08, BW_20),
+	EHT_GROUP(4, HE_GI_08, BW_20),
+	EHT_GROUP(5, HE_GI_08, BW_20),
+	EHT_GROUP(6, HE_GI_08, BW_20),
+	EHT_GROUP(7, HE_GI_08, BW_20),
+	EHT_GROUP(8, HE_GI_08, BW_20),
+
+	EHT_GROUP(1, HE_GI_16, BW_20),
+	EHT_GROUP(2, HE_GI_16, BW_20),
+	EHT_GROUP(3, HE_GI_16, BW_20),
+	EHT_GROUP(4, HE_GI_16, BW_20),
+	EHT_GROUP(5, HE_GI_16, BW_20),
+	EHT_GROUP(6, HE_GI_16, BW_20),
+	EHT_GROUP(7, HE_GI_16, BW_20),
+	EHT_GROUP(8, HE_GI_16, BW_20),
+
+	EHT_GROUP(1, HE_GI_32, BW_20),
+	EHT_GROUP(2, HE_GI_32, BW_20),
+	EHT_GROUP(3, HE_GI_32, BW_20),
+	EHT_GROUP(4, HE_GI_32, BW_20),
+	EHT_GROUP(5, HE_GI_32, BW_20),
+	EHT_GROUP(6, HE_GI_32, BW_20),
+	EHT_GROUP(7, HE_GI_32, BW_20),
+	EHT_GROUP(8, HE_GI_32, BW_20),
+
+	EHT_GROUP(1, HE_GI_08, BW_40),
+	EHT_GROUP(2, HE_GI_08, BW_40),
+	EHT_GROUP(3, HE_GI_08, BW_40),
+	EHT_GROUP(4, HE_GI_08, BW_40),
+	EHT_GROUP(5, HE_GI_08, BW_40),
+	EHT_GROUP(6, HE_GI_08, BW_40),
+	EHT_GROUP(7, HE_GI_08, BW_40),
+	EHT_GROUP(8, HE_GI_08, BW_40),
+
+	EHT_GROUP(1, HE_GI_16, BW_40),
+	EHT_GROUP(2, HE_GI_16, BW_40),
+	EHT_GROUP(3, HE_GI_16, BW_40),
+	EHT_GROUP(4, HE_GI_16, BW_40),
+	EHT_GROUP(5, HE_GI_16, BW_40),
+	EHT_GROUP(6, HE_GI_16, BW_40),
+	EHT_GROUP(7, HE_GI_16, BW_40),
+	EHT_GROUP(8, HE_GI_16, BW_40),
+
+	EHT_GROUP(1, HE_GI_32, BW_40),
+	EHT_GROUP(2, HE_GI_32, BW_40),
+	EHT_GROUP(3, HE_GI_32, BW_40),
+	EHT_GROUP(4, HE_GI_32, BW_40),
+	EHT_GROUP(5, HE_GI_32, BW_40),
+	EHT_GROUP(6, HE_GI_32, BW_40),
+	EHT_GROUP(7, HE_GI_32, BW_40),
+	EHT_GROUP(8, HE_GI_32, BW_40),
+
+	EHT_GROUP(1, HE_GI_08, BW_80),
+	EHT_GROUP(2, HE_GI_08, BW_80),
+	EHT_GROUP(3, HE_GI_08, BW_80),
+	EHT_GROUP(4, HE_GI_08, BW_80),
+	EHT_GROUP(5, HE_GI_08, BW_80),
+	EHT_GROUP(6, HE_GI_08, BW_80),
+	EHT_GROUP(7, HE_GI_08, BW_80),
+	EHT_GROUP(8, HE_GI_08, BW_80),
+
+	EHT_GROUP(1, HE_GI_16, BW_80),
+	EHT_GROUP(2, HE_GI_16, BW_80),
+	EHT_GROUP(3, HE_GI_16, BW_80),
+	EHT_GROUP(4, HE_GI_16, BW_80),
+	EHT_GROUP(5, HE_GI_16, BW_80),
+	EHT_GROUP(6, HE_GI_16, BW_80),
+	EHT_GROUP(7, HE_GI_16, BW_80),
+	EHT_GROUP(8, HE_GI_16, BW_80),
+
+	EHT_GROUP(1, HE_GI_32, BW_80),
+	EHT_GROUP(2, HE_GI_32, BW_80),
+	EHT_GROUP(3, HE_GI_32, BW_80),
+	EHT_GROUP(4, HE_GI_32, BW_80),
+	EHT_GROUP(5, HE_GI_32, BW_80),
+	EHT_GROUP(6, HE_GI_32, BW_80),
+	EHT_GROUP(7, HE_GI_32, BW_80),
+	EHT_GROUP(8, HE_GI_32, BW_80),
+
+	EHT_GROUP(1, HE_GI_08, BW_160),
+	EHT_GROUP(2, HE_GI_08, BW_160),
+	EHT_GROUP(3, HE_GI_08, BW_160),
+	EHT_GROUP(4, HE_GI_08, BW_160),
+	EHT_GROUP(5, HE_GI_08, BW_160),
+	EHT_GROUP(6, HE_GI_08, BW_160),
+	EHT_GROUP(7, HE_GI_08, BW_160),
+	EHT_GROUP(8, HE_GI_08, BW_160),
+
+	EHT_GROUP(1, HE_GI_16, BW_160),
+	EHT_GROUP(2, HE_GI_16, BW_160),
+	EHT_GROUP(3, HE_GI_16, BW_160),
+	EHT_GROUP(4, HE_GI_16, BW_160),
+	EHT_GROUP(5, HE_GI_16, BW_160),
+	EHT_GROUP(6, HE_GI_16, BW_160),
+	EHT_GROUP(7, HE_GI_16, BW_160),
+	EHT_GROUP(8, HE_GI_16, BW_160),
+
+	EHT_GROUP(1, HE_GI_32, BW_160),
+	EHT_GROUP(2, HE_GI_32, BW_160),
+	EHT_GROUP(3, HE_GI_32, BW_160),
+	EHT_GROUP(4, HE_GI_32, BW_160),
+	EHT_GROUP(5, HE_GI_32, BW_160),
+	EHT_GROUP(6, HE_GI_32, BW_160),
+	EHT_GROUP(7, HE_GI_32, BW_160),
+	EHT_GROUP(8, HE_GI_32, BW_160),
+
+	EHT_GROUP(1, HE_GI_08, BW_320),
+	EHT_GROUP(2, HE_GI_08, BW_320),
+	EHT_GROUP(3, HE_GI_08, BW_320),
+	EHT_GROUP(4, HE_GI_08, BW_320),
+	EHT_GROUP(5, HE_GI_08, BW_320),
+	EHT_GROUP(6, HE_GI_08, BW_320),
+	EHT_GROUP(7, HE_GI_08, BW_320),
+	EHT_GROUP(8, HE_GI_08, BW_320),
+
+	EHT_GROUP(1, HE_GI_16, BW_320),
+	EHT_GROUP(2, HE_GI_16, BW_320),
+	EHT_GROUP(3, HE_GI_16, BW_320),
+	EHT_GROUP(4, HE_GI_16, BW_320),
+	EHT_GROUP(5, HE_GI_16, BW_320),
+	EHT_GROUP(6, HE_GI_16, BW_320),
+	EHT_GROUP(7, HE_GI_16, BW_320),
+	EHT_GROUP(8, HE_GI_16, BW_320),
+
+	EHT_GROUP(1, HE_GI_32, BW_320),
+	EHT_GROUP(2, HE_GI_32, BW_320),
+	EHT_GROUP(3, HE_GI_32, BW_320),
+	EHT_GROUP(4, HE_GI_32, BW_320),
+	EHT_GROUP(5, HE_GI_32, BW_320),
+	EHT_GROUP(6, HE_GI_32, BW_320),
+	EHT_GROUP(7, HE_GI_32, BW_320),
+	EHT_GROUP(8, HE_GI_32, BW_320),
 };
 
 static u32
@@ -422,6 +580,9 @@ static u32 ieee80211_get_rate_duration(struct ieee80211_hw *hw,
 	case RATE_INFO_BW_160:
 		bw = BW_160;
 		break;
+	case RATE_INFO_BW_320:
+		bw = BW_320;
+		break;
 	default:
 		WARN_ON_ONCE(1);
 		return 0;
@@ -443,13 +604,23 @@ static u32 ieee80211_get_rate_duration(struct ieee80211_hw *hw,
 		idx = status->rate_idx;
 		group = HE_GROUP_IDX(streams, status->he_gi, bw);
 		break;
+	case RX_ENC_EHT:
+		streams = status->nss;
+		idx = status->rate_idx;
+		group = EHT_GROUP_IDX(streams, status->eht.gi, bw);
+		break;
 	default:
 		WARN_ON_ONCE(1);
 		return 0;
 	}
 
-	if (WARN_ON_ONCE((status->encoding != RX_ENC_HE && streams > 4) ||
-			 (status->encoding == RX_ENC_HE && streams > 8)))
+	/* only EHT has 320 MHz groups */
+	if (bw == BW_320 && status->encoding != RX_ENC_EHT)
+		return 0;
+
+	if (WARN_ON_ONCE((status->encoding != RX_ENC_HE &&
+			  status->encoding != RX_ENC_EHT && streams > 4) ||
+			 streams > 8))
 		return 0;
 
 	if (idx >= MCS_GROUP_RATES)
@@ -517,7 +688,9 @@ static bool ieee80211_fill_rate_info(struct ieee80211_hw *hw,
 	stat->nss = ri->nss;
 	stat->rate_idx = ri->mcs;
 
-	if (ri->flags & RATE_INFO_FLAGS_HE_MCS)
+	if (ri->flags & RATE_INFO_FLAGS_EHT_MCS)
+		stat->encoding = RX_ENC_EHT;
+	else if (ri->flags & RATE_INFO_FLAGS_HE_MCS)
 		stat->encoding = RX_ENC_HE;
 	else if (ri->flags & RATE_INFO_FLAGS_VHT_MCS)
 		stat->encoding = RX_ENC_VHT;
@@ -529,7 +702,10 @@ static bool ieee80211_fill_rate_info(struct ieee80211_hw *hw,
 	if (ri->flags & RATE_INFO_FLAGS_SHORT_GI)
 		stat->enc_flags |= RX_ENC_FLAG_SHORT_GI;
 
-	stat->he_gi = ri->he_gi;
+	if (stat->encoding == RX_ENC_EHT)
+		stat->eht.gi = ri->eht_gi;
+	else
+		stat->he_gi = ri->he_gi;
 
 	if (stat->encoding != RX_ENC_LEGACY)
 		return true;
@@ -676,7 +852,8 @@ u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 			agg_shift = 3;
 		else if (duration > 70 * 1024) /* <= VHT20 MCS5 2S */
 			agg_shift = 4;
-		else if (stat.encoding != RX_ENC_HE ||
+		else if ((stat.encoding != RX_ENC_HE &&
+			  stat.encoding != RX_ENC_EHT) ||
 			 duration > 20 * 1024) /* <= HE40 MCS6 2S */
 			agg_shift = 5;
 		else
@@ -1088,6 +1088,74 @@ ieee80211_copy_rnr_beacon(u8 *pos, struct cfg80211_rnr_elems *dst,
 	return offset;
 }
 
+static int
+ieee80211_mbssid_data_size(struct cfg80211_mbssid_elems *mbssid,
+			   struct cfg80211_rnr_elems *rnr)
+{
+	int i, size;
+
+	size = __alignof__(struct beacon_mbssid_data) - 1 +
+	       (mbssid->cnt + 1) * sizeof(struct beacon_mbssid_data);
+
+	for (i = 0; i <= mbssid->cnt; i++)
+		size += ieee80211_get_mbssid_beacon_len(mbssid, rnr, i);
+
+	return size;
+}
+
+/*
+ * Put the MBSSID (and for EMA, RNR) elements the way beacon @i needs
+ * them: for EMA index i the i-th MBSSID element, followed by the i-th
+ * RNR element and the RNR elements common to all profiles, or all the
+ * MBSSID elements for the non-EMA index (i == mbssid->cnt).
+ */
+static u8 *ieee80211_put_mbssid_data(u8 *pos,
+				     struct cfg80211_mbssid_elems *mbssid,
+				     struct cfg80211_rnr_elems *rnr, int i)
+{
+	int j;
+
+	if (i == mbssid->cnt) {
+		for (j = 0; j < mbssid->cnt; j++) {
+			memcpy(pos, mbssid->elem[j].data, mbssid->elem[j].len);
+			pos += mbssid->elem[j].len;
+		}
+		return pos;
+	}
+
+	memcpy(pos, mbssid->elem[i].data, mbssid->elem[i].len);
+	pos += mbssid->elem[i].len;
+
+	if (!rnr || !rnr->cnt)
+		return pos;
+
+	memcpy(pos, rnr->elem[i].data, rnr->elem[i].len);
+	pos += rnr->elem[i].len;
+
+	for (j = mbssid->cnt; j < rnr->cnt; j++) {
+		memcpy(pos, rnr->elem[j].data, rnr->elem[j].len);
+		pos += rnr->elem[j].len;
+	}
+	return pos;
+}
+
+/* prebuild them for each beacon so beacon generation is a single copy */
+static void ieee80211_prebuild_mbssid_data(struct beacon_data *new, u8 *pos)
+{
+	struct cfg80211_mbssid_elems *mbssid = new->mbssid_ies;
+	int i;
+
+	new->mbssid_data = PTR_ALIGN((void *)pos,
+				     __alignof__(struct beacon_mbssid_data));
+	pos = (u8 *)(new->mbssid_data + mbssid->cnt + 1);
+
+	for (i = 0; i <= mbssid->cnt; i++) {
+		new->mbssid_data[i].data = pos;
+		pos = ieee80211_put_mbssid_data(pos, mbssid, new->rnr_ies, i);
+		new->mbssid_data[i].len = pos - new->mbssid_data[i].data;
+	}
+}
+
 static int
 ieee80211_assign_beacon(struct ieee80211_sub_if_data *sdata,
 			struct ieee80211_link_data *link,
@@ -1146,6 +1214,9 @@ ieee80211_assign_beacon(struct ieee80211_sub_if_data *sdata,
 							mbssid->cnt);
 	}
 
+	if (mbssid)
+		size += ieee80211_mbssid_data_size(mbssid, rnr);
+
 	new = kzalloc(size, GFP_KERNEL);
 	if (!new)
 		return -ENOMEM;
@@ -1153,8 +1224,8 @@ ieee80211_assign_beacon(struct ieee80211_sub_if_data *sdata,
 	/* start filling the new info now */
 
 	/*
-	 * pointers go into the block we allocated,
-	 * memory is | beacon_data | head | tail | mbssid_ies | rnr_ies
+	 * pointers go into the block we allocated, memory is
+	 * | beacon_data | head | tail | mbssid_ies | rnr_ies | mbssid_data
 	 */
 	new->head = ((u8 *) new) + sizeof(*new);
 	new->tail = new->head + new_head_len;
@@ -1171,8 +1242,10 @@ ieee80211_assign_beacon(struct ieee80211_sub_if_data *sdata,
 		if (rnr) {
 			new->rnr_ies = (void *)pos;
 			pos += struct_size(new->rnr_ies, elem, rnr->cnt);
-			ieee80211_copy_rnr_beacon(pos, new->rnr_ies, rnr);
+			pos += ieee80211_copy_rnr_beacon(pos, new->rnr_ies,
+							 rnr);
 		}
+		ieee80211_prebuild_mbssid_data(new, pos);
 		/* update bssid_indicator */
 		link_conf->bssid_indicator =
 			ilog2(__roundup_pow_of_two(mbssid->cnt + 1));
@@ -1639,9 +1712,12 @@ static int ieee80211_stop_ap(struct wiphy *wiphy, struct net_device *dev,
 	drv_stop_ap(sdata->local, sdata, link_conf);
 
 	/* free all potentially still buffered bcast frames */
-	local->total_ps_buffered -= skb_queue_len(&sdata->u.ap.ps.bc_buf);
+	atomic_sub(skb_queue_len(&sdata->u.ap.ps.bc_buf),
+		   &local->total_ps_buffered);
 	ieee80211_purge_tx_queue(&local->hw, &sdata->u.ap.ps.bc_buf);
 
+	ieee80211_mcast_snoop_flush(&sdata->u.ap);
+
 	ieee80211_link_copy_chanctx_to_vlans(link, true);
 	ieee80211_link_release_channel(link);
 
@@ -614,6 +614,15 @@ static ssize_t ieee80211_if_fmt_num_buffered_multicast(
 }
 IEEE80211_IF_FILE_R(num_buffered_multicast);
 
+static ssize_t ieee80211_if_fmt_beacon_gen_ns(
+	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
+{
+	return scnprintf(buf, buflen, "last: %u\nmax: %u\n",
+			 sdata->u.ap.beacon_gen_ns,
+			 sdata->u.ap.beacon_gen_max_ns);
+}
+IEEE80211_IF_FILE_R(beacon_gen_ns);
+
 static ssize_t ieee80211_if_fmt_aqm(
 	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
 {
@@ -653,6 +662,32 @@ IEEE80211_IF_FILE_R(aqm);
 
 IEEE80211_IF_FILE(multicast_to_unicast, u.ap.multicast_to_unicast, HEX);
 
+static ssize_t ieee80211_if_fmt_multicast_snooping(
+	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
+{
+	return scnprintf(buf, buflen, "%d (%u groups)\n",
+			 sdata->u.ap.multicast_snooping,
+			 sdata->u.ap.mcast_num_groups);
+}
+
+static ssize_t ieee80211_if_parse_multicast_snooping(
+	struct ieee80211_sub_if_data *sdata, const char *buf, int buflen)
+{
+	bool val;
+	int ret;
+
+	ret = kstrtobool(buf, &val);
+	if (ret)
+		return ret;
+
+	sdata->u.ap.multicast_snooping = val;
+	if (!val)
+		ieee80211_mcast_snoop_flush(&sdata->u.ap);
+
+	return buflen;
+}
+IEEE80211_IF_FILE_RW(multicast_snooping);
+
 /* IBSS attributes */
 static ssize_t ieee80211_if_fmt_tsf(
 	const struct ieee80211_sub_if_data *sdata, char *buf, int buflen)
@@ -851,8 +886,10 @@ static void add_ap_files(struct ieee80211_sub_if_data *sdata)
 	DEBUGFS_ADD(num_sta_ps);
 	DEBUGFS_ADD(dtim_count);
 	DEBUGFS_ADD(num_buffered_multicast);
+	DEBUGFS_ADD(beacon_gen_ns);
 	DEBUGFS_ADD_MODE(tkip_mic_test, 0200);
 	DEBUGFS_ADD_MODE(multicast_to_unicast, 0600);
+	DEBUGFS_ADD_MODE(multicast_snooping, 0600);
 }
 
 static void add_vlan_files(struct ieee80211_sub_if_data *sdata)
@@ -1268,6 +1268,12 @@ void ieee80211_sta_debugfs_add(struct sta_info *sta)
 	DEBUGFS_ADD(agg_status);
 	/* FIXME: Kept here as the statistics are only done on the deflink */
 	DEBUGFS_ADD_COUNTER(tx_filtered, deflink.status_stats.filtered);
+	DEBUGFS_ADD_COUNTER(tx_mcast_to_ucast_dropped,
+			    deflink.tx_stats.mcast_to_ucast_dropped);
+	DEBUGFS_ADD_COUNTER(frag_evicted, frags.stats.evicted);
+	DEBUGFS_ADD_COUNTER(frag_expired, frags.stats.expired);
+	DEBUGFS_ADD_COUNTER(frag_unmatched, frags.stats.unmatched);
+	DEBUGFS_ADD_COUNTER(frag_oom, frags.stats.oom);
 
 	DEBUGFS_ADD(aqm);
 	DEBUGFS_ADD(airtime);
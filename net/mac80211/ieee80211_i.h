@@ -25,6 +25,7 @@
 #include <linux/leds.h>
 #include <linux/idr.h>
 #include <linux/rhashtable.h>
+#include <linux/hashtable.h>
 #include <linux/rbtree.h>
 #include <net/ieee80211_radiotap.h>
 #include <net/cfg80211.h>
@@ -267,6 +268,11 @@ struct ieee80211_color_change_settings {
 	u8 count;
 };
 
+struct beacon_mbssid_data {
+	const u8 *data;
+	int len;
+};
+
 struct beacon_data {
 	u8 *head, *tail;
 	int head_len, tail_len;
@@ -275,6 +281,10 @@ struct beacon_data {
 	u8 cntdwn_current_counter;
 	struct cfg80211_mbssid_elems *mbssid_ies;
 	struct cfg80211_rnr_elems *rnr_ies;
+	/* MBSSID and RNR elements exactly as put into the beacon for each
+	 * EMA index, the last entry has all of them; prebuilt when the
+	 * beacon is set so beacon generation only needs to copy them */
+	struct beacon_mbssid_data *mbssid_data;
 	struct rcu_head rcu_head;
 };
 
@@ -303,12 +313,35 @@ struct ps_data {
 	 * NB: don't touch this bitmap, use sta_info_{set,clear}_tim_bit */
 	u8 tim[sizeof(unsigned long) * BITS_TO_LONGS(IEEE80211_MAX_AID + 1)]
 			__aligned(__alignof__(unsigned long));
+	/* number of bits set in @tim and its first/last non-zero byte,
+	 * kept up to date along with it so beacons needn't scan it */
+	u16 tim_bits;
+	u8 tim_first, tim_last;
 	struct sk_buff_head bc_buf;
 	atomic_t num_sta_ps; /* number of stations in PS mode */
 	int dtim_count;
 	bool dtim_bc_mc;
 };
 
+/**
+ * struct ieee80211_mcast_group - multicast group joined by stations
+ *
+ * @node: entry in the AP's group hash table
+ * @rcu_head: RCU head to free the entry
+ * @addr: group (Ethernet) address
+ * @last_report: time of the last membership report for the group
+ * @members: AIDs of the stations that joined the group
+ */
+struct ieee80211_mcast_group {
+	struct hlist_node node;
+	struct rcu_head rcu_head;
+	u8 addr[ETH_ALEN];
+	unsigned long last_report;
+	unsigned long members[BITS_TO_LONGS(IEEE80211_MAX_AID + 1)];
+};
+
+#define IEEE80211_MCAST_HASH_BITS	5
+
 struct ieee80211_if_ap {
 	struct list_head vlans; /* write-protected with RTNL and local->mtx */
 
@@ -317,6 +350,15 @@ struct ieee80211_if_ap {
 
 	bool multicast_to_unicast;
 	bool active;
+
+	/* IGMP/MLD snooping for multicast_to_unicast, see mcast.c */
+	bool multicast_snooping;
+	spinlock_t mcast_lock;
+	unsigned int mcast_num_groups;
+	DECLARE_HASHTABLE(mcast_groups, IEEE80211_MCAST_HASH_BITS);
+
+	/* time taken to build the last/slowest beacon, for debugfs */
+	u32 beacon_gen_ns, beacon_gen_max_ns;
 };
 
 struct ieee80211_if_vlan {
@@ -1237,7 +1279,6 @@ enum queue_stop_reason {
 	IEEE80211_QUEUE_STOP_REASON_CSA,
 	IEEE80211_QUEUE_STOP_REASON_AGGREGATION,
 	IEEE80211_QUEUE_STOP_REASON_SUSPEND,
-	IEEE80211_QUEUE_STOP_REASON_SKB_ADD,
 	IEEE80211_QUEUE_STOP_REASON_OFFCHANNEL,
 	IEEE80211_QUEUE_STOP_REASON_FLUSH,
 	IEEE80211_QUEUE_STOP_REASON_TDLS_TEARDOWN,
@@ -1350,6 +1391,11 @@ struct ieee80211_local {
 	 */
 	struct workqueue_struct *workqueue;
 
+	/*
+	 * Stop reasons and their refcounts are changed under
+	 * queue_stop_reason_lock. The TX path reads queue_stop_reasons
+	 * without it, so it's only modified with atomic bitops.
+	 */
 	unsigned long queue_stop_reasons[IEEE80211_MAX_QUEUES];
 	int q_stop_reasons[IEEE80211_MAX_QUEUES][IEEE80211_QUEUE_STOP_REASONS];
 	/* also used to protect ampdu_ac_queue and amdpu_ac_stop_refcnt */
@@ -1451,6 +1497,25 @@ struct ieee80211_local {
 	struct timer_list sta_cleanup;
 	int sta_generation;
 
+	/*
+	 * Stations with PS-buffered or filtered frames, hashed by the time
+	 * their oldest frame expires, see sta_info_ps_buffered(). The
+	 * sta_cleanup timer only visits the slots that have come due.
+	 */
+	spinlock_t ps_wheel_lock;
+	struct list_head ps_wheel[STA_PS_WHEEL_SLOTS];
+	unsigned long ps_wheel_time;
+	unsigned int ps_wheel_count;
+
+	/* per-CPU last-hit RX station lookup, see sta_info_rx_cache_get() */
+	struct sta_info_rx_cache __percpu *sta_rx_cache;
+	unsigned int sta_rx_cache_gen;
+
+	/*
+	 * Frames waiting for a stopped queue. Each queue is protected by
+	 * its own lock, not queue_stop_reason_lock; see
+	 * ieee80211_kick_pending() for how this pairs with waking.
+	 */
 	struct sk_buff_head pending[IEEE80211_MAX_QUEUES];
 	struct tasklet_struct tx_pending_tasklet;
 	struct tasklet_struct wake_txqs_tasklet;
@@ -1542,9 +1607,10 @@ struct ieee80211_local {
 #endif /* CPTCFG_MAC80211_DEBUG_COUNTERS */
 
 
-	int total_ps_buffered; /* total number of all buffered unicast and
-				* multicast packets for power saving stations
-				*/
+	/* total number of all buffered unicast and multicast packets for
+	 * power saving stations
+	 */
+	atomic_t total_ps_buffered;
 
 	bool pspolling;
 	/*
@@ -2380,6 +2446,7 @@ void ieee80211_add_pending_skb(struct ieee80211_local *local,
 			       struct sk_buff *skb);
 void ieee80211_add_pending_skbs(struct ieee80211_local *local,
 				struct sk_buff_head *skbs);
+void ieee80211_kick_pending(struct ieee80211_local *local, int queue);
 void ieee80211_flush_queues(struct ieee80211_local *local,
 			    struct ieee80211_sub_if_data *sdata, bool drop);
 void __ieee80211_flush_queues(struct ieee80211_local *local,
@@ -2631,6 +2698,36 @@ u32 ieee80211_calc_expected_tx_airtime(struct ieee80211_hw *hw,
 				       struct ieee80211_vif *vif,
 				       struct ieee80211_sta *pubsta,
 				       int len, bool ampdu);
+
+/*
+ * Data bits per symbol of a single HE/EHT spatial stream for each MCS, at
+ * 20/40/80/160/320 MHz (234/468/980/1960/3920 data tones). Shared by the
+ * airtime estimation and minstrel_ht so that both use the same durations.
+ */
+#define IEEE80211_HE_DBPS_MCS0		  117,   234,   490,   980,  1960
+#define IEEE80211_HE_DBPS_MCS1		  234,   468,   980,  1960,  3920
+#define IEEE80211_HE_DBPS_MCS2		  351,   702,  1470,  2940,  5880
+#define IEEE80211_HE_DBPS_MCS3		  468,   936,  1960,  3920,  7840
+#define IEEE80211_HE_DBPS_MCS4		  702,  1404,  2940,  5880, 11760
+#define IEEE80211_HE_DBPS_MCS5		  936,  1872,  3920,  7840, 15680
+#define IEEE80211_HE_DBPS_MCS6		 1053,  2106,  4410,  8820, 17640
+#define IEEE80211_HE_DBPS_MCS7		 1170,  2340,  4900,  9800, 19600
+#define IEEE80211_HE_DBPS_MCS8		 1404,  2808,  5880, 11760, 23520
+#define IEEE80211_HE_DBPS_MCS9		 1560,  3120,  6533, 13066, 26133
+#define IEEE80211_HE_DBPS_MCS10		 1755,  3510,  7350, 14700, 29400
+#define IEEE80211_HE_DBPS_MCS11		 1950,  3900,  8166, 16333, 32666
+#define IEEE80211_HE_DBPS_MCS12		 2106,  4212,  8820, 17640, 35280
+#define IEEE80211_HE_DBPS_MCS13		 2340,  4680,  9800, 19600, 39200
+
+#define __IEEE80211_HE_DBPS(_bw, r20, r40, r80, r160, r320)		\
+	((_bw) == 4 ? r320 : (_bw) == 3 ? r160 : (_bw) == 2 ? r80 :	\
+	 (_bw) == 1 ? r40 : r20)
+#define _IEEE80211_HE_DBPS(_bw, _row)	__IEEE80211_HE_DBPS(_bw, _row)
+
+/* _bw is 0 (20 MHz) to 4 (320 MHz), _mcs a literal MCS index */
+#define IEEE80211_HE_DBPS(_bw, _mcs)					\
+	_IEEE80211_HE_DBPS(_bw, IEEE80211_HE_DBPS_MCS ## _mcs)
+
 #ifdef CPTCFG_MAC80211_NOINLINE
 #define debug_noinline noinline
 #else
@@ -2661,10 +2758,20 @@ void ieee80211_process_neg_ttlm_res(struct ieee80211_sub_if_data *sdata,
 int ieee80211_req_neg_ttlm(struct ieee80211_sub_if_data *sdata,
 			   struct cfg80211_ttlm_params *params);
 
+/* multicast snooping */
+void ieee80211_mcast_snoop_init(struct ieee80211_if_ap *ap);
+void ieee80211_mcast_snoop_flush(struct ieee80211_if_ap *ap);
+void ieee80211_mcast_snoop_rx(struct ieee80211_if_ap *ap, u16 aid,
+			      struct sk_buff *skb);
+void ieee80211_mcast_snoop_sta_removed(struct sta_info *sta);
+struct ieee80211_mcast_group *
+ieee80211_mcast_snoop_lookup(struct ieee80211_if_ap *ap, const u8 *addr);
+
 #if IS_ENABLED(CPTCFG_MAC80211_KUNIT_TEST)
 #define EXPORT_SYMBOL_IF_MAC80211_KUNIT(sym) EXPORT_SYMBOL_IF_KUNIT(sym)
 #define VISIBLE_IF_MAC80211_KUNIT
 ieee80211_rx_result ieee80211_drop_unencrypted_mgmt(struct ieee80211_rx_data *rx);
+ieee80211_rx_result ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx);
 #else
 #define EXPORT_SYMBOL_IF_MAC80211_KUNIT(sym)
 #define VISIBLE_IF_MAC80211_KUNIT static
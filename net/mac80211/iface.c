@@ -581,7 +581,7 @@ static void ieee80211_do_stop(struct ieee80211_sub_if_data *sdata, bool going_do
 		skb_queue_walk_safe(&ps->bc_buf, skb, tmp) {
 			if (skb->dev == sdata->dev) {
 				__skb_unlink(skb, &ps->bc_buf);
-				local->total_ps_buffered--;
+				atomic_dec(&local->total_ps_buffered);
 				ieee80211_free_txskb(&local->hw, skb);
 			}
 		}
@@ -647,8 +647,8 @@ static void ieee80211_do_stop(struct ieee80211_sub_if_data *sdata, bool going_do
 		skb_queue_purge(&sdata->status_queue);
 	}
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
 	for (i = 0; i < IEEE80211_MAX_QUEUES; i++) {
+		spin_lock_irqsave(&local->pending[i].lock, flags);
 		skb_queue_walk_safe(&local->pending[i], skb, tmp) {
 			struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 			if (info->control.vif == &sdata->vif) {
@@ -656,8 +656,8 @@ static void ieee80211_do_stop(struct ieee80211_sub_if_data *sdata, bool going_do
 				ieee80211_free_txskb(&local->hw, skb);
 			}
 		}
+		spin_unlock_irqrestore(&local->pending[i].lock, flags);
 	}
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
 
 	if (sdata->vif.type == NL80211_IFTYPE_AP_VLAN)
 		ieee80211_txq_remove_vlan(local, sdata);
@@ -1847,6 +1847,7 @@ static void ieee80211_setup_sdata(struct ieee80211_sub_if_data *sdata,
 	case NL80211_IFTYPE_AP:
 		skb_queue_head_init(&sdata->u.ap.ps.bc_buf);
 		INIT_LIST_HEAD(&sdata->u.ap.vlans);
+		ieee80211_mcast_snoop_init(&sdata->u.ap);
 		sdata->vif.bss_conf.bssid = sdata->vif.addr;
 		break;
 	case NL80211_IFTYPE_P2P_CLIENT:
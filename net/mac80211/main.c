@@ -1126,6 +1126,10 @@ int ieee80211_register_hw(struct ieee80211_hw *hw)
 			return -EINVAL;
 		}
 
+	if (WARN_ON(ieee80211_hw_check(hw, SUPPORTS_HE_RC_TABLE) &&
+		    !ieee80211_hw_check(hw, SUPPORTS_RC_TABLE)))
+		return -EINVAL;
+
 	if (WARN_ON(local->hw.wiphy->interface_modes &
 			BIT(NL80211_IFTYPE_NAN) &&
 		    (!local->ops->start_nan || !local->ops->stop_nan))) {
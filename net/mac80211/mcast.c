@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * IGMP/MLD snooping for multicast-to-unicast conversion
+ *
+ * With multicast_to_unicast enabled an AP sends each multicast frame to
+ * every associated station. When snooping is also enabled, membership
+ * reports sent by the stations are tracked per group (Ethernet) address,
+ * so frames for a group that stations have reported can be converted for
+ * the members only. Groups nobody reported, or whose reports timed out,
+ * as well as the link-local groups that are never reported, still go to
+ * all stations (RFC 4541).
+ */
+
+#include <linux/igmp.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <net/addrconf.h>
+#include <net/ip.h>
+#include <net/ipv6.h>
+#include <net/mld.h>
+#include <net/mac80211.h>
+#include <kunit/visibility.h>
+#include "ieee80211_i.h"
+#include "sta_info.h"
+
+/* IGMP/MLD default group membership interval, RFC 3376 section 8.4 */
+#define IEEE80211_MCAST_GROUP_TIMEOUT	(260 * HZ)
+#define IEEE80211_MCAST_MAX_GROUPS	256
+
+void ieee80211_mcast_snoop_init(struct ieee80211_if_ap *ap)
+{
+	spin_lock_init(&ap->mcast_lock);
+	hash_init(ap->mcast_groups);
+	ap->mcast_num_groups = 0;
+}
+
+static bool ieee80211_mcast_flooded(const u8 *addr)
+{
+	/* 224.0.0.0/24 (or an alias of it) */
+	if (addr[0] == 0x01 && addr[1] == 0x00 && addr[2] == 0x5e &&
+	    !(addr[3] & 0x7f) && !addr[4])
+		return true;
+
+	/* ff02::1 */
+	if (addr[0] == 0x33 && addr[1] == 0x33 && !addr[2] && !addr[3] &&
+	    !addr[4] && addr[5] == 0x01)
+		return true;
+
+	return false;
+}
+
+static u32 ieee80211_mcast_hash(const u8 *addr)
+{
+	return jhash(addr, ETH_ALEN, 0);
+}
+
+static struct ieee80211_mcast_group *
+__ieee80211_mcast_group_get(struct ieee80211_if_ap *ap, const u8 *addr)
+{
+	struct ieee80211_mcast_group *group;
+
+	hash_for_each_possible_rcu(ap->mcast_groups, group, node,
+				   ieee80211_mcast_hash(addr))
+		if (ether_addr_equal(group->addr, addr))
+			return group;
+
+	return NULL;
+}
+
+/**
+ * ieee80211_mcast_snoop_lookup - find the stations that joined a group
+ * @ap: the AP the frame is sent on
+ * @addr: multicast destination address
+ *
+ * Must be called under RCU read lock.
+ *
+ * Returns: the group, whose members bitmap is indexed by AID, or %NULL
+ *	if the frame should be sent to all stations.
+ */
+struct ieee80211_mcast_group *
+ieee80211_mcast_snoop_lookup(struct ieee80211_if_ap *ap, const u8 *addr)
+{
+	struct ieee80211_mcast_group *group;
+
+	if (!ap->multicast_snooping || ieee80211_mcast_flooded(addr))
+		return NULL;
+
+	group = __ieee80211_mcast_group_get(ap, addr);
+	if (!group || time_after(jiffies, READ_ONCE(group->last_report) +
+					  IEEE80211_MCAST_GROUP_TIMEOUT))
+		return NULL;
+
+	return group;
+}
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_mcast_snoop_lookup);
+
+static void ieee80211_mcast_group_free(struct ieee80211_if_ap *ap,
+				       struct ieee80211_mcast_group *group)
+{
+	lockdep_assert_held(&ap->mcast_lock);
+
+	hash_del_rcu(&group->node);
+	ap->mcast_num_groups--;
+	kfree_rcu(group, rcu_head);
+}
+
+static void ieee80211_mcast_update(struct ieee80211_if_ap *ap, u16 aid,
+				   const u8 *addr, bool join)
+{
+	struct ieee80211_mcast_group *group;
+	struct hlist_node *tmp;
+	u32 hash;
+
+	if (ieee80211_mcast_flooded(addr))
+		return;
+
+	hash = ieee80211_mcast_hash(addr);
+
+	spin_lock_bh(&ap->mcast_lock);
+
+	group = __ieee80211_mcast_group_get(ap, addr);
+	if (group) {
+		if (join) {
+			set_bit(aid, group->members);
+			WRITE_ONCE(group->last_report, jiffies);
+		} else {
+			clear_bit(aid, group->members);
+		}
+		goto out;
+	}
+
+	if (!join)
+		goto out;
+
+	/* make room by dropping timed out groups in the same bucket */
+	hash_for_each_possible_safe(ap->mcast_groups, group, tmp, node, hash)
+		if (time_after(jiffies, group->last_report +
+					IEEE80211_MCAST_GROUP_TIMEOUT))
+			ieee80211_mcast_group_free(ap, group);
+
+	/* beyond that, new groups simply keep going to everyone */
+	if (ap->mcast_num_groups >= IEEE80211_MCAST_MAX_GROUPS)
+		goto out;
+
+	group = kzalloc(sizeof(*group), GFP_ATOMIC);
+	if (!group)
+		goto out;
+
+	ether_addr_copy(group->addr, addr);
+	group->last_report = jiffies;
+	set_bit(aid, group->members);
+	hash_add_rcu(ap->mcast_groups, &group->node, hash);
+	ap->mcast_num_groups++;
+out:
+	spin_unlock_bh(&ap->mcast_lock);
+}
+
+static void ieee80211_mcast_update_ipv4(struct ieee80211_if_ap *ap, u16 aid,
+					__be32 group, bool join)
+{
+	u8 addr[ETH_ALEN];
+
+	if (!ipv4_is_multicast(group))
+		return;
+
+	ip_eth_mc_map(group, addr);
+	ieee80211_mcast_update(ap, aid, addr, join);
+}
+
+static void ieee80211_mcast_update_ipv6(struct ieee80211_if_ap *ap, u16 aid,
+					const struct in6_addr *group, bool join)
+{
+	u8 addr[ETH_ALEN];
+
+	if (!ipv6_addr_is_multicast(group))
+		return;
+
+	ipv6_eth_mc_map(group, addr);
+	ieee80211_mcast_update(ap, aid, addr, join);
+}
+
+static void ieee80211_mcast_snoop_igmp(struct ieee80211_if_ap *ap, u16 aid,
+				       struct sk_buff *skb, int offset)
+{
+	struct igmpv3_report _ih3, *ih3;
+	struct igmphdr _ih, *ih;
+	int i;
+
+	ih = skb_header_pointer(skb, offset, sizeof(_ih), &_ih);
+	if (!ih)
+		return;
+
+	switch (ih->type) {
+	case IGMP_HOST_MEMBERSHIP_REPORT:
+	case IGMPV2_HOST_MEMBERSHIP_REPORT:
+		ieee80211_mcast_update_ipv4(ap, aid, ih->group, true);
+		return;
+	case IGMP_HOST_LEAVE_MESSAGE:
+		ieee80211_mcast_update_ipv4(ap, aid, ih->group, false);
+		return;
+	case IGMPV3_HOST_MEMBERSHIP_REPORT:
+		break;
+	default:
+		return;
+	}
+
+	ih3 = skb_header_pointer(skb, offset, sizeof(_ih3), &_ih3);
+	if (!ih3)
+		return;
+
+	offset += sizeof(*ih3);
+	for (i = 0; i < ntohs(ih3->ngrec); i++) {
+		struct igmpv3_grec _grec, *grec;
+		bool join;
+
+		grec = skb_header_pointer(skb, offset, sizeof(_grec), &_grec);
+		if (!grec)
+			return;
+
+		switch (grec->grec_type) {
+		case IGMPV3_MODE_IS_INCLUDE:
+		case IGMPV3_CHANGE_TO_INCLUDE:
+			/* include nothing is how v3 leaves a group */
+			join = grec->grec_nsrcs;
+			break;
+		case IGMPV3_MODE_IS_EXCLUDE:
+		case IGMPV3_CHANGE_TO_EXCLUDE:
+		case IGMPV3_ALLOW_NEW_SOURCES:
+			join = true;
+			break;
+		default:
+			goto next;
+		}
+
+		ieee80211_mcast_update_ipv4(ap, aid, grec->grec_mca, join);
+next:
+		offset += sizeof(*grec) +
+			  ntohs(grec->grec_nsrcs) * sizeof(__be32) +
+			  grec->grec_auxwords * 4;
+	}
+}
+
+static void ieee80211_mcast_snoop_mld(struct ieee80211_if_ap *ap, u16 aid,
+				      struct sk_buff *skb, int offset)
+{
+	struct mld2_report _mld2, *mld2;
+	struct mld_msg _mld, *mld;
+	int i;
+
+	mld = skb_header_pointer(skb, offset, sizeof(_mld), &_mld);
+	if (!mld)
+		return;
+
+	switch (mld->mld_type) {
+	case ICMPV6_MGM_REPORT:
+		ieee80211_mcast_update_ipv6(ap, aid, &mld->mld_mca, true);
+		return;
+	case ICMPV6_MGM_REDUCTION:
+		ieee80211_mcast_update_ipv6(ap, aid, &mld->mld_mca, false);
+		return;
+	case ICMPV6_MLD2_REPORT:
+		break;
+	default:
+		return;
+	}
+
+	mld2 = skb_header_pointer(skb, offset, sizeof(_mld2), &_mld2);
+	if (!mld2)
+		return;
+
+	offset += sizeof(*mld2);
+	for (i = 0; i < ntohs(mld2->mld2r_ngrec); i++) {
+		struct mld2_grec _grec, *grec;
+		bool join;
+
+		grec = skb_header_pointer(skb, offset, sizeof(_grec), &_grec);
+		if (!grec)
+			return;
+
+		switch (grec->grec_type) {
+		case MLD2_MODE_IS_INCLUDE:
+		case MLD2_CHANGE_TO_INCLUDE:
+			join = grec->grec_nsrcs;
+			break;
+		case MLD2_MODE_IS_EXCLUDE:
+		case MLD2_CHANGE_TO_EXCLUDE:
+		case MLD2_ALLOW_NEW_SOURCES:
+			join = true;
+			break;
+		default:
+			goto next;
+		}
+
+		ieee80211_mcast_update_ipv6(ap, aid, &grec->grec_mca, join);
+next:
+		offset += sizeof(*grec) +
+			  ntohs(grec->grec_nsrcs) * sizeof(struct in6_addr) +
+			  grec->grec_auxwords * 4;
+	}
+}
+
+/**
+ * ieee80211_mcast_snoop_rx - track group membership reports of a station
+ * @ap: the AP the station is associated with
+ * @aid: the station's AID
+ * @skb: 802.3 frame received from the station, with data at the
+ *	Ethernet header
+ */
+void ieee80211_mcast_snoop_rx(struct ieee80211_if_ap *ap, u16 aid,
+			      struct sk_buff *skb)
+{
+	const struct ethhdr *eth = (void *)skb->data;
+	int offset = ETH_HLEN;
+
+	if (!ap->multicast_snooping || !is_multicast_ether_addr(eth->h_dest))
+		return;
+
+	if (!aid || aid > IEEE80211_MAX_AID)
+		return;
+
+	if (eth->h_proto == htons(ETH_P_IP)) {
+		struct iphdr _iph, *iph;
+
+		iph = skb_header_pointer(skb, offset, sizeof(_iph), &_iph);
+		if (!iph || iph->protocol != IPPROTO_IGMP || iph->ihl < 5)
+			return;
+
+		ieee80211_mcast_snoop_igmp(ap, aid, skb,
+					   offset + iph->ihl * 4);
+	} else if (eth->h_proto == htons(ETH_P_IPV6)) {
+		struct ipv6hdr _ip6h, *ip6h;
+		__be16 frag_off;
+		u8 nexthdr;
+
+		ip6h = skb_header_pointer(skb, offset, sizeof(_ip6h), &_ip6h);
+		if (!ip6h)
+			return;
+
+		nexthdr = ip6h->nexthdr;
+		offset = ipv6_skip_exthdr(skb, offset + sizeof(*ip6h),
+					  &nexthdr, &frag_off);
+		if (offset < 0 || nexthdr != IPPROTO_ICMPV6)
+			return;
+
+		ieee80211_mcast_snoop_mld(ap, aid, skb, offset);
+	}
+}
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_mcast_snoop_rx);
+
+void ieee80211_mcast_snoop_sta_removed(struct sta_info *sta)
+{
+	struct ieee80211_sub_if_data *sdata = sta->sdata;
+	struct ieee80211_mcast_group *group;
+	struct ieee80211_if_ap *ap;
+	int bkt;
+
+	if ((sdata->vif.type != NL80211_IFTYPE_AP &&
+	     sdata->vif.type != NL80211_IFTYPE_AP_VLAN) || !sdata->bss ||
+	    !sta->sta.aid || sta->sta.aid > IEEE80211_MAX_AID)
+		return;
+
+	ap = sdata->bss;
+
+	/* the AID may be handed to the next station */
+	spin_lock_bh(&ap->mcast_lock);
+	hash_for_each(ap->mcast_groups, bkt, group, node)
+		clear_bit(sta->sta.aid, group->members);
+	spin_unlock_bh(&ap->mcast_lock);
+}
+
+void ieee80211_mcast_snoop_flush(struct ieee80211_if_ap *ap)
+{
+	struct ieee80211_mcast_group *group;
+	struct hlist_node *tmp;
+	int bkt;
+
+	spin_lock_bh(&ap->mcast_lock);
+	hash_for_each_safe(ap->mcast_groups, bkt, tmp, group, node)
+		ieee80211_mcast_group_free(ap, group);
+	spin_unlock_bh(&ap->mcast_lock);
+}
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_mcast_snoop_flush);
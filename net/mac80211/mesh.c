@@ -1253,7 +1253,8 @@ void ieee80211_stop_mesh(struct ieee80211_sub_if_data *sdata)
 	kfree_rcu(bcn, rcu_head);
 
 	/* free all potentially still buffered group-addressed frames */
-	local->total_ps_buffered -= skb_queue_len(&ifmsh->ps.bc_buf);
+	atomic_sub(skb_queue_len(&ifmsh->ps.bc_buf),
+		   &local->total_ps_buffered);
 	skb_queue_purge(&ifmsh->ps.bc_buf);
 
 	del_timer_sync(&sdata->u.mesh.housekeeping_timer);
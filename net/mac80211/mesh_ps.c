@@ -471,7 +471,7 @@ static void mps_frame_deliver(struct sta_info *sta, int n_frames)
 				skb = skb_dequeue(
 					&sta->ps_tx_buf[ac]);
 				if (skb)
-					local->total_ps_buffered--;
+					atomic_dec(&local->total_ps_buffered);
 			}
 			if (!skb)
 				break;
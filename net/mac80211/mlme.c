@@ -2688,7 +2688,6 @@ void ieee80211_dynamic_ps_enable_work(struct wiphy *wiphy,
 			     dynamic_ps_enable_work);
 	struct ieee80211_sub_if_data *sdata = local->ps_sdata;
 	struct ieee80211_if_managed *ifmgd;
-	unsigned long flags;
 	int q;
 
 	/* can only happen when PS was just disabled anyway */
@@ -2714,18 +2713,14 @@ void ieee80211_dynamic_ps_enable_work(struct wiphy *wiphy,
 		 * dynamic_ps_timer expiry. Postpone the ps timer if it
 		 * is not the actual idle state.
 		 */
-		spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
 		for (q = 0; q < local->hw.queues; q++) {
-			if (local->queue_stop_reasons[q]) {
-				spin_unlock_irqrestore(&local->queue_stop_reason_lock,
-						       flags);
+			if (READ_ONCE(local->queue_stop_reasons[q])) {
 				mod_timer(&local->dynamic_ps_timer, jiffies +
 					  msecs_to_jiffies(
 					  local->hw.conf.dynamic_ps_timeout));
 				return;
 			}
 		}
-		spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
 	}
 
 	if (ieee80211_hw_check(&local->hw, PS_NULLFUNC_STACK) &&
@@ -733,7 +733,9 @@ static void rate_control_fill_sta_table(struct ieee80211_sta *sta,
 		    info->control.rates[i].count) {
 			if (rates != info->control.rates)
 				rates[i] = info->control.rates[i];
-		} else if (ratetbl) {
+		} else if (ratetbl &&
+			   !(ratetbl->rate[i].flags & (IEEE80211_TX_RC_HE_MCS |
+						       IEEE80211_TX_RC_EHT_MCS))) {
 			rates[i].idx = ratetbl->rate[i].idx;
 			rates[i].flags = ratetbl->rate[i].flags;
 			if (info->control.use_rts)
@@ -822,6 +824,11 @@ rate_control_apply_mask_ratetbl(struct sta_info *sta,
 		if (rates->rate[i].idx < 0)
 			break;
 
+		/* the masks don't cover HE/EHT rates */
+		if (rates->rate[i].flags & (IEEE80211_TX_RC_HE_MCS |
+					    IEEE80211_TX_RC_EHT_MCS))
+			continue;
+
 		rate_idx_match_mask(&rates->rate[i].idx, &rates->rate[i].flags,
 				    sband, chan_width, mask, mcs_mask,
 				    vht_mask);
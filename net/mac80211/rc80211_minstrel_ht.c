@@ -36,9 +36,25 @@
 #define MCS_DURATION(streams, sgi, bps) \
 	(MCS_SYMBOL_TIME(sgi, MCS_NSYMS((streams) * (bps))) / AVG_AMPDU_SIZE)
 
+/* These should match the values in enum nl80211_he_gi */
+#define HE_GI_08		0
+#define HE_GI_16		1
+#define HE_GI_32		2
+
+/* Transmission time (nanoseconds) for a packet containing (syms) HE symbols */
+#define HE_SYMBOL_TIME(gi, syms)					\
+	((syms) * (gi == HE_GI_08 ? 13600 :	/* 13.6 us */		\
+		   gi == HE_GI_16 ? 14400 :	/* 14.4 us */		\
+		   16000))			/* 16.0 us */
+
+#define HE_DURATION(streams, gi, bps) \
+	(HE_SYMBOL_TIME(gi, MCS_NSYMS((streams) * (bps))) / AVG_AMPDU_SIZE)
+
 #define BW_20			0
 #define BW_40			1
 #define BW_80			2
+#define BW_160			3
+#define BW_320			4
 
 /*
  * Define group sort order: HT40 -> SGI -> #streams
@@ -134,6 +150,82 @@
 	__VHT_GROUP(_streams, _sgi, _bw,				\
 		    VHT_GROUP_SHIFT(_streams, _sgi, _bw))
 
+#define HE_GROUP_IDX(_streams, _gi, _bw)				\
+	(MINSTREL_HE_GROUP_0 +						\
+	 MINSTREL_MAX_STREAMS * 3 * (_bw) +				\
+	 MINSTREL_MAX_STREAMS * (_gi) +					\
+	 (_streams) - 1)
+
+#define EHT_GROUP_IDX(_streams, _gi, _bw)				\
+	(MINSTREL_EHT_GROUP_0 +						\
+	 MINSTREL_MAX_STREAMS * 3 * (_bw) +				\
+	 MINSTREL_MAX_STREAMS * (_gi) +					\
+	 (_streams) - 1)
+
+#define HE_GROUP_FLAGS(_gi, _bw)					\
+	((_gi == HE_GI_16 ? IEEE80211_TX_RC_GI_1_6 : 0) |		\
+	 (_gi == HE_GI_32 ? IEEE80211_TX_RC_GI_3_2 : 0) |		\
+	 (_bw == BW_320 ? IEEE80211_TX_RC_320_MHZ_WIDTH :		\
+	  _bw == BW_160 ? IEEE80211_TX_RC_160_MHZ_WIDTH :		\
+	  _bw == BW_80 ? IEEE80211_TX_RC_80_MHZ_WIDTH :		\
+	  _bw == BW_40 ? IEEE80211_TX_RC_40_MHZ_WIDTH : 0))
+
+/*
+ * HE and EHT share the durations for MCS 0-11, HE groups simply never mark
+ * MCS 12/13 as supported
+ */
+#define __HE_GROUP(_idx, _flags, _streams, _gi, _bw, _s)		\
+	[_idx] = {							\
+	.streams = _streams,						\
+	.shift = _s,							\
+	.bw = _bw,							\
+	.flags = _flags | HE_GROUP_FLAGS(_gi, _bw),			\
+	.duration = {							\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 0)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 1)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 2)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 3)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 4)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 5)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 6)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 7)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 8)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 9)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 10)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 11)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 12)) >> _s,		\
+		HE_DURATION(_streams, _gi,				\
+			    IEEE80211_HE_DBPS(_bw, 13)) >> _s		\
+	}								\
+}
+
+#define HE_GROUP_SHIFT(_streams, _gi, _bw)				\
+	GROUP_SHIFT(HE_DURATION(_streams, _gi,				\
+				IEEE80211_HE_DBPS(_bw, 0)))
+
+#define HE_GROUP(_streams, _gi, _bw)					\
+	__HE_GROUP(HE_GROUP_IDX(_streams, _gi, _bw),			\
+		   IEEE80211_TX_RC_HE_MCS, _streams, _gi, _bw,		\
+		   HE_GROUP_SHIFT(_streams, _gi, _bw))
+
+#define EHT_GROUP(_streams, _gi, _bw)					\
+	__HE_GROUP(EHT_GROUP_IDX(_streams, _gi, _bw),			\
+		   IEEE80211_TX_RC_EHT_MCS, _streams, _gi, _bw,		\
+		   HE_GROUP_SHIFT(_streams, _gi, _bw))
+
 #define CCK_DURATION(_bitrate, _short)			\
 	(1000 * (10 /* SIFS */ +			\
 	 (_short ? 72 + 24 : 144 + 48) +		\
@@ -197,7 +289,7 @@
 static bool minstrel_vht_only = true;
 module_param(minstrel_vht_only, bool, 0644);
 MODULE_PARM_DESC(minstrel_vht_only,
-		 "Use only VHT rates when VHT is supported by sta.");
+		 "Use only the highest of VHT/HE/EHT rates supported by sta.");
 
 /*
  * To enable sufficiently targeted rate sampling, MCS rates are divided into
@@ -260,7 +352,143 @@ const struct mcs_group minstrel_mcs_groups[] = {
 	VHT_GROUP(2, 1, BW_80),
 	VHT_GROUP(3, 1, BW_80),
 	VHT_GROUP(4, 1, BW_80),
+
+	HE_GROUP(1, HE_GI_08, BW_20),
+	HE_GROUP(2, HE_GI_08, BW_20),
+	HE_GROUP(3, HE_GI_08, BW_20),
+	HE_GROUP(4, HE_GI_08, BW_20),
+
+	HE_GROUP(1, HE_GI_16, BW_20),
+	HE_GROUP(2, HE_GI_16, BW_20),
+	HE_GROUP(3, HE_GI_16, BW_20),
+	HE_GROUP(4, HE_GI_16, BW_20),
+
+	HE_GROUP(1, HE_GI_32, BW_20),
+	HE_GROUP(2, HE_GI_32, BW_20),
+	HE_GROUP(3, HE_GI_32, BW_20),
+	HE_GROUP(4, HE_GI_32, BW_20),
+
+	HE_GROUP(1, HE_GI_08, BW_40),
+	HE_GROUP(2, HE_GI_08, BW_40),
+	HE_GROUP(3, HE_GI_08, BW_40),
+	HE_GROUP(4, HE_GI_08, BW_40),
+
+	HE_GROUP(1, HE_GI_16, BW_40),
+	HE_GROUP(2, HE_GI_16, BW_40),
+	HE_GROUP(3, HE_GI_16, BW_40),
+	HE_GROUP(4, HE_GI_16, BW_40),
+
+	HE_GROUP(1, HE_GI_32, BW_40),
+	HE_GROUP(2, HE_GI_32, BW_40),
+	HE_GROUP(3, HE_GI_32, BW_40),
+	HE_GROUP(4, HE_GI_32, BW_40),
+
+	HE_GROUP(1, HE_GI_08, BW_80),
+	HE_GROUP(2, HE_GI_08, BW_80),
+	HE_GROUP(3, HE_GI_08, BW_80),
+	HE_GROUP(4, HE_GI_08, BW_80),
+
+	HE_GROUP(1, HE_GI_16, BW_80),
+	HE_GROUP(2, HE_GI_16, BW_80),
+	HE_GROUP(3, HE_GI_16, BW_80),
+	HE_GROUP(4, HE_GI_16, BW_80),
+
+	HE_GROUP(1, HE_GI_32, BW_80),
+	HE_GROUP(2, HE_GI_32, BW_80),
+	HE_GROUP(3, HE_GI_32, BW_80),
+	HE_GROUP(4, HE_GI_32, BW_80),
+
+	HE_GROUP(1, HE_GI_08, BW_160),
+	HE_GROUP(2, HE_GI_08, BW_160),
+	HE_GROUP(3, HE_GI_08, BW_160),
+	HE_GROUP(4, HE_GI_08, BW_160),
+
+	HE_GROUP(1, HE_GI_16, BW_160),
+	HE_GROUP(2, HE_GI_16, BW_160),
+	HE_GROUP(3, HE_GI_16, BW_160),
+	HE_GROUP(4, HE_GI_16, BW_160),
+
+	HE_GROUP(1, HE_GI_32, BW_160),
+	HE_GROUP(2, HE_GI_32, BW_160),
+	HE_GROUP(3, HE_GI_32, BW_160),
+	HE_GROUP(4, HE_GI_32, BW_160),
+
+	EHT_GROUP(1, HE_GI_08, BW_20),
+	EHT_GROUP(2, HE_GI_08, BW_20),
+	EHT_GROUP(3, HE_GI_08, BW_20),
+	EHT_GROUP(4, HE_GI_08, BW_20),
+
+	EHT_GROUP(1, HE_GI_16, BW_20),
+	EHT_GROUP(2, HE_GI_16, BW_20),
+	EHT_GROUP(3, HE_GI_16, BW_20),
+	EHT_GROUP(4, HE_GI_16, BW_20),
+
+	EHT_GROUP(1, HE_GI_32, BW_20),
+	EHT_GROUP(2, HE_GI_32, BW_20),
+	EHT_GROUP(3, HE_GI_32, BW_20),
+	EHT_GROUP(4, HE_GI_32, BW_20),
+
+	EHT_GROUP(1, HE_GI_08, BW_40),
+	EHT_GROUP(2, HE_GI_08, BW_40),
+	EHT_GROUP(3, HE_GI_08, BW_40),
+	EHT_GROUP(4, HE_GI_08, BW_40),
+
+	EHT_GROUP(1, HE_GI_16, BW_40),
+	EHT_GROUP(2, HE_GI_16, BW_40),
+	EHT_GROUP(3, HE_GI_16, BW_40),
+	EHT_GROUP(4, HE_GI_16, BW_40),
+
+	EHT_GROUP(1, HE_GI_32, BW_40),
+	EHT_GROUP(2, HE_GI_32, BW_40),
+	EHT_GROUP(3, HE_GI_32, BW_40),
+	EHT_GROUP(4, HE_GI_32, BW_40),
+
+	EHT_GROUP(1, HE_GI_08, BW_80),
+	EHT_GROUP(2, HE_GI_08, BW_80),
+	EHT_GROUP(3, HE_GI_08, BW_80),
+	EHT_GROUP(4, HE_GI_08, BW_80),
+
+	EHT_GROUP(1, HE_GI_16, BW_80),
+	EHT_GROUP(2, HE_GI_16, BW_80),
+	EHT_GROUP(3, HE_GI_16, BW_80),
+	EHT_GROUP(4, HE_GI_16, BW_80),
+
+	EHT_GROUP(1, HE_GI_32, BW_80),
+	EHT_GROUP(2, HE_GI_32, BW_80),
+	EHT_GROUP(3, HE_GI_32, BW_80),
+	EHT_GROUP(4, HE_GI_32, BW_80),
+
+	EHT_GROUP(1, HE_GI_08, BW_160),
+	EHT_GROUP(2, HE_GI_08, BW_160),
+	EHT_GROUP(3, HE_GI_08, BW_160),
+	EHT_GROUP(4, HE_GI_08, BW_160),
+
+	EHT_GROUP(1, HE_GI_16, BW_160),
+	EHT_GROUP(2, HE_GI_16, BW_160),
+	EHT_GROUP(3, HE_GI_16, BW_160),
+	EHT_GROUP(4, HE_GI_16, BW_160),
+
+	EHT_GROUP(1, HE_GI_32, BW_160),
+	EHT_GROUP(2, HE_GI_32, BW_160),
+	EHT_GROUP(3, HE_GI_32, BW_160),
+	EHT_GROUP(4, HE_GI_32, BW_160),
+
+	EHT_GROUP(1, HE_GI_08, BW_320),
+	EHT_GROUP(2, HE_GI_08, BW_320),
+	EHT_GROUP(3, HE_GI_08, BW_320),
+	EHT_GROUP(4, HE_GI_08, BW_320),
+
+	EHT_GROUP(1, HE_GI_16, BW_320),
+	EHT_GROUP(2, HE_GI_16, BW_320),
+	EHT_GROUP(3, HE_GI_16, BW_320),
+	EHT_GROUP(4, HE_GI_16, BW_320),
+
+	EHT_GROUP(1, HE_GI_32, BW_320),
+	EHT_GROUP(2, HE_GI_32, BW_320),
+	EHT_GROUP(3, HE_GI_32, BW_320),
+	EHT_GROUP(4, HE_GI_32, BW_320),
 };
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(minstrel_mcs_groups);
 
 const s16 minstrel_cck_bitrates[4] = { 10, 20, 55, 110 };
 const s16 minstrel_ofdm_bitrates[8] = { 60, 90, 120, 180, 240, 360, 480, 540 };
@@ -316,6 +544,76 @@ minstrel_get_valid_vht_rates(int bw, int nss, __le16 mcs_map)
 	return 0x3ff & ~mask;
 }
 
+/*
+ * HE MCS maps only distinguish MCS 0-7, 0-9 and 0-11
+ */
+static u16
+minstrel_get_valid_he_rates(struct ieee80211_sta *sta, int bw, int nss)
+{
+	const struct ieee80211_he_mcs_nss_supp *mcs_nss =
+		&sta->deflink.he_cap.he_mcs_nss_supp;
+	u16 mcs_map;
+
+	if (bw == BW_160)
+		mcs_map = le16_to_cpu(mcs_nss->rx_mcs_160);
+	else
+		mcs_map = le16_to_cpu(mcs_nss->rx_mcs_80);
+
+	switch ((mcs_map >> (2 * (nss - 1))) & 3) {
+	case IEEE80211_HE_MCS_SUPPORT_0_7:
+		return GENMASK(7, 0);
+	case IEEE80211_HE_MCS_SUPPORT_0_9:
+		return GENMASK(9, 0);
+	case IEEE80211_HE_MCS_SUPPORT_0_11:
+		return GENMASK(11, 0);
+	default:
+		return 0;
+	}
+}
+
+/*
+ * EHT gives the max. number of streams per range of MCSes, 20 MHz-only
+ * stations split MCS 0-9 into 0-7 and 8-9.
+ */
+static u16
+minstrel_get_valid_eht_rates(struct ieee80211_sta *sta, int bw, int nss)
+{
+	static const u16 ranges_20[] = {
+		GENMASK(7, 0), GENMASK(9, 8), GENMASK(11, 10), GENMASK(13, 12)
+	};
+	static const u16 ranges[] = {
+		GENMASK(9, 0), GENMASK(11, 10), GENMASK(13, 12)
+	};
+	const struct ieee80211_eht_mcs_nss_supp *mcs_nss =
+		&sta->deflink.eht_cap.eht_mcs_nss_supp;
+	u8 he_phy_cap0 = sta->deflink.he_cap.he_cap_elem.phy_cap_info[0];
+	const u8 *max_nss;
+	u16 mask = 0;
+	int i;
+
+	if (!(he_phy_cap0 & IEEE80211_HE_PHY_CAP0_CHANNEL_WIDTH_SET_MASK_ALL)) {
+		max_nss = mcs_nss->only_20mhz.rx_tx_max_nss;
+		for (i = 0; i < ARRAY_SIZE(ranges_20); i++)
+			if (u8_get_bits(max_nss[i], IEEE80211_EHT_MCS_NSS_RX) >= nss)
+				mask |= ranges_20[i];
+
+		return mask;
+	}
+
+	if (bw == BW_320)
+		max_nss = mcs_nss->bw._320.rx_tx_max_nss;
+	else if (bw == BW_160)
+		max_nss = mcs_nss->bw._160.rx_tx_max_nss;
+	else
+		max_nss = mcs_nss->bw._80.rx_tx_max_nss;
+
+	for (i = 0; i < ARRAY_SIZE(ranges); i++)
+		if (u8_get_bits(max_nss[i], IEEE80211_EHT_MCS_NSS_RX) >= nss)
+			mask |= ranges[i];
+
+	return mask;
+}
+
 static bool
 minstrel_ht_is_legacy_group(int group)
 {
@@ -323,6 +621,12 @@ minstrel_ht_is_legacy_group(int group)
 	       group == MINSTREL_OFDM_GROUP;
 }
 
+static bool
+minstrel_ht_is_he_group(int group)
+{
+	return group >= MINSTREL_HE_GROUP_0;
+}
+
 /*
  * Look up an MCS group index based on mac80211 rate information
  */
@@ -366,6 +670,49 @@ minstrel_vht_ri_get_group_idx(struct rate_info *rate)
 			     2*!!(rate->bw & RATE_INFO_BW_80));
 }
 
+static int
+minstrel_ri_get_bw(struct rate_info *rate)
+{
+	switch (rate->bw) {
+	case RATE_INFO_BW_40:
+		return BW_40;
+	case RATE_INFO_BW_80:
+		return BW_80;
+	case RATE_INFO_BW_160:
+		return BW_160;
+	case RATE_INFO_BW_320:
+		return BW_320;
+	default:
+		return BW_20;
+	}
+}
+
+/*
+ * Look up an HE/EHT group index based on cfg80211 rate_info, or -1 if the
+ * rate isn't covered by any group.
+ */
+static int
+minstrel_he_ri_get_group_idx(struct rate_info *rate)
+{
+	int bw = minstrel_ri_get_bw(rate);
+
+	if (!rate->nss || rate->nss > MINSTREL_MAX_STREAMS ||
+	    rate->mcs >= MCS_GROUP_RATES)
+		return -1;
+
+	if (rate->flags & RATE_INFO_FLAGS_EHT_MCS) {
+		if (rate->eht_gi > NL80211_RATE_INFO_EHT_GI_3_2)
+			return -1;
+
+		return EHT_GROUP_IDX(rate->nss, rate->eht_gi, bw);
+	}
+
+	if (bw == BW_320 || rate->he_gi > NL80211_RATE_INFO_HE_GI_3_2)
+		return -1;
+
+	return HE_GROUP_IDX(rate->nss, rate->he_gi, bw);
+}
+
 static struct minstrel_rate_stats *
 minstrel_ht_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 		      struct ieee80211_tx_rate *rate)
@@ -406,7 +753,7 @@ minstrel_ht_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 
 	idx = 0;
 out:
-	return &mi->groups[group].rates[idx];
+	return minstrel_ht_rate_stats(mi, group, idx);
 }
 
 /*
@@ -419,6 +766,12 @@ minstrel_ht_ri_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 	int group, idx;
 	struct rate_info *rate = &rate_status->rate_idx;
 
+	if (rate->flags & (RATE_INFO_FLAGS_HE_MCS | RATE_INFO_FLAGS_EHT_MCS)) {
+		group = minstrel_he_ri_get_group_idx(rate);
+		idx = rate->mcs;
+		goto out;
+	}
+
 	if (rate->flags & RATE_INFO_FLAGS_MCS) {
 		group = minstrel_ht_ri_get_group_idx(rate);
 		idx = rate->mcs % 8;
@@ -450,13 +803,14 @@ minstrel_ht_ri_get_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 
 	idx = 0;
 out:
-	return &mi->groups[group].rates[idx];
+	return minstrel_ht_rate_stats(mi, group, idx);
 }
 
 static inline struct minstrel_rate_stats *
 minstrel_get_ratestats(struct minstrel_ht_sta *mi, int index)
 {
-	return &mi->groups[MI_RATE_GROUP(index)].rates[MI_RATE_IDX(index)];
+	return minstrel_ht_rate_stats(mi, MI_RATE_GROUP(index),
+				      MI_RATE_IDX(index));
 }
 
 static inline int minstrel_get_duration(int index)
@@ -544,13 +898,13 @@ minstrel_ht_sort_best_tp_rates(struct minstrel_ht_sta *mi, u16 index,
 
 	cur_group = MI_RATE_GROUP(index);
 	cur_idx = MI_RATE_IDX(index);
-	cur_prob = mi->groups[cur_group].rates[cur_idx].prob_avg;
+	cur_prob = minstrel_ht_rate_stats(mi, cur_group, cur_idx)->prob_avg;
 	cur_tp_avg = minstrel_ht_get_tp_avg(mi, cur_group, cur_idx, cur_prob);
 
 	do {
 		tmp_group = MI_RATE_GROUP(tp_list[j - 1]);
 		tmp_idx = MI_RATE_IDX(tp_list[j - 1]);
-		tmp_prob = mi->groups[tmp_group].rates[tmp_idx].prob_avg;
+		tmp_prob = minstrel_ht_rate_stats(mi, tmp_group, tmp_idx)->prob_avg;
 		tmp_tp_avg = minstrel_ht_get_tp_avg(mi, tmp_group, tmp_idx,
 						    tmp_prob);
 		if (cur_tp_avg < tmp_tp_avg ||
@@ -583,19 +937,20 @@ minstrel_ht_set_best_prob_rate(struct minstrel_ht_sta *mi, u16 *dest, u16 index)
 
 	cur_group = MI_RATE_GROUP(index);
 	cur_idx = MI_RATE_IDX(index);
-	mg = &mi->groups[cur_group];
+	mg = minstrel_ht_group(mi, cur_group);
 	mrs = &mg->rates[cur_idx];
 
 	tmp_group = MI_RATE_GROUP(*dest);
 	tmp_idx = MI_RATE_IDX(*dest);
-	tmp_prob = mi->groups[tmp_group].rates[tmp_idx].prob_avg;
+	tmp_prob = minstrel_ht_rate_stats(mi, tmp_group, tmp_idx)->prob_avg;
 	tmp_tp_avg = minstrel_ht_get_tp_avg(mi, tmp_group, tmp_idx, tmp_prob);
 
 	/* if max_tp_rate[0] is from MCS_GROUP max_prob_rate get selected from
 	 * MCS_GROUP as well as CCK_GROUP rates do not allow aggregation */
 	max_tp_group = MI_RATE_GROUP(mi->max_tp_rate[0]);
 	max_tp_idx = MI_RATE_IDX(mi->max_tp_rate[0]);
-	max_tp_prob = mi->groups[max_tp_group].rates[max_tp_idx].prob_avg;
+	max_tp_prob = minstrel_ht_rate_stats(mi, max_tp_group,
+					     max_tp_idx)->prob_avg;
 
 	if (minstrel_ht_is_legacy_group(MI_RATE_GROUP(index)) &&
 	    !minstrel_ht_is_legacy_group(max_tp_group))
@@ -608,7 +963,8 @@ minstrel_ht_set_best_prob_rate(struct minstrel_ht_sta *mi, u16 *dest, u16 index)
 
 	max_gpr_group = MI_RATE_GROUP(mg->max_group_prob_rate);
 	max_gpr_idx = MI_RATE_IDX(mg->max_group_prob_rate);
-	max_gpr_prob = mi->groups[max_gpr_group].rates[max_gpr_idx].prob_avg;
+	max_gpr_prob = minstrel_ht_rate_stats(mi, max_gpr_group,
+					      max_gpr_idx)->prob_avg;
 
 	if (mrs->prob_avg > MINSTREL_FRAC(75, 100)) {
 		cur_tp_avg = minstrel_ht_get_tp_avg(mi, cur_group, cur_idx,
@@ -646,12 +1002,12 @@ minstrel_ht_assign_best_tp_rates(struct minstrel_ht_sta *mi,
 
 	tmp_group = MI_RATE_GROUP(tmp_legacy_tp_rate[0]);
 	tmp_idx = MI_RATE_IDX(tmp_legacy_tp_rate[0]);
-	tmp_prob = mi->groups[tmp_group].rates[tmp_idx].prob_avg;
+	tmp_prob = minstrel_ht_rate_stats(mi, tmp_group, tmp_idx)->prob_avg;
 	tmp_cck_tp = minstrel_ht_get_tp_avg(mi, tmp_group, tmp_idx, tmp_prob);
 
 	tmp_group = MI_RATE_GROUP(tmp_mcs_tp_rate[0]);
 	tmp_idx = MI_RATE_IDX(tmp_mcs_tp_rate[0]);
-	tmp_prob = mi->groups[tmp_group].rates[tmp_idx].prob_avg;
+	tmp_prob = minstrel_ht_rate_stats(mi, tmp_group, tmp_idx)->prob_avg;
 	tmp_mcs_tp = minstrel_ht_get_tp_avg(mi, tmp_group, tmp_idx, tmp_prob);
 
 	if (tmp_cck_tp > tmp_mcs_tp) {
@@ -673,19 +1029,23 @@ minstrel_ht_prob_rate_reduce_streams(struct minstrel_ht_sta *mi)
 	struct minstrel_mcs_group_data *mg;
 	int tmp_max_streams, group, tmp_idx, tmp_prob;
 	int tmp_tp = 0;
+	int i;
 
-	if (!mi->sta->deflink.ht_cap.ht_supported)
+	if (!mi->sta->deflink.ht_cap.ht_supported &&
+	    !mi->sta->deflink.he_cap.has_he)
 		return;
 
 	group = MI_RATE_GROUP(mi->max_tp_rate[0]);
 	tmp_max_streams = minstrel_mcs_groups[group].streams;
-	for (group = 0; group < ARRAY_SIZE(minstrel_mcs_groups); group++) {
-		mg = &mi->groups[group];
-		if (!mi->supported[group] || group == MINSTREL_CCK_GROUP)
+	for (i = 0; i < mi->n_groups; i++) {
+		group = mi->group_list[i];
+		if (group == MINSTREL_CCK_GROUP)
 			continue;
 
+		mg = minstrel_ht_group(mi, group);
+
 		tmp_idx = MI_RATE_IDX(mg->max_group_prob_rate);
-		tmp_prob = mi->groups[group].rates[tmp_idx].prob_avg;
+		tmp_prob = mg->rates[tmp_idx].prob_avg;
 
 		if (tmp_tp < minstrel_ht_get_tp_avg(mi, group, tmp_idx, tmp_prob) &&
 		   (minstrel_mcs_groups[group].streams < tmp_max_streams)) {
@@ -876,11 +1236,15 @@ minstrel_ht_next_inc_rate(struct minstrel_ht_sta *mi, u32 fast_rate_dur)
 {
 	u8 type = MINSTREL_SAMPLE_TYPE_INC;
 	int i, index = 0;
-	u8 group;
+	u8 group, pos;
 
-	group = mi->sample[type].sample_group;
-	for (i = 0; i < ARRAY_SIZE(minstrel_mcs_groups); i++) {
-		group = (group + 1) % ARRAY_SIZE(minstrel_mcs_groups);
+	if (!mi->n_groups)
+		return 0;
+
+	pos = mi->sample[type].sample_group;
+	for (i = 0; i < mi->n_groups; i++) {
+		pos = (pos + 1) % mi->n_groups;
+		group = mi->group_list[pos];
 
 		index = minstrel_ht_group_min_rate_offset(mi, group,
 							  fast_rate_dur);
@@ -894,7 +1258,7 @@ minstrel_ht_next_inc_rate(struct minstrel_ht_sta *mi, u32 fast_rate_dur)
 	index = 0;
 
 out:
-	mi->sample[type].sample_group = group;
+	mi->sample[type].sample_group = pos;
 
 	return index;
 }
@@ -903,7 +1267,7 @@ static int
 minstrel_ht_next_group_sample_rate(struct minstrel_ht_sta *mi, int group,
 				   u16 supported, int offset)
 {
-	struct minstrel_mcs_group_data *mg = &mi->groups[group];
+	struct minstrel_mcs_group_data *mg = minstrel_ht_group(mi, group);
 	u16 idx;
 	int i;
 
@@ -943,21 +1307,22 @@ minstrel_ht_next_jump_rate(struct minstrel_ht_sta *mi, u32 fast_rate_dur,
 	u16 *slow_rates;
 	u16 supported;
 	u32 duration;
-	u8 group;
+	u8 group, pos;
+
+	if (!mi->n_groups)
+		return 0;
 
 	if (*slow_rate_ofs >= MINSTREL_SAMPLE_RATES)
 		max_duration = fast_rate_dur;
 
 	slow_rates = mi->sample[MINSTREL_SAMPLE_TYPE_SLOW].sample_rates;
-	group = mi->sample[MINSTREL_SAMPLE_TYPE_JUMP].sample_group;
-	for (i = 0; i < ARRAY_SIZE(minstrel_mcs_groups); i++) {
+	pos = mi->sample[MINSTREL_SAMPLE_TYPE_JUMP].sample_group;
+	for (i = 0; i < mi->n_groups; i++) {
 		u8 type;
 
-		group = (group + 1) % ARRAY_SIZE(minstrel_mcs_groups);
-
+		pos = (pos + 1) % mi->n_groups;
+		group = mi->group_list[pos];
 		supported = mi->supported[group];
-		if (!supported)
-			continue;
 
 		offset = minstrel_ht_group_min_rate_offset(mi, group,
 							   max_duration);
@@ -999,7 +1364,7 @@ minstrel_ht_next_jump_rate(struct minstrel_ht_sta *mi, u32 fast_rate_dur,
 	index = 0;
 
 found:
-	mi->sample[MINSTREL_SAMPLE_TYPE_JUMP].sample_group = group;
+	mi->sample[MINSTREL_SAMPLE_TYPE_JUMP].sample_group = pos;
 
 	return index;
 }
@@ -1055,12 +1420,12 @@ minstrel_ht_refill_sample_rates(struct minstrel_ht_sta *mi)
  *  - as long as the max prob rate has a probability of more than 75%, pick
  *    higher throughput rates, even if the probablity is a bit lower
  */
-static void
+VISIBLE_IF_MAC80211_KUNIT void
 minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 {
 	struct minstrel_mcs_group_data *mg;
 	struct minstrel_rate_stats *mrs;
-	int group, i, j, cur_prob;
+	int group, i, j, n, cur_prob;
 	u16 tmp_mcs_tp_rate[MAX_THR_RATES], tmp_group_tp_rate[MAX_THR_RATES];
 	u16 tmp_legacy_tp_rate[MAX_THR_RATES], tmp_max_prob_rate;
 	u16 index;
@@ -1088,7 +1453,11 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 	for (j = 0; j < ARRAY_SIZE(tmp_legacy_tp_rate); j++)
 		tmp_legacy_tp_rate[j] = index;
 
-	if (mi->supported[MINSTREL_VHT_GROUP_0])
+	if (mi->supported[MINSTREL_EHT_GROUP_0])
+		group = MINSTREL_EHT_GROUP_0;
+	else if (mi->supported[MINSTREL_HE_GROUP_0])
+		group = MINSTREL_HE_GROUP_0;
+	else if (mi->supported[MINSTREL_VHT_GROUP_0])
 		group = MINSTREL_VHT_GROUP_0;
 	else if (ht_supported)
 		group = MINSTREL_HT_GROUP_0;
@@ -1103,13 +1472,12 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 		tmp_mcs_tp_rate[j] = index;
 
 	/* Find best rate sets within all MCS groups*/
-	for (group = 0; group < ARRAY_SIZE(minstrel_mcs_groups); group++) {
+	for (n = 0; n < mi->n_groups; n++) {
 		u16 *tp_rate = tmp_mcs_tp_rate;
 		u16 last_prob = 0;
 
-		mg = &mi->groups[group];
-		if (!mi->supported[group])
-			continue;
+		group = mi->group_list[n];
+		mg = minstrel_ht_group(mi, group);
 
 		/* (re)Initialize group rate indexes */
 		for(j = 0; j < MAX_THR_RATES; j++)
@@ -1154,11 +1522,9 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 					 tmp_legacy_tp_rate);
 	memcpy(mi->max_tp_rate, tmp_mcs_tp_rate, sizeof(mi->max_tp_rate));
 
-	for (group = 0; group < ARRAY_SIZE(minstrel_mcs_groups); group++) {
-		if (!mi->supported[group])
-			continue;
-
-		mg = &mi->groups[group];
+	for (n = 0; n < mi->n_groups; n++) {
+		group = mi->group_list[n];
+		mg = minstrel_ht_group(mi, group);
 		mg->max_group_prob_rate = MI_RATE(group, 0);
 
 		for (i = 0; i < MCS_GROUP_RATES; i++) {
@@ -1192,6 +1558,7 @@ minstrel_ht_update_stats(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 	mi->last_stats_update = jiffies;
 	mi->sample_time = jiffies;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(minstrel_ht_update_stats);
 
 static bool
 minstrel_ht_txstat_valid(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
@@ -1228,13 +1595,22 @@ minstrel_ht_ri_txstat_valid(struct minstrel_priv *mp,
 			    struct minstrel_ht_sta *mi,
 			    struct ieee80211_rate_status *rate_status)
 {
-	int i;
+	int group, i;
 
 	if (!rate_status)
 		return false;
 	if (!rate_status->try_count)
 		return false;
 
+	/* only account HE/EHT rates that have stats allocated */
+	if (rate_status->rate_idx.flags & (RATE_INFO_FLAGS_HE_MCS |
+					   RATE_INFO_FLAGS_EHT_MCS)) {
+		group = minstrel_he_ri_get_group_idx(&rate_status->rate_idx);
+
+		return group >= 0 &&
+		       (mi->supported[group] & BIT(rate_status->rate_idx.mcs));
+	}
+
 	if (rate_status->rate_idx.flags & RATE_INFO_FLAGS_MCS ||
 	    rate_status->rate_idx.flags & RATE_INFO_FLAGS_VHT_MCS)
 		return true;
@@ -1257,6 +1633,7 @@ minstrel_ht_ri_txstat_valid(struct minstrel_priv *mp,
 static void
 minstrel_downgrade_rate(struct minstrel_ht_sta *mi, u16 *idx, bool primary)
 {
+	struct minstrel_mcs_group_data *mg;
 	int group, orig_group;
 
 	orig_group = group = MI_RATE_GROUP(*idx);
@@ -1270,10 +1647,11 @@ minstrel_downgrade_rate(struct minstrel_ht_sta *mi, u16 *idx, bool primary)
 		    minstrel_mcs_groups[orig_group].streams)
 			continue;
 
+		mg = minstrel_ht_group(mi, group);
 		if (primary)
-			*idx = mi->groups[group].max_group_tp_rate[0];
+			*idx = mg->max_group_tp_rate[0];
 		else
-			*idx = mi->groups[group].max_group_tp_rate[1];
+			*idx = mg->max_group_tp_rate[1];
 		break;
 	}
 }
@@ -1468,7 +1846,8 @@ minstrel_ht_set_rate(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 	else if (group_idx == MINSTREL_OFDM_GROUP)
 		idx = mp->ofdm_rates[mi->band][index %
 					       ARRAY_SIZE(mp->ofdm_rates[0])];
-	else if (flags & IEEE80211_TX_RC_VHT_MCS)
+	else if (flags & (IEEE80211_TX_RC_VHT_MCS | IEEE80211_TX_RC_HE_MCS |
+			  IEEE80211_TX_RC_EHT_MCS))
 		idx = ((group->streams - 1) << 4) |
 		      (index & 0xF);
 	else
@@ -1494,7 +1873,7 @@ minstrel_ht_get_prob_avg(struct minstrel_ht_sta *mi, int rate)
 {
 	int group = MI_RATE_GROUP(rate);
 	rate = MI_RATE_IDX(rate);
-	return mi->groups[group].rates[rate].prob_avg;
+	return minstrel_ht_rate_stats(mi, group, rate)->prob_avg;
 }
 
 static int
@@ -1506,7 +1885,8 @@ minstrel_ht_get_max_amsdu_len(struct minstrel_ht_sta *mi)
 	unsigned int duration;
 
 	/* Disable A-MSDU if max_prob_rate is bad */
-	if (mi->groups[group].rates[rate].prob_avg < MINSTREL_FRAC(50, 100))
+	if (minstrel_ht_get_prob_avg(mi, mi->max_prob_rate) <
+	    MINSTREL_FRAC(50, 100))
 		return 1;
 
 	duration = g->duration[rate];
@@ -1539,7 +1919,8 @@ minstrel_ht_get_max_amsdu_len(struct minstrel_ht_sta *mi)
 	 * the limit here to avoid the complexity of having to de-aggregate
 	 * packets in the queue.
 	 */
-	if (!mi->sta->deflink.vht_cap.vht_supported)
+	if (!mi->sta->deflink.vht_cap.vht_supported &&
+	    !mi->sta->deflink.he_cap.has_he)
 		return IEEE80211_MAX_MPDU_LEN_HT_BA;
 
 	/* unlimited */
@@ -1550,19 +1931,28 @@ static void
 minstrel_ht_update_rates(struct minstrel_priv *mp, struct minstrel_ht_sta *mi)
 {
 	struct ieee80211_sta_rates *rates;
-	int i = 0;
+	int i = 0, j = 1;
 	int max_rates = min_t(int, mp->hw->max_rates, IEEE80211_TX_RATE_TABLE_SIZE);
 
 	rates = kzalloc(sizeof(*rates), GFP_ATOMIC);
 	if (!rates)
 		return;
 
+	/* Probe a HE/EHT sample rate once before falling back to the others */
+	if (mi->sample_rate && max_rates > 1) {
+		minstrel_ht_set_rate(mp, mi, rates, i, mi->sample_rate);
+		rates->rate[i].count = 1;
+		rates->rate[i].count_cts = 1;
+		rates->rate[i].count_rts = 1;
+		i++;
+	}
+
 	/* Start with max_tp_rate[0] */
 	minstrel_ht_set_rate(mp, mi, rates, i++, mi->max_tp_rate[0]);
 
 	/* Fill up remaining, keep one entry for max_probe_rate */
 	for (; i < (max_rates - 1); i++)
-		minstrel_ht_set_rate(mp, mi, rates, i, mi->max_tp_rate[i]);
+		minstrel_ht_set_rate(mp, mi, rates, i, mi->max_tp_rate[j++]);
 
 	if (i < max_rates)
 		minstrel_ht_set_rate(mp, mi, rates, i++, mi->max_prob_rate);
@@ -1591,6 +1981,31 @@ minstrel_ht_get_sample_rate(struct minstrel_priv *mp, struct minstrel_ht_sta *mi
 	return __minstrel_ht_get_sample_rate(mi, seq);
 }
 
+/*
+ * HE/EHT rates don't fit into the tx_info rate array, so they are probed by
+ * putting them at the head of the rate table until the next sampling attempt.
+ * Returns true if @sample_idx was handled that way.
+ */
+static bool
+minstrel_ht_table_sample(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
+			 u16 sample_idx)
+{
+	if (!sample_idx || !minstrel_ht_is_he_group(MI_RATE_GROUP(sample_idx))) {
+		if (mi->sample_rate) {
+			mi->sample_rate = 0;
+			minstrel_ht_update_rates(mp, mi);
+		}
+		return false;
+	}
+
+	if (mp->hw->max_rates > 1 && mi->sample_rate != sample_idx) {
+		mi->sample_rate = sample_idx;
+		minstrel_ht_update_rates(mp, mi);
+	}
+
+	return true;
+}
+
 static void
 minstrel_ht_get_rate(void *priv, struct ieee80211_sta *sta, void *priv_sta,
                      struct ieee80211_tx_rate_control *txrc)
@@ -1619,7 +2034,7 @@ minstrel_ht_get_rate(void *priv, struct ieee80211_sta *sta, void *priv_sta,
 
 	mi->sample_time = jiffies + MINSTREL_SAMPLE_INTERVAL;
 	sample_idx = minstrel_ht_get_sample_rate(mp, mi);
-	if (!sample_idx)
+	if (minstrel_ht_table_sample(mp, mi, sample_idx) || !sample_idx)
 		return;
 
 	sample_group = &minstrel_mcs_groups[MI_RATE_GROUP(sample_idx)];
@@ -1694,6 +2109,65 @@ minstrel_ht_update_ofdm(struct minstrel_priv *mp, struct minstrel_ht_sta *mi,
 	}
 }
 
+/*
+ * Rebuild the list of supported groups from mi->supported and resize the
+ * group statistics to match, resetting all of them. If the allocation
+ * fails and the old array is too small, the groups that don't fit are
+ * marked as unsupported.
+ *
+ * A replaced array is freed after a grace period, lockless readers may
+ * still look at it. The slot map lives in the same allocation, so they
+ * never index past the end of the array they got.
+ */
+VISIBLE_IF_MAC80211_KUNIT int
+minstrel_ht_update_groups(struct minstrel_ht_sta *mi, gfp_t gfp)
+{
+	struct minstrel_ht_groups *groups, *old = NULL, *new;
+	int i, n_groups = 0;
+
+	for (i = 0; i < ARRAY_SIZE(mi->supported); i++)
+		if (mi->supported[i])
+			n_groups++;
+
+	groups = rcu_dereference_protected(mi->groups, true);
+
+	/* avoid reallocating for small changes, e.g. bandwidth updates */
+	if (n_groups > mi->max_groups || n_groups < mi->max_groups / 2) {
+		new = kzalloc(struct_size(new, data, n_groups + 1), gfp);
+		if (new) {
+			old = groups;
+			groups = new;
+			mi->max_groups = n_groups;
+		}
+	}
+
+	memset(groups->data, 0,
+	       (mi->max_groups + 1) * sizeof(groups->data[0]));
+	memset(groups->slot, 0, sizeof(groups->slot));
+	mi->n_groups = 0;
+
+	for (i = 0; i < ARRAY_SIZE(mi->supported); i++) {
+		if (!mi->supported[i])
+			continue;
+
+		if (mi->n_groups == mi->max_groups) {
+			mi->supported[i] = 0;
+			continue;
+		}
+
+		mi->group_list[mi->n_groups++] = i;
+		groups->slot[i] = mi->n_groups;
+	}
+
+	if (old) {
+		rcu_assign_pointer(mi->groups, groups);
+		kfree_rcu(old, rcu_head);
+	}
+
+	return n_groups > mi->max_groups ? -ENOMEM : 0;
+}
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(minstrel_ht_update_groups);
+
 static void
 minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 			struct cfg80211_chan_def *chandef,
@@ -1704,8 +2178,10 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 	struct ieee80211_mcs_info *mcs = &sta->deflink.ht_cap.mcs;
 	u16 ht_cap = sta->deflink.ht_cap.cap;
 	struct ieee80211_sta_vht_cap *vht_cap = &sta->deflink.vht_cap;
+	struct ieee80211_sta_he_cap *he_cap = &sta->deflink.he_cap;
 	const struct ieee80211_rate *ctl_rate;
 	struct sta_info *sta_info;
+	bool use_he, use_eht;
 	bool ldpc, erp;
 	int use_vht;
 	int ack_dur;
@@ -1713,13 +2189,19 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 	int i;
 
 	BUILD_BUG_ON(ARRAY_SIZE(minstrel_mcs_groups) != MINSTREL_GROUPS_NB);
+	BUILD_BUG_ON(MINSTREL_GROUPS_NB > U8_MAX);
 
 	if (vht_cap->vht_supported)
 		use_vht = vht_cap->vht_mcs.tx_mcs_map != cpu_to_le16(~0);
 	else
 		use_vht = 0;
 
-	memset(mi, 0, sizeof(*mi));
+	use_he = ieee80211_hw_check(mp->hw, SUPPORTS_HE_RC_TABLE) &&
+		 he_cap->has_he;
+	use_eht = use_he && sta->deflink.eht_cap.has_eht;
+
+	/* the group statistics are reset by minstrel_ht_update_groups() */
+	memset(mi, 0, offsetof(struct minstrel_ht_sta, max_groups));
 
 	mi->sta = sta;
 	mi->band = sband->band;
@@ -1751,11 +2233,16 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 		ldpc = vht_cap->cap & IEEE80211_VHT_CAP_RXLDPC;
 	}
 
+	if (use_he &&
+	    (he_cap->he_cap_elem.phy_cap_info[1] &
+	     IEEE80211_HE_PHY_CAP1_LDPC_CODING_IN_PAYLOAD))
+		ldpc = true;
+
 	mi->tx_flags |= stbc << IEEE80211_TX_CTL_STBC_SHIFT;
 	if (ldpc)
 		mi->tx_flags |= IEEE80211_TX_CTL_LDPC;
 
-	for (i = 0; i < ARRAY_SIZE(mi->groups); i++) {
+	for (i = 0; i < ARRAY_SIZE(mi->supported); i++) {
 		u32 gflags = minstrel_mcs_groups[i].flags;
 		int bw, nss;
 
@@ -1785,13 +2272,33 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 
 		/* HT rate */
 		if (gflags & IEEE80211_TX_RC_MCS) {
-			if (use_vht && minstrel_vht_only)
+			if ((use_vht || use_he) && minstrel_vht_only)
 				continue;
 
 			mi->supported[i] = mcs->rx_mask[nss - 1];
 			continue;
 		}
 
+		/* HE/EHT rate */
+		if (minstrel_ht_is_he_group(i)) {
+			bw = minstrel_mcs_groups[i].bw;
+			if (!use_he || bw > sta->deflink.bandwidth)
+				continue;
+
+			if (gflags & IEEE80211_TX_RC_EHT_MCS) {
+				if (use_eht)
+					mi->supported[i] =
+						minstrel_get_valid_eht_rates(sta, bw, nss);
+			} else if (!use_eht || !minstrel_vht_only) {
+				mi->supported[i] =
+					minstrel_get_valid_he_rates(sta, bw, nss);
+			}
+			continue;
+		}
+
+		if (use_he && minstrel_vht_only)
+			continue;
+
 		/* VHT rate */
 		if (!vht_cap->vht_supported ||
 		    WARN_ON(!(gflags & IEEE80211_TX_RC_VHT_MCS)) ||
@@ -1824,6 +2331,9 @@ minstrel_ht_update_caps(void *priv, struct ieee80211_supported_band *sband,
 	minstrel_ht_update_cck(mp, mi, sband, sta);
 	minstrel_ht_update_ofdm(mp, mi, sband, sta);
 
+	/* called under the rate control lock, can't sleep */
+	minstrel_ht_update_groups(mi, GFP_ATOMIC);
+
 	/* create an initial rate table with the lowest supported rates */
 	minstrel_ht_update_stats(mp, mi);
 	minstrel_ht_update_rates(mp, mi);
@@ -1850,6 +2360,7 @@ static void *
 minstrel_ht_alloc_sta(void *priv, struct ieee80211_sta *sta, gfp_t gfp)
 {
 	struct ieee80211_supported_band *sband;
+	struct minstrel_ht_groups *groups;
 	struct minstrel_ht_sta *mi;
 	struct minstrel_priv *mp = priv;
 	struct ieee80211_hw *hw = mp->hw;
@@ -1862,13 +2373,33 @@ minstrel_ht_alloc_sta(void *priv, struct ieee80211_sta *sta, gfp_t gfp)
 			max_rates = sband->n_bitrates;
 	}
 
-	return kzalloc(sizeof(*mi), gfp);
+	mi = kzalloc(sizeof(*mi), gfp);
+	if (!mi)
+		return NULL;
+
+	/* enough for the legacy groups, resized once the caps are known */
+	groups = kzalloc(struct_size(groups, data,
+				     MINSTREL_LEGACY_GROUPS_NB + 1), gfp);
+	if (!groups) {
+		kfree(mi);
+		return NULL;
+	}
+
+	RCU_INIT_POINTER(mi->groups, groups);
+
+	mi->max_groups = MINSTREL_LEGACY_GROUPS_NB;
+	mi->sta = sta;
+
+	return mi;
 }
 
 static void
 minstrel_ht_free_sta(void *priv, struct ieee80211_sta *sta, void *priv_sta)
 {
-	kfree(priv_sta);
+	struct minstrel_ht_sta *mi = priv_sta;
+
+	kfree(rcu_dereference_protected(mi->groups, true));
+	kfree(mi);
 }
 
 static void
@@ -1991,7 +2522,11 @@ static u32 minstrel_ht_get_expected_throughput(void *priv_sta)
 
 	i = MI_RATE_GROUP(mi->max_tp_rate[0]);
 	j = MI_RATE_IDX(mi->max_tp_rate[0]);
-	prob = mi->groups[i].rates[j].prob_avg;
+
+	/* called without the rate control lock */
+	rcu_read_lock();
+	prob = minstrel_ht_rate_stats(mi, i, j)->prob_avg;
+	rcu_read_unlock();
 
 	/* convert tp_avg from pkt per second in kbps */
 	tp_avg = minstrel_ht_get_tp_avg(mi, i, j, prob) * 10;
@@ -42,22 +42,32 @@
 #define MINSTREL_MAX_STREAMS		4
 #define MINSTREL_HT_STREAM_GROUPS	4 /* BW(=2) * SGI(=2) */
 #define MINSTREL_VHT_STREAM_GROUPS	6 /* BW(=3) * SGI(=2) */
+#define MINSTREL_HE_STREAM_GROUPS	12 /* BW(=4) * GI(=3) */
+#define MINSTREL_EHT_STREAM_GROUPS	15 /* BW(=5) * GI(=3) */
 
 #define MINSTREL_HT_GROUPS_NB	(MINSTREL_MAX_STREAMS *		\
 				 MINSTREL_HT_STREAM_GROUPS)
 #define MINSTREL_VHT_GROUPS_NB	(MINSTREL_MAX_STREAMS *		\
 				 MINSTREL_VHT_STREAM_GROUPS)
+#define MINSTREL_HE_GROUPS_NB	(MINSTREL_MAX_STREAMS *		\
+				 MINSTREL_HE_STREAM_GROUPS)
+#define MINSTREL_EHT_GROUPS_NB	(MINSTREL_MAX_STREAMS *		\
+				 MINSTREL_EHT_STREAM_GROUPS)
 #define MINSTREL_LEGACY_GROUPS_NB	2
 #define MINSTREL_GROUPS_NB	(MINSTREL_HT_GROUPS_NB +	\
 				 MINSTREL_VHT_GROUPS_NB +	\
+				 MINSTREL_HE_GROUPS_NB +	\
+				 MINSTREL_EHT_GROUPS_NB +	\
 				 MINSTREL_LEGACY_GROUPS_NB)
 
 #define MINSTREL_HT_GROUP_0	0
 #define MINSTREL_CCK_GROUP	(MINSTREL_HT_GROUP_0 + MINSTREL_HT_GROUPS_NB)
 #define MINSTREL_OFDM_GROUP	(MINSTREL_CCK_GROUP + 1)
 #define MINSTREL_VHT_GROUP_0	(MINSTREL_OFDM_GROUP + 1)
+#define MINSTREL_HE_GROUP_0	(MINSTREL_VHT_GROUP_0 + MINSTREL_VHT_GROUPS_NB)
+#define MINSTREL_EHT_GROUP_0	(MINSTREL_HE_GROUP_0 + MINSTREL_HE_GROUPS_NB)
 
-#define MCS_GROUP_RATES		10
+#define MCS_GROUP_RATES		14
 
 #define MI_RATE_IDX_MASK	GENMASK(3, 0)
 #define MI_RATE_GROUP_MASK	GENMASK(15, 4)
@@ -145,7 +155,22 @@ struct minstrel_mcs_group_data {
 	struct minstrel_rate_stats rates[MCS_GROUP_RATES];
 };
 
+/*
+ * Only supported groups have statistics allocated. slot maps every group
+ * to its entry in data[], unsupported groups share the entry at slot 0.
+ * Tx status for rates outside the supported set ends up there, but it is
+ * never used for rate selection.
+ */
+struct minstrel_ht_groups {
+	struct rcu_head rcu_head;
+	u8 slot[MINSTREL_GROUPS_NB];
+
+	/* MCS rate group info and statistics */
+	struct minstrel_mcs_group_data data[];
+};
+
 struct minstrel_sample_category {
+	/* position in group_list of the last group that was sampled */
 	u8 sample_group;
 	u16 sample_rates[MINSTREL_SAMPLE_RATES];
 	u16 cur_sample_rates[MINSTREL_SAMPLE_RATES];
@@ -183,6 +208,8 @@ struct minstrel_ht_sta {
 	u8 band;
 
 	u8 sample_seq;
+
+	/* HE/EHT rate being probed through the rate table */
 	u16 sample_rate;
 
 	unsigned long sample_time;
@@ -191,12 +218,43 @@ struct minstrel_ht_sta {
 	/* Bitfield of supported MCS rates of all groups */
 	u16 supported[MINSTREL_GROUPS_NB];
 
-	/* MCS rate group info and statistics */
-	struct minstrel_mcs_group_data groups[MINSTREL_GROUPS_NB];
+	/* supported groups in ascending order */
+	u8 group_list[MINSTREL_GROUPS_NB];
+	u8 n_groups;
+
+	/*
+	 * Kept across capability updates. groups has max_groups + 1
+	 * entries, it is replaced under sta->rate_ctrl_lock and freed
+	 * after a grace period, since the expected throughput and the
+	 * tx path read it under the RCU read lock only.
+	 */
+	u8 max_groups;
+	struct minstrel_ht_groups __rcu *groups;
 };
 
+/* callers hold either sta->rate_ctrl_lock or the RCU read lock */
+static inline struct minstrel_mcs_group_data *
+minstrel_ht_group(struct minstrel_ht_sta *mi, int group)
+{
+	struct minstrel_ht_groups *groups = rcu_dereference_raw(mi->groups);
+
+	return &groups->data[groups->slot[group]];
+}
+
+static inline struct minstrel_rate_stats *
+minstrel_ht_rate_stats(struct minstrel_ht_sta *mi, int group, int idx)
+{
+	return &minstrel_ht_group(mi, group)->rates[idx];
+}
+
 void minstrel_ht_add_sta_debugfs(void *priv, void *priv_sta, struct dentry *dir);
 int minstrel_ht_get_tp_avg(struct minstrel_ht_sta *mi, int group, int rate,
 			   int prob_avg);
 
+#if IS_ENABLED(CPTCFG_MAC80211_KUNIT_TEST)
+int minstrel_ht_update_groups(struct minstrel_ht_sta *mi, gfp_t gfp);
+void minstrel_ht_update_stats(struct minstrel_priv *mp,
+			      struct minstrel_ht_sta *mi);
+#endif
+
 #endif
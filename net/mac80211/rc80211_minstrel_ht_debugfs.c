@@ -9,6 +9,7 @@
 #include <linux/ieee80211.h>
 #include <linux/export.h>
 #include <net/mac80211.h>
+#include "rate.h"
 #include "rc80211_minstrel_ht.h"
 
 struct minstrel_debugfs_info {
@@ -28,10 +29,77 @@ minstrel_stats_read(struct file *file, char __user *buf, size_t len, loff_t *ppo
 static int
 minstrel_stats_release(struct inode *inode, struct file *file)
 {
-	kfree(file->private_data);
+	kvfree(file->private_data);
 	return 0;
 }
 
+/* HE/EHT stations can have far more rates than fit into a fixed buffer */
+static size_t
+minstrel_ht_stats_size(struct minstrel_ht_sta *mi)
+{
+	unsigned int i, n_rates = 0;
+
+	for (i = 0; i < MINSTREL_GROUPS_NB; i++)
+		n_rates += hweight16(mi->supported[i]);
+
+	return sizeof(struct minstrel_debugfs_info) + 1024 + n_rates * 192;
+}
+
+/*
+ * Allocate the output buffer and lock the station rate control state.
+ * The supported groups can change until the lock is held, so retry if
+ * the buffer turns out to be too small.
+ */
+static struct minstrel_debugfs_info *
+minstrel_ht_stats_lock(struct minstrel_ht_sta *mi, size_t *size)
+{
+	struct sta_info *sta = container_of(mi->sta, struct sta_info, sta);
+	struct minstrel_debugfs_info *ms;
+
+	for (;;) {
+		*size = minstrel_ht_stats_size(mi);
+		ms = kvmalloc(*size, GFP_KERNEL);
+		if (!ms)
+			return NULL;
+
+		spin_lock_bh(&sta->rate_ctrl_lock);
+		if (minstrel_ht_stats_size(mi) <= *size)
+			return ms;
+
+		spin_unlock_bh(&sta->rate_ctrl_lock);
+		kvfree(ms);
+	}
+}
+
+static void
+minstrel_ht_stats_unlock(struct minstrel_ht_sta *mi)
+{
+	struct sta_info *sta = container_of(mi->sta, struct sta_info, sta);
+
+	spin_unlock_bh(&sta->rate_ctrl_lock);
+}
+
+static const char *
+minstrel_ht_he_mode(const struct mcs_group *mg)
+{
+	static const char * const modes[] = {
+		"HE20", "HE40", "HE80", "HE160", "HE320",
+		"EHT20", "EHT40", "EHT80", "EHT160", "EHT320",
+	};
+
+	return modes[(mg->flags & IEEE80211_TX_RC_EHT_MCS ? 5 : 0) + mg->bw];
+}
+
+static const char *
+minstrel_ht_he_gi(const struct mcs_group *mg)
+{
+	if (mg->flags & IEEE80211_TX_RC_GI_3_2)
+		return "3.2";
+	if (mg->flags & IEEE80211_TX_RC_GI_1_6)
+		return "1.6";
+	return "0.8";
+}
+
 static bool
 minstrel_ht_is_sample_rate(struct minstrel_ht_sta *mi, int idx)
 {
@@ -67,7 +135,8 @@ minstrel_ht_stats_dump(struct minstrel_ht_sta *mi, int i, char *p)
 		gimode = 'S';
 
 	for (j = 0; j < MCS_GROUP_RATES; j++) {
-		struct minstrel_rate_stats *mrs = &mi->groups[i].rates[j];
+		struct minstrel_rate_stats *mrs =
+			minstrel_ht_rate_stats(mi, i, j);
 		int idx = MI_RATE(i, j);
 		unsigned int duration;
 
@@ -78,6 +147,11 @@ minstrel_ht_stats_dump(struct minstrel_ht_sta *mi, int i, char *p)
 			p += sprintf(p, "HT%c0  ", htmode);
 			p += sprintf(p, "%cGI  ", gimode);
 			p += sprintf(p, "%d  ", mg->streams);
+		} else if (gflags & (IEEE80211_TX_RC_HE_MCS |
+				     IEEE80211_TX_RC_EHT_MCS)) {
+			p += sprintf(p, "%-6s ", minstrel_ht_he_mode(mg));
+			p += sprintf(p, "%s ", minstrel_ht_he_gi(mg));
+			p += sprintf(p, "%d  ", mg->streams);
 		} else if (gflags & IEEE80211_TX_RC_VHT_MCS) {
 			p += sprintf(p, "VHT%c0 ", htmode);
 			p += sprintf(p, "%cGI ", gimode);
@@ -100,7 +174,9 @@ minstrel_ht_stats_dump(struct minstrel_ht_sta *mi, int i, char *p)
 
 		if (gflags & IEEE80211_TX_RC_MCS) {
 			p += sprintf(p, "  MCS%-2u", (mg->streams - 1) * 8 + j);
-		} else if (gflags & IEEE80211_TX_RC_VHT_MCS) {
+		} else if (gflags & (IEEE80211_TX_RC_VHT_MCS |
+				     IEEE80211_TX_RC_HE_MCS |
+				     IEEE80211_TX_RC_EHT_MCS)) {
 			p += sprintf(p, "  MCS%-1u/%1u", j, mg->streams);
 		} else {
 			int r;
@@ -147,9 +223,10 @@ minstrel_ht_stats_open(struct inode *inode, struct file *file)
 	struct minstrel_ht_sta *mi = inode->i_private;
 	struct minstrel_debugfs_info *ms;
 	unsigned int i;
+	size_t size;
 	char *p;
 
-	ms = kmalloc(32768, GFP_KERNEL);
+	ms = minstrel_ht_stats_lock(mi, &size);
 	if (!ms)
 		return -ENOMEM;
 
@@ -163,10 +240,9 @@ minstrel_ht_stats_open(struct inode *inode, struct file *file)
 		     "mode guard #  rate   [name   idx airtime  max_tp]  [avg(tp) avg(prob)]  [retry|suc|att]  [#success | #attempts]\n");
 
 	p = minstrel_ht_stats_dump(mi, MINSTREL_CCK_GROUP, p);
-	for (i = 0; i < MINSTREL_CCK_GROUP; i++)
-		p = minstrel_ht_stats_dump(mi, i, p);
-	for (i++; i < ARRAY_SIZE(mi->groups); i++)
-		p = minstrel_ht_stats_dump(mi, i, p);
+	for (i = 0; i < mi->n_groups; i++)
+		if (mi->group_list[i] != MINSTREL_CCK_GROUP)
+			p = minstrel_ht_stats_dump(mi, mi->group_list[i], p);
 
 	p += sprintf(p, "\nTotal packet count::    ideal %d      "
 			"lookaround %d\n",
@@ -176,8 +252,10 @@ minstrel_ht_stats_open(struct inode *inode, struct file *file)
 		p += sprintf(p, "Average # of aggregated frames per A-MPDU: %d.%d\n",
 			MINSTREL_TRUNC(mi->avg_ampdu_len),
 			MINSTREL_TRUNC(mi->avg_ampdu_len * 10) % 10);
+	minstrel_ht_stats_unlock(mi);
+
 	ms->len = p - ms->buf;
-	WARN_ON(ms->len + sizeof(*ms) > 32768);
+	WARN_ON(ms->len + sizeof(*ms) > size);
 
 	return nonseekable_open(inode, file);
 }
@@ -213,7 +291,8 @@ minstrel_ht_stats_csv_dump(struct minstrel_ht_sta *mi, int i, char *p)
 		gimode = 'S';
 
 	for (j = 0; j < MCS_GROUP_RATES; j++) {
-		struct minstrel_rate_stats *mrs = &mi->groups[i].rates[j];
+		struct minstrel_rate_stats *mrs =
+			minstrel_ht_rate_stats(mi, i, j);
 		int idx = MI_RATE(i, j);
 		unsigned int duration;
 
@@ -224,6 +303,11 @@ minstrel_ht_stats_csv_dump(struct minstrel_ht_sta *mi, int i, char *p)
 			p += sprintf(p, "HT%c0,", htmode);
 			p += sprintf(p, "%cGI,", gimode);
 			p += sprintf(p, "%d,", mg->streams);
+		} else if (gflags & (IEEE80211_TX_RC_HE_MCS |
+				     IEEE80211_TX_RC_EHT_MCS)) {
+			p += sprintf(p, "%s,", minstrel_ht_he_mode(mg));
+			p += sprintf(p, "%s,", minstrel_ht_he_gi(mg));
+			p += sprintf(p, "%d,", mg->streams);
 		} else if (gflags & IEEE80211_TX_RC_VHT_MCS) {
 			p += sprintf(p, "VHT%c0,", htmode);
 			p += sprintf(p, "%cGI,", gimode);
@@ -245,7 +329,9 @@ minstrel_ht_stats_csv_dump(struct minstrel_ht_sta *mi, int i, char *p)
 
 		if (gflags & IEEE80211_TX_RC_MCS) {
 			p += sprintf(p, ",MCS%-2u,", (mg->streams - 1) * 8 + j);
-		} else if (gflags & IEEE80211_TX_RC_VHT_MCS) {
+		} else if (gflags & (IEEE80211_TX_RC_VHT_MCS |
+				     IEEE80211_TX_RC_HE_MCS |
+				     IEEE80211_TX_RC_EHT_MCS)) {
 			p += sprintf(p, ",MCS%-1u/%1u,", j, mg->streams);
 		} else {
 			int r;
@@ -296,9 +382,10 @@ minstrel_ht_stats_csv_open(struct inode *inode, struct file *file)
 	struct minstrel_ht_sta *mi = inode->i_private;
 	struct minstrel_debugfs_info *ms;
 	unsigned int i;
+	size_t size;
 	char *p;
 
-	ms = kmalloc(32768, GFP_KERNEL);
+	ms = minstrel_ht_stats_lock(mi, &size);
 	if (!ms)
 		return -ENOMEM;
 
@@ -307,13 +394,13 @@ minstrel_ht_stats_csv_open(struct inode *inode, struct file *file)
 	p = ms->buf;
 
 	p = minstrel_ht_stats_csv_dump(mi, MINSTREL_CCK_GROUP, p);
-	for (i = 0; i < MINSTREL_CCK_GROUP; i++)
-		p = minstrel_ht_stats_csv_dump(mi, i, p);
-	for (i++; i < ARRAY_SIZE(mi->groups); i++)
-		p = minstrel_ht_stats_csv_dump(mi, i, p);
+	for (i = 0; i < mi->n_groups; i++)
+		if (mi->group_list[i] != MINSTREL_CCK_GROUP)
+			p = minstrel_ht_stats_csv_dump(mi, mi->group_list[i], p);
+	minstrel_ht_stats_unlock(mi);
 
 	ms->len = p - ms->buf;
-	WARN_ON(ms->len + sizeof(*ms) > 32768);
+	WARN_ON(ms->len + sizeof(*ms) > size);
 
 	return nonseekable_open(inode, file);
 }
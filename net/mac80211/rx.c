@@ -1107,6 +1107,51 @@ static inline bool ieee80211_rx_reorder_ready(struct tid_ampdu_rx *tid_agg_rx,
 	return true;
 }
 
+/*
+ * Find the first reorder buffer slot at or after @start (wrapping around)
+ * that either holds frames or is marked as filtered, returns -1 if there
+ * is no such slot.
+ */
+static int ieee80211_rx_reorder_next_used(struct tid_ampdu_rx *tid_agg_rx,
+					  int start)
+{
+	unsigned long *used = tid_agg_rx->reorder_buf_used;
+	int size = tid_agg_rx->reorder_buf_mask + 1;
+	int i, index;
+
+	/*
+	 * The filtered bitmap is only used by drivers with at most 64
+	 * frames in the window, just check slot by slot in that case.
+	 */
+	if (unlikely(tid_agg_rx->reorder_buf_filtered)) {
+		for (i = 0; i < size; i++) {
+			index = (start + i) & tid_agg_rx->reorder_buf_mask;
+			if (test_bit(index, used) ||
+			    (index < 64 &&
+			     tid_agg_rx->reorder_buf_filtered & BIT_ULL(index)))
+				return index;
+		}
+		return -1;
+	}
+
+	index = find_next_bit(used, size, start);
+	if (index < size)
+		return index;
+
+	index = find_first_bit(used, start);
+	if (index < start)
+		return index;
+
+	return -1;
+}
+
+static void ieee80211_rx_reorder_purge(struct tid_ampdu_rx *tid_agg_rx,
+				       int index)
+{
+	__skb_queue_purge(&tid_agg_rx->reorder_buf[index]);
+	__clear_bit(index, tid_agg_rx->reorder_buf_used);
+}
+
 static void ieee80211_release_reorder_frame(struct ieee80211_sub_if_data *sdata,
 					    struct tid_ampdu_rx *tid_agg_rx,
 					    int index,
@@ -1122,7 +1167,7 @@ static void ieee80211_release_reorder_frame(struct ieee80211_sub_if_data *sdata,
 		goto no_frame;
 
 	if (!ieee80211_rx_reorder_ready(tid_agg_rx, index)) {
-		__skb_queue_purge(skb_list);
+		ieee80211_rx_reorder_purge(tid_agg_rx, index);
 		goto no_frame;
 	}
 
@@ -1133,6 +1178,7 @@ static void ieee80211_release_reorder_frame(struct ieee80211_sub_if_data *sdata,
 		status->rx_flags |= IEEE80211_RX_DEFERRED_RELEASE;
 		__skb_queue_tail(frames, skb);
 	}
+	__clear_bit(index, tid_agg_rx->reorder_buf_used);
 
 no_frame:
 	if (tid_agg_rx->reorder_buf_filtered)
@@ -1145,14 +1191,35 @@ static void ieee80211_release_reorder_frames(struct ieee80211_sub_if_data *sdata
 					     u16 head_seq_num,
 					     struct sk_buff_head *frames)
 {
-	int index;
+	u16 mask = tid_agg_rx->reorder_buf_mask;
+	int index, next, skip;
 
 	lockdep_assert_held(&tid_agg_rx->reorder_lock);
 
 	while (ieee80211_sn_less(tid_agg_rx->head_seq_num, head_seq_num)) {
-		index = tid_agg_rx->head_seq_num % tid_agg_rx->buf_size;
-		ieee80211_release_reorder_frame(sdata, tid_agg_rx, index,
-						frames);
+		index = tid_agg_rx->head_seq_num & mask;
+
+		if (ieee80211_rx_reorder_ready(tid_agg_rx, index) ||
+		    test_bit(index, tid_agg_rx->reorder_buf_used)) {
+			ieee80211_release_reorder_frame(sdata, tid_agg_rx,
+							index, frames);
+			continue;
+		}
+
+		/*
+		 * Move the head over the whole hole at once, the ring size
+		 * divides the SN space so slot distance equals SN distance.
+		 */
+		next = ieee80211_rx_reorder_next_used(tid_agg_rx, index);
+		if (next < 0)
+			skip = mask + 1;
+		else
+			skip = (next - index) & mask;
+		skip = min_t(int, skip,
+			     ieee80211_sn_sub(head_seq_num,
+					      tid_agg_rx->head_seq_num));
+		tid_agg_rx->head_seq_num =
+			(tid_agg_rx->head_seq_num + skip) & IEEE80211_SN_MASK;
 	}
 }
 
@@ -1171,21 +1238,33 @@ static void ieee80211_sta_reorder_release(struct ieee80211_sub_if_data *sdata,
 					  struct tid_ampdu_rx *tid_agg_rx,
 					  struct sk_buff_head *frames)
 {
+	u16 mask = tid_agg_rx->reorder_buf_mask;
 	int index, i, j;
 
 	lockdep_assert_held(&tid_agg_rx->reorder_lock);
 
 	/* release the buffer until next missing frame */
-	index = tid_agg_rx->head_seq_num % tid_agg_rx->buf_size;
+	index = tid_agg_rx->head_seq_num & mask;
 	if (!ieee80211_rx_reorder_ready(tid_agg_rx, index) &&
 	    tid_agg_rx->stored_mpdu_num) {
 		/*
 		 * No buffers ready to be released, but check whether any
-		 * frames in the reorder buffer have timed out.
+		 * frames in the reorder buffer have timed out. Only slots
+		 * that hold frames are visited, offsets are relative to
+		 * the original head.
 		 */
-		int skipped = 1;
-		for (j = (index + 1) % tid_agg_rx->buf_size; j != index;
-		     j = (j + 1) % tid_agg_rx->buf_size) {
+		int skipped = 1, offs = 0, released = 0, next;
+
+		while ((j = ieee80211_rx_reorder_next_used(tid_agg_rx,
+							   (index + offs + 1) &
+							   mask)) >= 0) {
+			next = (j - index) & mask;
+			if (next <= offs)
+				break;
+
+			skipped += next - offs - 1;
+			offs = next;
+
 			if (!ieee80211_rx_reorder_ready(tid_agg_rx, j)) {
 				skipped++;
 				continue;
@@ -1196,9 +1275,13 @@ static void ieee80211_sta_reorder_release(struct ieee80211_sub_if_data *sdata,
 				goto set_release_timer;
 
 			/* don't leave incomplete A-MSDUs around */
-			for (i = (index + 1) % tid_agg_rx->buf_size; i != j;
-			     i = (i + 1) % tid_agg_rx->buf_size)
-				__skb_queue_purge(&tid_agg_rx->reorder_buf[i]);
+			for (i = released + 1; i < offs; i++) {
+				int purge = (index + i) & mask;
+
+				if (test_bit(purge, tid_agg_rx->reorder_buf_used))
+					ieee80211_rx_reorder_purge(tid_agg_rx,
+								   purge);
+			}
 
 			ht_dbg_ratelimited(sdata,
 					   "release an RX reorder frame due to timeout on earlier frames\n");
@@ -1212,21 +1295,36 @@ static void ieee80211_sta_reorder_release(struct ieee80211_sub_if_data *sdata,
 				(tid_agg_rx->head_seq_num +
 				 skipped) & IEEE80211_SN_MASK;
 			skipped = 0;
+			released = offs;
 		}
 	} else while (ieee80211_rx_reorder_ready(tid_agg_rx, index)) {
 		ieee80211_release_reorder_frame(sdata, tid_agg_rx, index,
 						frames);
-		index =	tid_agg_rx->head_seq_num % tid_agg_rx->buf_size;
+		index =	tid_agg_rx->head_seq_num & mask;
 	}
 
 	if (tid_agg_rx->stored_mpdu_num) {
-		j = index = tid_agg_rx->head_seq_num % tid_agg_rx->buf_size;
+		index = tid_agg_rx->head_seq_num & mask;
+
+		/* find the first complete frame to arm the timer for */
+		for (i = 0, j = -1; i <= mask; i++) {
+			int next, offs;
 
-		for (; j != (index - 1) % tid_agg_rx->buf_size;
-		     j = (j + 1) % tid_agg_rx->buf_size) {
-			if (ieee80211_rx_reorder_ready(tid_agg_rx, j))
+			next = ieee80211_rx_reorder_next_used(tid_agg_rx,
+							      (index + i) & mask);
+			if (next < 0)
 				break;
+			offs = (next - index) & mask;
+			if (offs < i)
+				break;
+			if (ieee80211_rx_reorder_ready(tid_agg_rx, next)) {
+				j = next;
+				break;
+			}
+			i = offs;
 		}
+		if (WARN_ON_ONCE(j < 0))
+			j = index;
 
  set_release_timer:
 
@@ -1304,7 +1402,7 @@ static bool ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata
 
 	/* Now the new frame is always in the range of the reordering buffer */
 
-	index = mpdu_seq_num % tid_agg_rx->buf_size;
+	index = mpdu_seq_num & tid_agg_rx->reorder_buf_mask;
 
 	/* check if we already stored this frame */
 	if (ieee80211_rx_reorder_ready(tid_agg_rx, index)) {
@@ -1329,6 +1427,7 @@ static bool ieee80211_sta_manage_reorder_buf(struct ieee80211_sub_if_data *sdata
 
 	/* put the frame in the reordering buffer */
 	__skb_queue_tail(&tid_agg_rx->reorder_buf[index], skb);
+	__set_bit(index, tid_agg_rx->reorder_buf_used);
 	if (!(status->flag & RX_FLAG_AMSDU_MORE)) {
 		tid_agg_rx->reorder_time[index] = jiffies;
 		tid_agg_rx->stored_mpdu_num++;
@@ -2137,6 +2236,7 @@ void ieee80211_init_frag_cache(struct ieee80211_fragment_cache *cache)
 	for (i = 0; i < ARRAY_SIZE(cache->entries); i++)
 		skb_queue_head_init(&cache->entries[i].skb_list);
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_init_frag_cache);
 
 void ieee80211_destroy_frag_cache(struct ieee80211_fragment_cache *cache)
 {
@@ -2145,18 +2245,48 @@ void ieee80211_destroy_frag_cache(struct ieee80211_fragment_cache *cache)
 	for (i = 0; i < ARRAY_SIZE(cache->entries); i++)
 		__skb_queue_purge(&cache->entries[i].skb_list);
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_destroy_frag_cache);
+
+static bool
+ieee80211_reassemble_expired(struct ieee80211_fragment_entry *entry)
+{
+	return time_after(jiffies, entry->first_frag_time +
+				   IEEE80211_FRAGMENT_TIMEOUT);
+}
 
 static inline struct ieee80211_fragment_entry *
 ieee80211_reassemble_add(struct ieee80211_fragment_cache *cache,
 			 unsigned int frag, unsigned int seq, int rx_queue,
 			 struct sk_buff **skb)
 {
-	struct ieee80211_fragment_entry *entry;
+	struct ieee80211_fragment_entry *entry, *oldest = NULL;
+	int i;
 
-	entry = &cache->entries[cache->next++];
-	if (cache->next >= IEEE80211_FRAGMENT_MAX)
-		cache->next = 0;
+	/*
+	 * Use a free or expired entry if there is one, and only drop the
+	 * oldest pending reassembly if all entries are busy.
+	 */
+	for (i = 0; i < IEEE80211_FRAGMENT_MAX; i++) {
+		entry = &cache->entries[i];
+
+		if (skb_queue_empty(&entry->skb_list))
+			goto found;
+
+		if (ieee80211_reassemble_expired(entry)) {
+			cache->stats.expired++;
+			goto found;
+		}
+
+		if (!oldest ||
+		    time_before(entry->first_frag_time,
+				oldest->first_frag_time))
+			oldest = entry;
+	}
 
+	entry = oldest;
+	cache->stats.evicted++;
+
+ found:
 	__skb_queue_purge(&entry->skb_list);
 
 	__skb_queue_tail(&entry->skb_list, *skb); /* no need for locking */
@@ -2177,18 +2307,13 @@ ieee80211_reassemble_find(struct ieee80211_fragment_cache *cache,
 			  int rx_queue, struct ieee80211_hdr *hdr)
 {
 	struct ieee80211_fragment_entry *entry;
-	int i, idx;
+	int i;
 
-	idx = cache->next;
 	for (i = 0; i < IEEE80211_FRAGMENT_MAX; i++) {
 		struct ieee80211_hdr *f_hdr;
 		struct sk_buff *f_skb;
 
-		idx--;
-		if (idx < 0)
-			idx = IEEE80211_FRAGMENT_MAX - 1;
-
-		entry = &cache->entries[idx];
+		entry = &cache->entries[i];
 		if (skb_queue_empty(&entry->skb_list) || entry->seq != seq ||
 		    entry->rx_queue != rx_queue ||
 		    entry->last_frag + 1 != frag)
@@ -2206,8 +2331,9 @@ ieee80211_reassemble_find(struct ieee80211_fragment_cache *cache,
 		    !ether_addr_equal(hdr->addr2, f_hdr->addr2))
 			continue;
 
-		if (time_after(jiffies, entry->first_frag_time + 2 * HZ)) {
+		if (ieee80211_reassemble_expired(entry)) {
 			__skb_queue_purge(&entry->skb_list);
+			cache->stats.expired++;
 			continue;
 		}
 		return entry;
@@ -2226,7 +2352,7 @@ static bool requires_sequential_pn(struct ieee80211_rx_data *rx, __le16 fc)
 		ieee80211_has_protected(fc);
 }
 
-static ieee80211_rx_result debug_noinline
+VISIBLE_IF_MAC80211_KUNIT ieee80211_rx_result debug_noinline
 ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx)
 {
 	struct ieee80211_fragment_cache *cache = &rx->sdata->frags;
@@ -2258,8 +2384,10 @@ ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx)
 
 	I802_DEBUG_INC(rx->local->rx_handlers_fragments);
 
-	if (skb_linearize(rx->skb))
+	if (skb_linearize(rx->skb)) {
+		cache->stats.oom++;
 		return RX_DROP_U_OOM;
+	}
 
 	/*
 	 *  skb_linearize() might change the skb->data and
@@ -2309,6 +2437,7 @@ ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx)
 					  rx->seqno_idx, hdr);
 	if (!entry) {
 		I802_DEBUG_INC(rx->local->rx_handlers_drop_defrag);
+		cache->stats.unmatched++;
 		return RX_DROP_MONITOR;
 	}
 
@@ -2365,12 +2494,33 @@ ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx)
 	}
 
 	rx->skb = __skb_dequeue(&entry->skb_list);
+
+	/*
+	 * Chain the remaining fragments to the first one instead of copying
+	 * them. Management frames are expected to be linear, so those still
+	 * get copied, as do frames whose head can't be modified.
+	 */
+	if (ieee80211_is_data(fc) && !skb_cloned(rx->skb) &&
+	    !skb_has_frag_list(rx->skb)) {
+		struct sk_buff **next = &skb_shinfo(rx->skb)->frag_list;
+
+		while ((skb = __skb_dequeue(&entry->skb_list))) {
+			*next = skb;
+			next = &skb->next;
+			rx->skb->len += skb->len;
+			rx->skb->data_len += skb->len;
+			rx->skb->truesize += skb->truesize;
+		}
+		goto out;
+	}
+
 	if (skb_tailroom(rx->skb) < entry->extra_len) {
 		I802_DEBUG_INC(rx->local->rx_expand_skb_head_defrag);
 		if (unlikely(pskb_expand_head(rx->skb, 0, entry->extra_len,
 					      GFP_ATOMIC))) {
 			I802_DEBUG_INC(rx->local->rx_handlers_drop_defrag);
 			__skb_queue_purge(&entry->skb_list);
+			cache->stats.oom++;
 			return RX_DROP_U_OOM;
 		}
 	}
@@ -2385,6 +2535,7 @@ ieee80211_rx_h_defragment(struct ieee80211_rx_data *rx)
 		rx->link_sta->rx_stats.packets++;
 	return RX_CONTINUE;
 }
+EXPORT_SYMBOL_IF_MAC80211_KUNIT(ieee80211_rx_h_defragment);
 
 static int ieee80211_802_1x_port_control(struct ieee80211_rx_data *rx)
 {
@@ -2668,6 +2819,11 @@ ieee80211_deliver_skb(struct ieee80211_rx_data *rx)
 		u64_stats_update_end(&rx->link_sta->rx_stats.syncp);
 	}
 
+	if ((sdata->vif.type == NL80211_IFTYPE_AP ||
+	     sdata->vif.type == NL80211_IFTYPE_AP_VLAN) &&
+	    rx->sta && sdata->bss && is_multicast_ether_addr(ehdr->h_dest))
+		ieee80211_mcast_snoop_rx(sdata->bss, rx->sta->sta.aid, skb);
+
 	if ((sdata->vif.type == NL80211_IFTYPE_AP ||
 	     sdata->vif.type == NL80211_IFTYPE_AP_VLAN) &&
 	    !(sdata->flags & IEEE80211_SDATA_DONT_BRIDGE_PACKETS) &&
@@ -4370,10 +4526,10 @@ void ieee80211_mark_rx_ba_filtered_frames(struct ieee80211_sta *pubsta, u8 tid,
 	ssn += diff;
 
 	/* update bitmap */
+	tid_agg_rx->reorder_buf_filtered = 0;
 	for (i = 0; i < tid_agg_rx->buf_size; i++) {
-		int index = (ssn + i) % tid_agg_rx->buf_size;
+		int index = (ssn + i) & tid_agg_rx->reorder_buf_mask;
 
-		tid_agg_rx->reorder_buf_filtered &= ~BIT_ULL(index);
 		if (filtered & BIT_ULL(i))
 			tid_agg_rx->reorder_buf_filtered |= BIT_ULL(index);
 	}
@@ -4812,6 +4968,11 @@ static void ieee80211_rx_8023(struct ieee80211_rx_data *rx,
 	stats->bytes += orig_len;
 	u64_stats_update_end(&stats->syncp);
 
+	if ((fast_rx->vif_type == NL80211_IFTYPE_AP ||
+	     fast_rx->vif_type == NL80211_IFTYPE_AP_VLAN) &&
+	    rx->sdata->bss && is_multicast_ether_addr(da))
+		ieee80211_mcast_snoop_rx(rx->sdata->bss, sta->sta.aid, skb);
+
 	if (fast_rx->internal_forward) {
 		struct sk_buff *xmit_skb = NULL;
 		if (is_multicast_ether_addr(da)) {
@@ -5218,7 +5379,8 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 
 	if (ieee80211_is_data(fc)) {
 		struct sta_info *sta, *prev_sta;
-		int link_id = -1;
+		unsigned int gen;
+		int link_id = -1, nsta;
 
 		if (status->link_valid)
 			link_id = status->link_id;
@@ -5252,9 +5414,20 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 			goto out;
 		}
 
-		prev_sta = NULL;
+		/*
+		 * Try the last station this CPU resolved first, the hash
+		 * table only needs to be walked when that one doesn't match.
+		 */
+		prev_sta = sta_info_rx_cache_get(local, hdr->addr2);
+		if (prev_sta)
+			goto last_sta;
+
+		gen = sta_info_rx_cache_gen(local);
+		nsta = 0;
 
 		for_each_sta_info(local, hdr->addr2, sta, tmp) {
+			nsta++;
+
 			if (!prev_sta) {
 				prev_sta = sta;
 				continue;
@@ -5272,6 +5445,11 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 			prev_sta = sta;
 		}
 
+		/* only unambiguous lookups can be cached */
+		if (nsta == 1)
+			sta_info_rx_cache_set(local, prev_sta, gen);
+
+ last_sta:
 		if (prev_sta) {
 			rx.sdata = prev_sta->sdata;
 			if (!ieee80211_rx_data_set_sta(&rx, prev_sta, link_id))
@@ -5325,31 +5503,11 @@ static void __ieee80211_rx_handle_packet(struct ieee80211_hw *hw,
 }
 
 /*
- * This is the receive path handler. It is called by a low level driver when an
- * 802.11 MPDU is received from the hardware.
+ * Check whether the device is in a state to receive frames at all, this
+ * only depends on the device and is thus done once per batch of frames.
  */
-void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
-#if LINUX_VERSION_IS_GEQ(4,19,0)
-		       struct sk_buff *skb, struct list_head *list)
-#else
-		       struct sk_buff *skb, struct sk_buff_head *list)
-#endif
+static bool ieee80211_rx_local_ready(struct ieee80211_local *local)
 {
-	struct ieee80211_local *local = hw_to_local(hw);
-	struct ieee80211_rate *rate = NULL;
-	struct ieee80211_supported_band *sband;
-	struct ieee80211_rx_status *status = IEEE80211_SKB_RXCB(skb);
-	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
-
-	WARN_ON_ONCE(softirq_count() == 0);
-
-	if (WARN_ON(status->band >= NUM_NL80211_BANDS))
-		goto drop;
-
-	sband = local->hw.wiphy->bands[status->band];
-	if (WARN_ON(!sband))
-		goto drop;
-
 	/*
 	 * If we're suspending, it is possible although not too likely
 	 * that we'd be receiving frames after having already partially
@@ -5358,17 +5516,41 @@ void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
 	 * driver callbacks be invoked.
 	 */
 	if (unlikely(local->quiescing || local->suspended))
-		goto drop;
+		return false;
 
 	/* We might be during a HW reconfig, prevent Rx for the same reason */
 	if (unlikely(local->in_reconfig))
-		goto drop;
+		return false;
 
 	/*
 	 * The same happens when we're not even started,
 	 * but that's worth a warning.
 	 */
 	if (WARN_ON(!local->started))
+		return false;
+
+	return true;
+}
+
+static void __ieee80211_rx_list(struct ieee80211_hw *hw,
+				struct ieee80211_sta *pubsta,
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+				struct sk_buff *skb, struct list_head *list)
+#else
+				struct sk_buff *skb, struct sk_buff_head *list)
+#endif
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct ieee80211_rate *rate = NULL;
+	struct ieee80211_supported_band *sband;
+	struct ieee80211_rx_status *status = IEEE80211_SKB_RXCB(skb);
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *)skb->data;
+
+	if (WARN_ON(status->band >= NUM_NL80211_BANDS))
+		goto drop;
+
+	sband = local->hw.wiphy->bands[status->band];
+	if (WARN_ON(!sband))
 		goto drop;
 
 	if (likely(!(status->flag & RX_FLAG_FAILED_PLCP_CRC))) {
@@ -5463,8 +5645,58 @@ void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
  drop:
 	kfree_skb(skb);
 }
+
+/*
+ * This is the receive path handler. It is called by a low level driver when an
+ * 802.11 MPDU is received from the hardware.
+ */
+void ieee80211_rx_list(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+		       struct sk_buff *skb, struct list_head *list)
+#else
+		       struct sk_buff *skb, struct sk_buff_head *list)
+#endif
+{
+	WARN_ON_ONCE(softirq_count() == 0);
+
+	if (!ieee80211_rx_local_ready(hw_to_local(hw))) {
+		kfree_skb(skb);
+		return;
+	}
+
+	__ieee80211_rx_list(hw, pubsta, skb, list);
+}
 EXPORT_SYMBOL(ieee80211_rx_list);
 
+void ieee80211_rx_list_batch(struct ieee80211_hw *hw,
+			     struct ieee80211_sta *pubsta,
+			     struct sk_buff **skbs, unsigned int n_skbs,
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+			     struct list_head *list)
+#else
+			     struct sk_buff_head *list)
+#endif
+{
+	unsigned int i;
+
+	WARN_ON_ONCE(softirq_count() == 0);
+
+	if (!ieee80211_rx_local_ready(hw_to_local(hw))) {
+		for (i = 0; i < n_skbs; i++)
+			kfree_skb(skbs[i]);
+		return;
+	}
+
+	for (i = 0; i < n_skbs; i++) {
+		/* the next header will be parsed right after this frame */
+		if (i + 1 < n_skbs)
+			prefetch(skbs[i + 1]->data);
+
+		__ieee80211_rx_list(hw, pubsta, skbs[i], list);
+	}
+}
+EXPORT_SYMBOL(ieee80211_rx_list_batch);
+
 void ieee80211_rx_napi(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
 		       struct sk_buff *skb, struct napi_struct *napi)
 {
@@ -5503,6 +5735,41 @@ void ieee80211_rx_napi(struct ieee80211_hw *hw, struct ieee80211_sta *pubsta,
 }
 EXPORT_SYMBOL(ieee80211_rx_napi);
 
+void ieee80211_rx_napi_batch(struct ieee80211_hw *hw,
+			     struct ieee80211_sta *pubsta,
+			     struct sk_buff **skbs, unsigned int n_skbs,
+			     struct napi_struct *napi)
+{
+	struct sk_buff *skb, *tmp;
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+	LIST_HEAD(list);
+#else
+	struct sk_buff_head list;
+
+	__skb_queue_head_init(&list);
+#endif
+
+	rcu_read_lock();
+	ieee80211_rx_list_batch(hw, pubsta, skbs, n_skbs, &list);
+	rcu_read_unlock();
+
+	if (!napi) {
+		netif_receive_skb_list(&list);
+		return;
+	}
+
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+	list_for_each_entry_safe(skb, tmp, &list, list) {
+		skb_list_del_init(skb);
+#else
+	skb_queue_walk_safe(&list, skb, tmp) {
+		__skb_unlink(skb, &list);
+#endif
+		napi_gro_receive(napi, skb);
+	}
+}
+EXPORT_SYMBOL(ieee80211_rx_napi_batch);
+
 /* This is a version of the rx handler that can be called from hard irq
  * context. Post the skb on the queue and schedule the tasklet */
 void ieee80211_rx_irqsafe(struct ieee80211_hw *hw, struct sk_buff *skb)
@@ -88,11 +88,28 @@ static const struct rhashtable_params link_sta_rht_params = {
 	.max_size = CPTCFG_MAC80211_STA_HASH_MAX_SIZE,
 };
 
+/*
+ * Must be called whenever the station hash table changes, and before the
+ * synchronize_net() that precedes freeing a removed station: a reader that
+ * still saw the old generation is then guaranteed to be in an RCU read
+ * section that started before the station was unhashed.
+ */
+static void sta_info_rx_cache_invalidate(struct ieee80211_local *local)
+{
+	smp_store_release(&local->sta_rx_cache_gen,
+			  local->sta_rx_cache_gen + 1);
+}
+
 static int sta_info_hash_del(struct ieee80211_local *local,
 			     struct sta_info *sta)
 {
-	return rhltable_remove(&local->sta_hash, &sta->hash_node,
-			       sta_rht_params);
+	int ret;
+
+	ret = rhltable_remove(&local->sta_hash, &sta->hash_node,
+			      sta_rht_params);
+	sta_info_rx_cache_invalidate(local);
+
+	return ret;
 }
 
 static int link_sta_info_hash_add(struct ieee80211_local *local,
@@ -138,6 +155,13 @@ static void __cleanup_single_sta(struct sta_info *sta)
 	struct ieee80211_local *local = sdata->local;
 	struct ps_data *ps;
 
+	spin_lock_bh(&local->ps_wheel_lock);
+	if (!list_empty(&sta->ps_wheel_list)) {
+		list_del_init(&sta->ps_wheel_list);
+		local->ps_wheel_count--;
+	}
+	spin_unlock_bh(&local->ps_wheel_lock);
+
 	if (test_sta_flag(sta, WLAN_STA_PS_STA) ||
 	    test_sta_flag(sta, WLAN_STA_PS_DRIVER) ||
 	    test_sta_flag(sta, WLAN_STA_PS_DELIVER)) {
@@ -159,7 +183,8 @@ static void __cleanup_single_sta(struct sta_info *sta)
 	ieee80211_purge_sta_txqs(sta);
 
 	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++) {
-		local->total_ps_buffered -= skb_queue_len(&sta->ps_tx_buf[ac]);
+		atomic_sub(skb_queue_len(&sta->ps_tx_buf[ac]),
+			   &local->total_ps_buffered);
 		ieee80211_purge_tx_queue(&local->hw, &sta->ps_tx_buf[ac]);
 		ieee80211_purge_tx_queue(&local->hw, &sta->tx_filtered[ac]);
 	}
@@ -167,6 +192,8 @@ static void __cleanup_single_sta(struct sta_info *sta)
 	if (ieee80211_vif_is_mesh(&sdata->vif))
 		mesh_sta_cleanup(sta);
 
+	ieee80211_mcast_snoop_sta_removed(sta);
+
 	cancel_work_sync(&sta->drv_deliver_wk);
 
 	/*
@@ -449,8 +476,42 @@ void sta_info_free(struct ieee80211_local *local, struct sta_info *sta)
 static int sta_info_hash_add(struct ieee80211_local *local,
 			     struct sta_info *sta)
 {
-	return rhltable_insert(&local->sta_hash, &sta->hash_node,
-			       sta_rht_params);
+	int ret;
+
+	ret = rhltable_insert(&local->sta_hash, &sta->hash_node,
+			      sta_rht_params);
+	sta_info_rx_cache_invalidate(local);
+
+	return ret;
+}
+
+unsigned int sta_info_rx_cache_gen(struct ieee80211_local *local)
+{
+	/* pairs with smp_store_release() in sta_info_rx_cache_invalidate() */
+	return smp_load_acquire(&local->sta_rx_cache_gen);
+}
+
+struct sta_info *sta_info_rx_cache_get(struct ieee80211_local *local,
+				       const u8 *addr)
+{
+	struct sta_info_rx_cache *cache = this_cpu_ptr(local->sta_rx_cache);
+
+	if (!cache->sta || cache->gen != sta_info_rx_cache_gen(local) ||
+	    !ether_addr_equal(cache->addr, addr))
+		return NULL;
+
+	return cache->sta;
+}
+
+/* @gen must have been read by sta_info_rx_cache_gen() before the lookup */
+void sta_info_rx_cache_set(struct ieee80211_local *local,
+			   struct sta_info *sta, unsigned int gen)
+{
+	struct sta_info_rx_cache *cache = this_cpu_ptr(local->sta_rx_cache);
+
+	ether_addr_copy(cache->addr, sta->addr);
+	cache->gen = gen;
+	cache->sta = sta;
 }
 
 static void sta_deliver_ps_frames(struct work_struct *wk)
@@ -563,6 +624,7 @@ __sta_info_alloc(struct ieee80211_sub_if_data *sdata,
 
 	spin_lock_init(&sta->lock);
 	spin_lock_init(&sta->ps_lock);
+	INIT_LIST_HEAD(&sta->ps_wheel_list);
 	INIT_WORK(&sta->drv_deliver_wk, sta_deliver_ps_frames);
 	wiphy_work_init(&sta->ampdu_mlme.work, ieee80211_ba_session_work);
 #ifdef CPTCFG_MAC80211_MESH
@@ -983,6 +1045,38 @@ static inline bool __bss_tim_get(u8 *tim, u16 id)
 	return tim[id / 8] & (1 << (id % 8));
 }
 
+static void __bss_tim_update(struct ps_data *ps, u16 id, bool set)
+{
+	u8 idx = id / 8;
+
+	if (set) {
+		__bss_tim_set(ps->tim, id);
+
+		if (!ps->tim_bits++) {
+			ps->tim_first = idx;
+			ps->tim_last = idx;
+		} else if (idx < ps->tim_first) {
+			ps->tim_first = idx;
+		} else if (idx > ps->tim_last) {
+			ps->tim_last = idx;
+		}
+		return;
+	}
+
+	__bss_tim_clear(ps->tim, id);
+
+	if (!--ps->tim_bits || ps->tim[idx])
+		return;
+
+	/* an outer byte became empty, move in to the next non-empty one */
+	if (idx == ps->tim_first)
+		while (!ps->tim[ps->tim_first])
+			ps->tim_first++;
+	if (idx == ps->tim_last)
+		while (!ps->tim[ps->tim_last])
+			ps->tim_last--;
+}
+
 static unsigned long ieee80211_tids_for_ac(int ac)
 {
 	/* If we ever support TIDs > 7, this obviously needs to be adjusted */
@@ -1068,10 +1162,7 @@ static void __sta_info_recalc_tim(struct sta_info *sta, bool ignore_pending)
 	if (indicate_tim == __bss_tim_get(ps->tim, id))
 		goto out_unlock;
 
-	if (indicate_tim)
-		__bss_tim_set(ps->tim, id);
-	else
-		__bss_tim_clear(ps->tim, id);
+	__bss_tim_update(ps, id, indicate_tim);
 
 	if (local->ops->set_tim && !WARN_ON(sta->dead)) {
 		local->tim_in_locked_section = true;
@@ -1088,15 +1179,9 @@ void sta_info_recalc_tim(struct sta_info *sta)
 	__sta_info_recalc_tim(sta, false);
 }
 
-static bool sta_info_buffer_expired(struct sta_info *sta, struct sk_buff *skb)
+static unsigned long sta_info_buffer_timeout(struct sta_info *sta)
 {
-	struct ieee80211_tx_info *info;
-	int timeout;
-
-	if (!skb)
-		return false;
-
-	info = IEEE80211_SKB_CB(skb);
+	unsigned long timeout;
 
 	/* Timeout: (2 * listen_interval * beacon_int * 1024 / 1000000) sec */
 	timeout = (sta->listen_interval *
@@ -1104,12 +1189,32 @@ static bool sta_info_buffer_expired(struct sta_info *sta, struct sk_buff *skb)
 		   32 / 15625) * HZ;
 	if (timeout < STA_TX_BUFFER_EXPIRE)
 		timeout = STA_TX_BUFFER_EXPIRE;
-	return time_after(jiffies, info->control.jiffies + timeout);
+	return timeout;
+}
+
+static bool sta_info_buffer_expired(struct sta_info *sta, struct sk_buff *skb,
+				    unsigned long *next)
+{
+	struct ieee80211_tx_info *info;
+	unsigned long expires;
+
+	if (!skb)
+		return false;
+
+	info = IEEE80211_SKB_CB(skb);
+	expires = info->control.jiffies + sta_info_buffer_timeout(sta);
+	if (time_after(jiffies, expires))
+		return true;
+
+	if (time_before(expires, *next))
+		*next = expires;
+	return false;
 }
 
 
 static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
-						struct sta_info *sta, int ac)
+						struct sta_info *sta, int ac,
+						unsigned long *next)
 {
 	unsigned long flags;
 	struct sk_buff *skb;
@@ -1124,7 +1229,7 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 	for (;;) {
 		spin_lock_irqsave(&sta->tx_filtered[ac].lock, flags);
 		skb = skb_peek(&sta->tx_filtered[ac]);
-		if (sta_info_buffer_expired(sta, skb))
+		if (sta_info_buffer_expired(sta, skb, next))
 			skb = __skb_dequeue(&sta->tx_filtered[ac]);
 		else
 			skb = NULL;
@@ -1150,7 +1255,7 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 	for (;;) {
 		spin_lock_irqsave(&sta->ps_tx_buf[ac].lock, flags);
 		skb = skb_peek(&sta->ps_tx_buf[ac]);
-		if (sta_info_buffer_expired(sta, skb))
+		if (sta_info_buffer_expired(sta, skb, next))
 			skb = __skb_dequeue(&sta->ps_tx_buf[ac]);
 		else
 			skb = NULL;
@@ -1164,7 +1269,7 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 		if (!skb)
 			break;
 
-		local->total_ps_buffered--;
+		atomic_dec(&local->total_ps_buffered);
 		ps_dbg(sta->sdata, "Buffered frame expired (STA %pM)\n",
 		       sta->sta.addr);
 		ieee80211_free_txskb(&local->hw, skb);
@@ -1179,15 +1284,16 @@ static bool sta_info_cleanup_expire_buffered_ac(struct ieee80211_local *local,
 
 	/*
 	 * Return whether there are any frames still buffered, this is
-	 * used to check whether the cleanup timer still needs to run,
-	 * if there are no frames we don't need to rearm the timer.
+	 * used to check whether the station needs to stay on the expiry
+	 * wheel, at the time the oldest of them expires (in @next).
 	 */
 	return !(skb_queue_empty(&sta->ps_tx_buf[ac]) &&
 		 skb_queue_empty(&sta->tx_filtered[ac]));
 }
 
 static bool sta_info_cleanup_expire_buffered(struct ieee80211_local *local,
-					     struct sta_info *sta)
+					     struct sta_info *sta,
+					     unsigned long *next)
 {
 	bool have_buffered = false;
 	int ac;
@@ -1199,7 +1305,8 @@ static bool sta_info_cleanup_expire_buffered(struct ieee80211_local *local,
 
 	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++)
 		have_buffered |=
-			sta_info_cleanup_expire_buffered_ac(local, sta, ac);
+			sta_info_cleanup_expire_buffered_ac(local, sta, ac,
+							    next);
 
 	return have_buffered;
 }
@@ -1514,31 +1621,100 @@ int sta_info_destroy_addr_bss(struct ieee80211_sub_if_data *sdata,
 	return __sta_info_destroy(sta);
 }
 
+static void __sta_info_ps_wheel_add(struct ieee80211_local *local,
+				    struct sta_info *sta, unsigned long expires)
+{
+	unsigned int slot;
+
+	lockdep_assert_held(&local->ps_wheel_lock);
+
+	if (!local->ps_wheel_count++) {
+		local->ps_wheel_time = rounddown(jiffies, STA_PS_WHEEL_TICK);
+		if (!local->quiescing)
+			mod_timer(&local->sta_cleanup,
+				  local->ps_wheel_time + STA_PS_WHEEL_TICK);
+	}
+
+	/* never put it into a slot that was already handled */
+	if (time_before(expires, local->ps_wheel_time))
+		expires = local->ps_wheel_time;
+
+	slot = (expires / STA_PS_WHEEL_TICK) % STA_PS_WHEEL_SLOTS;
+	list_add_tail(&sta->ps_wheel_list, &local->ps_wheel[slot]);
+}
+
+/**
+ * sta_info_ps_buffered - track frames buffered for a sleeping station
+ * @sta: the station that frames were queued for
+ *
+ * Must be called after putting frames on the station's ps_tx_buf or
+ * tx_filtered queues, so the sta_cleanup timer will look at it once
+ * the frames may have expired.
+ */
+void sta_info_ps_buffered(struct sta_info *sta)
+{
+	struct ieee80211_local *local = sta->local;
+
+	if (!list_empty(&sta->ps_wheel_list))
+		return;
+
+	spin_lock_bh(&local->ps_wheel_lock);
+	if (list_empty(&sta->ps_wheel_list))
+		__sta_info_ps_wheel_add(local, sta,
+					jiffies + sta_info_buffer_timeout(sta));
+	spin_unlock_bh(&local->ps_wheel_lock);
+}
+
 static void sta_info_cleanup(struct timer_list *t)
 {
 	struct ieee80211_local *local = from_timer(local, t, sta_cleanup);
-	struct sta_info *sta;
-	bool timer_needed = false;
+	struct sta_info *sta, *tmp;
+	unsigned int i;
+	LIST_HEAD(due);
 
-	rcu_read_lock();
-	list_for_each_entry_rcu(sta, &local->sta_list, list)
-		if (sta_info_cleanup_expire_buffered(local, sta))
-			timer_needed = true;
-	rcu_read_unlock();
+	spin_lock_bh(&local->ps_wheel_lock);
 
-	if (local->quiescing)
-		return;
+	for (i = 0; i < STA_PS_WHEEL_SLOTS; i++) {
+		unsigned int slot;
 
-	if (!timer_needed)
-		return;
+		if (time_before(jiffies,
+				local->ps_wheel_time + STA_PS_WHEEL_TICK))
+			break;
+
+		slot = (local->ps_wheel_time / STA_PS_WHEEL_TICK) %
+		       STA_PS_WHEEL_SLOTS;
+		list_splice_tail_init(&local->ps_wheel[slot], &due);
+		local->ps_wheel_time += STA_PS_WHEEL_TICK;
+	}
+
+	/* the whole wheel came due, e.g. after resume */
+	if (i == STA_PS_WHEEL_SLOTS)
+		local->ps_wheel_time = rounddown(jiffies, STA_PS_WHEEL_TICK);
 
-	mod_timer(&local->sta_cleanup,
-		  round_jiffies(jiffies + STA_INFO_CLEANUP_INTERVAL));
+	/*
+	 * Stations are removed from the wheel before they're freed, and
+	 * that needs the lock, so they remain valid while we hold it.
+	 */
+	list_for_each_entry_safe(sta, tmp, &due, ps_wheel_list) {
+		unsigned long next = jiffies + MAX_JIFFY_OFFSET;
+
+		list_del_init(&sta->ps_wheel_list);
+		local->ps_wheel_count--;
+
+		if (sta_info_cleanup_expire_buffered(local, sta, &next))
+			__sta_info_ps_wheel_add(local, sta, next);
+	}
+
+	if (local->ps_wheel_count && !local->quiescing)
+		mod_timer(&local->sta_cleanup,
+			  local->ps_wheel_time + STA_PS_WHEEL_TICK);
+
+	spin_unlock_bh(&local->ps_wheel_lock);
 }
 
 int sta_info_init(struct ieee80211_local *local)
 {
-	int err;
+	int err, i;
 
 	err = rhltable_init(&local->sta_hash, &sta_rht_params);
 	if (err)
@@ -1550,9 +1726,21 @@ int sta_info_init(struct ieee80211_local *local)
 		return err;
 	}
 
+	local->sta_rx_cache = alloc_percpu(struct sta_info_rx_cache);
+	if (!local->sta_rx_cache) {
+		rhltable_destroy(&local->link_sta_hash);
+		rhltable_destroy(&local->sta_hash);
+		return -ENOMEM;
+	}
+
 	spin_lock_init(&local->tim_lock);
 	INIT_LIST_HEAD(&local->sta_list);
 
+	spin_lock_init(&local->ps_wheel_lock);
+	for (i = 0; i < STA_PS_WHEEL_SLOTS; i++)
+		INIT_LIST_HEAD(&local->ps_wheel[i]);
+	local->ps_wheel_time = rounddown(jiffies, STA_PS_WHEEL_TICK);
+
 	timer_setup(&local->sta_cleanup, sta_info_cleanup, 0);
 	return 0;
 }
@@ -1562,6 +1750,7 @@ void sta_info_stop(struct ieee80211_local *local)
 	del_timer_sync(&local->sta_cleanup);
 	rhltable_destroy(&local->sta_hash);
 	rhltable_destroy(&local->link_sta_hash);
+	free_percpu(local->sta_rx_cache);
 }
 
 
@@ -1749,7 +1938,7 @@ void ieee80211_sta_ps_deliver_wakeup(struct sta_info *sta)
 
 	atomic_dec(&ps->num_sta_ps);
 
-	local->total_ps_buffered -= buffered;
+	atomic_sub(buffered, &local->total_ps_buffered);
 
 	sta_info_recalc_tim(sta);
 
@@ -1927,7 +2116,8 @@ ieee80211_sta_ps_get_frames(struct sta_info *sta, int n_frames, u8 ignored_acs,
 					skb = skb_dequeue(
 						&sta->ps_tx_buf[ac]);
 					if (skb)
-						local->total_ps_buffered--;
+						atomic_dec(
+						  &local->total_ps_buffered);
 				}
 				if (!skb)
 					break;
@@ -2346,7 +2536,7 @@ EXPORT_SYMBOL(ieee80211_sta_recalc_aggregates);
 
 void ieee80211_sta_update_pending_airtime(struct ieee80211_local *local,
 					  struct sta_info *sta, u8 ac,
-					  u16 tx_airtime, bool tx_completed)
+					  u32 tx_airtime, bool tx_completed)
 {
 	int tx_pending;
 
@@ -147,7 +147,7 @@ struct airtime_info {
 
 void ieee80211_sta_update_pending_airtime(struct ieee80211_local *local,
 					  struct sta_info *sta, u8 ac,
-					  u16 tx_airtime, bool tx_completed);
+					  u32 tx_airtime, bool tx_completed);
 
 struct sta_info;
 
@@ -209,6 +209,11 @@ struct tid_ampdu_tx {
  *	A-MSDU with individually reported subframes.
  * @reorder_buf_filtered: bitmap indicating where there are filtered frames in
  *	the reorder buffer that should be ignored when releasing frames
+ * @reorder_buf_used: bitmap of reorder buffer slots holding at least one
+ *	frame (possibly an incomplete A-MSDU), used to skip over holes with
+ *	find_next_bit() instead of walking every slot
+ * @reorder_buf_mask: the reorder buffer has @buf_size rounded up to a power
+ *	of two slots, a frame is stored at index (SN & @reorder_buf_mask)
  * @reorder_time: jiffies when skb was added
  * @session_timer: check if peer keeps Tx-ing on the TID (by timeout value)
  * @reorder_timer: releases expired frames from the reorder buffer.
@@ -231,15 +236,16 @@ struct tid_ampdu_tx {
  * the array holding it must hold the aggregation mutex.
  *
  * The @reorder_lock is used to protect the members of this
- * struct, except for @timeout, @buf_size and @dialog_token,
- * which are constant across the lifetime of the struct (the
- * dialog token being used only for debugging).
+ * struct, except for @timeout, @buf_size, @reorder_buf_mask and
+ * @dialog_token, which are constant across the lifetime of the
+ * struct (the dialog token being used only for debugging).
  */
 struct tid_ampdu_rx {
 	struct rcu_head rcu_head;
 	spinlock_t reorder_lock;
 	u64 reorder_buf_filtered;
 	struct sk_buff_head *reorder_buf;
+	unsigned long *reorder_buf_used;
 	unsigned long *reorder_time;
 	struct sta_info *sta;
 	struct timer_list session_timer;
@@ -249,6 +255,7 @@ struct tid_ampdu_rx {
 	u16 stored_mpdu_num;
 	u16 ssn;
 	u16 buf_size;
+	u16 reorder_buf_mask;
 	u16 timeout;
 	u8 tid;
 	u8 auto_seq:1,
@@ -442,10 +449,13 @@ struct ieee80211_sta_rx_stats {
  * reception of at least one MSDU per access category per associated STA"
  * on APs, or "at least one MSDU per access category" on other interface types.
  *
- * This limit can be increased by changing this define, at the cost of slower
- * frame reassembly and increased memory use while fragments are pending.
+ * This limit can be increased with CONFIG_MAC80211_FRAGMENT_CACHE_SIZE, at the
+ * cost of increased memory use while fragments are pending.
  */
-#define IEEE80211_FRAGMENT_MAX 4
+#define IEEE80211_FRAGMENT_MAX CPTCFG_MAC80211_FRAGMENT_CACHE_SIZE
+
+/* pending fragments older than this are dropped */
+#define IEEE80211_FRAGMENT_TIMEOUT (2 * HZ)
 
 struct ieee80211_fragment_entry {
 	struct sk_buff_head skb_list;
@@ -460,9 +470,24 @@ struct ieee80211_fragment_entry {
 	unsigned int key_color;
 };
 
+/**
+ * struct ieee80211_fragment_stats - fragment cache drop counters
+ *
+ * @evicted: pending reassemblies dropped to make room for a new one
+ * @expired: pending reassemblies dropped after IEEE80211_FRAGMENT_TIMEOUT
+ * @unmatched: fragments dropped since no matching reassembly was pending
+ * @oom: reassembled frames dropped due to memory allocation failure
+ */
+struct ieee80211_fragment_stats {
+	unsigned long evicted;
+	unsigned long expired;
+	unsigned long unmatched;
+	unsigned long oom;
+};
+
 struct ieee80211_fragment_cache {
 	struct ieee80211_fragment_entry	entries[IEEE80211_FRAGMENT_MAX];
-	unsigned int next;
+	struct ieee80211_fragment_stats stats;
 };
 
 /*
@@ -553,6 +578,7 @@ struct link_sta_info {
 		struct ieee80211_tx_rate last_rate;
 		struct rate_info last_rate_info;
 		u64 msdu[IEEE80211_NUM_TIDS + 1];
+		unsigned long mcast_to_ucast_dropped;
 	} tx_stats;
 
 	enum ieee80211_sta_rx_bandwidth cur_max_bandwidth;
@@ -595,6 +621,9 @@ struct link_sta_info {
  *	transmit but were filtered by hardware due to STA having
  *	entered power saving state, these are also delivered to
  *	the station when it leaves powersave or polls for frames
+ * @ps_wheel_list: entry on the local PS expiry wheel while any frames
+ *	are buffered in @ps_tx_buf or @tx_filtered, protected by the
+ *	local->ps_wheel_lock
  * @driver_buffered_tids: bitmap of TIDs the driver has data buffered on
  * @txq_buffered_tids: bitmap of TIDs that mac80211 has txq data buffered on
  * @assoc_at: clock boottime (in ns) of last association
@@ -682,6 +711,7 @@ struct sta_info {
 	spinlock_t ps_lock;
 	struct sk_buff_head ps_tx_buf[IEEE80211_NUM_ACS];
 	struct sk_buff_head tx_filtered[IEEE80211_NUM_ACS];
+	struct list_head ps_wheel_list;
 	unsigned long driver_buffered_tids;
 	unsigned long txq_buffered_tids;
 
@@ -802,9 +832,11 @@ void ieee80211_assign_tid_tx(struct sta_info *sta, int tid,
  * smaller than this value, the minimum value here is used instead. */
 #define STA_TX_BUFFER_EXPIRE (10 * HZ)
 
-/* How often station data is cleaned up (e.g., expiration of buffered frames)
- */
-#define STA_INFO_CLEANUP_INTERVAL (10 * HZ)
+/* Buffered frame expiry is tracked on a wheel of STA_PS_WHEEL_SLOTS slots,
+ * each STA_PS_WHEEL_TICK long. Stations expiring further out than one
+ * rotation are simply looked at again on the way. */
+#define STA_PS_WHEEL_SLOTS	64
+#define STA_PS_WHEEL_TICK	HZ
 
 struct rhlist_head *sta_info_hash_lookup(struct ieee80211_local *local,
 					 const u8 *addr);
@@ -837,6 +869,27 @@ struct rhlist_head *link_sta_info_hash_lookup(struct ieee80211_local *local,
 struct link_sta_info *
 link_sta_info_get_bss(struct ieee80211_sub_if_data *sdata, const u8 *addr);
 
+/**
+ * struct sta_info_rx_cache - per-CPU cache of the last RX station lookup
+ *
+ * @addr: transmitter address that was looked up
+ * @gen: &ieee80211_local.sta_rx_cache_gen at the time of the lookup, the
+ *	entry is stale once the station hash table changed
+ * @sta: the only station in the hash table with address @addr
+ */
+struct sta_info_rx_cache {
+	u8 addr[ETH_ALEN];
+	unsigned int gen;
+	struct sta_info *sta;
+};
+
+/* must be called under RCU read lock with BHs disabled */
+unsigned int sta_info_rx_cache_gen(struct ieee80211_local *local);
+struct sta_info *sta_info_rx_cache_get(struct ieee80211_local *local,
+				       const u8 *addr);
+void sta_info_rx_cache_set(struct ieee80211_local *local,
+			   struct sta_info *sta, unsigned int gen);
+
 /*
  * Get STA info by index, BROKEN!
  */
@@ -874,6 +927,7 @@ int sta_info_destroy_addr_bss(struct ieee80211_sub_if_data *sdata,
 			      const u8 *addr);
 
 void sta_info_recalc_tim(struct sta_info *sta);
+void sta_info_ps_buffered(struct sta_info *sta);
 
 int sta_info_init(struct ieee80211_local *local);
 void sta_info_stop(struct ieee80211_local *local);
@@ -146,11 +146,7 @@ static void ieee80211_handle_filtered_frame(struct ieee80211_local *local,
 	    skb_queue_len(&sta->tx_filtered[ac]) < STA_MAX_TX_BUFFER) {
 		skb_queue_tail(&sta->tx_filtered[ac], skb);
 		sta_info_recalc_tim(sta);
-
-		if (!timer_pending(&local->sta_cleanup))
-			mod_timer(&local->sta_cleanup,
-				  round_jiffies(jiffies +
-						STA_INFO_CLEANUP_INTERVAL));
+		sta_info_ps_buffered(sta);
 		return;
 	}
 
@@ -1117,6 +1113,128 @@ void ieee80211_tx_status_skb(struct ieee80211_hw *hw, struct sk_buff *skb)
 }
 EXPORT_SYMBOL(ieee80211_tx_status_skb);
 
+/*
+ * Update the station statistics from the tx status of a frame. Returns
+ * false if the frame should be treated as filtered instead, because the
+ * station went to sleep.
+ */
+static bool ieee80211_tx_status_update_sta(struct ieee80211_local *local,
+					   struct sta_info *sta,
+					   struct ieee80211_tx_status *status,
+					   int retry_count)
+{
+	struct ieee80211_sub_if_data *sdata = sta->sdata;
+	struct ieee80211_tx_info *info = status->info;
+	struct sk_buff *skb = status->skb;
+	bool acked, noack_success, ack_signal_valid;
+
+	acked = !!(info->flags & IEEE80211_TX_STAT_ACK);
+	noack_success = !!(info->flags & IEEE80211_TX_STAT_NOACK_TRANSMITTED);
+	ack_signal_valid =
+		!!(info->status.flags & IEEE80211_TX_STATUS_ACK_SIGNAL_VALID);
+
+	if (!acked && !noack_success)
+		sta->deflink.status_stats.retry_failed++;
+	sta->deflink.status_stats.retry_count += retry_count;
+
+	if (ieee80211_hw_check(&local->hw, REPORTS_TX_ACK_STATUS)) {
+		if (sdata->vif.type == NL80211_IFTYPE_STATION &&
+		    skb && !(info->flags & IEEE80211_TX_CTL_HW_80211_ENCAP))
+			ieee80211_sta_tx_notify(sdata, (void *) skb->data,
+						acked, info->status.tx_time);
+
+		if (acked) {
+			sta->deflink.status_stats.last_ack = jiffies;
+
+			if (sta->deflink.status_stats.lost_packets)
+				sta->deflink.status_stats.lost_packets = 0;
+
+			/* Track when last packet was ACKed */
+			sta->deflink.status_stats.last_pkt_time = jiffies;
+
+			/* Reset connection monitor */
+			if (sdata->vif.type == NL80211_IFTYPE_STATION &&
+			    unlikely(sdata->u.mgd.probe_send_count > 0))
+				sdata->u.mgd.probe_send_count = 0;
+
+			if (ack_signal_valid) {
+				sta->deflink.status_stats.last_ack_signal =
+						 (s8)info->status.ack_signal;
+				sta->deflink.status_stats.ack_signal_filled = true;
+				ewma_avg_signal_add(&sta->deflink.status_stats.avg_ack_signal,
+						    -info->status.ack_signal);
+			}
+		} else if (test_sta_flag(sta, WLAN_STA_PS_STA)) {
+			/*
+			 * The STA is in power save mode, so assume
+			 * that this TX packet failed because of that.
+			 */
+			return false;
+		} else if (noack_success) {
+			/* nothing to do here, do not account as lost */
+		} else {
+			ieee80211_lost_packet(sta, info);
+		}
+	}
+
+	return true;
+}
+
+static void ieee80211_tx_status_rate_control(struct ieee80211_local *local,
+					     struct sta_info *sta,
+					     struct ieee80211_tx_status *status)
+{
+	rate_control_tx_status(local, status);
+	if (ieee80211_vif_is_mesh(&sta->sdata->vif))
+		ieee80211s_update_metric(local, sta, status);
+}
+
+static void ieee80211_tx_status_free(struct ieee80211_local *local,
+				     struct ieee80211_tx_status *status)
+{
+	struct sk_buff *skb = status->skb;
+
+	ieee80211_report_used_skb(local, skb, false, status->ack_hwtstamp);
+	if (status->free_list)
+#if LINUX_VERSION_IS_GEQ(4,19,0)
+		list_add_tail(&skb->list, status->free_list);
+#else
+		__skb_queue_tail(status->free_list, skb);
+#endif
+	else
+		dev_kfree_skb(skb);
+}
+
+/* per-frame part of the tx status, after the station has been updated */
+static void ieee80211_tx_status_frame(struct ieee80211_hw *hw,
+				      struct ieee80211_tx_status *status,
+				      int rates_idx, int retry_count)
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct ieee80211_tx_info *info = status->info;
+	struct sk_buff *skb = status->skb;
+
+	if (skb && !(info->flags & IEEE80211_TX_CTL_HW_80211_ENCAP))
+		return __ieee80211_tx_status(hw, status, rates_idx,
+					     retry_count);
+
+	if (info->flags & (IEEE80211_TX_STAT_ACK |
+			   IEEE80211_TX_STAT_NOACK_TRANSMITTED)) {
+		I802_DEBUG_INC(local->dot11TransmittedFrameCount);
+		if (!status->sta)
+			I802_DEBUG_INC(local->dot11MulticastTransmittedFrameCount);
+		if (retry_count > 0)
+			I802_DEBUG_INC(local->dot11RetryCount);
+		if (retry_count > 1)
+			I802_DEBUG_INC(local->dot11MultipleRetryCount);
+	} else {
+		I802_DEBUG_INC(local->dot11FailedCount);
+	}
+
+	if (skb)
+		ieee80211_tx_status_free(local, status);
+}
+
 void ieee80211_tx_status_ext(struct ieee80211_hw *hw,
 			     struct ieee80211_tx_status *status)
 {
@@ -1126,7 +1244,6 @@ void ieee80211_tx_status_ext(struct ieee80211_hw *hw,
 	struct sk_buff *skb = status->skb;
 	struct sta_info *sta = NULL;
 	int rates_idx, retry_count;
-	bool acked, noack_success, ack_signal_valid;
 	u16 tx_time_est;
 
 	if (pubsta) {
@@ -1149,101 +1266,116 @@ void ieee80211_tx_status_ext(struct ieee80211_hw *hw,
 		ieee80211_info_set_tx_time_est(IEEE80211_SKB_CB(skb), 0);
 	}
 
-	if (!status->info)
-		goto free;
+	if (!status->info) {
+		if (skb)
+			ieee80211_tx_status_free(local, status);
+		return;
+	}
 
 	rates_idx = ieee80211_tx_get_rates(hw, info, &retry_count);
 
-	acked = !!(info->flags & IEEE80211_TX_STAT_ACK);
-	noack_success = !!(info->flags & IEEE80211_TX_STAT_NOACK_TRANSMITTED);
-	ack_signal_valid =
-		!!(info->status.flags & IEEE80211_TX_STATUS_ACK_SIGNAL_VALID);
-
 	if (pubsta) {
-		struct ieee80211_sub_if_data *sdata = sta->sdata;
+		if (!ieee80211_tx_status_update_sta(local, sta, status,
+						    retry_count)) {
+			if (skb)
+				ieee80211_handle_filtered_frame(local, sta,
+								skb);
+			return;
+		}
 
-		if (!acked && !noack_success)
-			sta->deflink.status_stats.retry_failed++;
-		sta->deflink.status_stats.retry_count += retry_count;
+		ieee80211_tx_status_rate_control(local, sta, status);
+	}
 
-		if (ieee80211_hw_check(&local->hw, REPORTS_TX_ACK_STATUS)) {
-			if (sdata->vif.type == NL80211_IFTYPE_STATION &&
-			    skb && !(info->flags & IEEE80211_TX_CTL_HW_80211_ENCAP))
-				ieee80211_sta_tx_notify(sdata, (void *) skb->data,
-							acked, info->status.tx_time);
-
-			if (acked) {
-				sta->deflink.status_stats.last_ack = jiffies;
-
-				if (sta->deflink.status_stats.lost_packets)
-					sta->deflink.status_stats.lost_packets = 0;
-
-				/* Track when last packet was ACKed */
-				sta->deflink.status_stats.last_pkt_time = jiffies;
-
-				/* Reset connection monitor */
-				if (sdata->vif.type == NL80211_IFTYPE_STATION &&
-				    unlikely(sdata->u.mgd.probe_send_count > 0))
-					sdata->u.mgd.probe_send_count = 0;
-
-				if (ack_signal_valid) {
-					sta->deflink.status_stats.last_ack_signal =
-							 (s8)info->status.ack_signal;
-					sta->deflink.status_stats.ack_signal_filled = true;
-					ewma_avg_signal_add(&sta->deflink.status_stats.avg_ack_signal,
-							    -info->status.ack_signal);
-				}
-			} else if (test_sta_flag(sta, WLAN_STA_PS_STA)) {
-				/*
-				 * The STA is in power save mode, so assume
-				 * that this TX packet failed because of that.
-				 */
-				if (skb)
-					ieee80211_handle_filtered_frame(local, sta, skb);
-				return;
-			} else if (noack_success) {
-				/* nothing to do here, do not account as lost */
-			} else {
-				ieee80211_lost_packet(sta, info);
-			}
-		}
+	ieee80211_tx_status_frame(hw, status, rates_idx, retry_count);
+}
+EXPORT_SYMBOL(ieee80211_tx_status_ext);
+
+void ieee80211_tx_status_batch(struct ieee80211_hw *hw,
+			       struct ieee80211_tx_status *status, u8 tid,
+			       u32 tx_airtime, struct sk_buff_head *skbs)
+{
+	struct ieee80211_local *local = hw_to_local(hw);
+	struct ieee80211_tx_status batch = *status;
+	u32 pending[IEEE80211_NUM_ACS] = {};
+	struct sk_buff *skb, *owner;
+	struct sta_info *sta;
+	int rates_idx, retry_count;
+	int ac;
 
-		rate_control_tx_status(local, status);
-		if (ieee80211_vif_is_mesh(&sta->sdata->vif))
-			ieee80211s_update_metric(local, sta, status);
+	if (WARN_ON_ONCE(!status->sta || !status->info || status->skb)) {
+		while ((skb = __skb_dequeue(skbs))) {
+			struct ieee80211_tx_status frame = {
+				.sta = status->sta,
+				.info = IEEE80211_SKB_CB(skb),
+				.skb = skb,
+				.free_list = status->free_list,
+			};
+
+			ieee80211_tx_status_ext(hw, &frame);
+		}
+		return;
 	}
 
-	if (skb && !(info->flags & IEEE80211_TX_CTL_HW_80211_ENCAP))
-		return __ieee80211_tx_status(hw, status, rates_idx,
-					     retry_count);
+	sta = container_of(status->sta, struct sta_info, sta);
 
-	if (acked || noack_success) {
-		I802_DEBUG_INC(local->dot11TransmittedFrameCount);
-		if (!pubsta)
-			I802_DEBUG_INC(local->dot11MulticastTransmittedFrameCount);
-		if (retry_count > 0)
-			I802_DEBUG_INC(local->dot11RetryCount);
-		if (retry_count > 1)
-			I802_DEBUG_INC(local->dot11MultipleRetryCount);
-	} else {
-		I802_DEBUG_INC(local->dot11FailedCount);
+	if (status->n_rates)
+		sta->deflink.tx_stats.last_rate_info =
+			status->rates[status->n_rates - 1].rate_idx;
+
+	owner = skb_peek(skbs);
+	skb_queue_walk(skbs, skb) {
+		struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
+		u16 tx_time_est = ieee80211_info_get_tx_time_est(info);
+
+		if (info == status->info)
+			owner = skb;
+
+		if (!tx_time_est)
+			continue;
+
+		pending[skb_get_queue_mapping(skb)] += tx_time_est;
+		ieee80211_info_set_tx_time_est(info, 0);
 	}
 
-free:
-	if (!skb)
-		return;
+	for (ac = 0; ac < IEEE80211_NUM_ACS; ac++)
+		if (pending[ac])
+			ieee80211_sta_update_pending_airtime(local, sta, ac,
+							     pending[ac], true);
 
-	ieee80211_report_used_skb(local, skb, false, status->ack_hwtstamp);
-	if (status->free_list)
-#if LINUX_VERSION_IS_GEQ(4,19,0)
-		list_add_tail(&skb->list, status->free_list);
-#else
-		__skb_queue_tail(status->free_list, skb);
-#endif
-	else
-		dev_kfree_skb(skb);
+	if (tx_airtime)
+		ieee80211_sta_register_airtime(status->sta, tid, tx_airtime, 0);
+
+	/* rate control gets the shared rates cleaned up like the others */
+	ieee80211_tx_get_rates(hw, batch.info, &retry_count);
+
+	while ((skb = __skb_dequeue(skbs))) {
+		struct ieee80211_tx_status frame = *status;
+
+		/* station statistics count every frame with its own status */
+		frame.skb = skb;
+		frame.info = IEEE80211_SKB_CB(skb);
+		rates_idx = ieee80211_tx_get_rates(hw, frame.info,
+						   &retry_count);
+		if (!ieee80211_tx_status_update_sta(local, sta, &frame,
+						    retry_count)) {
+			ieee80211_handle_filtered_frame(local, sta, skb);
+			continue;
+		}
+
+		/*
+		 * Rate control only sees the shared status, once, along
+		 * with the frame it belongs to (or the first one) for the
+		 * algorithms that look at the skb.
+		 */
+		if (skb == owner) {
+			batch.skb = skb;
+			ieee80211_tx_status_rate_control(local, sta, &batch);
+		}
+
+		ieee80211_tx_status_frame(hw, &frame, rates_idx, retry_count);
+	}
 }
-EXPORT_SYMBOL(ieee80211_tx_status_ext);
+EXPORT_SYMBOL(ieee80211_tx_status_batch);
 
 void ieee80211_tx_rate_update(struct ieee80211_hw *hw,
 			      struct ieee80211_sta *pubsta,
@@ -0,0 +1,380 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for RX fragment reassembly
+ */
+#include <kunit/test.h>
+#include "../ieee80211_i.h"
+#include "../sta_info.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+#define FRAG_TEST_MAX_FRAGS	6
+
+/* fragment payloads differ in length, so the layout can be checked */
+#define FRAG_TEST_LEN(frag)	(20 + 8 * (frag))
+
+struct frag_test_frame {
+	u16 seq;
+	u8 frag;
+	bool more;
+	ieee80211_rx_result result;
+};
+
+static const struct frag_reassemble_case {
+	const char *desc;
+	bool mgmt;
+	struct frag_test_frame frames[FRAG_TEST_MAX_FRAGS];
+	unsigned int n_frames;
+	/* fragments 0..n_frags-1 of seq make up the frame completed last */
+	u16 seq;
+	unsigned int n_frags;
+} frag_reassemble_cases[] = {
+	{
+		.desc = "in order",
+		.frames = {
+			{ .seq = 1, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 1, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 1, .frag = 2, .result = RX_CONTINUE },
+		},
+		.n_frames = 3,
+		.seq = 1,
+		.n_frags = 3,
+	},
+	{
+		.desc = "in order, two fragments",
+		.frames = {
+			{ .seq = 7, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 7, .frag = 1, .result = RX_CONTINUE },
+		},
+		.n_frames = 2,
+		.seq = 7,
+		.n_frags = 2,
+	},
+	{
+		.desc = "interleaved with another reassembly",
+		.frames = {
+			{ .seq = 2, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 1, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 2, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 1, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 2, .frag = 2, .result = RX_CONTINUE },
+			{ .seq = 1, .frag = 2, .result = RX_CONTINUE },
+		},
+		.n_frames = 6,
+		.seq = 1,
+		.n_frags = 3,
+	},
+	{
+		.desc = "out of order, retransmitted in order",
+		.frames = {
+			{ .seq = 3, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 3, .frag = 2, .more = true,
+			  .result = RX_DROP_MONITOR },
+			{ .seq = 3, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 3, .frag = 2, .more = true, .result = RX_QUEUED },
+			{ .seq = 3, .frag = 3, .result = RX_CONTINUE },
+		},
+		.n_frames = 5,
+		.seq = 3,
+		.n_frags = 4,
+	},
+	{
+		.desc = "out of order last fragment",
+		.frames = {
+			{ .seq = 4, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 4, .frag = 2, .result = RX_DROP_MONITOR },
+		},
+		.n_frames = 2,
+	},
+	{
+		.desc = "missing first fragment",
+		.frames = {
+			{ .seq = 5, .frag = 1, .more = true,
+			  .result = RX_DROP_MONITOR },
+			{ .seq = 5, .frag = 2, .result = RX_DROP_MONITOR },
+		},
+		.n_frames = 2,
+	},
+	{
+		.desc = "duplicate fragment",
+		.frames = {
+			{ .seq = 6, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 6, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 6, .frag = 1, .more = true,
+			  .result = RX_DROP_MONITOR },
+			{ .seq = 6, .frag = 2, .result = RX_CONTINUE },
+		},
+		.n_frames = 4,
+		.seq = 6,
+		.n_frags = 3,
+	},
+	{
+		.desc = "management frame is copied",
+		.mgmt = true,
+		.frames = {
+			{ .seq = 8, .frag = 0, .more = true, .result = RX_QUEUED },
+			{ .seq = 8, .frag = 1, .more = true, .result = RX_QUEUED },
+			{ .seq = 8, .frag = 2, .result = RX_CONTINUE },
+		},
+		.n_frames = 3,
+		.seq = 8,
+		.n_frags = 3,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(frag_reassemble, frag_reassemble_cases, desc);
+
+static u8 frag_test_payload(u16 seq, u8 frag, unsigned int i)
+{
+	return seq * 16 + frag + i;
+}
+
+static struct sk_buff *frag_test_skb(struct kunit *test, bool mgmt,
+				     const struct frag_test_frame *frame)
+{
+	struct ieee80211_hdr_3addr *hdr;
+	struct sk_buff *skb;
+	unsigned int i;
+	u16 fc;
+
+	skb = alloc_skb(sizeof(*hdr) + FRAG_TEST_LEN(frame->frag), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	fc = mgmt ? IEEE80211_FTYPE_MGMT | IEEE80211_STYPE_ACTION :
+		    IEEE80211_FTYPE_DATA | IEEE80211_STYPE_DATA;
+	if (frame->more)
+		fc |= IEEE80211_FCTL_MOREFRAGS;
+
+	hdr = skb_put_zero(skb, sizeof(*hdr));
+	hdr->frame_control = cpu_to_le16(fc);
+	memcpy(hdr->addr1, "\x02\x00\x00\x00\x00\x01", ETH_ALEN);
+	memcpy(hdr->addr2, "\x02\x00\x00\x00\x00\x02", ETH_ALEN);
+	hdr->seq_ctrl = cpu_to_le16(IEEE80211_SN_TO_SEQ(frame->seq) |
+				    frame->frag);
+
+	for (i = 0; i < FRAG_TEST_LEN(frame->frag); i++)
+		skb_put_u8(skb, frag_test_payload(frame->seq, frame->frag, i));
+
+	return skb;
+}
+
+static void frag_test_destroy_cache(void *cache)
+{
+	ieee80211_destroy_frag_cache(cache);
+}
+
+static struct ieee80211_rx_data *frag_test_rx(struct kunit *test)
+{
+	struct ieee80211_rx_data *rx;
+
+	rx = kunit_kzalloc(test, sizeof(*rx), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, rx);
+	rx->local = kunit_kzalloc(test, sizeof(*rx->local), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, rx->local);
+	rx->sdata = kunit_kzalloc(test, sizeof(*rx->sdata), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, rx->sdata);
+
+	ieee80211_init_frag_cache(&rx->sdata->frags);
+	KUNIT_ASSERT_EQ(test, 0,
+			kunit_add_action_or_reset(test, frag_test_destroy_cache,
+						  &rx->sdata->frags));
+
+	return rx;
+}
+
+static ieee80211_rx_result frag_test_rx_frame(struct kunit *test,
+					      struct ieee80211_rx_data *rx,
+					      bool mgmt,
+					      const struct frag_test_frame *frame)
+{
+	ieee80211_rx_result result;
+
+	rx->skb = frag_test_skb(test, mgmt, frame);
+	result = ieee80211_rx_h_defragment(rx);
+
+	/* the skb is only still ours if it wasn't queued for reassembly */
+	if (result != RX_QUEUED && result != RX_CONTINUE)
+		kfree_skb(rx->skb);
+
+	return result;
+}
+
+static void frag_reassemble(struct kunit *test)
+{
+	const struct frag_reassemble_case *params = test->param_value;
+	struct ieee80211_rx_data *rx = frag_test_rx(test);
+	unsigned int i, n_frag_list = 0, offs;
+	struct sk_buff *skb = NULL, *iter;
+	u8 frag;
+
+	for (i = 0; i < params->n_frames; i++) {
+		const struct frag_test_frame *frame = &params->frames[i];
+		ieee80211_rx_result result;
+
+		result = frag_test_rx_frame(test, rx, params->mgmt, frame);
+		KUNIT_EXPECT_EQ_MSG(test, result, frame->result,
+				    "seq %u frag %u", frame->seq, frame->frag);
+
+		if (result != RX_CONTINUE)
+			continue;
+
+		kfree_skb(skb);
+		skb = rx->skb;
+	}
+
+	if (!params->n_frags) {
+		KUNIT_EXPECT_NULL(test, skb);
+		return;
+	}
+
+	KUNIT_ASSERT_NOT_NULL(test, skb);
+
+	/* data fragments are chained, management frames copied */
+	skb_walk_frags(skb, iter) {
+		KUNIT_EXPECT_EQ(test, iter->len,
+				FRAG_TEST_LEN(n_frag_list + 1));
+		n_frag_list++;
+	}
+	KUNIT_EXPECT_EQ(test, n_frag_list,
+			params->mgmt ? 0 : params->n_frags - 1);
+	if (!params->mgmt)
+		KUNIT_EXPECT_EQ(test, skb_headlen(skb),
+				sizeof(struct ieee80211_hdr_3addr) +
+				FRAG_TEST_LEN(0));
+	else
+		KUNIT_EXPECT_EQ(test, skb_headlen(skb), skb->len);
+
+	offs = sizeof(struct ieee80211_hdr_3addr);
+	for (frag = 0; frag < params->n_frags; frag++) {
+		for (i = 0; i < FRAG_TEST_LEN(frag); i++) {
+			u8 byte;
+
+			KUNIT_ASSERT_EQ(test, 0,
+					skb_copy_bits(skb, offs++, &byte, 1));
+			KUNIT_EXPECT_EQ_MSG(test, byte,
+					    frag_test_payload(params->seq,
+							      frag, i),
+					    "frag %u byte %u", frag, i);
+		}
+	}
+	KUNIT_EXPECT_EQ(test, skb->len, offs);
+
+	kfree_skb(skb);
+}
+
+#define FRAG_TEST_EXPIRED	-1
+
+static const struct frag_cache_case {
+	const char *desc;
+	/* age of the pending reassemblies in ms, by sequence number */
+	int age[4];
+	/* leave one cache entry free */
+	bool free_entry;
+	/* sequence number whose reassembly is replaced, or -1 */
+	int replaced;
+	u32 evicted, expired;
+} frag_cache_cases[] = {
+	{
+		.desc = "evict the oldest reassembly",
+		.age = { 500, 1000, 500, 500 },
+		.replaced = 1,
+		.evicted = 1,
+	},
+	{
+		.desc = "reuse an expired reassembly first",
+		.age = { 500, 1000, FRAG_TEST_EXPIRED, 500 },
+		.replaced = 2,
+		.expired = 1,
+	},
+	{
+		.desc = "use a free entry first",
+		.age = { 500, 1000, 500, 500 },
+		.free_entry = true,
+		.replaced = -1,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(frag_cache, frag_cache_cases, desc);
+
+static void frag_cache(struct kunit *test)
+{
+	const struct frag_cache_case *params = test->param_value;
+	struct ieee80211_rx_data *rx = frag_test_rx(test);
+	struct ieee80211_fragment_cache *cache = &rx->sdata->frags;
+	unsigned int n_pending = IEEE80211_FRAGMENT_MAX;
+	struct frag_test_frame frame = {
+		.frag = 0,
+		.more = true,
+	};
+	u16 seq;
+	int i;
+
+	if (params->free_entry)
+		n_pending--;
+
+	/* start a reassembly for each sequence number */
+	for (seq = 0; seq < n_pending; seq++) {
+		frame.seq = seq;
+		KUNIT_ASSERT_EQ(test, RX_QUEUED,
+				frag_test_rx_frame(test, rx, false, &frame));
+	}
+
+	for (i = 0; i < IEEE80211_FRAGMENT_MAX; i++) {
+		struct ieee80211_fragment_entry *entry = &cache->entries[i];
+		int age;
+
+		if (skb_queue_empty(&entry->skb_list) ||
+		    entry->seq >= ARRAY_SIZE(params->age))
+			continue;
+
+		age = params->age[entry->seq];
+		if (age == FRAG_TEST_EXPIRED)
+			entry->first_frag_time =
+				jiffies - IEEE80211_FRAGMENT_TIMEOUT - 1;
+		else
+			entry->first_frag_time = jiffies -
+						 msecs_to_jiffies(age);
+	}
+
+	/* a new reassembly replaces at most one of them */
+	frame.seq = 100;
+	KUNIT_ASSERT_EQ(test, RX_QUEUED,
+			frag_test_rx_frame(test, rx, false, &frame));
+
+	KUNIT_EXPECT_EQ(test, cache->stats.evicted, params->evicted);
+	KUNIT_EXPECT_EQ(test, cache->stats.expired, params->expired);
+
+	/* and all the others can still complete */
+	frame.frag = 1;
+	frame.more = false;
+	for (seq = 0; seq < n_pending; seq++) {
+		ieee80211_rx_result result;
+
+		frame.seq = seq;
+		result = frag_test_rx_frame(test, rx, false, &frame);
+		KUNIT_EXPECT_EQ_MSG(test, result,
+				    seq == params->replaced ?
+					RX_DROP_MONITOR : RX_CONTINUE,
+				    "seq %u", seq);
+		if (result == RX_CONTINUE)
+			kfree_skb(rx->skb);
+	}
+
+	frame.seq = 100;
+	KUNIT_EXPECT_EQ(test, RX_CONTINUE,
+			frag_test_rx_frame(test, rx, false, &frame));
+	kfree_skb(rx->skb);
+}
+
+static struct kunit_case frag_test_cases[] = {
+	KUNIT_CASE_PARAM(frag_reassemble, frag_reassemble_gen_params),
+	KUNIT_CASE_PARAM(frag_cache, frag_cache_gen_params),
+	{}
+};
+
+static struct kunit_suite frag = {
+	.name = "mac80211-frag",
+	.test_cases = frag_test_cases,
+};
+
+kunit_test_suite(frag);
@@ -0,0 +1,228 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for IGMP/MLD snooping
+ */
+#include <kunit/test.h>
+#include <kunit/skbuff.h>
+#include <linux/igmp.h>
+#include <net/ipv6.h>
+#include <net/mld.h>
+#include "../ieee80211_i.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+#define MCAST_TEST_AID	5
+
+/* Ethernet header from a station, followed by IPv4 with router alert */
+#define MCAST_TEST_IPV4(_len, _a, _b, _c, _d)				\
+	0x01, 0x00, 0x5e, (_b) & 0x7f, _c, _d,				\
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x05, 0x08, 0x00,			\
+	0x46, 0xc0, 0x00, _len, 0x00, 0x00, 0x00, 0x00,			\
+	0x01, IPPROTO_IGMP, 0x00, 0x00, 10, 0, 0, 5,			\
+	_a, _b, _c, _d, 0x94, 0x04, 0x00, 0x00
+
+/* IGMPv2 report for 239.1.2.3 */
+static const u8 igmpv2_join[] = {
+	MCAST_TEST_IPV4(32, 239, 1, 2, 3),
+	IGMPV2_HOST_MEMBERSHIP_REPORT, 0x00, 0x00, 0x00, 239, 1, 2, 3,
+};
+
+/* IGMPv2 leave for 239.1.2.3, sent to all routers */
+static const u8 igmpv2_leave[] = {
+	MCAST_TEST_IPV4(32, 224, 0, 0, 2),
+	IGMP_HOST_LEAVE_MESSAGE, 0x00, 0x00, 0x00, 239, 1, 2, 3,
+};
+
+/* IGMPv2 report for mDNS, 224.0.0.251 */
+static const u8 igmpv2_mdns[] = {
+	MCAST_TEST_IPV4(32, 224, 0, 0, 251),
+	IGMPV2_HOST_MEMBERSHIP_REPORT, 0x00, 0x00, 0x00, 224, 0, 0, 251,
+};
+
+/* IGMPv3 report, sent to all IGMPv3 routers */
+static const u8 igmpv3_report[] = {
+	MCAST_TEST_IPV4(64, 224, 0, 0, 22),
+	IGMPV3_HOST_MEMBERSHIP_REPORT, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 3,
+	/* exclude nothing: join 239.1.1.1 */
+	IGMPV3_CHANGE_TO_EXCLUDE, 0, 0x00, 0,
+	239, 1, 1, 1,
+	/* join 239.1.2.3 with a source and aux data to skip over */
+	IGMPV3_ALLOW_NEW_SOURCES, 1, 0x00, 1,
+	239, 1, 2, 3,
+	10, 0, 0, 1,
+	0x00, 0x00, 0x00, 0x00,
+	/* include nothing: leave 239.1.2.3 again */
+	IGMPV3_CHANGE_TO_INCLUDE, 0, 0x00, 0,
+	239, 1, 2, 3,
+};
+
+/* plain UDP to 239.1.2.3 */
+static const u8 ipv4_udp[] = {
+	0x01, 0x00, 0x5e, 0x01, 0x02, 0x03,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x05, 0x08, 0x00,
+	0x45, 0x00, 0x00, 28, 0x00, 0x00, 0x00, 0x00,
+	0x01, IPPROTO_UDP, 0x00, 0x00, 10, 0, 0, 5,
+	239, 1, 2, 3,
+	0x13, 0x88, 0x13, 0x88, 0x00, 0x08, 0x00, 0x00,
+};
+
+/* MLDv2 report to ff02::16 behind a hop-by-hop router alert */
+static const u8 mldv2_report[] = {
+	0x33, 0x33, 0x00, 0x00, 0x00, 0x16,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x05, 0x86, 0xdd,
+	0x60, 0x00, 0x00, 0x00, 0x00, 36, NEXTHDR_HOP, 1,
+	0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05,
+	0xff, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x16,
+	IPPROTO_ICMPV6, 0, IPV6_TLV_ROUTERALERT, 2, 0x00, 0x00,
+	IPV6_TLV_PADN, 0,
+	ICMPV6_MLD2_REPORT, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 1,
+	/* exclude nothing: join ff05::1:3 */
+	MLD2_CHANGE_TO_EXCLUDE, 0, 0x00, 0,
+	0xff, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x03,
+};
+
+#define MCAST_TEST_FRAME(_frame) { .data = _frame, .len = sizeof(_frame) }
+
+static const struct mcast_test_case {
+	const char *desc;
+	struct {
+		const u8 *data;
+		size_t len;
+	} frames[3];
+	bool disabled;
+	struct {
+		u8 addr[ETH_ALEN];
+		bool member;
+	} groups[2];
+	u8 n_groups;
+} mcast_snoop_cases[] = {
+	{
+		.desc = "IGMPv2 join",
+		.frames = { MCAST_TEST_FRAME(igmpv2_join) },
+		.groups = {
+			{ { 0x01, 0x00, 0x5e, 0x01, 0x02, 0x03 }, true },
+		},
+		.n_groups = 1,
+	},
+	{
+		.desc = "IGMPv2 join and leave",
+		.frames = {
+			MCAST_TEST_FRAME(igmpv2_join),
+			MCAST_TEST_FRAME(igmpv2_leave),
+		},
+		/* the group stays known, so it no longer goes to anyone */
+		.groups = {
+			{ { 0x01, 0x00, 0x5e, 0x01, 0x02, 0x03 }, false },
+		},
+		.n_groups = 1,
+	},
+	{
+		.desc = "IGMPv2 link-local join",
+		.frames = { MCAST_TEST_FRAME(igmpv2_mdns) },
+		.groups = {
+			{ { 0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb }, false },
+		},
+	},
+	{
+		.desc = "IGMPv3 report",
+		.frames = { MCAST_TEST_FRAME(igmpv3_report) },
+		.groups = {
+			{ { 0x01, 0x00, 0x5e, 0x01, 0x01, 0x01 }, true },
+			{ { 0x01, 0x00, 0x5e, 0x01, 0x02, 0x03 }, false },
+		},
+		.n_groups = 2,
+	},
+	{
+		.desc = "IPv4 multicast data",
+		.frames = { MCAST_TEST_FRAME(ipv4_udp) },
+		.groups = {
+			{ { 0x01, 0x00, 0x5e, 0x01, 0x02, 0x03 }, false },
+		},
+	},
+	{
+		.desc = "MLDv2 report",
+		.frames = { MCAST_TEST_FRAME(mldv2_report) },
+		.groups = {
+			{ { 0x33, 0x33, 0x00, 0x01, 0x00, 0x03 }, true },
+		},
+		.n_groups = 1,
+	},
+	{
+		.desc = "snooping disabled",
+		.frames = { MCAST_TEST_FRAME(mldv2_report) },
+		.disabled = true,
+		.groups = {
+			{ { 0x33, 0x33, 0x00, 0x01, 0x00, 0x03 }, false },
+		},
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(mcast_snoop, mcast_snoop_cases, desc);
+
+static void mcast_test_flush(void *ap)
+{
+	ieee80211_mcast_snoop_flush(ap);
+}
+
+static void mcast_snoop(struct kunit *test)
+{
+	const struct mcast_test_case *params = test->param_value;
+	struct ieee80211_if_ap *ap;
+	int i;
+
+	ap = kunit_kzalloc(test, sizeof(*ap), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, ap);
+
+	ieee80211_mcast_snoop_init(ap);
+	ap->multicast_snooping = !params->disabled;
+	KUNIT_ASSERT_EQ(test, 0,
+			kunit_add_action_or_reset(test, mcast_test_flush, ap));
+
+	for (i = 0; i < ARRAY_SIZE(params->frames); i++) {
+		size_t len = params->frames[i].len;
+		struct sk_buff *skb;
+
+		if (!len)
+			break;
+
+		skb = kunit_zalloc_skb(test, len, GFP_KERNEL);
+		KUNIT_ASSERT_NOT_NULL(test, skb);
+
+		skb_put_data(skb, params->frames[i].data, len);
+		ieee80211_mcast_snoop_rx(ap, MCAST_TEST_AID, skb);
+	}
+
+	KUNIT_EXPECT_EQ(test, ap->mcast_num_groups, params->n_groups);
+
+	for (i = 0; i < ARRAY_SIZE(params->groups); i++) {
+		const u8 *addr = params->groups[i].addr;
+		struct ieee80211_mcast_group *group;
+		bool member;
+
+		if (is_zero_ether_addr(addr))
+			continue;
+
+		rcu_read_lock();
+		group = ieee80211_mcast_snoop_lookup(ap, addr);
+		member = group && test_bit(MCAST_TEST_AID, group->members);
+		rcu_read_unlock();
+
+		KUNIT_EXPECT_EQ(test, member, params->groups[i].member);
+	}
+}
+
+static struct kunit_case mcast_test_cases[] = {
+	KUNIT_CASE_PARAM(mcast_snoop, mcast_snoop_gen_params),
+	{}
+};
+
+static struct kunit_suite mcast = {
+	.name = "mac80211-mcast-snooping",
+	.test_cases = mcast_test_cases,
+};
+
+kunit_test_suite(mcast);
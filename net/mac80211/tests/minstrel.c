@@ -0,0 +1,297 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for the minstrel_ht per-station group state
+ */
+#include <kunit/test.h>
+#include <linux/random.h>
+#include "../ieee80211_i.h"
+#include "../rc80211_minstrel_ht.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+#define MINSTREL_TEST_UPDATES	100
+
+static const struct minstrel_groups_case {
+	const char *desc;
+	u16 flags;
+	u8 max_streams;
+	u8 max_bw;
+	u16 mask;
+	bool cck, ofdm;
+	bool ht, vht, he;
+	u8 n_groups;
+} minstrel_groups_cases[] = {
+	{
+		.desc = "no supported rates",
+	},
+	{
+		.desc = "legacy 2.4 GHz",
+		.cck = true,
+		.ofdm = true,
+		.n_groups = 2,
+	},
+	{
+		.desc = "HT 2x2 40 MHz",
+		.flags = IEEE80211_TX_RC_MCS,
+		.max_streams = 2,
+		.max_bw = 1,
+		.mask = 0xff,
+		.ofdm = true,
+		.ht = true,
+		/* 2 streams, 2 widths, 2 guard intervals */
+		.n_groups = 8 + 1,
+	},
+	{
+		.desc = "VHT 4x4 80 MHz",
+		.flags = IEEE80211_TX_RC_VHT_MCS,
+		.max_streams = 4,
+		.max_bw = 2,
+		.mask = 0x3ff,
+		.ofdm = true,
+		.ht = true,
+		.vht = true,
+		/* 4 streams, 3 widths, 2 guard intervals */
+		.n_groups = 24 + 1,
+	},
+	{
+		.desc = "EHT 4x4 320 MHz",
+		.flags = IEEE80211_TX_RC_EHT_MCS,
+		.max_streams = 4,
+		.max_bw = 4,
+		.mask = 0x3fff,
+		.ofdm = true,
+		.ht = true,
+		.vht = true,
+		.he = true,
+		/* 4 streams, 5 widths, 3 guard intervals */
+		.n_groups = 60 + 1,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(minstrel_groups, minstrel_groups_cases, desc);
+
+static void minstrel_test_free_groups(void *data)
+{
+	struct minstrel_ht_sta *mi = data;
+
+	kfree(rcu_dereference_protected(mi->groups, true));
+}
+
+static struct minstrel_ht_sta *minstrel_test_sta(struct kunit *test)
+{
+	struct minstrel_ht_groups *groups;
+	struct minstrel_ht_sta *mi;
+
+	mi = kunit_kzalloc(test, sizeof(*mi), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mi);
+
+	mi->sta = kunit_kzalloc(test, sizeof(*mi->sta), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mi->sta);
+
+	/* same as minstrel_ht_alloc_sta(), resized by update_groups */
+	groups = kzalloc(struct_size(groups, data,
+				     MINSTREL_LEGACY_GROUPS_NB + 1),
+			 GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, groups);
+	RCU_INIT_POINTER(mi->groups, groups);
+	mi->max_groups = MINSTREL_LEGACY_GROUPS_NB;
+
+	KUNIT_ASSERT_EQ(test, 0,
+			kunit_add_action_or_reset(test,
+						  minstrel_test_free_groups,
+						  mi));
+
+	return mi;
+}
+
+static void minstrel_test_fill_stats(struct minstrel_ht_sta *mi)
+{
+	int i, j;
+
+	for (i = 0; i < mi->n_groups; i++) {
+		int group = mi->group_list[i];
+		struct minstrel_mcs_group_data *mg;
+
+		mg = minstrel_ht_group(mi, group);
+		for (j = 0; j < MCS_GROUP_RATES; j++) {
+			struct minstrel_rate_stats *mrs = &mg->rates[j];
+
+			if (!(mi->supported[group] & BIT(j)))
+				continue;
+
+			mrs->attempts = get_random_u32_inclusive(1, 64);
+			mrs->success = get_random_u32_below(mrs->attempts + 1);
+		}
+	}
+}
+
+static void minstrel_groups(struct kunit *test)
+{
+	const struct minstrel_groups_case *params = test->param_value;
+	struct minstrel_ht_sta *mi = minstrel_test_sta(test);
+	struct minstrel_ht_groups *groups;
+	size_t size, dense_size;
+	struct minstrel_priv *mp;
+	u64 start, elapsed = 0;
+	int i, prev = -1;
+
+	mp = kunit_kzalloc(test, sizeof(*mp), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mp);
+	mp->hw = kunit_kzalloc(test, sizeof(*mp->hw), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mp->hw);
+#ifdef CPTCFG_MAC80211_DEBUGFS
+	mp->fixed_rate_idx = (u32)-1;
+#endif
+
+	mi->sta->deflink.ht_cap.ht_supported = params->ht;
+	mi->sta->deflink.vht_cap.vht_supported = params->vht;
+	mi->sta->deflink.he_cap.has_he = params->he;
+	mi->overhead = 100;
+	mi->overhead_rtscts = 300;
+	mi->overhead_legacy = 50;
+	mi->overhead_legacy_rtscts = 150;
+	mi->avg_ampdu_len = MINSTREL_FRAC(1, 1);
+
+	if (params->cck)
+		mi->supported[MINSTREL_CCK_GROUP] = 0xf;
+	if (params->ofdm)
+		mi->supported[MINSTREL_OFDM_GROUP] = 0xff;
+	for (i = 0; i < MINSTREL_GROUPS_NB; i++) {
+		const struct mcs_group *g = &minstrel_mcs_groups[i];
+
+		if (g->flags & params->flags && g->bw <= params->max_bw &&
+		    g->streams <= params->max_streams)
+			mi->supported[i] = params->mask;
+	}
+
+	KUNIT_ASSERT_EQ(test, minstrel_ht_update_groups(mi, GFP_KERNEL), 0);
+	KUNIT_EXPECT_EQ(test, mi->n_groups, params->n_groups);
+	KUNIT_EXPECT_EQ(test, mi->max_groups, params->n_groups);
+
+	/*
+	 * Supported groups are listed in ascending order and own a slot,
+	 * everything else shares slot 0.
+	 */
+	groups = rcu_dereference_protected(mi->groups, true);
+	for (i = 0; i < MINSTREL_GROUPS_NB; i++) {
+		u8 slot = groups->slot[i];
+
+		if (!mi->supported[i]) {
+			KUNIT_EXPECT_EQ(test, slot, 0);
+			continue;
+		}
+
+		KUNIT_ASSERT_GT(test, slot, 0);
+		KUNIT_ASSERT_LE(test, slot, mi->n_groups);
+		KUNIT_EXPECT_EQ(test, mi->group_list[slot - 1], i);
+		KUNIT_EXPECT_GT(test, i, prev);
+		prev = i;
+	}
+
+	for (i = 0; i < MINSTREL_TEST_UPDATES; i++) {
+		minstrel_test_fill_stats(mi);
+
+		start = ktime_get_ns();
+		minstrel_ht_update_stats(mp, mi);
+		elapsed += ktime_get_ns() - start;
+	}
+
+	/* compare with statistics for every group, as before */
+	size = sizeof(*mi) + struct_size(groups, data, mi->max_groups + 1);
+	dense_size = sizeof(*mi) + struct_size(groups, data, MINSTREL_GROUPS_NB);
+	kunit_info(test, "%u groups, %zu bytes per station (%zu with all groups), %llu ns per update\n",
+		   mi->n_groups, size, dense_size,
+		   div_u64(elapsed, MINSTREL_TEST_UPDATES));
+
+	if (!mi->n_groups)
+		return;
+
+	KUNIT_EXPECT_NE(test, mi->supported[MI_RATE_GROUP(mi->max_tp_rate[0])],
+			0);
+	KUNIT_EXPECT_NE(test, mi->supported[MI_RATE_GROUP(mi->max_prob_rate)],
+			0);
+}
+
+static const struct minstrel_resize_case {
+	const char *desc;
+	u8 before, after;
+	bool realloc;
+} minstrel_resize_cases[] = {
+	{
+		.desc = "grow",
+		.before = 4,
+		.after = 8,
+		.realloc = true,
+	},
+	{
+		.desc = "unchanged",
+		.before = 8,
+		.after = 8,
+	},
+	{
+		.desc = "shrink by less than half",
+		.before = 8,
+		.after = 5,
+	},
+	{
+		.desc = "shrink by more than half",
+		.before = 8,
+		.after = 3,
+		.realloc = true,
+	},
+	{
+		.desc = "drop all groups",
+		.before = 8,
+		.after = 0,
+		.realloc = true,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(minstrel_resize, minstrel_resize_cases, desc);
+
+static void minstrel_test_set_groups(struct minstrel_ht_sta *mi, int n)
+{
+	int i;
+
+	for (i = 0; i < MINSTREL_HT_GROUPS_NB; i++)
+		mi->supported[MINSTREL_HT_GROUP_0 + i] = i < n ? 0xff : 0;
+}
+
+static void minstrel_resize(struct kunit *test)
+{
+	const struct minstrel_resize_case *params = test->param_value;
+	struct minstrel_ht_sta *mi = minstrel_test_sta(test);
+	struct minstrel_ht_groups *groups;
+
+	minstrel_test_set_groups(mi, params->before);
+	KUNIT_ASSERT_EQ(test, minstrel_ht_update_groups(mi, GFP_KERNEL), 0);
+	KUNIT_ASSERT_EQ(test, mi->n_groups, params->before);
+
+	groups = rcu_access_pointer(mi->groups);
+	minstrel_test_set_groups(mi, params->after);
+	KUNIT_ASSERT_EQ(test, minstrel_ht_update_groups(mi, GFP_KERNEL), 0);
+	KUNIT_EXPECT_EQ(test, mi->n_groups, params->after);
+
+	if (params->realloc) {
+		KUNIT_EXPECT_PTR_NE(test, rcu_access_pointer(mi->groups),
+				    groups);
+		KUNIT_EXPECT_EQ(test, mi->max_groups, params->after);
+	} else {
+		KUNIT_EXPECT_PTR_EQ(test, rcu_access_pointer(mi->groups),
+				    groups);
+		KUNIT_EXPECT_EQ(test, mi->max_groups, params->before);
+	}
+}
+
+static struct kunit_case minstrel_test_cases[] = {
+	KUNIT_CASE_PARAM(minstrel_groups, minstrel_groups_gen_params),
+	KUNIT_CASE_PARAM(minstrel_resize, minstrel_resize_gen_params),
+	{}
+};
+
+static struct kunit_suite minstrel = {
+	.name = "mac80211-minstrel-ht",
+	.test_cases = minstrel_test_cases,
+};
+
+kunit_test_suite(minstrel);
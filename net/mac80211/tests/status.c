@@ -0,0 +1,130 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for batched tx status reporting
+ */
+#include <kunit/test.h>
+#include <kunit/skbuff.h>
+#include "../ieee80211_i.h"
+#include "../sta_info.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+#define STATUS_TEST_MAX_FRAMES	4
+
+static const struct status_batch_case {
+	const char *desc;
+	struct {
+		bool acked;
+		u8 tries;
+	} frames[STATUS_TEST_MAX_FRAMES];
+	u8 n_frames;
+	u32 retry_failed;
+	u32 retry_count;
+	u32 lost_packets;
+} status_batch_cases[] = {
+	{
+		.desc = "all acked",
+		.frames = { { true, 1 }, { true, 2 }, { true, 1 } },
+		.n_frames = 3,
+		.retry_count = 1,
+	},
+	{
+		.desc = "acked and failed",
+		.frames = { { true, 1 }, { false, 3 }, { true, 2 },
+			    { false, 1 } },
+		.n_frames = 4,
+		.retry_failed = 2,
+		.retry_count = 3,
+		/* the ACK in between resets the lost packet count */
+		.lost_packets = 1,
+	},
+	{
+		.desc = "all failed",
+		.frames = { { false, 2 }, { false, 2 }, { false, 2 } },
+		.n_frames = 3,
+		.retry_failed = 3,
+		.retry_count = 3,
+		.lost_packets = 3,
+	},
+};
+
+KUNIT_ARRAY_PARAM_DESC(status_batch, status_batch_cases, desc);
+
+static void status_batch(struct kunit *test)
+{
+	const struct status_batch_case *params = test->param_value;
+	struct ieee80211_sub_if_data *sdata;
+	struct ieee80211_tx_status status = {};
+	struct ieee80211_local *local;
+	struct sk_buff *skb, *tmp;
+	struct sk_buff_head skbs;
+	struct sta_info *sta;
+	LIST_HEAD(free_list);
+	int i;
+
+	local = kunit_kzalloc(test, sizeof(*local), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, local);
+	local->hw.max_report_rates = IEEE80211_TX_MAX_RATES;
+	ieee80211_hw_set(&local->hw, REPORTS_TX_ACK_STATUS);
+
+	sdata = kunit_kzalloc(test, sizeof(*sdata), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sdata);
+	sdata->vif.type = NL80211_IFTYPE_AP;
+
+	sta = kunit_kzalloc(test, sizeof(*sta), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, sta);
+	sta->local = local;
+	sta->sdata = sdata;
+
+	__skb_queue_head_init(&skbs);
+
+	for (i = 0; i < params->n_frames; i++) {
+		struct ieee80211_tx_info *info;
+
+		skb = kunit_zalloc_skb(test, 24, GFP_KERNEL);
+		KUNIT_ASSERT_NOT_NULL(test, skb);
+		skb_put_zero(skb, 24);
+
+		/* skip the 802.11 frame handling, only the counters matter */
+		info = IEEE80211_SKB_CB(skb);
+		info->flags = IEEE80211_TX_CTL_HW_80211_ENCAP;
+		if (params->frames[i].acked)
+			info->flags |= IEEE80211_TX_STAT_ACK;
+		info->status.rates[0].idx = 0;
+		info->status.rates[0].count = params->frames[i].tries;
+		info->status.rates[1].idx = -1;
+
+		__skb_queue_tail(&skbs, skb);
+	}
+
+	status.sta = &sta->sta;
+	status.info = IEEE80211_SKB_CB(skb_peek(&skbs));
+	status.free_list = &free_list;
+
+	ieee80211_tx_status_batch(&local->hw, &status, 0, 0, &skbs);
+
+	KUNIT_EXPECT_TRUE(test, skb_queue_empty(&skbs));
+	KUNIT_EXPECT_EQ(test, list_count_nodes(&free_list), params->n_frames);
+	KUNIT_EXPECT_EQ(test, sta->deflink.status_stats.retry_failed,
+			params->retry_failed);
+	KUNIT_EXPECT_EQ(test, sta->deflink.status_stats.retry_count,
+			params->retry_count);
+	KUNIT_EXPECT_EQ(test, sta->deflink.status_stats.lost_packets,
+			params->lost_packets);
+
+	/* the skbs are freed by KUnit */
+	list_for_each_entry_safe(skb, tmp, &free_list, list)
+		skb_list_del_init(skb);
+}
+
+static struct kunit_case status_test_cases[] = {
+	KUNIT_CASE_PARAM(status_batch, status_batch_gen_params),
+	{}
+};
+
+static struct kunit_suite status = {
+	.name = "mac80211-tx-status",
+	.test_cases = status_test_cases,
+};
+
+kunit_test_suite(status);
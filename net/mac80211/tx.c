@@ -339,13 +339,18 @@ ieee80211_tx_h_check_assoc(struct ieee80211_tx_data *tx)
 /* This function is called whenever the AP is about to exceed the maximum limit
  * of buffered frames for power saving STAs. This situation should not really
  * happen often during normal operation, so dropping the oldest buffered packet
- * from each queue should be OK to make some room for new frames. */
+ * from each multicast queue and from the stations whose frames are closest to
+ * expiring should be OK to make some room for new frames. */
 static void purge_old_ps_buffers(struct ieee80211_local *local)
 {
-	int total = 0, purged = 0;
+	struct sk_buff_head purged;
 	struct sk_buff *skb;
 	struct ieee80211_sub_if_data *sdata;
 	struct sta_info *sta;
+	unsigned int i, slot;
+	bool sta_purged = false;
+
+	__skb_queue_head_init(&purged);
 
 	list_for_each_entry_rcu(sdata, &local->interfaces, list) {
 		struct ps_data *ps;
@@ -359,32 +364,43 @@ static void purge_old_ps_buffers(struct ieee80211_local *local)
 
 		skb = skb_dequeue(&ps->bc_buf);
 		if (skb) {
-			purged++;
-			ieee80211_free_txskb(&local->hw, skb);
+			atomic_dec(&local->total_ps_buffered);
+			__skb_queue_tail(&purged, skb);
 		}
-		total += skb_queue_len(&ps->bc_buf);
 	}
 
 	/*
-	 * Drop one frame from each station from the lowest-priority
-	 * AC that has frames at all.
+	 * Drop one frame from each station in the first wheel slot that
+	 * has any, from the lowest-priority AC that has frames at all.
+	 * That way we don't have to walk all stations here.
 	 */
-	list_for_each_entry_rcu(sta, &local->sta_list, list) {
-		int ac;
+	spin_lock_bh(&local->ps_wheel_lock);
+	slot = local->ps_wheel_time / STA_PS_WHEEL_TICK;
+	for (i = 0; i < STA_PS_WHEEL_SLOTS && !sta_purged; i++) {
+		struct list_head *head;
+
+		head = &local->ps_wheel[(slot + i) % STA_PS_WHEEL_SLOTS];
+		list_for_each_entry(sta, head, ps_wheel_list) {
+			int ac;
+
+			for (ac = IEEE80211_AC_BK; ac >= IEEE80211_AC_VO;
+			     ac--) {
+				skb = skb_dequeue(&sta->ps_tx_buf[ac]);
+				if (!skb)
+					continue;
 
-		for (ac = IEEE80211_AC_BK; ac >= IEEE80211_AC_VO; ac--) {
-			skb = skb_dequeue(&sta->ps_tx_buf[ac]);
-			total += skb_queue_len(&sta->ps_tx_buf[ac]);
-			if (skb) {
-				purged++;
-				ieee80211_free_txskb(&local->hw, skb);
+				atomic_dec(&local->total_ps_buffered);
+				__skb_queue_tail(&purged, skb);
+				sta_purged = true;
 				break;
 			}
 		}
 	}
+	spin_unlock_bh(&local->ps_wheel_lock);
 
-	local->total_ps_buffered = total;
-	ps_dbg_hw(&local->hw, "PS buffers full - purged %d frames\n", purged);
+	ps_dbg_hw(&local->hw, "PS buffers full - purged %d frames\n",
+		  skb_queue_len(&purged));
+	ieee80211_purge_tx_queue(&local->hw, &purged);
 }
 
 static ieee80211_tx_result
@@ -437,7 +453,7 @@ ieee80211_tx_h_multicast_ps_buf(struct ieee80211_tx_data *tx)
 		return TX_CONTINUE;
 
 	/* buffered in mac80211 */
-	if (tx->local->total_ps_buffered >= TOTAL_MAX_TX_BUFFER)
+	if (atomic_read(&tx->local->total_ps_buffered) >= TOTAL_MAX_TX_BUFFER)
 		purge_old_ps_buffers(tx->local);
 
 	if (skb_queue_len(&ps->bc_buf) >= AP_MAX_BC_BUFFER) {
@@ -445,7 +461,7 @@ ieee80211_tx_h_multicast_ps_buf(struct ieee80211_tx_data *tx)
 		       "BC TX buffer full - dropping the oldest frame\n");
 		ieee80211_free_txskb(&tx->local->hw, skb_dequeue(&ps->bc_buf));
 	} else
-		tx->local->total_ps_buffered++;
+		atomic_inc(&tx->local->total_ps_buffered);
 
 	skb_queue_tail(&ps->bc_buf, tx->skb);
 
@@ -492,7 +508,8 @@ ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 
 		ps_dbg(sta->sdata, "STA %pM aid %d: PS buffer for AC %d\n",
 		       sta->sta.addr, sta->sta.aid, ac);
-		if (tx->local->total_ps_buffered >= TOTAL_MAX_TX_BUFFER)
+		if (atomic_read(&local->total_ps_buffered) >=
+		    TOTAL_MAX_TX_BUFFER)
 			purge_old_ps_buffers(tx->local);
 
 		/* sync with ieee80211_sta_ps_deliver_wakeup */
@@ -516,7 +533,7 @@ ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 			       sta->sta.addr, ac);
 			ieee80211_free_txskb(&local->hw, old);
 		} else
-			tx->local->total_ps_buffered++;
+			atomic_inc(&tx->local->total_ps_buffered);
 
 		info->control.jiffies = jiffies;
 		info->control.vif = &tx->sdata->vif;
@@ -525,10 +542,7 @@ ieee80211_tx_h_unicast_ps_buf(struct ieee80211_tx_data *tx)
 		skb_queue_tail(&sta->ps_tx_buf[ac], tx->skb);
 		spin_unlock(&sta->ps_lock);
 
-		if (!timer_pending(&local->sta_cleanup))
-			mod_timer(&local->sta_cleanup,
-				  round_jiffies(jiffies +
-						STA_INFO_CLEANUP_INTERVAL));
+		sta_info_ps_buffered(sta);
 
 		/*
 		 * We queued up some frames, so the TIM bit might
@@ -1672,7 +1686,7 @@ static bool ieee80211_tx_frags(struct ieee80211_local *local,
 {
 	struct ieee80211_tx_control control = {};
 	struct sk_buff *skb, *tmp;
-	unsigned long flags;
+	unsigned long flags, stopped;
 
 	skb_queue_walk_safe(skbs, skb, tmp) {
 		struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
@@ -1686,12 +1700,13 @@ static bool ieee80211_tx_frags(struct ieee80211_local *local,
 		}
 #endif
 
-		spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
-		if (local->queue_stop_reasons[q] ||
+		spin_lock_irqsave(&local->pending[q].lock, flags);
+		stopped = READ_ONCE(local->queue_stop_reasons[q]);
+		if (stopped ||
 		    (!txpending && !skb_queue_empty(&local->pending[q]))) {
 			if (unlikely(info->flags &
 				     IEEE80211_TX_INTFL_OFFCHAN_TX_OK)) {
-				if (local->queue_stop_reasons[q] &
+				if (stopped &
 				    ~BIT(IEEE80211_QUEUE_STOP_REASON_OFFCHANNEL)) {
 					/*
 					 * Drop off-channel frames if queues
@@ -1700,7 +1715,7 @@ static bool ieee80211_tx_frags(struct ieee80211_local *local,
 					 * queue them.
 					 */
 					spin_unlock_irqrestore(
-						&local->queue_stop_reason_lock,
+						&local->pending[q].lock,
 						flags);
 					ieee80211_purge_tx_queue(&local->hw,
 								 skbs);
@@ -1720,12 +1735,13 @@ static bool ieee80211_tx_frags(struct ieee80211_local *local,
 					skb_queue_splice_tail_init(skbs,
 								   &local->pending[q]);
 
-				spin_unlock_irqrestore(&local->queue_stop_reason_lock,
+				spin_unlock_irqrestore(&local->pending[q].lock,
 						       flags);
+				ieee80211_kick_pending(local, q);
 				return false;
 			}
 		}
-		spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
+		spin_unlock_irqrestore(&local->pending[q].lock, flags);
 
 		info->control.vif = vif;
 		control.sta = sta ? &sta->sta : NULL;
@@ -3831,8 +3847,6 @@ struct sk_buff *ieee80211_tx_dequeue(struct ieee80211_hw *hw,
 	ieee80211_tx_result r;
 	struct ieee80211_vif *vif = txq->vif;
 	int q = vif->hw_queue[txq->ac];
-	unsigned long flags;
-	bool q_stopped;
 
 	WARN_ON_ONCE(softirq_count() == 0);
 
@@ -3840,11 +3854,7 @@ struct sk_buff *ieee80211_tx_dequeue(struct ieee80211_hw *hw,
 		return NULL;
 
 begin:
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
-	q_stopped = local->queue_stop_reasons[q];
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
-
-	if (unlikely(q_stopped)) {
+	if (unlikely(READ_ONCE(local->queue_stop_reasons[q]))) {
 		/* mark for waking later */
 		set_bit(IEEE80211_TXQ_DIRTY, &txqi->flags);
 		return NULL;
@@ -4420,6 +4430,49 @@ static bool ieee80211_multicast_to_unicast(struct sk_buff *skb,
 	return true;
 }
 
+/*
+ * Make a version of the frame whose linear part is only the Ethernet header,
+ * with the payload referenced from the original's page fragments, so that
+ * giving each clone of it a private header doesn't copy the payload along.
+ * Only done when the device takes paged frames anyway, otherwise they would
+ * just be linearized again later.
+ */
+static struct sk_buff *
+ieee80211_unicast_payload_ref(struct ieee80211_sub_if_data *sdata,
+			      struct sk_buff *skb)
+{
+	struct sk_buff *ref;
+
+	if (!(ieee80211_sdata_netdev_features(sdata) & NETIF_F_SG))
+		return NULL;
+
+	/* skb_zerocopy() would copy the payload anyway */
+	if (skb_zerocopy_headlen(skb) || skb_is_gso(skb) ||
+	    skb->ip_summed == CHECKSUM_PARTIAL)
+		return NULL;
+
+	ref = alloc_skb(skb_headroom(skb) + ETH_HLEN, GFP_ATOMIC);
+	if (!ref)
+		return NULL;
+
+	skb_reserve(ref, skb_headroom(skb));
+	if (skb_zerocopy(ref, skb, skb->len, 0) ||
+	    !pskb_may_pull(ref, ETH_HLEN)) {
+		kfree_skb(ref);
+		return NULL;
+	}
+
+	ref->dev = skb->dev;
+	ref->protocol = skb->protocol;
+	ref->priority = skb->priority;
+	ref->mark = skb->mark;
+	ref->ip_summed = skb->ip_summed;
+	skb_set_queue_mapping(ref, skb_get_queue_mapping(skb));
+	skb_reset_mac_header(ref);
+
+	return ref;
+}
+
 static void
 ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 			     struct sk_buff_head *queue)
@@ -4428,10 +4481,13 @@ ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 	struct ieee80211_local *local = sdata->local;
 	const struct ethhdr *eth = (struct ethhdr *)skb->data;
 	struct sta_info *sta, *first = NULL;
-	struct sk_buff *cloned_skb;
+	struct sk_buff *ref = NULL, *cloned_skb;
+	struct ieee80211_mcast_group *group;
 
 	rcu_read_lock();
 
+	group = ieee80211_mcast_snoop_lookup(sdata->bss, eth->h_dest);
+
 	list_for_each_entry_rcu(sta, &local->sta_list, list) {
 		if (sdata != sta->sdata)
 			/* AP-VLAN mismatch */
@@ -4439,20 +4495,33 @@ ieee80211_convert_to_unicast(struct sk_buff *skb, struct net_device *dev,
 		if (unlikely(ether_addr_equal(eth->h_source, sta->sta.addr)))
 			/* do not send back to source */
 			continue;
+		if (group && !test_bit(sta->sta.aid, group->members))
+			/* didn't join the group */
+			continue;
 		if (!first) {
 			first = sta;
 			continue;
 		}
-		cloned_skb = skb_clone(skb, GFP_ATOMIC);
-		if (!cloned_skb)
-			goto multicast;
-		if (unlikely(ieee80211_change_da(cloned_skb, sta))) {
-			dev_kfree_skb(cloned_skb);
-			goto multicast;
+		/*
+		 * Clones for the other stations only need their own header,
+		 * so share the payload if there's more than one of them.
+		 */
+		if (!ref)
+			ref = ieee80211_unicast_payload_ref(sdata, skb) ?: skb;
+		cloned_skb = skb_clone(ref, GFP_ATOMIC);
+		if (unlikely(!cloned_skb ||
+			     ieee80211_change_da(cloned_skb, sta))) {
+			/* just this station misses out on the frame */
+			sta->deflink.tx_stats.mcast_to_ucast_dropped++;
+			kfree_skb(cloned_skb);
+			continue;
 		}
 		__skb_queue_tail(queue, cloned_skb);
 	}
 
+	if (ref && ref != skb)
+		consume_skb(ref);
+
 	if (likely(first)) {
 		if (unlikely(ieee80211_change_da(skb, first)))
 			goto multicast;
@@ -4568,21 +4637,22 @@ static bool __ieee80211_tx_8023(struct ieee80211_sub_if_data *sdata,
 	unsigned long flags;
 	int q = info->hw_queue;
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
+	spin_lock_irqsave(&local->pending[q].lock, flags);
 
-	if (local->queue_stop_reasons[q] ||
+	if (READ_ONCE(local->queue_stop_reasons[q]) ||
 	    (!txpending && !skb_queue_empty(&local->pending[q]))) {
 		if (txpending)
-			skb_queue_head(&local->pending[q], skb);
+			__skb_queue_head(&local->pending[q], skb);
 		else
-			skb_queue_tail(&local->pending[q], skb);
+			__skb_queue_tail(&local->pending[q], skb);
 
-		spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
+		spin_unlock_irqrestore(&local->pending[q].lock, flags);
+		ieee80211_kick_pending(local, q);
 
 		return false;
 	}
 
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
+	spin_unlock_irqrestore(&local->pending[q].lock, flags);
 
 	if (sta && sta->uploaded)
 		pubsta = &sta->sta;
@@ -4862,24 +4932,20 @@ void ieee80211_tx_pending(struct tasklet_struct *t)
 {
 	struct ieee80211_local *local = from_tasklet(local, t,
 						     tx_pending_tasklet);
-	unsigned long flags;
+	struct sk_buff *skb;
 	int i;
-	bool txok;
 
 	rcu_read_lock();
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
 	for (i = 0; i < local->hw.queues; i++) {
 		/*
-		 * If queue is stopped by something other than due to pending
-		 * frames, or we have no pending frames, proceed to next queue.
+		 * If the queue is stopped, the frames stay until it's woken,
+		 * which will schedule us again.
 		 */
-		if (local->queue_stop_reasons[i] ||
-		    skb_queue_empty(&local->pending[i]))
+		if (READ_ONCE(local->queue_stop_reasons[i]))
 			continue;
 
-		while (!skb_queue_empty(&local->pending[i])) {
-			struct sk_buff *skb = __skb_dequeue(&local->pending[i]);
+		while ((skb = skb_dequeue(&local->pending[i]))) {
 			struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 
 			if (WARN_ON(!info->control.vif)) {
@@ -4887,17 +4953,10 @@ void ieee80211_tx_pending(struct tasklet_struct *t)
 				continue;
 			}
 
-			spin_unlock_irqrestore(&local->queue_stop_reason_lock,
-						flags);
-
-			txok = ieee80211_tx_pending_skb(local, skb);
-			spin_lock_irqsave(&local->queue_stop_reason_lock,
-					  flags);
-			if (!txok)
+			if (!ieee80211_tx_pending_skb(local, skb))
 				break;
 		}
 	}
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
 
 	rcu_read_unlock();
 }
@@ -4911,16 +4970,13 @@ static void __ieee80211_beacon_add_tim(struct ieee80211_sub_if_data *sdata,
 {
 	u8 *pos, *tim;
 	int aid0 = 0;
-	int i, have_bits = 0, n1, n2;
+	int have_bits = 0, n1, n2;
 	struct ieee80211_bss_conf *link_conf = link->conf;
 
 	/* Generate bitmap for TIM only if there are any STAs in power save
 	 * mode. */
 	if (atomic_read(&ps->num_sta_ps) > 0)
-		/* in the hope that this is faster than
-		 * checking byte-for-byte */
-		have_bits = !bitmap_empty((unsigned long *)ps->tim,
-					  IEEE80211_MAX_AID+1);
+		have_bits = ps->tim_bits;
 	if (!is_template) {
 		if (ps->dtim_count == 0)
 			ps->dtim_count = link_conf->dtim_period - 1;
@@ -4942,21 +4998,10 @@ static void __ieee80211_beacon_add_tim(struct ieee80211_sub_if_data *sdata,
 	if (have_bits) {
 		/* Find largest even number N1 so that bits numbered 1 through
 		 * (N1 x 8) - 1 in the bitmap are 0 and number N2 so that bits
-		 * (N2 + 1) x 8 through 2007 are 0. */
-		n1 = 0;
-		for (i = 0; i < IEEE80211_MAX_TIM_LEN; i++) {
-			if (ps->tim[i]) {
-				n1 = i & 0xfe;
-				break;
-			}
-		}
-		n2 = n1;
-		for (i = IEEE80211_MAX_TIM_LEN - 1; i >= n1; i--) {
-			if (ps->tim[i]) {
-				n2 = i;
-				break;
-			}
-		}
+		 * (N2 + 1) x 8 through 2007 are 0. The first and last non-zero
+		 * bytes are tracked as bits are set and cleared. */
+		n1 = ps->tim_first & 0xfe;
+		n2 = ps->tim_last;
 
 		/* Bitmap control */
 		*pos++ = n1 | aid0;
@@ -5269,25 +5314,8 @@ ieee80211_beacon_add_mbssid(struct sk_buff *skb, struct beacon_data *beacon,
 	    i > beacon->mbssid_ies->cnt)
 		return;
 
-	if (i < beacon->mbssid_ies->cnt) {
-		skb_put_data(skb, beacon->mbssid_ies->elem[i].data,
-			     beacon->mbssid_ies->elem[i].len);
-
-		if (beacon->rnr_ies && beacon->rnr_ies->cnt) {
-			skb_put_data(skb, beacon->rnr_ies->elem[i].data,
-				     beacon->rnr_ies->elem[i].len);
-
-			for (i = beacon->mbssid_ies->cnt; i < beacon->rnr_ies->cnt; i++)
-				skb_put_data(skb, beacon->rnr_ies->elem[i].data,
-					     beacon->rnr_ies->elem[i].len);
-		}
-		return;
-	}
-
-	/* i == beacon->mbssid_ies->cnt, include all MBSSID elements */
-	for (i = 0; i < beacon->mbssid_ies->cnt; i++)
-		skb_put_data(skb, beacon->mbssid_ies->elem[i].data,
-			     beacon->mbssid_ies->elem[i].len);
+	skb_put_data(skb, beacon->mbssid_data[i].data,
+		     beacon->mbssid_data[i].len);
 }
 
 static struct sk_buff *
@@ -5438,6 +5466,9 @@ __ieee80211_beacon_get(struct ieee80211_hw *hw,
 								 beacon,
 								 chanctx_conf);
 		} else {
+			u64 start = ktime_get_ns();
+			u32 elapsed;
+
 			if (beacon->mbssid_ies && beacon->mbssid_ies->cnt) {
 				if (ema_index >= beacon->mbssid_ies->cnt)
 					goto out; /* End of MBSSID elements */
@@ -5452,6 +5483,11 @@ __ieee80211_beacon_get(struct ieee80211_hw *hw,
 						      is_template, beacon,
 						      chanctx_conf,
 						      ema_index);
+
+			elapsed = ktime_get_ns() - start;
+			sdata->u.ap.beacon_gen_ns = elapsed;
+			if (elapsed > sdata->u.ap.beacon_gen_max_ns)
+				sdata->u.ap.beacon_gen_max_ns = elapsed;
 		}
 	} else if (sdata->vif.type == NL80211_IFTYPE_ADHOC) {
 		struct ieee80211_if_ibss *ifibss = &sdata->u.ibss;
@@ -5923,7 +5959,7 @@ ieee80211_get_buffered_bc(struct ieee80211_hw *hw,
 		skb = skb_dequeue(&ps->bc_buf);
 		if (!skb)
 			goto out;
-		local->total_ps_buffered--;
+		atomic_dec(&local->total_ps_buffered);
 
 		if (!skb_queue_empty(&ps->bc_buf) && skb->len >= 2) {
 			struct ieee80211_hdr *hdr =
@@ -454,13 +454,15 @@ static void __ieee80211_wake_queue(struct ieee80211_hw *hw, int queue,
 	}
 
 	if (local->q_stop_reasons[queue][reason] == 0)
-		__clear_bit(reason, &local->queue_stop_reasons[queue]);
+		clear_bit(reason, &local->queue_stop_reasons[queue]);
 
 	if (local->queue_stop_reasons[queue] != 0)
 		/* someone still has this queue stopped */
 		return;
 
-	if (!skb_queue_empty(&local->pending[queue]))
+	/* pairs with the barrier in ieee80211_kick_pending() */
+	smp_mb();
+	if (!skb_queue_empty_lockless(&local->pending[queue]))
 		tasklet_schedule(&local->tx_pending_tasklet);
 
 	/*
@@ -535,11 +537,23 @@ void ieee80211_stop_queue(struct ieee80211_hw *hw, int queue)
 }
 EXPORT_SYMBOL(ieee80211_stop_queue);
 
+/*
+ * Called after frames were added to a pending queue. If the queue is
+ * running (or was woken while we were adding), the wake path may not
+ * have seen the frames yet, so make sure the tasklet runs. The barrier
+ * pairs with the one in __ieee80211_wake_queue(): either the waker sees
+ * the new frames or we see the cleared stop reasons.
+ */
+void ieee80211_kick_pending(struct ieee80211_local *local, int queue)
+{
+	smp_mb();
+	if (!READ_ONCE(local->queue_stop_reasons[queue]))
+		tasklet_schedule(&local->tx_pending_tasklet);
+}
+
 void ieee80211_add_pending_skb(struct ieee80211_local *local,
 			       struct sk_buff *skb)
 {
-	struct ieee80211_hw *hw = &local->hw;
-	unsigned long flags;
 	struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 	int queue = info->hw_queue;
 
@@ -548,46 +562,47 @@ void ieee80211_add_pending_skb(struct ieee80211_local *local,
 		return;
 	}
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
-	__ieee80211_stop_queue(hw, queue, IEEE80211_QUEUE_STOP_REASON_SKB_ADD,
-			       false);
-	__skb_queue_tail(&local->pending[queue], skb);
-	__ieee80211_wake_queue(hw, queue, IEEE80211_QUEUE_STOP_REASON_SKB_ADD,
-			       false, &flags);
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
+	skb_queue_tail(&local->pending[queue], skb);
+	ieee80211_kick_pending(local, queue);
 }
 
 void ieee80211_add_pending_skbs(struct ieee80211_local *local,
 				struct sk_buff_head *skbs)
 {
-	struct ieee80211_hw *hw = &local->hw;
-	struct sk_buff *skb;
+	struct sk_buff_head frames;
+	struct sk_buff *skb, *tmp;
+	unsigned long queues = 0;
 	unsigned long flags;
-	int queue, i;
+	int queue;
+
+	__skb_queue_head_init(&frames);
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
 	while ((skb = skb_dequeue(skbs))) {
 		struct ieee80211_tx_info *info = IEEE80211_SKB_CB(skb);
 
-		if (WARN_ON(!info->control.vif)) {
+		if (WARN_ON(!info->control.vif) ||
+		    info->hw_queue >= local->hw.queues) {
 			ieee80211_free_txskb(&local->hw, skb);
 			continue;
 		}
 
-		queue = info->hw_queue;
+		__skb_queue_tail(&frames, skb);
+		queues |= BIT(info->hw_queue);
+	}
 
-		__ieee80211_stop_queue(hw, queue,
-				IEEE80211_QUEUE_STOP_REASON_SKB_ADD,
-				false);
+	/* move each queue's frames at once so new frames can't interleave */
+	for_each_set_bit(queue, &queues, local->hw.queues) {
+		spin_lock_irqsave(&local->pending[queue].lock, flags);
+		skb_queue_walk_safe(&frames, skb, tmp) {
+			if (IEEE80211_SKB_CB(skb)->hw_queue != queue)
+				continue;
+			__skb_unlink(skb, &frames);
+			__skb_queue_tail(&local->pending[queue], skb);
+		}
+		spin_unlock_irqrestore(&local->pending[queue].lock, flags);
 
-		__skb_queue_tail(&local->pending[queue], skb);
+		ieee80211_kick_pending(local, queue);
 	}
-
-	for (i = 0; i < hw->queues; i++)
-		__ieee80211_wake_queue(hw, i,
-			IEEE80211_QUEUE_STOP_REASON_SKB_ADD,
-			false, &flags);
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
 }
 
 void ieee80211_stop_queues_by_reason(struct ieee80211_hw *hw,
@@ -618,17 +633,12 @@ EXPORT_SYMBOL(ieee80211_stop_queues);
 int ieee80211_queue_stopped(struct ieee80211_hw *hw, int queue)
 {
 	struct ieee80211_local *local = hw_to_local(hw);
-	unsigned long flags;
-	int ret;
 
 	if (WARN_ON(queue >= hw->queues))
 		return true;
 
-	spin_lock_irqsave(&local->queue_stop_reason_lock, flags);
-	ret = test_bit(IEEE80211_QUEUE_STOP_REASON_DRIVER,
-		       &local->queue_stop_reasons[queue]);
-	spin_unlock_irqrestore(&local->queue_stop_reason_lock, flags);
-	return ret;
+	return test_bit(IEEE80211_QUEUE_STOP_REASON_DRIVER,
+			&local->queue_stop_reasons[queue]);
 }
 EXPORT_SYMBOL(ieee80211_queue_stopped);
 